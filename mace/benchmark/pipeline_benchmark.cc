@@ -0,0 +1,263 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Usage:
+ * pipeline_benchmark --model_file=mobi_mace.pb \
+ *          --model_data_file=mobi_mace.data \
+ *          --input_node=input --input_shape=1,224,224,3 \
+ *          --output_node=output --output_shape=1,1001 \
+ *          --pipeline_cpus="0,1;2,3" --num_frames=200
+ *
+ * Streams num_frames frames through MaceEngine::RunAsync on the CPU, with
+ * up to max_in_flight of them submitted and not completed, once on an
+ * engine running the whole model on omp_num_threads threads and once on
+ * an engine running it as a pipeline, a stage per group of pipeline_cpus.
+ * Reports the frames per second of both and the utilization of each
+ * stage, i.e. the share of the time the stage spends running frames.
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <future>  // NOLINT(build/c++11)
+#include <map>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "mace/benchmark/statistics.h"
+#include "mace/proto/mace.pb.h"
+#include "mace/public/mace.h"
+#include "mace/utils/env_time.h"
+#include "mace/utils/logging.h"
+#include "mace/utils/string_util.h"
+#include "mace/utils/utils.h"
+
+DEFINE_string(model_file, "", "model graph pb file path");
+DEFINE_string(model_data_file, "", "model data file path");
+DEFINE_string(input_node, "input_node0", "input nodes, separated by comma");
+DEFINE_string(output_node, "output_node0",
+              "output nodes, separated by comma");
+DEFINE_string(input_shape, "", "input shapes, separated by colon and comma");
+DEFINE_string(output_shape, "",
+              "output shapes, separated by colon and comma");
+DEFINE_int32(omp_num_threads, -1,
+             "num of threads of the engine without pipeline");
+DEFINE_string(pipeline_cpus, "0;1",
+              "cores of the pipeline stages, the stages separated by"
+              " semicolon and their cores by comma; a stage without"
+              " cores runs on a thread not bound to any");
+DEFINE_int32(num_frames, 100, "number of frames to stream");
+DEFINE_int32(max_in_flight, 4,
+             "max number of frames submitted and not completed");
+
+namespace mace {
+namespace benchmark {
+namespace {
+
+std::vector<std::string> Split(const std::string &str, char delim) {
+  std::vector<std::string> result;
+  std::stringstream stream(str);
+  for (std::string item; std::getline(stream, item, delim);) {
+    result.push_back(item);
+  }
+  return result;
+}
+
+std::vector<int64_t> ParseShape(const std::string &str) {
+  std::vector<int64_t> shape;
+  for (auto &dim : Split(str, ',')) {
+    shape.push_back(atoi(dim.c_str()));
+  }
+  return shape;
+}
+
+void CreateTensors(const std::vector<std::string> &names,
+                   const std::string &shapes,
+                   std::map<std::string, MaceTensor> *tensors) {
+  const std::vector<std::string> shape_strs = Split(shapes, ':');
+  MACE_CHECK(names.size() == shape_strs.size(),
+             "Each node needs a shape");
+  for (size_t i = 0; i < names.size(); ++i) {
+    const std::vector<int64_t> shape = ParseShape(shape_strs[i]);
+    const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                         std::multiplies<int64_t>());
+    auto buffer = std::shared_ptr<float>(new float[size],
+                                         std::default_delete<float[]>());
+    std::fill(buffer.get(), buffer.get() + size, 0.5f);
+    (*tensors)[names[i]] = MaceTensor(shape, buffer);
+  }
+}
+
+// Streams the frames through RunAsync, and returns the frames per second,
+// or a negative value if a frame fails.
+double StreamFrames(MaceEngine *engine,
+                    const std::vector<std::string> &input_names,
+                    const std::vector<std::string> &output_names) {
+  const int num_slots = std::max(FLAGS_max_in_flight, 1);
+  std::vector<std::map<std::string, MaceTensor>> inputs(num_slots);
+  std::vector<std::map<std::string, MaceTensor>> outputs(num_slots);
+  std::vector<std::future<MaceStatus>> futures(num_slots);
+  for (int i = 0; i < num_slots; ++i) {
+    CreateTensors(input_names, FLAGS_input_shape, &inputs[i]);
+    CreateTensors(output_names, FLAGS_output_shape, &outputs[i]);
+  }
+
+  bool success = true;
+  const int64_t start_micros = NowMicros();
+  for (int frame = 0; frame < FLAGS_num_frames; ++frame) {
+    const int slot = frame % num_slots;
+    if (futures[slot].valid()) {
+      success &= futures[slot].get() == MaceStatus::MACE_SUCCESS;
+    }
+    if (engine->RunAsync(inputs[slot], &outputs[slot], nullptr,
+                         &futures[slot]) != MaceStatus::MACE_SUCCESS) {
+      success = false;
+      break;
+    }
+  }
+  for (auto &future : futures) {
+    if (future.valid()) {
+      success &= future.get() == MaceStatus::MACE_SUCCESS;
+    }
+  }
+  const int64_t elapsed_micros = NowMicros() - start_micros;
+  if (!success) {
+    LOG(ERROR) << "Failed to run the model";
+    return -1;
+  }
+  return FLAGS_num_frames * 1e6 / std::max<int64_t>(elapsed_micros, 1);
+}
+
+std::unique_ptr<MaceEngine> CreateEngine(
+    const MaceEngineConfig &config,
+    const NetDef &net_def,
+    const std::vector<std::string> &input_names,
+    const std::vector<std::string> &output_names,
+    const unsigned char *model_data) {
+  std::unique_ptr<MaceEngine> engine(new MaceEngine(config));
+  if (engine->Init(&net_def, input_names, output_names, model_data)
+      != MaceStatus::MACE_SUCCESS) {
+    LOG(ERROR) << "Failed to initialize the engine";
+    return nullptr;
+  }
+  return engine;
+}
+
+void PrintStages(const PipelineStats &stats) {
+  const std::vector<std::string> header = {
+      "stage", "cores", "ops", "busy(ms)", "utilization"
+  };
+  const std::vector<std::string> stage_cpus = Split(FLAGS_pipeline_cpus, ';');
+  std::vector<std::vector<std::string>> data;
+  for (size_t i = 0; i < stats.stages.size(); ++i) {
+    const PipelineStageStats &stage = stats.stages[i];
+    data.push_back({IntToString(i),
+                    i < stage_cpus.size() ? stage_cpus[i] : "",
+                    IntToString(stage.num_ops),
+                    FloatToString(stage.busy_micros / 1000.0, 3),
+                    FloatToString(stage.busy_micros * 100.0
+                                      / std::max<int64_t>(
+                                          stats.elapsed_micros, 1), 1)
+                        + "%"});
+  }
+  std::stringstream stream(string_util::StringFormatter::Table(
+      "Pipeline stages", header, data));
+  for (std::string line; std::getline(stream, line);) {
+    LOG(INFO) << line;
+  }
+}
+
+}  // namespace
+
+int Main(int argc, char **argv) {
+  gflags::SetUsageMessage("benchmark the pipeline execution of a model");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_model_file.empty()) {
+    LOG(ERROR) << "model_file is required";
+    return -1;
+  }
+
+  std::vector<unsigned char> model_pb;
+  if (!ReadBinaryFile(&model_pb, FLAGS_model_file)) {
+    LOG(ERROR) << "Failed to read " << FLAGS_model_file;
+    return -1;
+  }
+  NetDef net_def;
+  if (!net_def.ParseFromArray(model_pb.data(), model_pb.size())) {
+    LOG(ERROR) << "Failed to parse " << FLAGS_model_file;
+    return -1;
+  }
+  std::vector<unsigned char> model_data;
+  if (!FLAGS_model_data_file.empty()
+      && !ReadBinaryFile(&model_data, FLAGS_model_data_file)) {
+    LOG(ERROR) << "Failed to read " << FLAGS_model_data_file;
+    return -1;
+  }
+
+  std::vector<std::vector<int>> stage_cpu_ids;
+  for (auto &stage_cpus : Split(FLAGS_pipeline_cpus, ';')) {
+    std::vector<int> cpu_ids;
+    for (auto &cpu : Split(stage_cpus, ',')) {
+      cpu_ids.push_back(atoi(cpu.c_str()));
+    }
+    stage_cpu_ids.push_back(cpu_ids);
+  }
+
+  const std::vector<std::string> input_names = Split(FLAGS_input_node, ',');
+  const std::vector<std::string> output_names =
+      Split(FLAGS_output_node, ',');
+  const unsigned char *data = model_data.empty() ? nullptr
+                                                 : model_data.data();
+
+  MaceEngineConfig config(DeviceType::CPU);
+  config.SetCPUThreadPolicy(FLAGS_omp_num_threads,
+                            CPUAffinityPolicy::AFFINITY_NONE);
+  std::unique_ptr<MaceEngine> engine =
+      CreateEngine(config, net_def, input_names, output_names, data);
+  if (engine == nullptr) return -1;
+  const double fps = StreamFrames(engine.get(), input_names, output_names);
+  engine.reset();
+  if (fps < 0) return -1;
+
+  MaceEngineConfig pipeline_config(DeviceType::CPU);
+  if (pipeline_config.SetPipelineStages(stage_cpu_ids)
+      != MaceStatus::MACE_SUCCESS) {
+    LOG(ERROR) << "Invalid pipeline_cpus " << FLAGS_pipeline_cpus;
+    return -1;
+  }
+  engine = CreateEngine(pipeline_config, net_def, input_names, output_names,
+                        data);
+  if (engine == nullptr) return -1;
+  const double pipeline_fps =
+      StreamFrames(engine.get(), input_names, output_names);
+  if (pipeline_fps < 0) return -1;
+  PipelineStats stats;
+  MACE_CHECK(engine->GetPipelineStats(&stats) == MaceStatus::MACE_SUCCESS);
+
+  LOG(INFO) << "Frames per second: " << FloatToString(fps, 2)
+            << " without pipeline, " << FloatToString(pipeline_fps, 2)
+            << " with " << stats.stages.size() << " stages";
+  PrintStages(stats);
+  return 0;
+}
+
+}  // namespace benchmark
+}  // namespace mace
+
+int main(int argc, char **argv) {
+  return mace::benchmark::Main(argc, argv);
+}
@@ -0,0 +1,406 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Usage:
+ * startup_benchmark --model_file=mobi_mace.pb \
+ *          --model_data_file=mobi_mace.data \
+ *          --input_node=input --input_shape=1,224,224,3 \
+ *          --output_node=output --output_shape=1,1001 \
+ *          --num_launches=10 --page_cache=both
+ *
+ * Launches the benchmark itself num_launches times, each launch creating
+ * the engine and running the model twice, and reports the time of each
+ * startup phase over the launches. With a cold page cache, the model files
+ * are dropped from the page cache (POSIX_FADV_DONTNEED) before each launch;
+ * the binary and the libraries it loads stay cached. With a warm page
+ * cache, the launches follow one which is not counted. A compressed model
+ * data file is decompressed into memory after it is mapped. The peak
+ * resident memory of the launches is reported too.
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "mace/benchmark/statistics.h"
+#include "mace/core/compressed_model_data.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
+#include "mace/proto/mace.pb.h"
+#include "mace/public/mace.h"
+#include "mace/utils/env_time.h"
+#include "mace/utils/logging.h"
+#include "mace/utils/string_util.h"
+#include "mace/utils/utils.h"
+
+DEFINE_string(model_file, "", "model graph pb file path");
+DEFINE_string(model_data_file, "", "model data file path");
+DEFINE_string(device, "CPU", "Device [CPU|GPU]");
+DEFINE_string(input_node, "input_node0", "input nodes, separated by comma");
+DEFINE_string(output_node, "output_node0",
+              "output nodes, separated by comma");
+DEFINE_string(input_shape, "", "input shapes, separated by colon and comma");
+DEFINE_string(output_shape, "",
+              "output shapes, separated by colon and comma");
+DEFINE_int32(omp_num_threads, -1, "num of openmp threads");
+DEFINE_int32(cpu_affinity_policy, 1,
+             "0:AFFINITY_NONE/1:AFFINITY_BIG_ONLY/2:AFFINITY_LITTLE_ONLY");
+DEFINE_string(snapshot_path, "",
+              "directory of the engine snapshots, saved by each launch");
+DEFINE_int32(num_launches, 10, "number of launches per page cache state");
+DEFINE_string(page_cache, "both",
+              "page cache state of the model files [cold|warm|both]");
+DEFINE_int32(result_fd, -1,
+             "set for the launched processes, which write their timings to"
+             " this file descriptor");
+
+namespace mace {
+namespace benchmark {
+namespace {
+
+// In the order they happen
+const char *kPhases[] = {
+    "read_model_file", "map_model_data", "decompress_model_data",
+    "parse_model", "create_engine",
+    "optimize_graph", "load_tensors", "init_net", "create_operators",
+    "init", "first_run", "second_run", "launch"
+};
+
+std::vector<std::string> Split(const std::string &str, char delim) {
+  std::vector<std::string> result;
+  std::stringstream stream(str);
+  for (std::string item; std::getline(stream, item, delim);) {
+    result.push_back(item);
+  }
+  return result;
+}
+
+std::vector<int64_t> ParseShape(const std::string &str) {
+  std::vector<int64_t> shape;
+  for (auto &dim : Split(str, ',')) {
+    shape.push_back(atoi(dim.c_str()));
+  }
+  return shape;
+}
+
+void CreateTensors(const std::vector<std::string> &names,
+                   const std::string &shapes,
+                   std::map<std::string, MaceTensor> *tensors) {
+  const std::vector<std::string> shape_strs = Split(shapes, ':');
+  MACE_CHECK(names.size() == shape_strs.size(),
+             "Each node needs a shape");
+  for (size_t i = 0; i < names.size(); ++i) {
+    const std::vector<int64_t> shape = ParseShape(shape_strs[i]);
+    const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                         std::multiplies<int64_t>());
+    auto buffer = std::shared_ptr<float>(new float[size],
+                                         std::default_delete<float[]>());
+    std::fill(buffer.get(), buffer.get() + size, 0.5f);
+    (*tensors)[names[i]] = MaceTensor(shape, buffer);
+  }
+}
+
+// Drops the clean pages of the file from the page cache
+void DropPageCache(const std::string &file) {
+  int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(WARNING) << "Failed to open " << file;
+    return;
+  }
+  fdatasync(fd);
+  if (posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) != 0) {
+    LOG(WARNING) << "Failed to drop the page cache of " << file;
+  }
+  close(fd);
+}
+
+// Runs in the launched process: starts up the engine and writes the time
+// of each phase to result_fd, as "<phase> <micros>" lines.
+int RunStartup(int result_fd) {
+  std::map<std::string, int64_t> timings;
+  int64_t start_micros = NowMicros();
+  std::vector<unsigned char> model_pb;
+  if (!ReadBinaryFile(&model_pb, FLAGS_model_file)) {
+    LOG(ERROR) << "Failed to read " << FLAGS_model_file;
+    return -1;
+  }
+  timings["read_model_file"] = NowMicros() - start_micros;
+
+  start_micros = NowMicros();
+  const unsigned char *model_data = nullptr;
+  size_t model_data_size = 0;
+  if (!FLAGS_model_data_file.empty()) {
+    int fd = open(FLAGS_model_data_file.c_str(), O_RDONLY);
+    MACE_CHECK(fd >= 0, "Failed to open ", FLAGS_model_data_file);
+    struct stat st;
+    MACE_CHECK(fstat(fd, &st) == 0 && st.st_size > 0);
+    model_data_size = static_cast<size_t>(st.st_size);
+    void *data = mmap(nullptr, model_data_size, PROT_READ, MAP_PRIVATE,
+                      fd, 0);
+    MACE_CHECK(data != MAP_FAILED, "Failed to map ", FLAGS_model_data_file);
+    close(fd);
+    model_data = static_cast<const unsigned char *>(data);
+  }
+  timings["map_model_data"] = NowMicros() - start_micros;
+
+  std::unique_ptr<unsigned char[]> decompressed_model_data;
+  if (model_data != nullptr
+      && IsCompressedModelData(model_data, model_data_size)) {
+    ThreadPool thread_pool(FLAGS_omp_num_threads > 0
+                               ? FLAGS_omp_num_threads
+                               : std::thread::hardware_concurrency(),
+                           {});
+    ThreadPoolGuard thread_pool_guard(&thread_pool);
+    start_micros = NowMicros();
+    const uint64_t data_size =
+        DecompressedModelDataSize(model_data, model_data_size);
+    MACE_CHECK(data_size > 0, "Invalid ", FLAGS_model_data_file);
+    decompressed_model_data.reset(new unsigned char[data_size]);
+    MACE_CHECK(DecompressModelData(model_data, model_data_size,
+                                   decompressed_model_data.get())
+                   == MaceStatus::MACE_SUCCESS);
+    munmap(const_cast<unsigned char *>(model_data), model_data_size);
+    model_data = decompressed_model_data.get();
+    model_data_size = 0;
+    timings["decompress_model_data"] = NowMicros() - start_micros;
+  }
+
+  start_micros = NowMicros();
+  NetDef net_def;
+  if (!net_def.ParseFromArray(model_pb.data(), model_pb.size())) {
+    LOG(ERROR) << "Failed to parse " << FLAGS_model_file;
+    return -1;
+  }
+  timings["parse_model"] = NowMicros() - start_micros;
+
+  start_micros = NowMicros();
+  const DeviceType device_type =
+      FLAGS_device == "GPU" ? DeviceType::GPU : DeviceType::CPU;
+  MaceEngineConfig config(device_type);
+  config.SetCPUThreadPolicy(
+      FLAGS_omp_num_threads,
+      static_cast<CPUAffinityPolicy>(FLAGS_cpu_affinity_policy));
+#ifdef MACE_ENABLE_OPENCL
+  std::shared_ptr<GPUContext> gpu_context;
+  if (device_type == DeviceType::GPU) {
+    const char *storage_path = getenv("MACE_INTERNAL_STORAGE_PATH");
+    gpu_context = GPUContextBuilder()
+        .SetStoragePath(storage_path == nullptr
+                            ? "/data/local/tmp/mace_run/interior"
+                            : storage_path)
+        .Finalize();
+    config.SetGPUContext(gpu_context);
+  }
+#endif  // MACE_ENABLE_OPENCL
+  if (!FLAGS_snapshot_path.empty()) {
+    config.SetSnapshotPath(FLAGS_snapshot_path);
+  }
+  std::unique_ptr<MaceEngine> engine(new MaceEngine(config));
+  timings["create_engine"] = NowMicros() - start_micros;
+
+  const std::vector<std::string> input_names = Split(FLAGS_input_node, ',');
+  const std::vector<std::string> output_names =
+      Split(FLAGS_output_node, ',');
+  start_micros = NowMicros();
+  if (engine->Init(&net_def, input_names, output_names, model_data)
+      != MaceStatus::MACE_SUCCESS) {
+    LOG(ERROR) << "Failed to initialize the engine";
+    return -1;
+  }
+  timings["init"] = NowMicros() - start_micros;
+  InitStats init_stats;
+  if (engine->GetInitStats(&init_stats) == MaceStatus::MACE_SUCCESS) {
+    timings["optimize_graph"] = init_stats.optimize_graph_micros;
+    timings["load_tensors"] = init_stats.load_tensors_micros;
+    timings["init_net"] = init_stats.init_net_micros;
+    timings["create_operators"] = init_stats.create_operators_micros;
+  }
+
+  std::map<std::string, MaceTensor> inputs;
+  std::map<std::string, MaceTensor> outputs;
+  CreateTensors(input_names, FLAGS_input_shape, &inputs);
+  CreateTensors(output_names, FLAGS_output_shape, &outputs);
+  for (const char *run : {"first_run", "second_run"}) {
+    start_micros = NowMicros();
+    if (engine->Run(inputs, &outputs) != MaceStatus::MACE_SUCCESS) {
+      LOG(ERROR) << "Failed to run the model";
+      return -1;
+    }
+    timings[run] = NowMicros() - start_micros;
+  }
+  if (!FLAGS_snapshot_path.empty()) {
+    engine->SaveSnapshot();
+  }
+
+  engine.reset();
+  if (model_data != nullptr && model_data_size > 0) {
+    munmap(const_cast<unsigned char *>(model_data), model_data_size);
+  }
+
+  std::stringstream result;
+  for (auto &timing : timings) {
+    result << timing.first << " " << timing.second << "\n";
+  }
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    result << "peak_rss_kb " << usage.ru_maxrss << "\n";
+  }
+  const std::string result_str = result.str();
+  if (write(result_fd, result_str.data(), result_str.size())
+      != static_cast<ssize_t>(result_str.size())) {
+    return -1;
+  }
+  return 0;
+}
+
+// Launches the benchmark with the same arguments to start up once, and
+// adds its timings to phases.
+bool Launch(const std::vector<std::string> &args,
+            std::map<std::string, TimeInfo<int64_t>> *phases) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    LOG(ERROR) << "Failed to create a pipe";
+    return false;
+  }
+  std::vector<std::string> launch_args(args);
+  launch_args.push_back(MakeString("--result_fd=", fds[1]));
+  std::vector<char *> argv;
+  for (auto &arg : launch_args) {
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+
+  const int64_t start_micros = NowMicros();
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    execv("/proc/self/exe", argv.data());
+    _exit(127);
+  }
+  close(fds[1]);
+  std::string result;
+  char buffer[256];
+  for (ssize_t n; (n = read(fds[0], buffer, sizeof(buffer))) > 0;) {
+    result.append(buffer, n);
+  }
+  close(fds[0]);
+  int status = 0;
+  if (pid < 0 || waitpid(pid, &status, 0) != pid
+      || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    LOG(ERROR) << "Launch failed";
+    return false;
+  }
+  const int64_t launch_micros = NowMicros() - start_micros;
+
+  std::stringstream stream(result);
+  std::string phase;
+  int64_t micros;
+  while (stream >> phase >> micros) {
+    (*phases)[phase].UpdateTime(micros);
+  }
+  (*phases)["launch"].UpdateTime(launch_micros);
+  return true;
+}
+
+void PrintPhases(const std::string &title,
+                 const std::map<std::string, TimeInfo<int64_t>> &phases) {
+  const std::vector<std::string> header = {
+      "phase", "round", "first(ms)", "min(ms)", "max(ms)", "avg(ms)", "std"
+  };
+  std::vector<std::vector<std::string>> data;
+  for (const char *phase : kPhases) {
+    auto iter = phases.find(phase);
+    if (iter == phases.end()) continue;
+    const TimeInfo<int64_t> &time_info = iter->second;
+    data.push_back({phase,
+                    IntToString(time_info.round()),
+                    FloatToString(time_info.first() / 1000.0, 3),
+                    FloatToString(time_info.min() / 1000.0, 3),
+                    FloatToString(time_info.max() / 1000.0, 3),
+                    FloatToString(time_info.avg() / 1000.0, 3),
+                    FloatToString(time_info.std_deviation() / 1000.0, 3)});
+  }
+  std::stringstream stream(
+      string_util::StringFormatter::Table(title, header, data));
+  for (std::string line; std::getline(stream, line);) {
+    LOG(INFO) << line;
+  }
+  auto peak_rss = phases.find("peak_rss_kb");
+  if (peak_rss != phases.end()) {
+    LOG(INFO) << "Peak RSS: min " << peak_rss->second.min() << " KB, max "
+              << peak_rss->second.max() << " KB, avg "
+              << peak_rss->second.avg() << " KB";
+  }
+}
+
+}  // namespace
+
+int Main(int argc, char **argv) {
+  const std::vector<std::string> args(argv, argv + argc);
+  gflags::SetUsageMessage("benchmark the startup of a model");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_result_fd >= 0) {
+    return RunStartup(FLAGS_result_fd);
+  }
+  if (FLAGS_model_file.empty()) {
+    LOG(ERROR) << "model_file is required";
+    return -1;
+  }
+
+  std::vector<std::string> page_cache_states;
+  if (FLAGS_page_cache == "cold" || FLAGS_page_cache == "both") {
+    page_cache_states.push_back("cold");
+  }
+  if (FLAGS_page_cache == "warm" || FLAGS_page_cache == "both") {
+    page_cache_states.push_back("warm");
+  }
+  for (auto &state : page_cache_states) {
+    std::map<std::string, TimeInfo<int64_t>> phases;
+    if (state == "warm") {
+      std::map<std::string, TimeInfo<int64_t>> ignored;
+      if (!Launch(args, &ignored)) return -1;
+    }
+    for (int i = 0; i < FLAGS_num_launches; ++i) {
+      if (state == "cold") {
+        DropPageCache(FLAGS_model_file);
+        if (!FLAGS_model_data_file.empty()) {
+          DropPageCache(FLAGS_model_data_file);
+        }
+      }
+      if (!Launch(args, &phases)) return -1;
+    }
+    PrintPhases(MakeString("Startup with ", state, " page cache"), phases);
+  }
+  return 0;
+}
+
+}  // namespace benchmark
+}  // namespace mace
+
+int main(int argc, char **argv) {
+  return mace::benchmark::Main(argc, argv);
+}
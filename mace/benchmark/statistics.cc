@@ -118,6 +118,8 @@ void OpStat::StatMetadata(const RunMetadata &meta_data) {
     record->start.UpdateTime(op_stat.stats.start_micros - first_op_start_time);
     int64_t run_time = op_stat.stats.end_micros - op_stat.stats.start_micros;
     record->rel_end.UpdateTime(run_time);
+    record->page_faults.UpdateTime(op_stat.page_faults.minor
+                                       + op_stat.page_faults.major);
     record->called_times += 1;
     total_time += run_time;
   }
@@ -148,7 +150,7 @@ std::string OpStat::StatByMetric(const Metric metric,
   // generate string
   std::string title = "Sort by " + MetricToString(metric);
   const std::vector<std::string> header = {
-      "Node Type", "Start", "First", "Avg(ms)", "%", "cdf%",
+      "Node Type", "Start", "First", "Avg(ms)", "%", "cdf%", "First Faults",
       "Stride", "Pad", "Filter Shape", "Output Shape", "Dilation", "name"
   };
   std::vector<std::vector<std::string>> data;
@@ -169,6 +171,7 @@ std::string OpStat::StatByMetric(const Metric metric,
         FloatToString(record.rel_end.sum() * 100.f / total_time_.sum(), 3));
     tuple.push_back(
         FloatToString(accumulate_time * 100.f / total_time_.sum(), 3));
+    tuple.push_back(IntToString(record.page_faults.first()));
     tuple.push_back(VectorToString<int>(record.args.strides));
     if (record.args.padding_type != -1) {
       tuple.push_back(PaddingTypeToString(record.args.padding_type));
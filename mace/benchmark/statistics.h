@@ -67,6 +67,14 @@ class TimeInfo {
     return sum_;
   }
 
+  T min() const {
+    return min_;
+  }
+
+  T max() const {
+    return max_;
+  }
+
   double avg() const {
     return round_ == 0 ? std::numeric_limits<double>::quiet_NaN() :
            sum_ * 1.0f / round_;
@@ -148,6 +156,8 @@ class OpStat{
     int64_t order;
     TimeInfo<int64_t> start;
     TimeInfo<int64_t> rel_end;
+    // Minor and major page faults
+    TimeInfo<int64_t> page_faults;
     int64_t called_times;
   };
 
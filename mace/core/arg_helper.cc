@@ -26,7 +26,7 @@ ProtoArgHelper::ProtoArgHelper(const OperatorDef &def) {
       LOG(WARNING) << "Duplicated argument " << arg.name()
                    << " found in operator " << def.name();
     }
-    arg_map_[arg.name()] = arg;
+    arg_map_[arg.name()] = &arg;
   }
 }
 
@@ -34,7 +34,7 @@ ProtoArgHelper::ProtoArgHelper(const NetDef &netdef) {
   for (auto &arg : netdef.arg()) {
     MACE_CHECK(arg_map_.count(arg.name()) == 0,
                "Duplicated argument found in net def.");
-    arg_map_[arg.name()] = arg;
+    arg_map_[arg.name()] = &arg;
   }
 }
 
@@ -54,9 +54,9 @@ inline bool IsCastLossless(const InputType &value) {
               << arg_name;                                                     \
       return default_value;                                                    \
     }                                                                          \
-    MACE_CHECK(arg_map_.at(arg_name).has_##fieldname(), "Argument ", arg_name, \
-               " not found!");                                                 \
-    auto value = arg_map_.at(arg_name).fieldname();                            \
+    MACE_CHECK(arg_map_.at(arg_name)->has_##fieldname(), "Argument ",          \
+               arg_name, " not found!");                                       \
+    auto value = arg_map_.at(arg_name)->fieldname();                           \
     if (lossless_conversion) {                                                 \
       const bool castLossless = IsCastLossless<decltype(value), T>(value);     \
       MACE_CHECK(castLossless, "Value", value, " of argument ", arg_name,      \
@@ -80,7 +80,7 @@ MACE_GET_OPTIONAL_ARGUMENT_FUNC(std::string, s, false)
       return default_value;                                                \
     }                                                                      \
     std::vector<T> values;                                                 \
-    for (const auto &v : arg_map_.at(arg_name).fieldname()) {              \
+    for (const auto &v : arg_map_.at(arg_name)->fieldname()) {             \
       if (lossless_conversion) {                                           \
         const bool castLossless = IsCastLossless<decltype(v), T>(v);       \
         MACE_CHECK(castLossless, "Value", v, " of argument ", arg_name,    \
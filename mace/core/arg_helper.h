@@ -41,6 +41,7 @@ class ProtoArgHelper {
     return ProtoArgHelper(def).GetRepeatedArgs<T>(arg_name, default_value);
   }
 
+  // Refers to the arguments of def, which must outlive the helper
   explicit ProtoArgHelper(const OperatorDef &def);
   explicit ProtoArgHelper(const NetDef &netdef);
 
@@ -52,7 +53,7 @@ class ProtoArgHelper {
       const std::vector<T> &default_value = std::vector<T>()) const;
 
  private:
-  std::map<std::string, Argument> arg_map_;
+  std::map<std::string, const Argument *> arg_map_;
 };
 
 }  // namespace mace
@@ -0,0 +1,304 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/compressed_model_data.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <set>
+#include <utility>
+
+#include "mace/core/runtime/cpu/thread_pool.h"
+#include "mace/core/types.h"
+#include "mace/utils/logging.h"
+
+namespace mace {
+namespace {
+
+constexpr size_t kMinMatch = 4;
+constexpr size_t kMaxOffset = 65535;
+constexpr int kHashBits = 14;
+
+inline uint32_t Hash4(const unsigned char *data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return (value * 2654435761U) >> (32 - kHashBits);
+}
+
+// The bytes continuing a 4-bit count of 15
+void PutLength(size_t length, std::vector<unsigned char> *dst) {
+  for (; length >= 255; length -= 255) {
+    dst->push_back(255);
+  }
+  dst->push_back(static_cast<unsigned char>(length));
+}
+
+bool GetLength(const unsigned char *src, size_t size, size_t *pos,
+               size_t *length) {
+  unsigned char byte;
+  do {
+    if (*pos >= size) return false;
+    byte = src[(*pos)++];
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// A match_length of 0 ends the block with literals only
+void PutSequence(const unsigned char *literals,
+                 size_t num_literals,
+                 size_t offset,
+                 size_t match_length,
+                 std::vector<unsigned char> *dst) {
+  const size_t match_code = match_length > 0 ? match_length - kMinMatch : 0;
+  dst->push_back(static_cast<unsigned char>(
+      (std::min<size_t>(num_literals, 15) << 4)
+          | std::min<size_t>(match_code, 15)));
+  if (num_literals >= 15) {
+    PutLength(num_literals - 15, dst);
+  }
+  dst->insert(dst->end(), literals, literals + num_literals);
+  if (match_length > 0) {
+    dst->push_back(static_cast<unsigned char>(offset & 0xFF));
+    dst->push_back(static_cast<unsigned char>(offset >> 8));
+    if (match_code >= 15) {
+      PutLength(match_code - 15, dst);
+    }
+  }
+}
+
+const CompressedBlock *Blocks(const unsigned char *compressed) {
+  return reinterpret_cast<const CompressedBlock *>(
+      compressed + sizeof(CompressedModelDataHeader));
+}
+
+}  // namespace
+
+void LZCompress(const unsigned char *src,
+                size_t size,
+                std::vector<unsigned char> *dst) {
+  dst->clear();
+  // The last position + 1 of each hashed 4 bytes, 0 if none
+  std::vector<size_t> table(1 << kHashBits, 0);
+  size_t anchor = 0;
+  size_t pos = 0;
+  while (pos + kMinMatch <= size) {
+    const uint32_t hash = Hash4(src + pos);
+    const size_t candidate = table[hash];
+    table[hash] = pos + 1;
+    if (candidate > 0 && pos - (candidate - 1) <= kMaxOffset
+        && memcmp(src + candidate - 1, src + pos, kMinMatch) == 0) {
+      const size_t match = candidate - 1;
+      size_t length = kMinMatch;
+      while (pos + length < size && src[match + length] == src[pos + length]) {
+        ++length;
+      }
+      PutSequence(src + anchor, pos - anchor, pos - match, length, dst);
+      pos += length;
+      anchor = pos;
+    } else {
+      ++pos;
+    }
+  }
+  PutSequence(src + anchor, size - anchor, 0, 0, dst);
+}
+
+bool LZDecompress(const unsigned char *src,
+                  size_t size,
+                  unsigned char *dst,
+                  size_t dst_size) {
+  size_t pos = 0;
+  size_t out = 0;
+  while (pos < size) {
+    const unsigned char token = src[pos++];
+    size_t num_literals = token >> 4;
+    if (num_literals == 15 && !GetLength(src, size, &pos, &num_literals)) {
+      return false;
+    }
+    if (num_literals > size - pos || num_literals > dst_size - out) {
+      return false;
+    }
+    memcpy(dst + out, src + pos, num_literals);
+    pos += num_literals;
+    out += num_literals;
+    if (pos == size) {
+      break;
+    }
+
+    if (size - pos < 2) return false;
+    const size_t offset = src[pos] | (src[pos + 1] << 8);
+    pos += 2;
+    size_t length = token & 0xF;
+    if (length == 15 && !GetLength(src, size, &pos, &length)) {
+      return false;
+    }
+    length += kMinMatch;
+    if (offset == 0 || offset > out || length > dst_size - out) {
+      return false;
+    }
+    const unsigned char *match = dst + out - offset;
+    if (offset >= length) {
+      memcpy(dst + out, match, length);
+    } else {
+      // Overlapping, e.g. a run of a repeated byte
+      for (size_t i = 0; i < length; ++i) {
+        dst[out + i] = match[i];
+      }
+    }
+    out += length;
+  }
+  return out == dst_size;
+}
+
+bool IsCompressedModelData(const unsigned char *data, size_t size) {
+  return size >= sizeof(CompressedModelDataHeader)
+      && memcmp(data, kCompressedModelDataMagic,
+                sizeof(kCompressedModelDataMagic)) == 0;
+}
+
+MaceStatus CompressModelData(const NetDef &net_def,
+                             const unsigned char *model_data,
+                             size_t model_data_size,
+                             size_t block_size,
+                             std::vector<unsigned char> *compressed) {
+  MACE_CHECK_NOTNULL(compressed);
+  if (block_size == 0 || block_size > std::numeric_limits<uint32_t>::max()) {
+    LOG(ERROR) << "Invalid block size " << block_size;
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  std::set<size_t> boundaries = {0, model_data_size};
+  for (auto &const_tensor : net_def.tensors()) {
+    const size_t begin = const_tensor.offset();
+    const size_t end = begin + const_tensor.data_size()
+        * GetEnumTypeSize(const_tensor.data_type());
+    if (end > model_data_size) {
+      LOG(ERROR) << "Tensor " << const_tensor.name()
+                 << " is out of the model data";
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
+    boundaries.insert(begin);
+    boundaries.insert(end);
+  }
+  // (offset, size) of the blocks
+  std::vector<std::pair<size_t, size_t>> ranges;
+  for (auto iter = boundaries.begin(); std::next(iter) != boundaries.end();
+       ++iter) {
+    const size_t end = *std::next(iter);
+    for (size_t begin = *iter; begin < end; begin += block_size) {
+      ranges.emplace_back(begin, std::min(block_size, end - begin));
+    }
+  }
+
+  const int num_blocks = static_cast<int>(ranges.size());
+  std::vector<std::vector<unsigned char>> blocks(num_blocks);
+  ParallelFor(0, num_blocks, [&](index_t i) {
+    LZCompress(model_data + ranges[i].first, ranges[i].second, &blocks[i]);
+    if (blocks[i].size() >= ranges[i].second) {
+      blocks[i].assign(model_data + ranges[i].first,
+                       model_data + ranges[i].first + ranges[i].second);
+    }
+  });
+
+  CompressedModelDataHeader header;
+  memcpy(header.magic, kCompressedModelDataMagic, sizeof(header.magic));
+  header.version = kCompressedModelDataVersion;
+  header.num_blocks = static_cast<uint32_t>(num_blocks);
+  header.data_size = model_data_size;
+  compressed->assign(reinterpret_cast<const unsigned char *>(&header),
+                     reinterpret_cast<const unsigned char *>(&header + 1));
+  for (int i = 0; i < num_blocks; ++i) {
+    CompressedBlock block = {static_cast<uint32_t>(ranges[i].second),
+                             static_cast<uint32_t>(blocks[i].size())};
+    compressed->insert(compressed->end(),
+                       reinterpret_cast<const unsigned char *>(&block),
+                       reinterpret_cast<const unsigned char *>(&block + 1));
+  }
+  for (auto &block : blocks) {
+    compressed->insert(compressed->end(), block.begin(), block.end());
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+uint64_t DecompressedModelDataSize(const unsigned char *compressed,
+                                   size_t size) {
+  if (!IsCompressedModelData(compressed, size)) {
+    return 0;
+  }
+  CompressedModelDataHeader header;
+  memcpy(&header, compressed, sizeof(header));
+  const size_t max_blocks = (size - sizeof(header)) / sizeof(CompressedBlock);
+  if (header.version != kCompressedModelDataVersion
+      || header.num_blocks > max_blocks) {
+    return 0;
+  }
+  const CompressedBlock *blocks = Blocks(compressed);
+  uint64_t data_size = 0;
+  uint64_t stored_size = sizeof(header)
+      + header.num_blocks * sizeof(CompressedBlock);
+  for (uint32_t i = 0; i < header.num_blocks; ++i) {
+    data_size += blocks[i].data_size;
+    stored_size += blocks[i].stored_size;
+  }
+  if (data_size != header.data_size || stored_size > size) {
+    return 0;
+  }
+  return header.data_size;
+}
+
+MaceStatus DecompressModelData(const unsigned char *compressed,
+                               size_t size,
+                               unsigned char *model_data) {
+  if (DecompressedModelDataSize(compressed, size) == 0) {
+    LOG(ERROR) << "Invalid compressed model data";
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  CompressedModelDataHeader header;
+  memcpy(&header, compressed, sizeof(header));
+  const CompressedBlock *blocks = Blocks(compressed);
+  const int num_blocks = static_cast<int>(header.num_blocks);
+  std::vector<uint64_t> data_offsets(num_blocks);
+  std::vector<uint64_t> stored_offsets(num_blocks);
+  uint64_t data_offset = 0;
+  uint64_t stored_offset = sizeof(header)
+      + header.num_blocks * sizeof(CompressedBlock);
+  for (int i = 0; i < num_blocks; ++i) {
+    data_offsets[i] = data_offset;
+    stored_offsets[i] = stored_offset;
+    data_offset += blocks[i].data_size;
+    stored_offset += blocks[i].stored_size;
+  }
+
+  std::vector<char> decoded(num_blocks, 1);
+  ParallelFor(0, num_blocks, [&](index_t i) {
+    const unsigned char *src = compressed + stored_offsets[i];
+    unsigned char *dst = model_data + data_offsets[i];
+    if (blocks[i].stored_size == blocks[i].data_size) {
+      memcpy(dst, src, blocks[i].data_size);
+    } else {
+      decoded[i] = LZDecompress(src, blocks[i].stored_size,
+                                dst, blocks[i].data_size);
+    }
+  });
+  for (int i = 0; i < num_blocks; ++i) {
+    if (!decoded[i]) {
+      LOG(ERROR) << "Corrupted block " << i << " of compressed model data";
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+}  // namespace mace
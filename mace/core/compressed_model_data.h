@@ -0,0 +1,89 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_COMPRESSED_MODEL_DATA_H_
+#define MACE_CORE_COMPRESSED_MODEL_DATA_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "mace/proto/mace.pb.h"
+#include "mace/public/mace.h"
+
+namespace mace {
+
+// A model data file compressed in blocks, which are decompressed in
+// parallel. The blocks cover the data in order and never span a tensor
+// boundary. The file starts with a CompressedModelDataHeader, followed by
+// a CompressedBlock per block and then the blocks, in the host byte order.
+// A block is LZ coded (see LZCompress), or stored as is if that is not
+// smaller.
+//
+// Changing the layout must bump kCompressedModelDataVersion.
+constexpr char kCompressedModelDataMagic[8] =
+    {'M', 'A', 'C', 'E', 'L', 'Z', 'M', 'D'};
+constexpr uint32_t kCompressedModelDataVersion = 1;
+constexpr size_t kDefaultCompressedBlockSize = 1 << 20;
+
+struct CompressedModelDataHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_blocks;
+  uint64_t data_size;
+};
+
+struct CompressedBlock {
+  uint32_t data_size;
+  uint32_t stored_size;  // equal to data_size if stored as is
+};
+
+bool IsCompressedModelData(const unsigned char *data, size_t size);
+
+// Compresses the model data of net_def, splitting it in blocks of at most
+// block_size bytes at the tensor boundaries.
+MaceStatus CompressModelData(const NetDef &net_def,
+                             const unsigned char *model_data,
+                             size_t model_data_size,
+                             size_t block_size,
+                             std::vector<unsigned char> *compressed);
+
+// Returns the size of the model data in compressed, or 0 if it is not a
+// valid compressed model data file.
+uint64_t DecompressedModelDataSize(const unsigned char *compressed,
+                                   size_t size);
+
+// Decompresses the blocks on the thread pool of the calling thread (see
+// ThreadPoolGuard) into model_data, which must hold
+// DecompressedModelDataSize bytes.
+MaceStatus DecompressModelData(const unsigned char *compressed,
+                               size_t size,
+                               unsigned char *model_data);
+
+// The LZ77 codec of the blocks. A block is a sequence of (literals, match)
+// pairs, each starting with a token whose high and low 4 bits are the
+// literal count and the match length minus 4, continued by bytes adding
+// up to it when 15. The literals follow, then the 2-byte match offset and
+// the match length bytes. The last pair has literals only.
+void LZCompress(const unsigned char *src,
+                size_t size,
+                std::vector<unsigned char> *dst);
+// Returns false unless src decodes to exactly dst_size bytes.
+bool LZDecompress(const unsigned char *src,
+                  size_t size,
+                  unsigned char *dst,
+                  size_t dst_size);
+
+}  // namespace mace
+
+#endif  // MACE_CORE_COMPRESSED_MODEL_DATA_H_
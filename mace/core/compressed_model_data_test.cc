@@ -0,0 +1,105 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mace/core/compressed_model_data.h"
+#include "mace/utils/string_util.h"
+#include "mace/utils/utils.h"
+
+namespace mace {
+namespace test {
+
+TEST(CompressedModelDataTest, LZCodec) {
+  std::vector<std::vector<unsigned char>> inputs = {
+      {}, {7}, {1, 2, 3}, std::vector<unsigned char>(1000, 0)};
+  std::vector<unsigned char> mixed;
+  for (int i = 0; i < 5000; ++i) {
+    // Long literal runs, short and long matches
+    mixed.push_back(static_cast<unsigned char>(
+        i % 700 < 300 ? (i * 131 + i / 7) % 251 : i % 5));
+  }
+  inputs.push_back(mixed);
+  for (auto &input : inputs) {
+    std::vector<unsigned char> compressed;
+    LZCompress(input.data(), input.size(), &compressed);
+    std::vector<unsigned char> output(input.size());
+    ASSERT_TRUE(LZDecompress(compressed.data(), compressed.size(),
+                             output.data(), output.size()));
+    EXPECT_EQ(input, output);
+    if (!input.empty()) {
+      EXPECT_FALSE(LZDecompress(compressed.data(), compressed.size(),
+                                output.data(), output.size() - 1));
+    }
+  }
+  std::vector<unsigned char> compressed;
+  LZCompress(inputs[3].data(), inputs[3].size(), &compressed);
+  EXPECT_LT(compressed.size(), 20u);
+}
+
+TEST(CompressedModelDataTest, Blocks) {
+  NetDef net_def;
+  std::vector<unsigned char> model_data;
+  const std::vector<index_t> sizes = {3000, 5, 2500};
+  for (size_t t = 0; t < sizes.size(); ++t) {
+    ConstTensor *tensor = net_def.add_tensors();
+    tensor->set_name(MakeString("Weight", t));
+    tensor->set_data_type(DT_FLOAT);
+    tensor->add_dims(sizes[t]);
+    // Aligned with padding in between
+    model_data.resize(RoundUp<size_t>(model_data.size(), 16), 0);
+    tensor->set_offset(model_data.size());
+    tensor->set_data_size(sizes[t]);
+    for (index_t i = 0; i < sizes[t]; ++i) {
+      float value = t == 0 ? 0.f : (i * 37 % 101) * 0.25f;
+      const unsigned char *bytes =
+          reinterpret_cast<const unsigned char *>(&value);
+      model_data.insert(model_data.end(), bytes, bytes + sizeof(value));
+    }
+  }
+
+  std::vector<unsigned char> compressed;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            CompressModelData(net_def, model_data.data(), model_data.size(),
+                              4096, &compressed));
+  EXPECT_LT(compressed.size(), model_data.size() / 2);
+  EXPECT_TRUE(IsCompressedModelData(compressed.data(), compressed.size()));
+  EXPECT_FALSE(IsCompressedModelData(model_data.data(), model_data.size()));
+  // Blocks of at most 4096 bytes, split at the tensor boundaries
+  CompressedModelDataHeader header;
+  memcpy(&header, compressed.data(), sizeof(header));
+  EXPECT_EQ(8u, header.num_blocks);
+
+  ASSERT_EQ(model_data.size(),
+            DecompressedModelDataSize(compressed.data(), compressed.size()));
+  std::vector<unsigned char> decompressed(model_data.size());
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            DecompressModelData(compressed.data(), compressed.size(),
+                                decompressed.data()));
+  EXPECT_EQ(model_data, decompressed);
+
+  // Truncated or corrupted
+  EXPECT_EQ(0u, DecompressedModelDataSize(compressed.data(),
+                                          compressed.size() - 1));
+  compressed[sizeof(header) + header.num_blocks * sizeof(CompressedBlock)]
+      ^= 0xF0;
+  EXPECT_EQ(MaceStatus::MACE_INVALID_ARGS,
+            DecompressModelData(compressed.data(), compressed.size(),
+                                decompressed.data()));
+}
+
+}  // namespace test
+}  // namespace mace
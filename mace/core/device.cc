@@ -18,12 +18,33 @@
 
 namespace mace {
 
+namespace {
+thread_local ScratchBuffer *thread_scratch_buffer = nullptr;
+}  // namespace
+
+ScratchBufferGuard::ScratchBufferGuard(ScratchBuffer *scratch_buffer)
+    : prev_scratch_buffer_(thread_scratch_buffer) {
+  thread_scratch_buffer = scratch_buffer;
+}
+
+ScratchBufferGuard::~ScratchBufferGuard() {
+  thread_scratch_buffer = prev_scratch_buffer_;
+}
+
+ScratchBuffer *ScratchBufferGuard::current() {
+  return thread_scratch_buffer;
+}
+
 CPUDevice::CPUDevice(const int num_threads,
                      const CPUAffinityPolicy policy,
-                     const bool use_gemmlowp)
+                     const bool use_gemmlowp,
+                     const std::vector<int> &cpu_ids,
+                     std::shared_ptr<Executor> executor)
     : cpu_runtime_(new CPURuntime(num_threads,
                                   policy,
-                                  use_gemmlowp)),
+                                  use_gemmlowp,
+                                  cpu_ids,
+                                  executor)),
       scratch_buffer_(new ScratchBuffer(GetCPUAllocator())) {}
 
 CPUDevice::~CPUDevice() = default;
@@ -48,6 +69,10 @@ DeviceType CPUDevice::device_type() const {
 }
 
 ScratchBuffer *CPUDevice::scratch_buffer() {
+  ScratchBuffer *scratch = ScratchBufferGuard::current();
+  if (scratch != nullptr) {
+    return scratch;
+  }
   return scratch_buffer_.get();
 }
 
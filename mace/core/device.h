@@ -16,9 +16,11 @@
 #define MACE_CORE_DEVICE_H_
 
 #include <memory>
+#include <vector>
 
 #include "mace/core/runtime/cpu/cpu_runtime.h"
 #include "mace/core/allocator.h"
+#include "mace/utils/utils.h"
 
 #ifdef MACE_ENABLE_OPENCL
 #include "mace/core/runtime/opencl/opencl_runtime.h"
@@ -42,11 +44,29 @@ class Device {
   virtual ScratchBuffer *scratch_buffer() = 0;
 };
 
+// Redirects CPUDevice::scratch_buffer() of the calling thread to the given
+// buffer while the guard is alive, so that operators run concurrently by
+// different threads (see ParallelNet) never share one scratch buffer.
+class ScratchBufferGuard {
+ public:
+  explicit ScratchBufferGuard(ScratchBuffer *scratch_buffer);
+  ~ScratchBufferGuard();
+
+  static ScratchBuffer *current();
+
+ private:
+  ScratchBuffer *prev_scratch_buffer_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(ScratchBufferGuard);
+};
+
 class CPUDevice : public Device {
  public:
   CPUDevice(const int num_threads,
             const CPUAffinityPolicy policy,
-            const bool use_gemmlowp);
+            const bool use_gemmlowp,
+            const std::vector<int> &cpu_ids = {},
+            std::shared_ptr<Executor> executor = nullptr);
   virtual ~CPUDevice();
 
 #ifdef MACE_ENABLE_OPENCL
@@ -0,0 +1,171 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/engine_snapshot.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include "mace/core/flat_graph.h"
+#include "mace/core/runtime/cpu/cpu_runtime.h"
+#include "mace/utils/logging.h"
+#include "mace/utils/utils.h"
+
+namespace mace {
+namespace {
+
+constexpr int kEngineSnapshotVersion = 1;
+constexpr size_t kTensorAlignment = 16;
+const char kInputTensorPrefix[] = "mace_input_node_";
+
+size_t ModelDataSize(const NetDef &net_def) {
+  size_t size = 0;
+  for (auto &const_tensor : net_def.tensors()) {
+    size = std::max(size, static_cast<size_t>(
+        const_tensor.offset() + const_tensor.data_size()
+            * GetEnumTypeSize(const_tensor.data_type())));
+  }
+  return size;
+}
+
+}  // namespace
+
+std::string ModelChecksum(const NetDef &net_def,
+                          const unsigned char *model_data,
+                          const std::string &model_data_file) {
+  const std::string net = net_def.SerializeAsString();
+  uint64_t hash = Hash64(
+      reinterpret_cast<const unsigned char *>(net.data()), net.size(), 0);
+  struct stat st;
+  if (!model_data_file.empty() && stat(model_data_file.c_str(), &st) == 0) {
+    const std::string file_id = MakeString(
+        model_data_file, ":", st.st_dev, ":", st.st_ino, ":", st.st_size,
+        ":", st.st_mtim.tv_sec, ".", st.st_mtim.tv_nsec);
+    hash = Hash64(reinterpret_cast<const unsigned char *>(file_id.data()),
+                  file_id.size(), hash);
+  } else if (model_data != nullptr) {
+    hash = Hash64(model_data, ModelDataSize(net_def), hash);
+  }
+  char checksum[17];
+  snprintf(checksum, sizeof(checksum), "%016llx",
+           static_cast<unsigned long long>(hash));  // NOLINT(runtime/int)
+  return checksum;
+}
+
+std::string EngineSnapshotKey(const std::string &model_checksum,
+                              const std::string &options) {
+  return MakeString("version=", kEngineSnapshotVersion,
+                    ";model=", model_checksum,
+                    ";options=", options,
+                    ";cpu=", GetCPUFingerprint());
+}
+
+MaceStatus SaveEngineSnapshot(const NetDef &net_def,
+                              const Workspace &ws,
+                              const std::string &key,
+                              KVStorage *storage) {
+  MACE_CHECK_NOTNULL(storage);
+  NetDef snapshot_net_def(net_def);
+  snapshot_net_def.clear_tensors();
+  ws.ExportMemoryPlan(&snapshot_net_def);
+
+  // The const tensors are those the ops read and no op writes
+  std::set<std::string> op_outputs;
+  for (auto &op : net_def.op()) {
+    op_outputs.insert(op.output().begin(), op.output().end());
+  }
+  std::set<std::string> saved_tensors;
+  std::vector<unsigned char> model_data;
+  for (auto &op : net_def.op()) {
+    for (auto &input : op.input()) {
+      if (op_outputs.count(input) > 0 || saved_tensors.count(input) > 0
+          || input.compare(0, strlen(kInputTensorPrefix),
+                           kInputTensorPrefix) == 0
+          || !ws.HasTensor(input)) {
+        continue;
+      }
+      saved_tensors.insert(input);
+      const Tensor *tensor = ws.GetTensor(input);
+      const size_t offset = RoundUp(model_data.size(), kTensorAlignment);
+      model_data.resize(offset + tensor->raw_size());
+      Tensor::MappingGuard guard(tensor);
+      memcpy(model_data.data() + offset, tensor->raw_data(),
+             tensor->raw_size());
+
+      // Saved as the workspace holds it, e.g. dequantized
+      ConstTensor *const_tensor = snapshot_net_def.add_tensors();
+      const_tensor->set_name(input);
+      for (auto dim : tensor->shape()) {
+        const_tensor->add_dims(dim);
+      }
+      const_tensor->set_data_type(tensor->dtype());
+      const_tensor->set_offset(offset);
+      const_tensor->set_data_size(tensor->size());
+      const_tensor->set_scale(tensor->scale());
+      const_tensor->set_zero_point(tensor->zero_point());
+    }
+  }
+
+  std::vector<unsigned char> graph;
+  MACE_RETURN_IF_ERROR(SerializeFlatGraph(snapshot_net_def, &graph));
+  storage->Clear();
+  storage->Insert("meta", std::vector<unsigned char>(key.begin(), key.end()));
+  storage->Insert("net_def", graph);
+  storage->Insert("model_data", model_data);
+  if (storage->Flush() != 0) {
+    LOG(ERROR) << "Failed to write the engine snapshot";
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  LOG(INFO) << "Saved engine snapshot: " << snapshot_net_def.op_size()
+            << " ops, " << saved_tensors.size() << " const tensors, "
+            << model_data.size() << " bytes";
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus LoadEngineSnapshot(KVStorage *storage,
+                              const std::string &key,
+                              NetDef *net_def,
+                              const unsigned char **model_data) {
+  MACE_CHECK_NOTNULL(storage);
+  if (storage->Load() != 0) {
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  const std::vector<unsigned char> *meta = storage->Find("meta");
+  if (meta == nullptr || std::string(meta->begin(), meta->end()) != key) {
+    VLOG(1) << "No engine snapshot for " << key;
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  const std::vector<unsigned char> *graph = storage->Find("net_def");
+  const std::vector<unsigned char> *data = storage->Find("model_data");
+  if (graph == nullptr || data == nullptr) {
+    LOG(WARNING) << "Engine snapshot is incomplete";
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  FlatGraph flat_graph;
+  MACE_RETURN_IF_ERROR(flat_graph.Open(graph->data(), graph->size()));
+  MACE_RETURN_IF_ERROR(flat_graph.ToNetDef(net_def));
+  if (ModelDataSize(*net_def) > data->size()) {
+    LOG(WARNING) << "Engine snapshot is truncated";
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  *model_data = data->empty() ? nullptr : data->data();
+  return MaceStatus::MACE_SUCCESS;
+}
+
+}  // namespace mace
@@ -0,0 +1,67 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_ENGINE_SNAPSHOT_H_
+#define MACE_CORE_ENGINE_SNAPSHOT_H_
+
+#include <string>
+
+#include "mace/core/file_storage.h"
+#include "mace/core/workspace.h"
+#include "mace/proto/mace.pb.h"
+#include "mace/public/mace.h"
+
+namespace mace {
+
+// The state of a CPU engine after Init, which a later Init can start from:
+// the net as rewritten by the graph optimizer, with the memory plan made
+// at load time, and its const tensors as the workspace holds them (folded,
+// dequantized) in one model data blob. It is stored in a KVStorage under
+// these keys:
+//   meta:       the key the snapshot was made for
+//   net_def:    the net, in the flat graph format
+//   model_data: the const tensors
+//
+// A snapshot is only valid for the model and the CPU it was made on, which
+// the key identifies.
+
+// Returns a checksum of the net and the model data it reads. The data of a
+// model data file are identified by the path, device, inode, size and
+// modification time of the file instead, so that they are not read, which
+// would page in every weight; model_data may be null then.
+std::string ModelChecksum(const NetDef &net_def,
+                          const unsigned char *model_data,
+                          const std::string &model_data_file = "");
+
+// Returns the key of a snapshot of the model for this CPU. The options
+// changing the state after Init (e.g. the graph passes) go in options.
+std::string EngineSnapshotKey(const std::string &model_checksum,
+                              const std::string &options);
+
+MaceStatus SaveEngineSnapshot(const NetDef &net_def,
+                              const Workspace &ws,
+                              const std::string &key,
+                              KVStorage *storage);
+
+// Loads the net of the snapshot and points model_data at its const
+// tensors, which the storage keeps. Returns MACE_INVALID_ARGS if the
+// storage has no snapshot made for key.
+MaceStatus LoadEngineSnapshot(KVStorage *storage,
+                              const std::string &key,
+                              NetDef *net_def,
+                              const unsigned char **model_data);
+
+}  // namespace mace
+
+#endif  // MACE_CORE_ENGINE_SNAPSHOT_H_
@@ -0,0 +1,67 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sys/time.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mace/core/engine_snapshot.h"
+#include "mace/core/testing/test_net_util.h"
+
+namespace mace {
+namespace test {
+
+TEST(EngineSnapshotTest, ModelChecksumOfFile) {
+  NetDef net_def;
+  std::vector<float> model_data;
+  BuildResidualNet(&net_def, &model_data);
+  const std::string model_data_file = "engine_snapshot_test_model.data";
+  auto write_file = [&model_data_file](const std::vector<float> &data,
+                                       time_t mtime) {
+    FILE *file = fopen(model_data_file.c_str(), "wb");
+    ASSERT_NE(nullptr, file);
+    EXPECT_EQ(data.size(), fwrite(data.data(), sizeof(float), data.size(),
+                                  file));
+    fclose(file);
+    struct timeval times[2] = {{mtime, 0}, {mtime, 0}};
+    EXPECT_EQ(0, utimes(model_data_file.c_str(), times));
+  };
+  write_file(model_data, 1000);
+
+  // The file is not read: its data are not passed
+  const std::string checksum =
+      ModelChecksum(net_def, nullptr, model_data_file);
+  EXPECT_EQ(checksum, ModelChecksum(net_def, nullptr, model_data_file));
+  EXPECT_NE(checksum, ModelChecksum(net_def, nullptr));
+  const unsigned char *data =
+      reinterpret_cast<const unsigned char *>(model_data.data());
+  EXPECT_NE(ModelChecksum(net_def, data),
+            ModelChecksum(net_def, data, model_data_file));
+
+  // Rewritten data, of the same size
+  std::vector<float> new_model_data(model_data.size(), 1.f);
+  write_file(new_model_data, 2000);
+  EXPECT_NE(checksum, ModelChecksum(net_def, nullptr, model_data_file));
+
+  // A missing file falls back to the data
+  EXPECT_EQ(0, remove(model_data_file.c_str()));
+  EXPECT_EQ(ModelChecksum(net_def, data),
+            ModelChecksum(net_def, data, model_data_file));
+}
+
+}  // namespace test
+}  // namespace mace
@@ -0,0 +1,653 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/flat_graph.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "mace/utils/logging.h"
+
+namespace mace {
+namespace {
+
+constexpr size_t kFlatAlignment = 8;
+
+size_t AlignUp(size_t size) {
+  return (size + kFlatAlignment - 1) / kFlatAlignment * kFlatAlignment;
+}
+
+const size_t kElementSizes[FLAT_NUM_SECTIONS] = {
+    sizeof(char),
+    sizeof(int64_t),
+    sizeof(int32_t),
+    sizeof(float),
+    sizeof(FlatString),
+    sizeof(FlatRange),
+    sizeof(FlatArg),
+    sizeof(FlatQuantizeInfo),
+    sizeof(FlatOp),
+    sizeof(FlatTensor),
+    sizeof(FlatMemBlock),
+    sizeof(FlatIOInfo),
+    sizeof(FlatNet),
+};
+
+uint32_t Flag(bool has, FlatFieldFlag flag) {
+  return has ? static_cast<uint32_t>(flag) : 0u;
+}
+
+class FlatGraphBuilder {
+ public:
+  MaceStatus Build(const NetDef &net_def, std::vector<unsigned char> *data);
+
+ private:
+  FlatString AddString(const std::string &str) {
+    FlatString ref = {static_cast<uint32_t>(strings_.size()),
+                      static_cast<uint32_t>(str.size())};
+    strings_.insert(strings_.end(), str.begin(), str.end());
+    return ref;
+  }
+
+  template <typename T, typename Container>
+  static FlatRange Append(const Container &values, std::vector<T> *pool) {
+    FlatRange range = {static_cast<uint32_t>(pool->size()),
+                       static_cast<uint32_t>(values.size())};
+    pool->insert(pool->end(), values.begin(), values.end());
+    return range;
+  }
+
+  template <typename Container>
+  FlatRange AddStrings(const Container &values) {
+    FlatRange range = {static_cast<uint32_t>(string_pool_.size()),
+                       static_cast<uint32_t>(values.size())};
+    for (auto &value : values) {
+      string_pool_.push_back(AddString(value));
+    }
+    return range;
+  }
+
+  template <typename Container>
+  FlatRange AddArgs(const Container &args) {
+    // Args are appended as a block, so make the records first
+    std::vector<FlatArg> flat_args;
+    for (auto &arg : args) {
+      FlatArg flat_arg;
+      memset(&flat_arg, 0, sizeof(flat_arg));
+      flat_arg.name = AddString(arg.name());
+      flat_arg.s = AddString(arg.s());
+      flat_arg.i = arg.i();
+      flat_arg.f = arg.f();
+      flat_arg.flags = Flag(arg.has_name(), FLAT_HAS_NAME)
+          | Flag(arg.has_f(), FLAT_HAS_F) | Flag(arg.has_i(), FLAT_HAS_I)
+          | Flag(arg.has_s(), FLAT_HAS_S);
+      flat_arg.floats = Append(arg.floats(), &float_pool_);
+      flat_arg.ints = Append(arg.ints(), &int64_pool_);
+      flat_args.push_back(flat_arg);
+    }
+    return Append(flat_args, &args_);
+  }
+
+  FlatIOInfo MakeIOInfo(const std::string &name, bool has_name,
+                        const google::protobuf::RepeatedField<int32_t> &dims,
+                        bool has_node_id, int32_t node_id,
+                        bool has_max_byte_size, int32_t max_byte_size,
+                        bool has_data_type, int32_t data_type);
+
+  void AddOp(const OperatorDef &op);
+  void AddTensor(const ConstTensor &tensor);
+
+  std::vector<char> strings_;
+  std::vector<int64_t> int64_pool_;
+  std::vector<int32_t> int32_pool_;
+  std::vector<float> float_pool_;
+  std::vector<FlatString> string_pool_;
+  std::vector<FlatRange> range_pool_;
+  std::vector<FlatArg> args_;
+  std::vector<FlatQuantizeInfo> quantize_infos_;
+  std::vector<FlatOp> ops_;
+  std::vector<FlatTensor> tensors_;
+  std::vector<FlatMemBlock> mem_blocks_;
+  std::vector<FlatIOInfo> io_infos_;
+};
+
+void FlatGraphBuilder::AddOp(const OperatorDef &op) {
+  FlatOp flat_op;
+  memset(&flat_op, 0, sizeof(flat_op));
+  flat_op.name = AddString(op.name());
+  flat_op.type = AddString(op.type());
+  flat_op.inputs = AddStrings(op.input());
+  flat_op.outputs = AddStrings(op.output());
+  flat_op.args = AddArgs(op.arg());
+  std::vector<FlatRange> shapes;
+  for (auto &shape : op.output_shape()) {
+    shapes.push_back(Append(shape.dims(), &int64_pool_));
+  }
+  flat_op.output_shapes = Append(shapes, &range_pool_);
+  flat_op.output_types = Append(op.output_type(), &int32_pool_);
+  std::vector<FlatQuantizeInfo> quantize_infos;
+  for (auto &info : op.quantize_info()) {
+    FlatQuantizeInfo flat_info;
+    memset(&flat_info, 0, sizeof(flat_info));
+    flat_info.scale = info.scale();
+    flat_info.zero_point = info.zero_point();
+    flat_info.minval = info.minval();
+    flat_info.maxval = info.maxval();
+    flat_info.flags = Flag(info.has_scale(), FLAT_HAS_SCALE)
+        | Flag(info.has_zero_point(), FLAT_HAS_ZERO_POINT)
+        | Flag(info.has_minval(), FLAT_HAS_MINVAL)
+        | Flag(info.has_maxval(), FLAT_HAS_MAXVAL);
+    quantize_infos.push_back(flat_info);
+  }
+  flat_op.quantize_infos = Append(quantize_infos, &quantize_infos_);
+  flat_op.mem_ids = Append(op.mem_id(), &int32_pool_);
+  std::vector<int32_t> node_inputs;
+  for (auto &node_input : op.node_input()) {
+    node_inputs.push_back(node_input.node_id());
+    node_inputs.push_back(node_input.output_port());
+  }
+  flat_op.node_inputs = Append(node_inputs, &int32_pool_);
+  flat_op.node_inputs.count = op.node_input_size();
+  flat_op.out_max_byte_size = Append(op.out_max_byte_size(), &int32_pool_);
+  flat_op.node_id = op.node_id();
+  flat_op.op_id = op.op_id();
+  flat_op.padding = op.padding();
+  flat_op.flags = Flag(op.has_name(), FLAT_HAS_NAME)
+      | Flag(op.has_type(), FLAT_HAS_TYPE)
+      | Flag(op.has_node_id(), FLAT_HAS_NODE_ID)
+      | Flag(op.has_op_id(), FLAT_HAS_OP_ID)
+      | Flag(op.has_padding(), FLAT_HAS_PADDING);
+  ops_.push_back(flat_op);
+}
+
+void FlatGraphBuilder::AddTensor(const ConstTensor &tensor) {
+  FlatTensor flat_tensor;
+  memset(&flat_tensor, 0, sizeof(flat_tensor));
+  flat_tensor.name = AddString(tensor.name());
+  flat_tensor.dims = Append(tensor.dims(), &int64_pool_);
+  flat_tensor.offset = tensor.offset();
+  flat_tensor.data_size = tensor.data_size();
+  flat_tensor.data_type = tensor.data_type();
+  flat_tensor.scale = tensor.scale();
+  flat_tensor.zero_point = tensor.zero_point();
+  flat_tensor.node_id = tensor.node_id();
+  flat_tensor.flags = Flag(tensor.has_name(), FLAT_HAS_NAME)
+      | Flag(tensor.has_data_type(), FLAT_HAS_DATA_TYPE)
+      | Flag(tensor.has_offset(), FLAT_HAS_OFFSET)
+      | Flag(tensor.has_data_size(), FLAT_HAS_DATA_SIZE)
+      | Flag(tensor.has_scale(), FLAT_HAS_SCALE)
+      | Flag(tensor.has_zero_point(), FLAT_HAS_ZERO_POINT)
+      | Flag(tensor.has_quantized(), FLAT_HAS_QUANTIZED)
+      | Flag(tensor.quantized(), FLAT_QUANTIZED)
+      | Flag(tensor.has_node_id(), FLAT_HAS_NODE_ID);
+  tensors_.push_back(flat_tensor);
+}
+
+FlatIOInfo FlatGraphBuilder::MakeIOInfo(
+    const std::string &name, bool has_name,
+    const google::protobuf::RepeatedField<int32_t> &dims,
+    bool has_node_id, int32_t node_id,
+    bool has_max_byte_size, int32_t max_byte_size,
+    bool has_data_type, int32_t data_type) {
+  FlatIOInfo flat_info;
+  memset(&flat_info, 0, sizeof(flat_info));
+  flat_info.name = AddString(name);
+  flat_info.dims = Append(dims, &int32_pool_);
+  flat_info.node_id = node_id;
+  flat_info.max_byte_size = max_byte_size;
+  flat_info.data_type = data_type;
+  flat_info.flags = Flag(has_name, FLAT_HAS_NAME)
+      | Flag(has_node_id, FLAT_HAS_NODE_ID)
+      | Flag(has_max_byte_size, FLAT_HAS_MAX_BYTE_SIZE)
+      | Flag(has_data_type, FLAT_HAS_DATA_TYPE);
+  return flat_info;
+}
+
+MaceStatus FlatGraphBuilder::Build(const NetDef &net_def,
+                                   std::vector<unsigned char> *data) {
+  FlatNet net;
+  memset(&net, 0, sizeof(net));
+  net.name = AddString(net_def.name());
+  net.version = AddString(net_def.version());
+  net.args = AddArgs(net_def.arg());
+  net.ops.begin = static_cast<uint32_t>(ops_.size());
+  for (auto &op : net_def.op()) {
+    AddOp(op);
+  }
+  net.ops.count = net_def.op_size();
+  net.tensors.begin = static_cast<uint32_t>(tensors_.size());
+  for (auto &tensor : net_def.tensors()) {
+    if (tensor.float_data_size() > 0 || tensor.int32_data_size() > 0) {
+      LOG(ERROR) << "Const tensor " << tensor.name()
+                 << " has inline data, which the flat graph does not keep";
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
+    AddTensor(tensor);
+  }
+  net.tensors.count = net_def.tensors_size();
+  net.mem_blocks.begin = static_cast<uint32_t>(mem_blocks_.size());
+  for (auto &block : net_def.mem_arena().mem_block()) {
+    FlatMemBlock flat_block;
+    memset(&flat_block, 0, sizeof(flat_block));
+    flat_block.mem_id = block.mem_id();
+    flat_block.device_type = block.device_type();
+    flat_block.mem_type = block.mem_type();
+    flat_block.x = block.x();
+    flat_block.y = block.y();
+    flat_block.flags = Flag(block.has_mem_id(), FLAT_HAS_MEM_ID)
+        | Flag(block.has_device_type(), FLAT_HAS_DEVICE_TYPE)
+        | Flag(block.has_mem_type(), FLAT_HAS_MEM_TYPE)
+        | Flag(block.has_x(), FLAT_HAS_X) | Flag(block.has_y(), FLAT_HAS_Y);
+    mem_blocks_.push_back(flat_block);
+  }
+  net.mem_blocks.count = net_def.mem_arena().mem_block_size();
+  net.input_infos.begin = static_cast<uint32_t>(io_infos_.size());
+  for (auto &info : net_def.input_info()) {
+    io_infos_.push_back(MakeIOInfo(
+        info.name(), info.has_name(), info.dims(),
+        info.has_node_id(), info.node_id(),
+        info.has_max_byte_size(), info.max_byte_size(),
+        info.has_data_type(), info.data_type()));
+  }
+  net.input_infos.count = net_def.input_info_size();
+  net.output_infos.begin = static_cast<uint32_t>(io_infos_.size());
+  for (auto &info : net_def.output_info()) {
+    io_infos_.push_back(MakeIOInfo(
+        info.name(), info.has_name(), info.dims(),
+        info.has_node_id(), info.node_id(),
+        info.has_max_byte_size(), info.max_byte_size(),
+        info.has_data_type(), info.data_type()));
+  }
+  net.output_infos.count = net_def.output_info_size();
+  net.flags = Flag(net_def.has_name(), FLAT_HAS_NAME)
+      | Flag(net_def.has_version(), FLAT_HAS_VERSION)
+      | Flag(net_def.has_mem_arena(), FLAT_HAS_MEM_ARENA);
+
+  const std::pair<const void *, size_t> sections[FLAT_NUM_SECTIONS] = {
+      {strings_.data(), strings_.size()},
+      {int64_pool_.data(), int64_pool_.size()},
+      {int32_pool_.data(), int32_pool_.size()},
+      {float_pool_.data(), float_pool_.size()},
+      {string_pool_.data(), string_pool_.size()},
+      {range_pool_.data(), range_pool_.size()},
+      {args_.data(), args_.size()},
+      {quantize_infos_.data(), quantize_infos_.size()},
+      {ops_.data(), ops_.size()},
+      {tensors_.data(), tensors_.size()},
+      {mem_blocks_.data(), mem_blocks_.size()},
+      {io_infos_.data(), io_infos_.size()},
+      {&net, 1},
+  };
+
+  FlatGraphHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kFlatGraphMagic, sizeof(header.magic));
+  header.version = kFlatGraphVersion;
+  header.num_sections = FLAT_NUM_SECTIONS;
+  size_t offset = AlignUp(sizeof(header));
+  for (int i = 0; i < FLAT_NUM_SECTIONS; ++i) {
+    header.sections[i].offset = offset;
+    header.sections[i].count = sections[i].second;
+    offset = AlignUp(offset + sections[i].second * kElementSizes[i]);
+  }
+  if (offset > UINT32_MAX) {
+    LOG(ERROR) << "Net is too large for the flat graph format";
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  header.file_size = offset;
+
+  data->assign(offset, 0);
+  memcpy(data->data(), &header, sizeof(header));
+  for (int i = 0; i < FLAT_NUM_SECTIONS; ++i) {
+    if (sections[i].second > 0) {
+      memcpy(data->data() + header.sections[i].offset, sections[i].first,
+             sections[i].second * kElementSizes[i]);
+    }
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+}  // namespace
+
+MaceStatus SerializeFlatGraph(const NetDef &net_def,
+                              std::vector<unsigned char> *data) {
+  MACE_CHECK_NOTNULL(data);
+  FlatGraphBuilder builder;
+  return builder.Build(net_def, data);
+}
+
+FlatGraph::FlatGraph()
+    : data_(nullptr), size_(0), header_(nullptr), net_(nullptr) {}
+
+#define MACE_FLAT_CHECK(condition, ...)                                     \
+  if (!(condition)) {                                                       \
+    LOG(ERROR) << "Invalid flat graph: " << MakeString(__VA_ARGS__);        \
+    return MaceStatus::MACE_INVALID_ARGS;                                   \
+  }
+
+MaceStatus FlatGraph::Open(const unsigned char *data, size_t size) {
+  MACE_FLAT_CHECK(data != nullptr && size >= sizeof(FlatGraphHeader),
+                  "too small");
+  MACE_FLAT_CHECK(reinterpret_cast<uintptr_t>(data) % kFlatAlignment == 0,
+                  "data is not aligned");
+  const FlatGraphHeader *header =
+      reinterpret_cast<const FlatGraphHeader *>(data);
+  MACE_FLAT_CHECK(memcmp(header->magic, kFlatGraphMagic,
+                         sizeof(header->magic)) == 0, "bad magic");
+  MACE_FLAT_CHECK(header->version == kFlatGraphVersion,
+                  "version ", header->version, ", expected ",
+                  kFlatGraphVersion);
+  MACE_FLAT_CHECK(header->num_sections == FLAT_NUM_SECTIONS
+                      && header->file_size == size,
+                  "bad header");
+  for (int i = 0; i < FLAT_NUM_SECTIONS; ++i) {
+    const FlatSection &section = header->sections[i];
+    MACE_FLAT_CHECK(section.offset % kFlatAlignment == 0
+                        && section.offset <= size
+                        && section.count <= size
+                        && section.count * kElementSizes[i]
+                            <= size - section.offset,
+                    "section ", i, " out of bounds");
+  }
+  MACE_FLAT_CHECK(header->sections[FLAT_NET].count == 1, "no net");
+
+  data_ = data;
+  size_ = size;
+  header_ = header;
+  net_ = Section<FlatNet>(FLAT_NET);
+
+  // Checks the references, so the readers can use them as they are
+  auto count = [header](FlatGraphSectionType type) {
+    return header->sections[type].count;
+  };
+  auto in_range = [&count](const FlatRange &range,
+                           FlatGraphSectionType type) {
+    return static_cast<uint64_t>(range.begin) + range.count <= count(type);
+  };
+  auto in_strings = [&count](const FlatString &str) {
+    return static_cast<uint64_t>(str.offset) + str.size
+        <= count(FLAT_STRINGS);
+  };
+  const FlatString *string_pool = Section<FlatString>(FLAT_STRING_POOL);
+  for (uint64_t i = 0; i < count(FLAT_STRING_POOL); ++i) {
+    MACE_FLAT_CHECK(in_strings(string_pool[i]), "string ", i);
+  }
+  const FlatRange *range_pool = Section<FlatRange>(FLAT_RANGE_POOL);
+  for (uint64_t i = 0; i < count(FLAT_RANGE_POOL); ++i) {
+    MACE_FLAT_CHECK(in_range(range_pool[i], FLAT_INT64_POOL), "range ", i);
+  }
+  const FlatArg *args = Section<FlatArg>(FLAT_ARGS);
+  for (uint64_t i = 0; i < count(FLAT_ARGS); ++i) {
+    MACE_FLAT_CHECK(in_strings(args[i].name) && in_strings(args[i].s)
+                        && in_range(args[i].floats, FLAT_FLOAT_POOL)
+                        && in_range(args[i].ints, FLAT_INT64_POOL),
+                    "arg ", i);
+  }
+  const FlatOp *ops = Section<FlatOp>(FLAT_OPS);
+  for (uint64_t i = 0; i < count(FLAT_OPS); ++i) {
+    const FlatOp &op = ops[i];
+    FlatRange node_inputs = {op.node_inputs.begin, op.node_inputs.count * 2};
+    MACE_FLAT_CHECK(in_strings(op.name) && in_strings(op.type)
+                        && in_range(op.inputs, FLAT_STRING_POOL)
+                        && in_range(op.outputs, FLAT_STRING_POOL)
+                        && in_range(op.args, FLAT_ARGS)
+                        && in_range(op.output_shapes, FLAT_RANGE_POOL)
+                        && in_range(op.output_types, FLAT_INT32_POOL)
+                        && in_range(op.quantize_infos, FLAT_QUANTIZE_INFOS)
+                        && in_range(op.mem_ids, FLAT_INT32_POOL)
+                        && op.node_inputs.count <= UINT32_MAX / 2
+                        && in_range(node_inputs, FLAT_INT32_POOL)
+                        && in_range(op.out_max_byte_size, FLAT_INT32_POOL),
+                    "op ", i);
+    const int32_t *output_types =
+        Section<int32_t>(FLAT_INT32_POOL) + op.output_types.begin;
+    for (uint32_t j = 0; j < op.output_types.count; ++j) {
+      MACE_FLAT_CHECK(DataType_IsValid(output_types[j]), "op ", i);
+    }
+  }
+  const FlatTensor *tensors = Section<FlatTensor>(FLAT_TENSORS);
+  for (uint64_t i = 0; i < count(FLAT_TENSORS); ++i) {
+    MACE_FLAT_CHECK(in_strings(tensors[i].name)
+                        && in_range(tensors[i].dims, FLAT_INT64_POOL)
+                        && DataType_IsValid(tensors[i].data_type),
+                    "tensor ", i);
+  }
+  const FlatIOInfo *io_infos = Section<FlatIOInfo>(FLAT_IO_INFOS);
+  for (uint64_t i = 0; i < count(FLAT_IO_INFOS); ++i) {
+    MACE_FLAT_CHECK(in_strings(io_infos[i].name)
+                        && in_range(io_infos[i].dims, FLAT_INT32_POOL)
+                        && DataType_IsValid(io_infos[i].data_type),
+                    "io info ", i);
+  }
+  const FlatMemBlock *mem_blocks = Section<FlatMemBlock>(FLAT_MEM_BLOCKS);
+  for (uint64_t i = 0; i < count(FLAT_MEM_BLOCKS); ++i) {
+    MACE_FLAT_CHECK(MemoryType_IsValid(mem_blocks[i].mem_type),
+                    "mem block ", i);
+  }
+  MACE_FLAT_CHECK(in_strings(net_->name) && in_strings(net_->version)
+                      && in_range(net_->args, FLAT_ARGS)
+                      && in_range(net_->ops, FLAT_OPS)
+                      && in_range(net_->tensors, FLAT_TENSORS)
+                      && in_range(net_->mem_blocks, FLAT_MEM_BLOCKS)
+                      && in_range(net_->input_infos, FLAT_IO_INFOS)
+                      && in_range(net_->output_infos, FLAT_IO_INFOS),
+                  "net");
+  return MaceStatus::MACE_SUCCESS;
+}
+
+#undef MACE_FLAT_CHECK
+
+void FlatGraph::ToArgument(const FlatArg &flat_arg, Argument *arg) const {
+  if (flat_arg.flags & FLAT_HAS_NAME) arg->set_name(String(flat_arg.name));
+  if (flat_arg.flags & FLAT_HAS_F) arg->set_f(flat_arg.f);
+  if (flat_arg.flags & FLAT_HAS_I) arg->set_i(flat_arg.i);
+  if (flat_arg.flags & FLAT_HAS_S) {
+    arg->set_s(Section<char>(FLAT_STRINGS) + flat_arg.s.offset,
+               flat_arg.s.size);
+  }
+  const float *floats = Section<float>(FLAT_FLOAT_POOL) + flat_arg.floats.begin;
+  arg->mutable_floats()->Reserve(flat_arg.floats.count);
+  for (uint32_t i = 0; i < flat_arg.floats.count; ++i) {
+    arg->add_floats(floats[i]);
+  }
+  const int64_t *ints = Section<int64_t>(FLAT_INT64_POOL) + flat_arg.ints.begin;
+  arg->mutable_ints()->Reserve(flat_arg.ints.count);
+  for (uint32_t i = 0; i < flat_arg.ints.count; ++i) {
+    arg->add_ints(ints[i]);
+  }
+}
+
+void FlatGraph::ToOperatorDef(const FlatOp &flat_op, OperatorDef *op) const {
+  const FlatString *string_pool = Section<FlatString>(FLAT_STRING_POOL);
+  const int32_t *int32_pool = Section<int32_t>(FLAT_INT32_POOL);
+  const int64_t *int64_pool = Section<int64_t>(FLAT_INT64_POOL);
+  if (flat_op.flags & FLAT_HAS_NAME) op->set_name(String(flat_op.name));
+  if (flat_op.flags & FLAT_HAS_TYPE) op->set_type(String(flat_op.type));
+  op->mutable_input()->Reserve(flat_op.inputs.count);
+  for (uint32_t i = 0; i < flat_op.inputs.count; ++i) {
+    op->add_input(String(string_pool[flat_op.inputs.begin + i]));
+  }
+  op->mutable_output()->Reserve(flat_op.outputs.count);
+  for (uint32_t i = 0; i < flat_op.outputs.count; ++i) {
+    op->add_output(String(string_pool[flat_op.outputs.begin + i]));
+  }
+  const FlatArg *args = Section<FlatArg>(FLAT_ARGS) + flat_op.args.begin;
+  op->mutable_arg()->Reserve(flat_op.args.count);
+  for (uint32_t i = 0; i < flat_op.args.count; ++i) {
+    ToArgument(args[i], op->add_arg());
+  }
+  const FlatRange *shapes =
+      Section<FlatRange>(FLAT_RANGE_POOL) + flat_op.output_shapes.begin;
+  for (uint32_t i = 0; i < flat_op.output_shapes.count; ++i) {
+    OutputShape *shape = op->add_output_shape();
+    shape->mutable_dims()->Reserve(shapes[i].count);
+    for (uint32_t j = 0; j < shapes[i].count; ++j) {
+      shape->add_dims(int64_pool[shapes[i].begin + j]);
+    }
+  }
+  for (uint32_t i = 0; i < flat_op.output_types.count; ++i) {
+    op->add_output_type(static_cast<DataType>(
+        int32_pool[flat_op.output_types.begin + i]));
+  }
+  const FlatQuantizeInfo *quantize_infos =
+      Section<FlatQuantizeInfo>(FLAT_QUANTIZE_INFOS)
+          + flat_op.quantize_infos.begin;
+  for (uint32_t i = 0; i < flat_op.quantize_infos.count; ++i) {
+    const FlatQuantizeInfo &flat_info = quantize_infos[i];
+    QuantizeActivationInfo *info = op->add_quantize_info();
+    if (flat_info.flags & FLAT_HAS_SCALE) info->set_scale(flat_info.scale);
+    if (flat_info.flags & FLAT_HAS_ZERO_POINT) {
+      info->set_zero_point(flat_info.zero_point);
+    }
+    if (flat_info.flags & FLAT_HAS_MINVAL) info->set_minval(flat_info.minval);
+    if (flat_info.flags & FLAT_HAS_MAXVAL) info->set_maxval(flat_info.maxval);
+  }
+  for (uint32_t i = 0; i < flat_op.mem_ids.count; ++i) {
+    op->add_mem_id(int32_pool[flat_op.mem_ids.begin + i]);
+  }
+  if (flat_op.flags & FLAT_HAS_NODE_ID) op->set_node_id(flat_op.node_id);
+  if (flat_op.flags & FLAT_HAS_OP_ID) op->set_op_id(flat_op.op_id);
+  if (flat_op.flags & FLAT_HAS_PADDING) op->set_padding(flat_op.padding);
+  for (uint32_t i = 0; i < flat_op.node_inputs.count; ++i) {
+    NodeInput *node_input = op->add_node_input();
+    node_input->set_node_id(int32_pool[flat_op.node_inputs.begin + 2 * i]);
+    node_input->set_output_port(
+        int32_pool[flat_op.node_inputs.begin + 2 * i + 1]);
+  }
+  for (uint32_t i = 0; i < flat_op.out_max_byte_size.count; ++i) {
+    op->add_out_max_byte_size(
+        int32_pool[flat_op.out_max_byte_size.begin + i]);
+  }
+}
+
+namespace {
+
+template <typename Info>
+void ToIOInfo(const FlatGraph &graph, const FlatIOInfo &flat_info,
+              Info *info) {
+  if (flat_info.flags & FLAT_HAS_NAME) {
+    info->set_name(graph.String(flat_info.name));
+  }
+  if (flat_info.flags & FLAT_HAS_NODE_ID) info->set_node_id(flat_info.node_id);
+  const int32_t *dims =
+      graph.Section<int32_t>(FLAT_INT32_POOL) + flat_info.dims.begin;
+  for (uint32_t i = 0; i < flat_info.dims.count; ++i) {
+    info->add_dims(dims[i]);
+  }
+  if (flat_info.flags & FLAT_HAS_MAX_BYTE_SIZE) {
+    info->set_max_byte_size(flat_info.max_byte_size);
+  }
+  if (flat_info.flags & FLAT_HAS_DATA_TYPE) {
+    info->set_data_type(static_cast<DataType>(flat_info.data_type));
+  }
+}
+
+}  // namespace
+
+MaceStatus FlatGraph::ToNetDef(NetDef *net_def) const {
+  MACE_CHECK_NOTNULL(net_def);
+  MACE_CHECK(net_ != nullptr, "Flat graph is not opened");
+  net_def->Clear();
+  if (net_->flags & FLAT_HAS_NAME) net_def->set_name(String(net_->name));
+  if (net_->flags & FLAT_HAS_VERSION) {
+    net_def->set_version(String(net_->version));
+  }
+  const FlatArg *args = Section<FlatArg>(FLAT_ARGS) + net_->args.begin;
+  for (uint32_t i = 0; i < net_->args.count; ++i) {
+    ToArgument(args[i], net_def->add_arg());
+  }
+  const FlatOp *ops = Section<FlatOp>(FLAT_OPS) + net_->ops.begin;
+  net_def->mutable_op()->Reserve(net_->ops.count);
+  for (uint32_t i = 0; i < net_->ops.count; ++i) {
+    ToOperatorDef(ops[i], net_def->add_op());
+  }
+  const FlatTensor *tensors =
+      Section<FlatTensor>(FLAT_TENSORS) + net_->tensors.begin;
+  const int64_t *int64_pool = Section<int64_t>(FLAT_INT64_POOL);
+  net_def->mutable_tensors()->Reserve(net_->tensors.count);
+  for (uint32_t i = 0; i < net_->tensors.count; ++i) {
+    const FlatTensor &flat_tensor = tensors[i];
+    ConstTensor *tensor = net_def->add_tensors();
+    for (uint32_t j = 0; j < flat_tensor.dims.count; ++j) {
+      tensor->add_dims(int64_pool[flat_tensor.dims.begin + j]);
+    }
+    const uint32_t flags = flat_tensor.flags;
+    if (flags & FLAT_HAS_DATA_TYPE) {
+      tensor->set_data_type(static_cast<DataType>(flat_tensor.data_type));
+    }
+    if (flags & FLAT_HAS_NAME) tensor->set_name(String(flat_tensor.name));
+    if (flags & FLAT_HAS_OFFSET) tensor->set_offset(flat_tensor.offset);
+    if (flags & FLAT_HAS_DATA_SIZE) {
+      tensor->set_data_size(flat_tensor.data_size);
+    }
+    if (flags & FLAT_HAS_SCALE) tensor->set_scale(flat_tensor.scale);
+    if (flags & FLAT_HAS_ZERO_POINT) {
+      tensor->set_zero_point(flat_tensor.zero_point);
+    }
+    if (flags & FLAT_HAS_QUANTIZED) {
+      tensor->set_quantized((flags & FLAT_QUANTIZED) != 0);
+    }
+    if (flags & FLAT_HAS_NODE_ID) tensor->set_node_id(flat_tensor.node_id);
+  }
+  if (net_->flags & FLAT_HAS_MEM_ARENA) {
+    MemoryArena *arena = net_def->mutable_mem_arena();
+    const FlatMemBlock *blocks =
+        Section<FlatMemBlock>(FLAT_MEM_BLOCKS) + net_->mem_blocks.begin;
+    for (uint32_t i = 0; i < net_->mem_blocks.count; ++i) {
+      const FlatMemBlock &flat_block = blocks[i];
+      MemoryBlock *block = arena->add_mem_block();
+      if (flat_block.flags & FLAT_HAS_MEM_ID) {
+        block->set_mem_id(flat_block.mem_id);
+      }
+      if (flat_block.flags & FLAT_HAS_DEVICE_TYPE) {
+        block->set_device_type(flat_block.device_type);
+      }
+      if (flat_block.flags & FLAT_HAS_MEM_TYPE) {
+        block->set_mem_type(static_cast<MemoryType>(flat_block.mem_type));
+      }
+      if (flat_block.flags & FLAT_HAS_X) block->set_x(flat_block.x);
+      if (flat_block.flags & FLAT_HAS_Y) block->set_y(flat_block.y);
+    }
+  }
+  const FlatIOInfo *io_infos = Section<FlatIOInfo>(FLAT_IO_INFOS);
+  for (uint32_t i = 0; i < net_->input_infos.count; ++i) {
+    ToIOInfo(*this, io_infos[net_->input_infos.begin + i],
+             net_def->add_input_info());
+  }
+  for (uint32_t i = 0; i < net_->output_infos.count; ++i) {
+    ToIOInfo(*this, io_infos[net_->output_infos.begin + i],
+             net_def->add_output_info());
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus FlatGraph::CreateNetDef(std::shared_ptr<NetDef> *net_def) const {
+  MACE_CHECK_NOTNULL(net_def);
+  MACE_CHECK(net_ != nullptr, "Flat graph is not opened");
+  // The messages take about as much memory as the records, so one block
+  // of twice the graph size mostly holds them all
+  google::protobuf::ArenaOptions options;
+  options.start_block_size = std::max(options.start_block_size, 2 * size_);
+  options.max_block_size = std::max(options.max_block_size,
+                                    options.start_block_size);
+  std::shared_ptr<google::protobuf::Arena> arena(
+      new google::protobuf::Arena(options));
+  NetDef *arena_net_def =
+      google::protobuf::Arena::CreateMessage<NetDef>(arena.get());
+  MACE_RETURN_IF_ERROR(ToNetDef(arena_net_def));
+  *net_def = std::shared_ptr<NetDef>(arena, arena_net_def);
+  return MaceStatus::MACE_SUCCESS;
+}
+
+}  // namespace mace
@@ -0,0 +1,234 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_FLAT_GRAPH_H_
+#define MACE_CORE_FLAT_GRAPH_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mace/proto/mace.pb.h"
+#include "mace/public/mace.h"
+
+namespace mace {
+
+// A NetDef laid out as fixed-size records, which can be used in place
+// from a mapped file. The file starts with a FlatGraphHeader, whose
+// sections are arrays of the records below; strings and repeated fields
+// are (offset, count) references into the pool sections. All records are
+// 8-byte aligned and stored in the host byte order.
+//
+// Changing the layout of any record must bump kFlatGraphVersion.
+constexpr char kFlatGraphMagic[8] = {'M', 'A', 'C', 'E', 'F', 'L', 'A', 'T'};
+constexpr uint32_t kFlatGraphVersion = 1;
+
+enum FlatGraphSectionType {
+  FLAT_STRINGS = 0,      // char
+  FLAT_INT64_POOL,       // int64_t
+  FLAT_INT32_POOL,       // int32_t
+  FLAT_FLOAT_POOL,       // float
+  FLAT_STRING_POOL,      // FlatString
+  FLAT_RANGE_POOL,       // FlatRange
+  FLAT_ARGS,             // FlatArg
+  FLAT_QUANTIZE_INFOS,   // FlatQuantizeInfo
+  FLAT_OPS,              // FlatOp
+  FLAT_TENSORS,          // FlatTensor
+  FLAT_MEM_BLOCKS,       // FlatMemBlock
+  FLAT_IO_INFOS,         // FlatIOInfo
+  FLAT_NET,              // FlatNet, one record
+  FLAT_NUM_SECTIONS,
+};
+
+struct FlatSection {
+  uint64_t offset;
+  uint64_t count;
+};
+
+struct FlatGraphHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_sections;
+  uint64_t file_size;
+  FlatSection sections[FLAT_NUM_SECTIONS];
+};
+
+struct FlatString {
+  uint32_t offset;
+  uint32_t size;
+};
+
+struct FlatRange {
+  uint32_t begin;
+  uint32_t count;
+};
+
+// Presence bits of the optional fields
+enum FlatFieldFlag : uint32_t {
+  FLAT_HAS_NAME = 1 << 0,
+  FLAT_HAS_TYPE = 1 << 1,
+  FLAT_HAS_F = 1 << 2,
+  FLAT_HAS_I = 1 << 3,
+  FLAT_HAS_S = 1 << 4,
+  FLAT_HAS_NODE_ID = 1 << 5,
+  FLAT_HAS_OP_ID = 1 << 6,
+  FLAT_HAS_PADDING = 1 << 7,
+  FLAT_HAS_DATA_TYPE = 1 << 8,
+  FLAT_HAS_OFFSET = 1 << 9,
+  FLAT_HAS_DATA_SIZE = 1 << 10,
+  FLAT_HAS_SCALE = 1 << 11,
+  FLAT_HAS_ZERO_POINT = 1 << 12,
+  FLAT_HAS_QUANTIZED = 1 << 13,
+  FLAT_QUANTIZED = 1 << 14,
+  FLAT_HAS_MINVAL = 1 << 15,
+  FLAT_HAS_MAXVAL = 1 << 16,
+  FLAT_HAS_MEM_ID = 1 << 17,
+  FLAT_HAS_DEVICE_TYPE = 1 << 18,
+  FLAT_HAS_MEM_TYPE = 1 << 19,
+  FLAT_HAS_X = 1 << 20,
+  FLAT_HAS_Y = 1 << 21,
+  FLAT_HAS_MAX_BYTE_SIZE = 1 << 22,
+  FLAT_HAS_VERSION = 1 << 23,
+  FLAT_HAS_MEM_ARENA = 1 << 24,
+};
+
+struct FlatArg {
+  FlatString name;
+  FlatString s;
+  int64_t i;
+  float f;
+  uint32_t flags;
+  FlatRange floats;  // float pool
+  FlatRange ints;    // int64 pool
+};
+
+struct FlatQuantizeInfo {
+  float scale;
+  int32_t zero_point;
+  float minval;
+  float maxval;
+  uint32_t flags;
+  uint32_t reserved;
+};
+
+struct FlatOp {
+  FlatString name;
+  FlatString type;
+  FlatRange inputs;             // string pool
+  FlatRange outputs;            // string pool
+  FlatRange args;               // args
+  FlatRange output_shapes;      // range pool, each into the int64 pool
+  FlatRange output_types;       // int32 pool
+  FlatRange quantize_infos;     // quantize infos
+  FlatRange mem_ids;            // int32 pool
+  FlatRange node_inputs;        // int32 pool, (node_id, output_port) pairs
+  FlatRange out_max_byte_size;  // int32 pool
+  uint32_t node_id;
+  uint32_t op_id;
+  uint32_t padding;
+  uint32_t flags;
+};
+
+struct FlatTensor {
+  FlatString name;
+  FlatRange dims;  // int64 pool
+  int64_t offset;
+  int64_t data_size;
+  int32_t data_type;
+  float scale;
+  int32_t zero_point;
+  uint32_t node_id;
+  uint32_t flags;
+  uint32_t reserved;
+};
+
+struct FlatMemBlock {
+  int32_t mem_id;
+  int32_t device_type;
+  int32_t mem_type;
+  uint32_t x;
+  uint32_t y;
+  uint32_t flags;
+};
+
+struct FlatIOInfo {
+  FlatString name;
+  FlatRange dims;  // int32 pool
+  int32_t node_id;
+  int32_t max_byte_size;
+  int32_t data_type;
+  uint32_t flags;
+};
+
+struct FlatNet {
+  FlatString name;
+  FlatString version;
+  FlatRange args;          // args
+  FlatRange ops;           // ops
+  FlatRange tensors;       // tensors
+  FlatRange mem_blocks;    // mem blocks
+  FlatRange input_infos;   // io infos
+  FlatRange output_infos;  // io infos
+  uint32_t flags;
+  uint32_t reserved;
+};
+
+// Serializes the net into the flat format. Tensors must keep their data in
+// the model data file: inline float_data and int32_data are not supported.
+MaceStatus SerializeFlatGraph(const NetDef &net_def,
+                              std::vector<unsigned char> *data);
+
+// A read-only view over flat graph bytes, which must outlive it.
+class FlatGraph {
+ public:
+  FlatGraph();
+
+  // Checks the header and that every reference stays inside its section,
+  // so the accessors below need no checks.
+  MaceStatus Open(const unsigned char *data, size_t size);
+
+  const FlatNet &net() const { return *net_; }
+
+  template <typename T>
+  const T *Section(FlatGraphSectionType type) const {
+    return reinterpret_cast<const T *>(data_ + header_->sections[type].offset);
+  }
+
+  std::string String(const FlatString &str) const {
+    return std::string(Section<char>(FLAT_STRINGS) + str.offset, str.size);
+  }
+
+  // Fills the NetDef straight from the records, without the wire format
+  // decoding and the per-field allocations of ParseFromArray.
+  MaceStatus ToNetDef(NetDef *net_def) const;
+
+  // As ToNetDef, into a NetDef created on an arena sized for the graph, so
+  // that its messages and strings take a few blocks instead of one heap
+  // allocation each. The arena lives as long as the returned pointer.
+  MaceStatus CreateNetDef(std::shared_ptr<NetDef> *net_def) const;
+
+ private:
+  void ToOperatorDef(const FlatOp &flat_op, OperatorDef *op) const;
+  void ToArgument(const FlatArg &flat_arg, Argument *arg) const;
+
+  const unsigned char *data_;
+  size_t size_;
+  const FlatGraphHeader *header_;
+  const FlatNet *net_;
+};
+
+}  // namespace mace
+
+#endif  // MACE_CORE_FLAT_GRAPH_H_
@@ -0,0 +1,81 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mace/core/flat_graph.h"
+#include "mace/core/testing/test_net_util.h"
+
+namespace mace {
+namespace test {
+
+TEST(FlatGraphTest, SerializeAndLoad) {
+  NetDef net_def;
+  std::vector<float> model_data;
+  BuildResidualNet(&net_def, &model_data);
+  net_def.set_name("residual");
+  net_def.mutable_op(0)->add_mem_id(0);
+  net_def.mutable_op(0)->set_node_id(7);
+  NodeInput *node_input = net_def.mutable_op(0)->add_node_input();
+  node_input->set_node_id(1);
+  node_input->set_output_port(2);
+  QuantizeActivationInfo *quantize_info =
+      net_def.mutable_op(1)->add_quantize_info();
+  quantize_info->set_scale(0.5f);
+  quantize_info->set_zero_point(128);
+  MemoryBlock *mem_block = net_def.mutable_mem_arena()->add_mem_block();
+  mem_block->set_mem_id(0);
+  mem_block->set_x(32);
+  InputInfo *input_info = net_def.add_input_info();
+  input_info->set_name("Input");
+  input_info->add_dims(1);
+  input_info->add_dims(2);
+  net_def.mutable_tensors(0)->set_quantized(false);
+
+  std::vector<unsigned char> data;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS, SerializeFlatGraph(net_def, &data));
+  FlatGraph graph;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS, graph.Open(data.data(), data.size()));
+  EXPECT_EQ(static_cast<uint32_t>(net_def.op_size()), graph.net().ops.count);
+  NetDef loaded_net_def;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS, graph.ToNetDef(&loaded_net_def));
+  EXPECT_EQ(net_def.SerializeAsString(), loaded_net_def.SerializeAsString());
+  std::shared_ptr<NetDef> arena_net_def;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS, graph.CreateNetDef(&arena_net_def));
+  EXPECT_NE(nullptr, arena_net_def->GetArena());
+  EXPECT_EQ(net_def.SerializeAsString(), arena_net_def->SerializeAsString());
+
+  // The loaded net runs as the original one
+  std::vector<float> expected, output;
+  Workspace ws, loaded_ws;
+  RunResidualNet(net_def, model_data, &ws, &expected);
+  RunResidualNet(loaded_net_def, model_data, &loaded_ws, &output);
+  EXPECT_EQ(expected, output);
+
+  // Truncated, or written by another version
+  EXPECT_EQ(MaceStatus::MACE_INVALID_ARGS,
+            FlatGraph().Open(data.data(), data.size() - 8));
+  reinterpret_cast<FlatGraphHeader *>(data.data())->version += 1;
+  EXPECT_EQ(MaceStatus::MACE_INVALID_ARGS,
+            FlatGraph().Open(data.data(), data.size()));
+
+  // Inline data is not kept
+  net_def.mutable_tensors(0)->add_float_data(1.f);
+  EXPECT_EQ(MaceStatus::MACE_INVALID_ARGS, SerializeFlatGraph(net_def, &data));
+}
+
+}  // namespace test
+}  // namespace mace
@@ -0,0 +1,703 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/graph_optimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <numeric>
+
+#include "mace/core/arg_helper.h"
+#include "mace/core/op_kernel_context.h"
+#include "mace/core/operator.h"
+#include "mace/utils/logging.h"
+
+namespace mace {
+namespace {
+
+// kernels::EltwiseType::SUM
+constexpr int kEltwiseSum = 0;
+
+bool IsFloatOp(const OperatorDef &op) {
+  return ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+      op, "T", static_cast<int>(DT_FLOAT)) == static_cast<int>(DT_FLOAT);
+}
+
+bool HasActivation(const OperatorDef &op) {
+  return ProtoArgHelper::GetOptionalArg<OperatorDef, std::string>(
+      op, "activation", "NOOP") != "NOOP";
+}
+
+index_t ShapeSize(const std::vector<index_t> &dims) {
+  return std::accumulate(dims.begin(), dims.end(), static_cast<index_t>(1),
+                         std::multiplies<index_t>());
+}
+
+// Returns the only op reading the output of op, once, or nullptr if the
+// output is read by several ops or must keep its name.
+OperatorDef *SingleConsumer(GraphPassContext *context,
+                            const OperatorDef &op) {
+  if (op.output_size() != 1 || context->IsNetOutput(op.output(0))) {
+    return nullptr;
+  }
+  const std::vector<OperatorDef *> &consumers =
+      context->Consumers(op.output(0));
+  if (consumers.size() != 1
+      || std::count(consumers[0]->input().begin(),
+                    consumers[0]->input().end(), op.output(0)) != 1) {
+    return nullptr;
+  }
+  return consumers[0];
+}
+
+// Whether the tensor is available to the op at op_idx, i.e. it is not
+// written by the op or an op after it.
+bool IsAvailableAt(GraphPassContext *context,
+                   const std::string &name,
+                   const int op_idx) {
+  int producer_idx = -1;
+  return context->Producer(name, &producer_idx) == nullptr
+      || producer_idx < op_idx;
+}
+
+void CopyActivation(const OperatorDef &from, OperatorDef *to) {
+  for (const std::string arg_name : {"activation", "max_limit"}) {
+    auto *args = to->mutable_arg();
+    for (int i = args->size() - 1; i >= 0; --i) {
+      if (args->Get(i).name() == arg_name) {
+        args->DeleteSubrange(i, 1);
+      }
+    }
+    for (auto &arg : from.arg()) {
+      if (arg.name() == arg_name) {
+        to->add_arg()->CopyFrom(arg);
+      }
+    }
+  }
+}
+
+// Makes producer write the output of consumer, which is then removed.
+void TakeOutput(const OperatorDef &consumer, OperatorDef *producer) {
+  producer->set_name(consumer.name());
+  producer->set_output(0, consumer.output(0));
+  producer->mutable_output_shape()->CopyFrom(consumer.output_shape());
+  producer->mutable_output_type()->CopyFrom(consumer.output_type());
+}
+
+// Evaluates the ops whose inputs are constants once, replacing their
+// outputs by const tensors. With static_shapes, an op which only reads the
+// shape of its input (Shape, InferConv2dShape) takes the shape recorded
+// for the input as a constant too.
+class FoldConstantsPass : public GraphPass {
+ public:
+  FoldConstantsPass(const std::string &name,
+                    const bool static_shapes,
+                    const OperatorRegistryBase *op_registry,
+                    Device *device)
+      : name_(name),
+        static_shapes_(static_shapes),
+        op_registry_(op_registry),
+        device_(device) {}
+
+  std::string name() const override { return name_; }
+
+  int Run(GraphPassContext *context) override {
+    if (op_registry_ == nullptr || device_ == nullptr) return 0;
+    NetDef *net_def = context->net_def();
+    // The folded ops run in a workspace of their own, holding their
+    // inputs and outputs.
+    Workspace folded_ws;
+    std::vector<std::string> folded_tensors;
+    int count = 0;
+    for (int i = 0; i < net_def->op_size();) {
+      const OperatorDef *op = &net_def->op(i);
+      if (!CanFold(context, folded_ws, *op)
+          || !Fold(context, *op, &folded_ws)) {
+        ++i;
+        continue;
+      }
+      VLOG(1) << "Fold constant op: " << op->name();
+      folded_tensors.insert(folded_tensors.end(), op->output().begin(),
+                            op->output().end());
+      context->RemoveOp(op);
+      ++count;
+    }
+
+    // Keep the folded tensors the remaining ops read
+    for (auto &name : folded_tensors) {
+      if (context->Consumers(name).empty()) continue;
+      const Tensor *tensor = folded_ws.GetTensor(name);
+      Tensor::MappingGuard guard(tensor);
+      Tensor *const_tensor = context->CreateConstTensor(
+          name, tensor->dtype(), tensor->shape());
+      memcpy(const_tensor->raw_mutable_data(), tensor->raw_data(),
+             tensor->raw_size());
+    }
+    return count;
+  }
+
+ private:
+  // The ops and data types which can be folded, registered on CPU
+  static const std::map<std::string, std::set<DataType>> &FoldableOps() {
+    static const std::map<std::string, std::set<DataType>> kFoldableOps = {
+        {"Shape", {DT_FLOAT}},
+        {"InferConv2dShape", {DT_FLOAT, DT_INT32}},
+        {"Fill", {DT_FLOAT}},
+        {"StridedSlice", {DT_FLOAT, DT_INT32}},
+        {"Stack", {DT_FLOAT, DT_INT32}},
+        {"ExpandDims", {DT_FLOAT, DT_INT32, DT_UINT8}},
+        {"Unstack", {DT_FLOAT, DT_INT32}},
+        {"Reshape", {DT_FLOAT, DT_INT32}},
+    };
+    return kFoldableOps;
+  }
+
+  static bool ReadsShapeOnly(const OperatorDef &op) {
+    return op.type() == "Shape" || op.type() == "InferConv2dShape";
+  }
+
+  // Returns whether the shape of the tensor is recorded by its producer.
+  static bool StaticShape(GraphPassContext *context,
+                          const std::string &name,
+                          std::vector<index_t> *dims) {
+    const OperatorDef *producer = context->Producer(name);
+    if (producer == nullptr) return false;
+    for (int j = 0; j < producer->output_size()
+        && j < producer->output_shape_size(); ++j) {
+      if (producer->output(j) == name) {
+        dims->assign(producer->output_shape(j).dims().begin(),
+                     producer->output_shape(j).dims().end());
+        return !dims->empty();
+      }
+    }
+    return false;
+  }
+
+  bool CanFold(GraphPassContext *context,
+               const Workspace &folded_ws,
+               const OperatorDef &op) {
+    auto iter = FoldableOps().find(op.type());
+    const DataType data_type = static_cast<DataType>(
+        ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+            op, "T", static_cast<int>(DT_FLOAT)));
+    if (iter == FoldableOps().end()
+        || iter->second.count(data_type) == 0
+        || ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+            op, "mode", static_cast<int>(NetMode::NORMAL))
+            != static_cast<int>(NetMode::NORMAL)
+        || op.input_size() == 0 || op.output_size() == 0) {
+      return false;
+    }
+    for (auto &output : op.output()) {
+      if (context->IsNetOutput(output)
+          || context->workspace()->HasTensor(output)) {
+        return false;
+      }
+    }
+    for (auto &input : op.input()) {
+      DataType input_type;
+      std::vector<index_t> dims;
+      if (!folded_ws.HasTensor(input)
+          && context->ConstData(input, &input_type, &dims) == nullptr
+          && !(static_shapes_ && ReadsShapeOnly(op)
+               && StaticShape(context, input, &dims))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Runs the op in folded_ws, returns false if it could not run.
+  bool Fold(GraphPassContext *context,
+            const OperatorDef &op,
+            Workspace *folded_ws) {
+    for (auto &input : op.input()) {
+      if (folded_ws->HasTensor(input)) continue;
+      DataType data_type;
+      std::vector<index_t> dims;
+      const void *data = context->ConstData(input, &data_type, &dims);
+      if (data != nullptr) {
+        Tensor *tensor = folded_ws->CreateTensor(input, device_->allocator(),
+                                                 data_type);
+        tensor->Resize(dims);
+        Tensor::MappingGuard guard(tensor);
+        memcpy(tensor->raw_mutable_data(), data, tensor->raw_size());
+      } else {
+        // Only the shape is read
+        MACE_CHECK(StaticShape(context, input, &dims));
+        folded_ws->CreateTensor(input, device_->allocator(), DT_FLOAT)
+            ->Resize(dims);
+      }
+    }
+
+    OpKernelContext kernel_context(folded_ws, device_);
+    std::unique_ptr<OperatorBase> folded_op = op_registry_->CreateOperator(
+        op, &kernel_context, DeviceType::CPU, NetMode::NORMAL);
+    if (folded_op == nullptr) return false;
+    if (folded_op->Run(nullptr) != MaceStatus::MACE_SUCCESS) {
+      LOG(WARNING) << "Failed to fold constant op " << op.name();
+      return false;
+    }
+    return true;
+  }
+
+  std::string name_;
+  bool static_shapes_;
+  const OperatorRegistryBase *op_registry_;
+  Device *device_;
+};
+
+class RemoveIdentityPass : public GraphPass {
+ public:
+  std::string name() const override { return "RemoveIdentity"; }
+
+  int Run(GraphPassContext *context) override {
+    NetDef *net_def = context->net_def();
+    int count = 0;
+    for (int i = 0; i < net_def->op_size();) {
+      OperatorDef *op = net_def->mutable_op(i);
+      if (op->type() != "Identity" || op->input_size() < 1
+          || op->output_size() != 1 || context->IsNetOutput(op->output(0))) {
+        ++i;
+        continue;
+      }
+      const std::vector<OperatorDef *> consumers =
+          context->Consumers(op->output(0));
+      for (OperatorDef *consumer : consumers) {
+        for (int j = 0; j < consumer->input_size(); ++j) {
+          if (consumer->input(j) == op->output(0)) {
+            consumer->set_input(j, op->input(0));
+          }
+        }
+      }
+      VLOG(1) << "Remove identity: " << op->name();
+      context->RemoveOp(op);
+      ++count;
+    }
+    return count;
+  }
+};
+
+class FoldBatchNormPass : public GraphPass {
+ public:
+  std::string name() const override { return "FoldBatchNorm"; }
+
+  int Run(GraphPassContext *context) override {
+    NetDef *net_def = context->net_def();
+    int count = 0;
+    for (int i = 0; i < net_def->op_size(); ++i) {
+      OperatorDef *conv = net_def->mutable_op(i);
+      if (conv->type() != "Conv2D" || !IsFloatOp(*conv)
+          || HasActivation(*conv) || conv->input_size() < 2
+          || conv->input_size() > 3) {
+        continue;
+      }
+      OperatorDef *bn = SingleConsumer(context, *conv);
+      if (bn == nullptr || bn->type() != "FoldedBatchNorm"
+          || bn->input_size() != 3 || bn->input(0) != conv->output(0)) {
+        continue;
+      }
+      std::vector<index_t> filter_dims, scale_dims, offset_dims, bias_dims;
+      const float *filter =
+          context->ConstFloatData(conv->input(1), &filter_dims);
+      const float *scale = context->ConstFloatData(bn->input(1), &scale_dims);
+      const float *offset =
+          context->ConstFloatData(bn->input(2), &offset_dims);
+      const float *bias = conv->input_size() == 3
+          ? context->ConstFloatData(conv->input(2), &bias_dims) : nullptr;
+      if (filter == nullptr || scale == nullptr || offset == nullptr
+          || filter_dims.size() != 4) {
+        continue;
+      }
+      // OIHW filter
+      const index_t channels = filter_dims[0];
+      const std::vector<index_t> channel_dims = {channels};
+      if (scale_dims != channel_dims || offset_dims != channel_dims
+          || (conv->input_size() == 3
+              && (bias == nullptr || bias_dims != channel_dims))) {
+        continue;
+      }
+
+      const std::string filter_name = bn->output(0) + "/folded_filter";
+      const std::string bias_name = bn->output(0) + "/folded_bias";
+      float *new_filter = context->CreateConstTensor(filter_name,
+                                                     filter_dims);
+      float *new_bias = context->CreateConstTensor(bias_name, channel_dims);
+      const index_t filter_size = ShapeSize(filter_dims) / channels;
+      for (index_t c = 0; c < channels; ++c) {
+        for (index_t k = 0; k < filter_size; ++k) {
+          new_filter[c * filter_size + k] =
+              filter[c * filter_size + k] * scale[c];
+        }
+        new_bias[c] = offset[c] + (bias == nullptr ? 0 : bias[c] * scale[c]);
+      }
+
+      VLOG(1) << "Fold batch norm: " << bn->name() << " into "
+              << conv->name();
+      conv->set_input(1, filter_name);
+      if (conv->input_size() == 3) {
+        conv->set_input(2, bias_name);
+      } else {
+        conv->add_input(bias_name);
+      }
+      CopyActivation(*bn, conv);
+      TakeOutput(*bn, conv);
+      context->RemoveOp(bn);
+      ++count;
+    }
+    return count;
+  }
+};
+
+class FuseBiasAddPass : public GraphPass {
+ public:
+  std::string name() const override { return "FuseBiasAdd"; }
+
+  int Run(GraphPassContext *context) override {
+    static const std::set<std::string> kBiasOps = {
+        "Conv2D", "DepthwiseConv2d", "FullyConnected"
+    };
+    NetDef *net_def = context->net_def();
+    int count = 0;
+    for (int i = 0; i < net_def->op_size(); ++i) {
+      OperatorDef *op = net_def->mutable_op(i);
+      if (kBiasOps.find(op->type()) == kBiasOps.end() || !IsFloatOp(*op)
+          || HasActivation(*op) || op->input_size() != 2) {
+        continue;
+      }
+      OperatorDef *bias_add = SingleConsumer(context, *op);
+      // The outputs of the convolutions on CPU are NCHW
+      if (bias_add == nullptr || bias_add->type() != "BiasAdd"
+          || bias_add->input_size() != 2
+          || bias_add->input(0) != op->output(0)
+          || ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+              *bias_add, "data_format", NHWC) != NCHW
+          || !IsAvailableAt(context, bias_add->input(1), i)) {
+        continue;
+      }
+      VLOG(1) << "Fuse bias add: " << bias_add->name() << " into "
+              << op->name();
+      op->add_input(bias_add->input(1));
+      TakeOutput(*bias_add, op);
+      context->RemoveOp(bias_add);
+      ++count;
+    }
+    return count;
+  }
+};
+
+class FuseResidualAddPass : public GraphPass {
+ public:
+  std::string name() const override { return "FuseResidualAdd"; }
+
+  int Run(GraphPassContext *context) override {
+    NetDef *net_def = context->net_def();
+    int count = 0;
+    for (int i = 0; i < net_def->op_size(); ++i) {
+      OperatorDef *eltwise = net_def->mutable_op(i);
+      if (eltwise->type() != "Eltwise" || !IsFloatOp(*eltwise)
+          || eltwise->input_size() != 2 || eltwise->output_size() != 1
+          || ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+              *eltwise, "type", -1) != kEltwiseSum
+          || !ProtoArgHelper::GetRepeatedArgs<OperatorDef, float>(
+              *eltwise, "coeff").empty()) {
+        continue;
+      }
+      // Fuse into the later conv, for the residual to be computed before
+      OperatorDef *conv = nullptr;
+      int conv_idx = -1;
+      std::string residual;
+      for (int k = 0; k < 2; ++k) {
+        int idx = -1;
+        OperatorDef *producer = context->Producer(eltwise->input(k), &idx);
+        const std::string &other = eltwise->input(1 - k);
+        if (producer != nullptr && idx > conv_idx
+            && IsResidualConv(context, *producer, *eltwise, other, idx)) {
+          conv = producer;
+          conv_idx = idx;
+          residual = other;
+        }
+      }
+      if (conv == nullptr) continue;
+
+      if (conv->input_size() == 2) {
+        // The residual is input 3, after a zero bias
+        const index_t channels = conv->output_shape(0).dims(1);
+        const std::string bias_name = eltwise->output(0) + "/zero_bias";
+        float *bias = context->CreateConstTensor(bias_name, {channels});
+        std::fill(bias, bias + channels, 0.f);
+        conv->add_input(bias_name);
+      }
+      VLOG(1) << "Fuse residual add: " << eltwise->name() << " into "
+              << conv->name();
+      conv->add_input(residual);
+      TakeOutput(*eltwise, conv);
+      context->RemoveOp(eltwise);
+      ++count;
+    }
+    return count;
+  }
+
+ private:
+  // Whether the conv can add residual to its output in place of eltwise:
+  // a float NCHW convolution with no activation whose output is only read
+  // by eltwise, and a residual of the same shape computed before it.
+  bool IsResidualConv(GraphPassContext *context,
+                      const OperatorDef &conv,
+                      const OperatorDef &eltwise,
+                      const std::string &residual,
+                      const int conv_idx) {
+    if (conv.type() != "Conv2D" || !IsFloatOp(conv) || HasActivation(conv)
+        || conv.input_size() < 2 || conv.input_size() > 3
+        || conv.output_size() != 1 || conv.output(0) == residual
+        || conv.output_shape_size() != 1
+        || conv.output_shape(0).dims_size() != 4
+        || SingleConsumer(context, conv) != &eltwise
+        || !IsAvailableAt(context, residual, conv_idx)) {
+      return false;
+    }
+    const OperatorDef *producer = context->Producer(residual);
+    if (producer == nullptr) return false;
+    for (int j = 0; j < producer->output_size()
+        && j < producer->output_shape_size(); ++j) {
+      if (producer->output(j) == residual) {
+        const auto &dims = producer->output_shape(j).dims();
+        const auto &conv_dims = conv.output_shape(0).dims();
+        return dims.size() == conv_dims.size()
+            && std::equal(dims.begin(), dims.end(), conv_dims.begin());
+      }
+    }
+    return false;
+  }
+};
+
+class FuseActivationPass : public GraphPass {
+ public:
+  std::string name() const override { return "FuseActivation"; }
+
+  int Run(GraphPassContext *context) override {
+    static const std::set<std::string> kActivationOps = {
+        "Conv2D", "Deconv2D", "DepthwiseConv2d", "FullyConnected",
+        "FoldedBatchNorm"
+    };
+    NetDef *net_def = context->net_def();
+    int count = 0;
+    for (int i = 0; i < net_def->op_size(); ++i) {
+      OperatorDef *op = net_def->mutable_op(i);
+      if (kActivationOps.find(op->type()) == kActivationOps.end()
+          || !IsFloatOp(*op) || HasActivation(*op)) {
+        continue;
+      }
+      OperatorDef *activation = SingleConsumer(context, *op);
+      if (activation == nullptr || activation->type() != "Activation"
+          || activation->input_size() != 1
+          || ProtoArgHelper::GetOptionalArg<OperatorDef, std::string>(
+              *activation, "activation", "NOOP") == "PRELU") {
+        continue;
+      }
+      VLOG(1) << "Fuse activation: " << activation->name() << " into "
+              << op->name();
+      CopyActivation(*activation, op);
+      TakeOutput(*activation, op);
+      context->RemoveOp(activation);
+      ++count;
+    }
+    return count;
+  }
+};
+
+}  // namespace
+
+GraphPassContext::GraphPassContext(NetDef *net_def,
+                                   const unsigned char *model_data,
+                                   Workspace *ws)
+    : net_def_(net_def),
+      model_data_(model_data),
+      ws_(ws),
+      index_dirty_(true) {
+  for (auto &const_tensor : net_def->tensors()) {
+    const_tensors_[const_tensor.name()] = &const_tensor;
+  }
+  for (auto &output_info : net_def->output_info()) {
+    output_names_.insert(output_info.name());
+  }
+}
+
+void GraphPassContext::BuildIndex() {
+  consumers_.clear();
+  producers_.clear();
+  for (int i = 0; i < net_def_->op_size(); ++i) {
+    OperatorDef *op = net_def_->mutable_op(i);
+    for (auto &input : op->input()) {
+      auto &consumers = consumers_[input];
+      if (consumers.empty() || consumers.back() != op) {
+        consumers.push_back(op);
+      }
+    }
+    for (auto &output : op->output()) {
+      producers_[output] = i;
+    }
+  }
+  index_dirty_ = false;
+}
+
+const std::vector<OperatorDef *> &GraphPassContext::Consumers(
+    const std::string &name) {
+  if (index_dirty_) BuildIndex();
+  return consumers_[name];
+}
+
+OperatorDef *GraphPassContext::Producer(const std::string &name,
+                                        int *op_idx) {
+  if (index_dirty_) BuildIndex();
+  auto iter = producers_.find(name);
+  if (iter == producers_.end()) return nullptr;
+  if (op_idx != nullptr) *op_idx = iter->second;
+  return net_def_->mutable_op(iter->second);
+}
+
+bool GraphPassContext::IsNetOutput(const std::string &name) {
+  return output_names_.find(name) != output_names_.end()
+      || Consumers(name).empty();
+}
+
+const void *GraphPassContext::ConstData(const std::string &name,
+                                        DataType *data_type,
+                                        std::vector<index_t> *dims) const {
+  if (created_tensors_.find(name) != created_tensors_.end()) {
+    const Tensor *tensor = ws_->GetTensor(name);
+    *data_type = tensor->dtype();
+    *dims = tensor->shape();
+    return tensor->raw_data();
+  }
+  auto iter = const_tensors_.find(name);
+  if (iter == const_tensors_.end() || model_data_ == nullptr) return nullptr;
+  const ConstTensor *const_tensor = iter->second;
+  // Quantized weights are dequantized when loaded
+  if (const_tensor->quantized()) return nullptr;
+  *data_type = const_tensor->data_type();
+  dims->assign(const_tensor->dims().begin(), const_tensor->dims().end());
+  return model_data_ + const_tensor->offset();
+}
+
+const float *GraphPassContext::ConstFloatData(
+    const std::string &name, std::vector<index_t> *dims) const {
+  DataType data_type;
+  const void *data = ConstData(name, &data_type, dims);
+  return data != nullptr && data_type == DT_FLOAT
+      ? static_cast<const float *>(data) : nullptr;
+}
+
+Tensor *GraphPassContext::CreateConstTensor(const std::string &name,
+                                            const DataType data_type,
+                                            const std::vector<index_t> &dims) {
+  MACE_CHECK(!ws_->HasTensor(name) && const_tensors_.count(name) == 0,
+             "Tensor ", name, " exists");
+  Tensor *tensor = ws_->CreateTensor(name, GetCPUAllocator(), data_type);
+  tensor->Resize(dims);
+  created_tensors_.insert(name);
+  return tensor;
+}
+
+float *GraphPassContext::CreateConstTensor(const std::string &name,
+                                           const std::vector<index_t> &dims) {
+  return CreateConstTensor(name, DT_FLOAT, dims)->mutable_data<float>();
+}
+
+void GraphPassContext::RemoveOp(const OperatorDef *op) {
+  auto *ops = net_def_->mutable_op();
+  for (int i = 0; i < ops->size(); ++i) {
+    if (&ops->Get(i) == op) {
+      ops->DeleteSubrange(i, 1);
+      break;
+    }
+  }
+  index_dirty_ = true;
+}
+
+GraphOptimizer::GraphOptimizer(const OperatorRegistryBase *op_registry,
+                               Device *device) {
+  AddPass(std::unique_ptr<GraphPass>(new FoldConstantsPass(
+      "FoldStaticShapes", true, op_registry, device)));
+  AddPass(std::unique_ptr<GraphPass>(new FoldConstantsPass(
+      "FoldConstants", false, op_registry, device)));
+  AddPass(std::unique_ptr<GraphPass>(new RemoveIdentityPass()));
+  AddPass(std::unique_ptr<GraphPass>(new FoldBatchNormPass()));
+  AddPass(std::unique_ptr<GraphPass>(new FuseBiasAddPass()));
+  AddPass(std::unique_ptr<GraphPass>(new FuseResidualAddPass()));
+  AddPass(std::unique_ptr<GraphPass>(new FuseActivationPass()));
+  // Only right for models whose input shapes never change
+  disabled_passes_.insert("FoldStaticShapes");
+}
+
+void GraphOptimizer::AddPass(std::unique_ptr<GraphPass> pass) {
+  passes_.push_back(std::move(pass));
+}
+
+bool GraphOptimizer::SetPassEnabled(const std::string &name,
+                                    const bool enabled) {
+  for (auto &pass : passes_) {
+    if (pass->name() == name) {
+      if (enabled) {
+        disabled_passes_.erase(name);
+      } else {
+        disabled_passes_.insert(name);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void GraphOptimizer::SetAllPassesEnabled(const bool enabled) {
+  disabled_passes_.clear();
+  if (!enabled) {
+    for (auto &pass : passes_) {
+      disabled_passes_.insert(pass->name());
+    }
+  }
+}
+
+MaceStatus GraphOptimizer::Optimize(NetDef *net_def,
+                                    const unsigned char *model_data,
+                                    Workspace *ws) {
+  MACE_LATENCY_LOGGER(1, "Optimize graph");
+  GraphPassContext context(net_def, model_data, ws);
+  report_.clear();
+  int total_count = 0;
+  for (auto &pass : passes_) {
+    if (disabled_passes_.find(pass->name()) != disabled_passes_.end()) {
+      continue;
+    }
+    const int count = pass->Run(&context);
+    LOG(INFO) << "Graph pass " << pass->name() << ": " << count
+              << " rewrites";
+    report_.emplace_back(pass->name(), count);
+    total_count += count;
+  }
+
+  if (total_count > 0 && net_def->mem_arena().mem_block_size() > 0) {
+    // The offline plan does not fit the rewritten net.
+    VLOG(1) << "Drop the memory plan of the converter";
+    net_def->clear_mem_arena();
+    for (auto &op : *net_def->mutable_op()) {
+      op.clear_mem_id();
+    }
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+}  // namespace mace
@@ -0,0 +1,150 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_GRAPH_OPTIMIZER_H_
+#define MACE_CORE_GRAPH_OPTIMIZER_H_
+
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "mace/core/device.h"
+#include "mace/core/types.h"
+#include "mace/core/workspace.h"
+#include "mace/proto/mace.pb.h"
+
+namespace mace {
+
+class OperatorRegistryBase;
+
+// The net a graph pass rewrites, with the lookups the passes share.
+class GraphPassContext {
+ public:
+  GraphPassContext(NetDef *net_def,
+                   const unsigned char *model_data,
+                   Workspace *ws);
+
+  NetDef *net_def() { return net_def_; }
+
+  Workspace *workspace() { return ws_; }
+
+  // Returns the ops reading the tensor, in net order.
+  const std::vector<OperatorDef *> &Consumers(const std::string &name);
+
+  // Returns the op writing the tensor and its index, or nullptr if it is
+  // not written by an op (const tensors, inputs).
+  OperatorDef *Producer(const std::string &name, int *op_idx = nullptr);
+
+  // Whether the tensor must keep its name: an output of the net, or a
+  // tensor no op reads.
+  bool IsNetOutput(const std::string &name);
+
+  // Returns the data, type and shape of a const tensor, of the model or
+  // created by a pass, or nullptr if the tensor is not a constant.
+  const void *ConstData(const std::string &name,
+                        DataType *data_type,
+                        std::vector<index_t> *dims) const;
+
+  const float *ConstFloatData(const std::string &name,
+                              std::vector<index_t> *dims) const;
+
+  // Creates a const tensor in the workspace.
+  Tensor *CreateConstTensor(const std::string &name,
+                            DataType data_type,
+                            const std::vector<index_t> &dims);
+
+  float *CreateConstTensor(const std::string &name,
+                           const std::vector<index_t> &dims);
+
+  void RemoveOp(const OperatorDef *op);
+
+ private:
+  void BuildIndex();
+
+  NetDef *net_def_;
+  const unsigned char *model_data_;
+  Workspace *ws_;
+  std::unordered_map<std::string, const ConstTensor *> const_tensors_;
+  std::set<std::string> created_tensors_;
+  std::set<std::string> output_names_;
+
+  // Rebuilt when the ops change
+  bool index_dirty_;
+  std::unordered_map<std::string, std::vector<OperatorDef *>> consumers_;
+  std::unordered_map<std::string, int> producers_;
+};
+
+class GraphPass {
+ public:
+  virtual ~GraphPass() {}
+
+  virtual std::string name() const = 0;
+
+  // Rewrites the net, returns the number of rewrites made.
+  virtual int Run(GraphPassContext *context) = 0;
+};
+
+// Runs graph rewrites over a CPU NetDef at load time, catching what the
+// converter did not fuse. Passes run in the order they were added; the
+// default pipeline is:
+//   FoldStaticShapes: as FoldConstants, also taking the shapes recorded
+//                     by the converter as constant inputs of Shape and
+//                     InferConv2dShape; disabled unless enabled, as it
+//                     breaks models whose input shapes change
+//   FoldConstants:    evaluates the shape ops (Shape, StridedSlice, Stack,
+//                     ...) whose inputs are constants once
+//   RemoveIdentity:   rewires the readers of Identity outputs to the input
+//   FoldBatchNorm:    folds FoldedBatchNorm into the Conv2D filter and bias
+//   FuseBiasAdd:      makes BiasAdd the bias of the preceding conv or FC
+//   FuseResidualAdd:  adds the other input of Eltwise(SUM) in the Conv2D
+//   FuseActivation:   fuses Activation into the preceding op
+// The new const tensors are created in the workspace, so the optimizer runs
+// before the workspace loads the model. A memory plan made offline is
+// dropped if the net changed, for the runtime planner to plan it again.
+// The folding passes run the ops with op_registry on device, and do nothing
+// without them.
+class GraphOptimizer {
+ public:
+  explicit GraphOptimizer(const OperatorRegistryBase *op_registry = nullptr,
+                          Device *device = nullptr);
+
+  void AddPass(std::unique_ptr<GraphPass> pass);
+
+  // Returns false if there is no pass of that name.
+  bool SetPassEnabled(const std::string &name, bool enabled);
+
+  // Passes added afterwards are enabled.
+  void SetAllPassesEnabled(bool enabled);
+
+  MaceStatus Optimize(NetDef *net_def,
+                      const unsigned char *model_data,
+                      Workspace *ws);
+
+  // Number of rewrites of each enabled pass in the last Optimize
+  const std::vector<std::pair<std::string, int>> &report() const {
+    return report_;
+  }
+
+ private:
+  std::vector<std::unique_ptr<GraphPass>> passes_;
+  std::set<std::string> disabled_passes_;
+  std::vector<std::pair<std::string, int>> report_;
+};
+
+}  // namespace mace
+
+#endif  // MACE_CORE_GRAPH_OPTIMIZER_H_
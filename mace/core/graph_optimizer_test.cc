@@ -0,0 +1,177 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mace/core/arg_helper.h"
+#include "mace/core/graph_optimizer.h"
+#include "mace/core/testing/test_net_util.h"
+#include "mace/kernels/eltwise.h"
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace test {
+
+namespace {
+// Output = Relu(Input) + Fill(Shape(Relu(Input)), Value)
+void BuildShapeNet(NetDef *net_def, std::vector<float> *model_data) {
+  AddOpDef("Activation", {"Input"}, "A", {1, 2, 2, 3}, net_def);
+  AddOpDef("Shape", {"A"}, "S", {4}, net_def);
+  AddOpDef("Fill", {"S", "Value"}, "F", {1, 2, 2, 3}, net_def);
+  AddOpDef("Eltwise", {"A", "F"}, "Output", {1, 2, 2, 3}, net_def);
+  Argument *activation = net_def->mutable_op(0)->add_arg();
+  activation->set_name("activation");
+  activation->set_s("RELU");
+  net_def->mutable_op(1)->add_output_type(DT_INT32);
+  Argument *eltwise_type = net_def->mutable_op(3)->add_arg();
+  eltwise_type->set_name("type");
+  eltwise_type->set_i(static_cast<int>(kernels::EltwiseType::SUM));
+  net_def->add_output_info()->set_name("Output");
+  AddFloatConst("Value", {}, {0.5f}, net_def, model_data);
+}
+}  // namespace
+
+TEST(GraphOptimizerTest, Passes) {
+  NetDef net_def;
+  std::vector<float> model_data;
+  BuildResidualNet(&net_def, &model_data);
+
+  std::vector<float> expected;
+  {
+    Workspace ws;
+    RunResidualNet(net_def, model_data, &ws, &expected);
+  }
+
+  NetDef optimized_net_def(net_def);
+  Workspace ws;
+  GraphOptimizer optimizer;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            optimizer.Optimize(
+                &optimized_net_def,
+                reinterpret_cast<const unsigned char *>(model_data.data()),
+                &ws));
+  const std::vector<std::pair<std::string, int>> report = {
+      {"FoldConstants", 0}, {"RemoveIdentity", 1}, {"FoldBatchNorm", 1},
+      {"FuseBiasAdd", 1}, {"FuseResidualAdd", 1}, {"FuseActivation", 1}
+  };
+  EXPECT_EQ(report, optimizer.report());
+
+  ASSERT_EQ(2, optimized_net_def.op_size());
+  const OperatorDef &conv1 = optimized_net_def.op(0);
+  EXPECT_EQ("Conv2D", conv1.type());
+  EXPECT_EQ("Input", conv1.input(0));
+  EXPECT_EQ("B1", conv1.output(0));
+  ASSERT_EQ(3, conv1.input_size());
+  const OperatorDef &conv2 = optimized_net_def.op(1);
+  EXPECT_EQ("Conv2D", conv2.type());
+  ASSERT_EQ(4, conv2.input_size());
+  EXPECT_EQ("B1", conv2.input(0));
+  EXPECT_EQ("Bias2", conv2.input(2));
+  EXPECT_EQ("B1", conv2.input(3));
+  EXPECT_EQ("Output", conv2.output(0));
+  const std::string activation =
+      ProtoArgHelper::GetOptionalArg<OperatorDef, std::string>(
+          conv2, "activation", "NOOP");
+  EXPECT_EQ("RELU", activation);
+
+  std::vector<float> output;
+  RunResidualNet(optimized_net_def, model_data, &ws, &output);
+  ASSERT_EQ(expected.size(), output.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected[i], output[i], 1e-4);
+  }
+}
+
+TEST(GraphOptimizerTest, DisabledPass) {
+  NetDef net_def;
+  std::vector<float> model_data;
+  BuildResidualNet(&net_def, &model_data);
+
+  Workspace ws;
+  GraphOptimizer optimizer;
+  EXPECT_FALSE(optimizer.SetPassEnabled("Unknown", false));
+  EXPECT_TRUE(optimizer.SetPassEnabled("FuseResidualAdd", false));
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            optimizer.Optimize(
+                &net_def,
+                reinterpret_cast<const unsigned char *>(model_data.data()),
+                &ws));
+  EXPECT_EQ(5u, optimizer.report().size());
+  // The Eltwise stays, so the Relu is not fused either
+  ASSERT_EQ(4, net_def.op_size());
+  EXPECT_EQ("Eltwise", net_def.op(2).type());
+  EXPECT_EQ("Activation", net_def.op(3).type());
+}
+
+TEST(GraphOptimizerTest, FoldConstants) {
+  NetDef net_def;
+  std::vector<float> model_data;
+  BuildShapeNet(&net_def, &model_data);
+  const unsigned char *data =
+      reinterpret_cast<const unsigned char *>(model_data.data());
+  Device *device = ops::test::OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  std::shared_ptr<OperatorRegistryBase> op_registry(new OperatorRegistry());
+
+  {
+    // The shape of A is only known at runtime, unless FoldStaticShapes
+    // is enabled
+    NetDef dynamic_net_def(net_def);
+    Workspace ws;
+    GraphOptimizer optimizer(op_registry.get(), device);
+    ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+              optimizer.Optimize(&dynamic_net_def, data, &ws));
+    EXPECT_EQ(4, dynamic_net_def.op_size());
+  }
+
+  Workspace ws;
+  GraphOptimizer optimizer(op_registry.get(), device);
+  EXPECT_TRUE(optimizer.SetPassEnabled("FoldStaticShapes", true));
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            optimizer.Optimize(&net_def, data, &ws));
+  EXPECT_EQ("FoldStaticShapes", optimizer.report()[0].first);
+  EXPECT_EQ(2, optimizer.report()[0].second);
+  ASSERT_EQ(2, net_def.op_size());
+  EXPECT_EQ("Activation", net_def.op(0).type());
+  EXPECT_EQ("Eltwise", net_def.op(1).type());
+  // Only the tensor read at runtime is kept
+  EXPECT_FALSE(ws.HasTensor("S"));
+  ASSERT_TRUE(ws.HasTensor("F"));
+  EXPECT_EQ(std::vector<index_t>({1, 2, 2, 3}), ws.GetTensor("F")->shape());
+
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            ws.LoadModelTensor(net_def, device, data));
+  const std::vector<float> input_data =
+      {-3, -2, -1, 0, 1, 2, 3, 4, 5, -6, -7, -8};
+  Tensor *input = ws.CreateTensor("Input", device->allocator(), DT_FLOAT);
+  input->Resize({1, 2, 2, 3});
+  std::copy(input_data.begin(), input_data.end(),
+            input->mutable_data<float>());
+  auto net = CreateNet(op_registry, net_def, &ws, device);
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS, net->Run());
+
+  const Tensor *output = ws.GetTensor("Output");
+  ASSERT_EQ(static_cast<index_t>(input_data.size()), output->size());
+  for (size_t i = 0; i < input_data.size(); ++i) {
+    EXPECT_NEAR(std::max(input_data[i], 0.f) + 0.5f,
+                output->data<float>()[i], 1e-5);
+  }
+}
+
+}  // namespace test
+}  // namespace mace
@@ -0,0 +1,47 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/memory_plan_cache.h"
+
+#include <algorithm>
+
+#include "mace/utils/logging.h"
+
+namespace mace {
+
+MemoryPlanCache::MemoryPlanCache(const int capacity)
+    : capacity_(static_cast<size_t>(std::max(1, capacity))) {}
+
+MemoryPlan *MemoryPlanCache::Get(const std::vector<index_t> &shape_key) {
+  for (auto iter = plans_.begin(); iter != plans_.end(); ++iter) {
+    if ((*iter)->shape_key() == shape_key) {
+      plans_.splice(plans_.begin(), plans_, iter);
+      return plans_.front().get();
+    }
+  }
+  return nullptr;
+}
+
+MemoryPlan *MemoryPlanCache::Put(std::unique_ptr<MemoryPlan> plan) {
+  MACE_CHECK_NOTNULL(plan);
+  if (plans_.size() >= capacity_) {
+    VLOG(1) << "Evict memory plan of shape "
+            << MakeString(plans_.back()->shape_key());
+    plans_.pop_back();
+  }
+  plans_.push_front(std::move(plan));
+  return plans_.front().get();
+}
+
+}  // namespace mace
@@ -0,0 +1,69 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_MEMORY_PLAN_CACHE_H_
+#define MACE_CORE_MEMORY_PLAN_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "mace/core/preallocated_pooled_allocator.h"
+#include "mace/core/types.h"
+
+namespace mace {
+
+// The memory blocks of one input shape. Nothing is planned ahead: a plan is
+// created with empty blocks, which Tensor::Resize grows to the sizes the
+// shape needs during its first run; later runs with the same shape
+// allocate nothing. Shapes sharing a key share the blocks, which a larger
+// one grows again.
+class MemoryPlan {
+ public:
+  explicit MemoryPlan(const std::vector<index_t> &shape_key)
+      : shape_key_(shape_key) {}
+
+  const std::vector<index_t> &shape_key() const { return shape_key_; }
+
+  PreallocatedPooledAllocator *buffers() { return &buffers_; }
+
+ private:
+  std::vector<index_t> shape_key_;
+  PreallocatedPooledAllocator buffers_;
+};
+
+// Least recently used cache of memory plans keyed by input shape.
+class MemoryPlanCache {
+ public:
+  explicit MemoryPlanCache(const int capacity);
+
+  // Returns the plan of shape_key, or nullptr if it is not cached.
+  MemoryPlan *Get(const std::vector<index_t> &shape_key);
+
+  // Adds a plan and evicts the least recently used one if the cache is full.
+  // The evicted plan is freed, so its buffers must not be in use.
+  MemoryPlan *Put(std::unique_ptr<MemoryPlan> plan);
+
+  size_t size() const { return plans_.size(); }
+
+ private:
+  const size_t capacity_;
+  // Most recently used first
+  std::list<std::unique_ptr<MemoryPlan>> plans_;
+};
+
+}  // namespace mace
+
+#endif  // MACE_CORE_MEMORY_PLAN_CACHE_H_
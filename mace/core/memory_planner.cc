@@ -0,0 +1,187 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/memory_planner.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "mace/core/arg_helper.h"
+#include "mace/core/operator.h"
+#include "mace/utils/logging.h"
+
+namespace mace {
+namespace {
+
+// Element count and data type of a tensor
+typedef std::pair<index_t, DataType> TensorInfo;
+
+// Returns the buffer of input 0 if the op can write its output over it,
+// i.e. both tensors have the same shape and the op is the last reader of
+// everything in the buffer; -1 otherwise.
+int InPlaceBuffer(
+    const OperatorDef &op,
+    const std::unordered_map<std::string, int> &tensor_buffer,
+    const std::unordered_map<std::string, TensorInfo> &tensor_info,
+    const std::vector<int> &buffer_refs) {
+  auto iter = tensor_buffer.find(op.input(0));
+  if (iter == tensor_buffer.end()
+      || tensor_info.at(op.input(0)) != tensor_info.at(op.output(0))) {
+    return -1;
+  }
+  const int mem_id = iter->second;
+  int reads = 0;
+  for (auto &input : op.input()) {
+    auto input_iter = tensor_buffer.find(input);
+    if (input_iter != tensor_buffer.end() && input_iter->second == mem_id) {
+      ++reads;
+    }
+  }
+  return buffer_refs[mem_id] == reads ? mem_id : -1;
+}
+
+// Returns the idle buffer which grows the least to hold size bytes (then
+// wastes the least), or a new buffer if growing it costs more than that.
+int BestFitBuffer(const index_t size,
+                  std::vector<index_t> *buffer_sizes,
+                  std::vector<int> *buffer_refs,
+                  std::set<int> *idle_buffers) {
+  int mem_id = -1;
+  index_t best_add_size = std::numeric_limits<index_t>::max();
+  index_t best_waste_size = std::numeric_limits<index_t>::max();
+  for (int idle_id : *idle_buffers) {
+    const index_t new_size = std::max((*buffer_sizes)[idle_id], size);
+    const index_t add_size = new_size - (*buffer_sizes)[idle_id];
+    const index_t waste_size = new_size - size;
+    // minimize the growth, then the waste among the ones not growing
+    if ((best_add_size > 0 && add_size < best_add_size)
+        || (best_add_size == 0 && add_size == 0
+            && waste_size < best_waste_size)) {
+      mem_id = idle_id;
+      best_add_size = add_size;
+      best_waste_size = waste_size;
+    }
+  }
+  if (mem_id >= 0 && best_add_size <= size) {
+    (*buffer_sizes)[mem_id] = std::max((*buffer_sizes)[mem_id], size);
+    idle_buffers->erase(mem_id);
+  } else {
+    mem_id = static_cast<int>(buffer_sizes->size());
+    buffer_sizes->push_back(size);
+    buffer_refs->push_back(0);
+  }
+  return mem_id;
+}
+
+}  // namespace
+
+bool CPUMemoryPlanner::Plan(
+    const NetDef &net_def,
+    const std::function<bool(const OperatorDef &)> &should_plan) {
+  const int op_count = net_def.op_size();
+  std::vector<std::vector<int>> op_mem_ids(op_count);
+  std::vector<index_t> buffer_sizes;
+  index_t naive_size = 0;
+
+  // The buffer each tensor lives in, and the number of pending reads of
+  // each buffer. Tensors of other buffers (weights, inputs) are not here.
+  std::unordered_map<std::string, int> tensor_buffer;
+  std::unordered_map<std::string, TensorInfo> tensor_info;
+  std::unordered_map<std::string, int> tensor_consumers;
+  std::vector<int> buffer_refs;
+  std::set<int> idle_buffers;
+
+  for (auto &op : net_def.op()) {
+    if (!should_plan(op)) continue;
+    for (auto &input : op.input()) {
+      ++tensor_consumers[input];
+    }
+  }
+  // The outputs of the net are read after the last op.
+  for (auto &output_info : net_def.output_info()) {
+    ++tensor_consumers[output_info.name()];
+  }
+
+  for (int op_idx = 0; op_idx < op_count; ++op_idx) {
+    const OperatorDef &op = net_def.op(op_idx);
+    if (!should_plan(op)) continue;
+    for (int i = 0; i < op.output_size(); ++i) {
+      const std::string &output = op.output(i);
+      int mem_id = -1;
+      if (IsBufferReuseOp(op)) {
+        // Not preallocated, the output shares the buffer of its input.
+        auto iter = tensor_buffer.find(op.input(0));
+        if (iter != tensor_buffer.end()) {
+          mem_id = iter->second;
+          tensor_info[output] = tensor_info[op.input(0)];
+        }
+      } else {
+        if (i >= op.output_shape_size()) {
+          LOG(WARNING) << "No output shape to plan memory: " << op.name()
+                       << " (" << op.type() << ")";
+          return false;
+        }
+        DataType dtype = static_cast<DataType>(
+            ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+                op, "T", static_cast<int>(DT_FLOAT)));
+        if (i < op.output_type_size()) {
+          dtype = op.output_type(i);
+        }
+        const auto &dims = op.output_shape(i).dims();
+        const index_t count = std::accumulate(
+            dims.begin(), dims.end(), static_cast<index_t>(1),
+            std::multiplies<index_t>());
+        const index_t size = count * GetEnumTypeSize(dtype);
+        naive_size += size;
+        tensor_info[output] = std::make_pair(count, dtype);
+
+        if (i == 0 && IsInPlaceOp(op)) {
+          mem_id = InPlaceBuffer(op, tensor_buffer, tensor_info, buffer_refs);
+        }
+        if (mem_id < 0) {
+          mem_id = BestFitBuffer(size, &buffer_sizes, &buffer_refs,
+                                 &idle_buffers);
+        }
+        op_mem_ids[op_idx].push_back(mem_id);
+      }
+      if (mem_id >= 0) {
+        tensor_buffer[output] = mem_id;
+        // Never consumed outputs keep their buffer to the end.
+        buffer_refs[mem_id] += std::max(1, tensor_consumers[output]);
+      }
+    }
+
+    for (auto &input : op.input()) {
+      auto iter = tensor_buffer.find(input);
+      if (iter != tensor_buffer.end() && --buffer_refs[iter->second] == 0) {
+        idle_buffers.insert(iter->second);
+      }
+    }
+  }
+
+  buffer_sizes_ = std::move(buffer_sizes);
+  op_mem_ids_ = std::move(op_mem_ids);
+  planned_size_ = std::accumulate(buffer_sizes_.begin(), buffer_sizes_.end(),
+                                  static_cast<index_t>(0));
+  naive_size_ = naive_size;
+  return true;
+}
+
+}  // namespace mace
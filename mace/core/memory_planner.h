@@ -0,0 +1,69 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_MEMORY_PLANNER_H_
+#define MACE_CORE_MEMORY_PLANNER_H_
+
+#include <functional>
+#include <vector>
+
+#include "mace/core/types.h"
+#include "mace/proto/mace.pb.h"
+
+namespace mace {
+
+// Plans the CPU buffers of op outputs for a NetDef converted without
+// memory optimization, the runtime counterpart of memory_optimizer.py.
+//
+// Tensor lifetimes follow the op order: the buffer of an output is
+// allocated by its op and released after its last consumer, outputs of
+// the net and outputs nobody consumes are kept to the end. A released
+// buffer is reused by the next output which grows it the least (best fit),
+// as long as growing it costs less than allocating a new one. Outputs of
+// the ops which reuse their input buffer (Reshape, Identity, ...) extend
+// the input's lifetime, and in place ops (Activation, BiasAdd, ...) write
+// their output over input 0 when it dies at the op.
+class CPUMemoryPlanner {
+ public:
+  CPUMemoryPlanner() : planned_size_(0), naive_size_(0) {}
+
+  // Plans the outputs of the ops accepted by should_plan. Returns false,
+  // leaving nothing planned, if an output has no shape information.
+  bool Plan(const NetDef &net_def,
+            const std::function<bool(const OperatorDef &)> &should_plan);
+
+  // Size in bytes of each planned buffer, indexed by mem id
+  const std::vector<index_t> &buffer_sizes() const { return buffer_sizes_; }
+
+  // Mem ids of the outputs of each op, empty for the ops not planned
+  const std::vector<std::vector<int>> &op_mem_ids() const {
+    return op_mem_ids_;
+  }
+
+  // Total size of the planned buffers
+  index_t planned_size() const { return planned_size_; }
+
+  // Total size with one buffer per output
+  index_t naive_size() const { return naive_size_; }
+
+ private:
+  std::vector<index_t> buffer_sizes_;
+  std::vector<std::vector<int>> op_mem_ids_;
+  index_t planned_size_;
+  index_t naive_size_;
+};
+
+}  // namespace mace
+
+#endif  // MACE_CORE_MEMORY_PLANNER_H_
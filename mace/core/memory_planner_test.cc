@@ -0,0 +1,184 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mace/core/memory_planner.h"
+#include "mace/core/testing/test_net_util.h"
+#include "mace/kernels/eltwise.h"
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace test {
+
+TEST(MemoryPlannerTest, CPUMemoryPlanner) {
+  NetDef net_def;
+  AddOpDef("Conv2D", {"input", "filter0"}, "t0", {1, 8, 8, 8}, &net_def);
+  AddOpDef("Activation", {"t0"}, "t1", {1, 8, 8, 8}, &net_def);
+  AddOpDef("Conv2D", {"t1", "filter1"}, "t2", {1, 4, 8, 8}, &net_def);
+  AddOpDef("Reshape", {"t2", "shape"}, "t3", {1, 256}, &net_def);
+  AddOpDef("Eltwise", {"t3", "t1"}, "t4", {1, 4, 8, 8}, &net_def);
+  AddOpDef("Activation", {"t4"}, "output", {1, 4, 8, 8}, &net_def);
+
+  CPUMemoryPlanner planner;
+  ASSERT_TRUE(planner.Plan(net_def, [](const OperatorDef &) {
+    return true;
+  }));
+  // t1 runs in place over t0 and is still read by t4, so t2 takes a new
+  // buffer, which t3 shares; t4 and the output run in place over t3.
+  const std::vector<std::vector<int>> expected_mem_ids =
+      {{0}, {0}, {1}, {}, {1}, {1}};
+  EXPECT_EQ(expected_mem_ids, planner.op_mem_ids());
+  EXPECT_EQ(std::vector<index_t>({2048, 1024}), planner.buffer_sizes());
+  EXPECT_EQ(3072, planner.planned_size());
+  EXPECT_EQ(7168, planner.naive_size());
+
+  AddOpDef("Activation", {"output"}, "no_shape", {}, &net_def);
+  CPUMemoryPlanner no_shape_planner;
+  EXPECT_FALSE(no_shape_planner.Plan(net_def, [](const OperatorDef &) {
+    return true;
+  }));
+  EXPECT_TRUE(no_shape_planner.op_mem_ids().empty());
+}
+
+TEST(MemoryPlannerTest, NetOutputs) {
+  NetDef net_def;
+  AddOpDef("Conv2D", {"input", "filter"}, "a", {1, 8, 8, 8}, &net_def);
+  AddOpDef("Conv2D", {"a", "filter"}, "b", {1, 8, 8, 8}, &net_def);
+  AddOpDef("Conv2D", {"b", "filter"}, "c", {1, 8, 8, 8}, &net_def);
+  net_def.add_output_info()->set_name("a");
+  net_def.add_output_info()->set_name("c");
+
+  CPUMemoryPlanner planner;
+  ASSERT_TRUE(planner.Plan(net_def, [](const OperatorDef &) {
+    return true;
+  }));
+  // a is read by b but is an output of the net, so c does not take it over
+  const std::vector<std::vector<int>> expected_mem_ids = {{0}, {1}, {2}};
+  EXPECT_EQ(expected_mem_ids, planner.op_mem_ids());
+}
+
+TEST(MemoryPlannerTest, InPlace) {
+  NetDef net_def;
+  AddOpDef("Conv2D", {"input", "filter"}, "a", {1, 8, 8, 8}, &net_def);
+  AddOpDef("BiasAdd", {"a", "bias"}, "b", {1, 8, 8, 8}, &net_def);
+  AddOpDef("Activation", {"b"}, "c", {1, 8, 8, 8}, &net_def);
+  AddOpDef("Eltwise", {"c", "c"}, "d", {1, 8, 8, 8}, &net_def);
+  AddOpDef("Conv2D", {"d", "filter"}, "e", {1, 1, 8, 8}, &net_def);
+  AddOpDef("Eltwise", {"e", "d"}, "output", {1, 8, 8, 8}, &net_def);
+  net_def.add_output_info()->set_name("c");
+  net_def.add_output_info()->set_name("output");
+
+  CPUMemoryPlanner planner;
+  ASSERT_TRUE(planner.Plan(net_def, [](const OperatorDef &) {
+    return true;
+  }));
+  // b and c run in place; d does not overwrite c which is an output of the
+  // net, and the output does not overwrite e which is broadcast.
+  const std::vector<std::vector<int>> expected_mem_ids =
+      {{0}, {0}, {0}, {1}, {2}, {3}};
+  EXPECT_EQ(expected_mem_ids, planner.op_mem_ids());
+}
+
+TEST(MemoryPlannerTest, InPlaceNet) {
+  NetDef net_def;
+  AddOpDef("BiasAdd", {"Input", "Bias"}, "A", {1, 2, 2, 3}, &net_def);
+  AddOpDef("Activation", {"A"}, "B", {1, 2, 2, 3}, &net_def);
+  AddOpDef("Eltwise", {"B", "Input"}, "Output", {1, 2, 2, 3}, &net_def);
+  Argument *activation = net_def.mutable_op(1)->add_arg();
+  activation->set_name("activation");
+  activation->set_s("RELU");
+  Argument *eltwise_type = net_def.mutable_op(2)->add_arg();
+  eltwise_type->set_name("type");
+  eltwise_type->set_i(static_cast<int>(kernels::EltwiseType::SUM));
+  net_def.add_output_info()->set_name("Output");
+
+  Device *device = ops::test::OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  Workspace ws;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            ws.LoadModelTensor(net_def, device, nullptr));
+  // All the activations share one buffer
+  EXPECT_EQ(ws.GetTensor("A")->raw_data(), ws.GetTensor("B")->raw_data());
+  EXPECT_EQ(ws.GetTensor("A")->raw_data(),
+            ws.GetTensor("Output")->raw_data());
+
+  const std::vector<float> input_data =
+      {-3, -2, -1, 0, 1, 2, 3, 4, 5, -6, -7, -8};
+  Tensor *input = ws.CreateTensor("Input", device->allocator(), DT_FLOAT);
+  input->Resize({1, 2, 2, 3});
+  std::copy(input_data.begin(), input_data.end(),
+            input->mutable_data<float>());
+  Tensor *bias = ws.CreateTensor("Bias", device->allocator(), DT_FLOAT);
+  bias->Resize({3});
+  const std::vector<float> bias_data = {1, 2, 3};
+  std::copy(bias_data.begin(), bias_data.end(), bias->mutable_data<float>());
+
+  std::shared_ptr<OperatorRegistryBase> op_registry(new OperatorRegistry());
+  auto net = CreateNet(op_registry, net_def, &ws, device);
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS, net->Run());
+
+  const Tensor *output = ws.GetTensor("Output");
+  ASSERT_EQ(static_cast<index_t>(input_data.size()), output->size());
+  for (size_t i = 0; i < input_data.size(); ++i) {
+    EXPECT_NEAR(std::max(input_data[i] + bias_data[i % 3], 0.f)
+                    + input_data[i],
+                output->data<float>()[i], 1e-5);
+  }
+}
+
+TEST(MemoryPlannerTest, InPlaceConvertedNet) {
+  // A plan made by the converter without the in place rule
+  NetDef net_def;
+  AddOpDef("BiasAdd", {"Input", "Bias"}, "A", {1, 2, 2, 3}, &net_def);
+  AddOpDef("Activation", {"A"}, "B", {1, 2, 2, 3}, &net_def);
+  AddOpDef("Activation", {"B"}, "Output", {1, 2, 2, 3}, &net_def);
+  net_def.add_output_info()->set_name("Output");
+  const std::vector<int> converter_mem_ids = {0, 1, 0};
+  for (int i = 0; i < net_def.op_size(); ++i) {
+    net_def.mutable_op(i)->add_mem_id(converter_mem_ids[i]);
+  }
+  for (int mem_id = 0; mem_id < 2; ++mem_id) {
+    MemoryBlock *mem_block = net_def.mutable_mem_arena()->add_mem_block();
+    mem_block->set_mem_id(mem_id);
+    mem_block->set_device_type(DeviceType::CPU);
+    mem_block->set_mem_type(MemoryType::CPU_BUFFER);
+    mem_block->set_x(12 * sizeof(float));
+    mem_block->set_y(1);
+  }
+
+  Device *device = ops::test::OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  Workspace ws;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            ws.LoadModelTensor(net_def, device, nullptr));
+  EXPECT_EQ(ws.GetTensor("A")->raw_data(), ws.GetTensor("B")->raw_data());
+  EXPECT_EQ(ws.GetTensor("A")->raw_data(),
+            ws.GetTensor("Output")->raw_data());
+
+  // The converter's plan is kept if planning again takes more memory
+  net_def.mutable_mem_arena()->mutable_mem_block(0)->set_x(8);
+  net_def.mutable_mem_arena()->mutable_mem_block(1)->set_x(8);
+  Workspace small_ws;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            small_ws.LoadModelTensor(net_def, device, nullptr));
+  EXPECT_NE(small_ws.GetTensor("A")->raw_data(),
+            small_ws.GetTensor("B")->raw_data());
+  EXPECT_EQ(small_ws.GetTensor("A")->raw_data(),
+            small_ws.GetTensor("Output")->raw_data());
+}
+
+}  // namespace test
+}  // namespace mace
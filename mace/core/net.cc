@@ -12,12 +12,18 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <sys/resource.h>
+
 #include <utility>
 #include <algorithm>
 #include <limits>
+#include <set>
+#include <unordered_map>
 
 #include "mace/core/macros.h"
 #include "mace/core/net.h"
+#include "mace/core/run_control.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/public/mace.h"
 #include "mace/utils/memory_logging.h"
 #include "mace/utils/timer.h"
@@ -25,6 +31,37 @@
 
 namespace mace {
 
+namespace {
+PageFaults GetPageFaults() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return {usage.ru_minflt, usage.ru_majflt};
+}
+
+PageFaults PageFaultsSince(const PageFaults &start) {
+  const PageFaults now = GetPageFaults();
+  return {now.minor - start.minor, now.major - start.major};
+}
+
+void AddOperatorStats(OperatorBase *op,
+                      const CallStats &call_stats,
+                      const PageFaults &page_faults,
+                      RunMetadata *run_metadata) {
+  const OperatorAttributes &attributes = op->attributes();
+  OperatorStats op_stats = {op->debug_def().name(), op->debug_def().type(),
+                            {}, attributes.conv_pool_args, call_stats,
+                            page_faults};
+  if (attributes.has_conv_pool_args && attributes.kernels_from_filter) {
+    op_stats.args.kernels = op->Input(1)->shape();
+  }
+  for (auto output : op->Outputs()) {
+    op_stats.output_shape.push_back(output->shape());
+  }
+  run_metadata->op_stats.emplace_back(std::move(op_stats));
+}
+
+}  // namespace
+
 NetBase::NetBase(const std::shared_ptr<const OperatorRegistryBase> op_registry,
                  const std::shared_ptr<const NetDef> net_def,
                  Workspace *ws,
@@ -34,6 +71,10 @@ NetBase::NetBase(const std::shared_ptr<const OperatorRegistryBase> op_registry,
   MACE_UNUSED(device);
 }
 
+void NetBase::SetWeightPager(std::unique_ptr<WeightPager> weight_pager) {
+  MACE_UNUSED(weight_pager);
+}
+
 SerialNet::SerialNet(
     const std::shared_ptr<const OperatorRegistryBase> op_registry,
     const std::shared_ptr<const NetDef> net_def,
@@ -41,9 +82,11 @@ SerialNet::SerialNet(
     Device *device,
     const NetMode mode)
     : NetBase(op_registry, net_def, ws, device), device_(device),
-      op_kernel_context_(new OpKernelContext(ws, device)) {
+      op_kernel_context_(new OpKernelContext(ws, device, net_def)),
+      log_tensor_range_(EnvEnabled("MACE_LOG_TENSOR_RANGE")) {
   MACE_LATENCY_LOGGER(1, "Constructing SerialNet ", net_def->name());
   DeviceType device_type = device->device_type();
+  std::vector<const OperatorDef *> operator_defs;
   for (int idx = 0; idx < net_def->op_size(); ++idx) {
     const auto &operator_def = net_def->op(idx);
     // TODO(liuqi): refactor to add device_type to OperatorDef
@@ -51,25 +94,98 @@ SerialNet::SerialNet(
         ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
             operator_def, "device", static_cast<int>(device_type));
     if (op_device == device_type) {
-      VLOG(3) << "Creating operator " << operator_def.name() << "("
-              << operator_def.type() << ")";
-      OperatorDef temp_def(operator_def);
-      std::unique_ptr<OperatorBase> op(
-          op_registry->CreateOperator(temp_def, op_kernel_context_.get(),
-                                      device_type, mode));
-      if (op) {
-        operators_.emplace_back(std::move(op));
+      operator_defs.push_back(&operator_def);
+    }
+  }
+
+  // On CPU, the operators are constructed on the threads of the device once
+  // their outputs are in the workspace, and kept in model order.
+  const bool parallel = device_type == DeviceType::CPU;
+  if (parallel) {
+    for (const OperatorDef *operator_def : operator_defs) {
+      const int op_mode = ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+          *operator_def, "mode", static_cast<int>(NetMode::NORMAL));
+      if (op_mode == mode) {
+        const int dtype = ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+            *operator_def, "T", static_cast<int>(DT_FLOAT));
+        CreateOutputTensors(*operator_def, op_kernel_context_.get(),
+                            static_cast<DataType>(dtype));
       }
     }
   }
+  const index_t num_ops = static_cast<index_t>(operator_defs.size());
+  std::vector<std::unique_ptr<OperatorBase>> operators(num_ops);
+  {
+    ThreadPoolGuard thread_pool_guard(
+        parallel ? device->cpu_runtime()->thread_pool() : nullptr);
+    ParallelFor(0, num_ops, [&](index_t i) {
+      VLOG(3) << "Creating operator " << operator_defs[i]->name() << "("
+              << operator_defs[i]->type() << ")";
+      operators[i] = op_registry->CreateOperator(
+          *operator_defs[i], op_kernel_context_.get(), device_type, mode);
+    });
+  }
+  for (auto &op : operators) {
+    if (op) {
+      operators_.emplace_back(std::move(op));
+    }
+  }
+
+  // The per-op debugging is set up by the environment at construction
+  debug_ = VLOG_IS_ON(2) || log_tensor_range_;
+  for (auto &op : operators_) {
+    plan_.push_back(op.get());
+  }
+}
+
+void SerialNet::SetWeightPager(std::unique_ptr<WeightPager> weight_pager) {
+  weight_pager_ = std::move(weight_pager);
+  if (weight_pager_ != nullptr) {
+    for (auto &op : operators_) {
+      weight_pager_->AddOp(op.get());
+    }
+  }
+}
+
+MaceStatus SerialNet::RunPlan() {
+  if (plan_.empty()) {
+    return MACE_SUCCESS;
+  }
+  OperatorBase *const *op = plan_.data();
+  OperatorBase *const *last_op = op + plan_.size() - 1;
+  for (; op != last_op; ++op) {
+    MACE_RETURN_IF_ERROR((*op)->Run(nullptr));
+  }
+  if (device_->device_type() == DeviceType::GPU) {
+    StatsFuture future;
+    MACE_RETURN_IF_ERROR((*last_op)->Run(&future));
+    future.wait_fn(nullptr);
+    return MACE_SUCCESS;
+  }
+  return (*last_op)->Run(nullptr);
 }
 
 MaceStatus SerialNet::Run(RunMetadata *run_metadata) {
   MACE_MEMORY_LOGGING_GUARD();
   MACE_LATENCY_LOGGER(1, "Running net");
+  ThreadPool *thread_pool = device_->cpu_runtime()->thread_pool();
+  ThreadPoolGuard thread_pool_guard(thread_pool);
+  const RunControl *run_control = RunControl::current();
+  PriorityGate::Scope priority_scope(thread_pool->priority_gate(),
+                                     run_control);
+  if (run_metadata == nullptr && !debug_ && weight_pager_ == nullptr
+      && run_control == nullptr) {
+    return RunPlan();
+  }
   const DeviceType device_type = device_->device_type();
   for (auto iter = operators_.begin(); iter != operators_.end(); ++iter) {
     auto &op = *iter;
+    if (run_control != nullptr) {
+      thread_pool->priority_gate()->Yield(run_control);
+      if (run_control->Stopped()) {
+        return MaceStatus::MACE_CANCELLED;
+      }
+    }
     MACE_LATENCY_LOGGER(2, "Running operator ", op->debug_def().name(), "(",
                         op->debug_def().type(), "), mem_id: ",
                         MakeListString(op->debug_def().mem_id().data(),
@@ -77,8 +193,16 @@ MaceStatus SerialNet::Run(RunMetadata *run_metadata) {
     bool future_wait = (device_type == DeviceType::GPU &&
                         (run_metadata != nullptr ||
                          std::distance(iter, operators_.end()) == 1));
+    const size_t idx = iter - operators_.begin();
+    if (weight_pager_ != nullptr) {
+      weight_pager_->WillRun(idx);
+    }
 
     CallStats call_stats;
+    PageFaults page_faults = {0, 0};
+    if (run_metadata != nullptr) {
+      page_faults = GetPageFaults();
+    }
     if (future_wait) {
       StatsFuture future;
       MACE_RETURN_IF_ERROR(op->Run(&future));
@@ -95,48 +219,21 @@ MaceStatus SerialNet::Run(RunMetadata *run_metadata) {
       MACE_RETURN_IF_ERROR(op->Run(nullptr));
     }
 
+    if (weight_pager_ != nullptr) {
+      weight_pager_->DidRun(idx);
+    }
     if (run_metadata != nullptr) {
-      std::vector<int> strides;
-      int padding_type = -1;
-      std::vector<int> paddings;
-      std::vector<int> dilations;
-      std::vector<index_t> kernels;
-      std::string type = op->debug_def().type();
-
-      if (type.compare("Conv2D") == 0 ||
-          type.compare("FusedConv2D") == 0 ||
-          type.compare("DepthwiseConv2d") == 0 ||
-          type.compare("Pooling") == 0) {
-        strides = op->GetRepeatedArgs<int>("strides");
-        padding_type = op->GetOptionalArg<int>("padding", -1);
-        paddings = op->GetRepeatedArgs<int>("padding_values");
-        dilations = op->GetRepeatedArgs<int>("dilations");
-        if (type.compare("Pooling") == 0) {
-          kernels = op->GetRepeatedArgs<index_t>("kernels");
-        } else {
-          kernels = op->Input(1)->shape();
-        }
-      }
-
-      std::vector<std::vector<int64_t>> output_shapes;
-      for (auto output : op->Outputs()) {
-        output_shapes.push_back(output->shape());
-      }
-      OperatorStats op_stats = {op->debug_def().name(), op->debug_def().type(),
-                                output_shapes,
-                                {strides, padding_type, paddings, dilations,
-                                 kernels}, call_stats};
-      run_metadata->op_stats.emplace_back(op_stats);
+      AddOperatorStats(op.get(), call_stats, PageFaultsSince(page_faults),
+                       run_metadata);
     }
 
     VLOG(3) << "Operator " << op->debug_def().name()
             << " has shape: " << MakeString(op->Output(0)->shape());
 
-    if (EnvEnabled("MACE_LOG_TENSOR_RANGE") && device_type == CPU) {
+    if (log_tensor_range_ && device_type == CPU) {
       for (int i = 0; i < op->OutputSize(); ++i) {
         if (op->debug_def().quantize_info_size() == 0) {
-          int data_type = op->GetOptionalArg("T", static_cast<int>(DT_FLOAT));
-          if (data_type == static_cast<int>(DT_FLOAT)) {
+          if (op->attributes().data_type == DT_FLOAT) {
             float max_v = std::numeric_limits<float>::lowest();
             float min_v = std::numeric_limits<float>::max();
             Tensor::MappingGuard guard(op->Output(i));
@@ -173,17 +270,271 @@ MaceStatus SerialNet::Run(RunMetadata *run_metadata) {
     }
   }
 
+  // The last operator may have stopped early
+  if (run_control != nullptr && run_control->Stopped()) {
+    return MaceStatus::MACE_CANCELLED;
+  }
   return MACE_SUCCESS;
 }
 
+MaceStatus SerialNet::RunStep(size_t *next_op,
+                              const int64_t budget_micros,
+                              bool *done) {
+  MACE_CHECK_NOTNULL(next_op);
+  MACE_CHECK_NOTNULL(done);
+  MACE_CHECK(device_->device_type() == DeviceType::CPU,
+             "Only CPU nets run in steps");
+  MACE_LATENCY_LOGGER(1, "Running net step");
+  ThreadPool *thread_pool = device_->cpu_runtime()->thread_pool();
+  ThreadPoolGuard thread_pool_guard(thread_pool);
+  PriorityGate::Scope priority_scope(thread_pool->priority_gate(), nullptr);
+  const int64_t start_micros = NowMicros();
+  while (*next_op < plan_.size()) {
+    const size_t idx = *next_op;
+    if (weight_pager_ != nullptr) {
+      weight_pager_->WillRun(idx);
+    }
+    MACE_RETURN_IF_ERROR(plan_[idx]->Run(nullptr));
+    if (weight_pager_ != nullptr) {
+      weight_pager_->DidRun(idx);
+    }
+    ++*next_op;
+    if (NowMicros() - start_micros >= budget_micros) {
+      break;
+    }
+  }
+  *done = *next_op == plan_.size();
+  return MACE_SUCCESS;
+}
+
+ParallelNet::ParallelNet(
+    const std::shared_ptr<const OperatorRegistryBase> op_registry,
+    const std::shared_ptr<const NetDef> net_def,
+    Workspace *ws,
+    Device *device,
+    const int num_threads)
+    : SerialNet(op_registry, net_def, ws, device),
+      num_running_(0),
+      collect_stats_(false),
+      run_control_(nullptr),
+      stop_(false),
+      status_(MaceStatus::MACE_SUCCESS) {
+  MACE_CHECK(device->device_type() == DeviceType::CPU,
+             "ParallelNet only supports CPU");
+  MACE_CHECK(num_threads > 0, "ParallelNet needs at least one thread");
+  BuildDependencies(ws);
+
+  // The operators share the thread pool of the device: one running alone
+  // uses all of it, while those running concurrently with it run inline.
+  VLOG(1) << "Create ParallelNet with " << num_threads << " threads";
+  for (int i = 0; i < num_threads; ++i) {
+    scratch_buffers_.emplace_back(new ScratchBuffer(device->allocator()));
+    workers_.emplace_back(&ParallelNet::WorkerLoop, this,
+                          scratch_buffers_.back().get());
+  }
+}
+
+ParallelNet::~ParallelNet() noexcept {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ParallelNet::BuildDependencies(const Workspace *ws) {
+  const int num_ops = static_cast<int>(operators_.size());
+  // A resource is a memory region that may be shared by several tensors:
+  // one preallocated buffer (mem_id), or one tensor together with all the
+  // tensors aliasing its buffer.
+  std::unordered_map<std::string, int> tensor_resources;
+  std::unordered_map<int, int> mem_id_resources;
+  std::vector<int> last_writer;
+  std::vector<std::vector<int>> readers;
+  auto new_resource = [&]() -> int {
+    last_writer.push_back(-1);
+    readers.emplace_back();
+    return static_cast<int>(last_writer.size()) - 1;
+  };
+  auto tensor_resource = [&](const std::string &name) -> int {
+    auto iter = tensor_resources.find(name);
+    if (iter != tensor_resources.end()) {
+      return iter->second;
+    }
+    const int resource = new_resource();
+    tensor_resources[name] = resource;
+    return resource;
+  };
+
+  successors_.resize(num_ops);
+  num_predecessors_.resize(num_ops, 0);
+  for (int idx = 0; idx < num_ops; ++idx) {
+    const OperatorDef &op_def = operators_[idx]->debug_def();
+    std::set<int> predecessors;
+    for (const std::string &input : op_def.input()) {
+      const int resource = tensor_resource(input);
+      if (last_writer[resource] >= 0) {
+        predecessors.insert(last_writer[resource]);
+      }
+      readers[resource].push_back(idx);
+    }
+    for (int i = 0; i < op_def.output_size(); ++i) {
+      int resource;
+      if (IsBufferReuseOp(op_def) && op_def.input_size() > 0) {
+        resource = tensor_resource(op_def.input(0));
+      } else if (ws->GetTensorMemId(op_def.output(i)) >= 0) {
+        const int mem_id = ws->GetTensorMemId(op_def.output(i));
+        auto iter = mem_id_resources.find(mem_id);
+        if (iter == mem_id_resources.end()) {
+          resource = new_resource();
+          mem_id_resources[mem_id] = resource;
+        } else {
+          resource = iter->second;
+        }
+      } else {
+        resource = tensor_resource(op_def.output(i));
+      }
+      tensor_resources[op_def.output(i)] = resource;
+      // Write after read and write after write.
+      if (last_writer[resource] >= 0) {
+        predecessors.insert(last_writer[resource]);
+      }
+      predecessors.insert(readers[resource].begin(), readers[resource].end());
+      last_writer[resource] = idx;
+      readers[resource].clear();
+    }
+    predecessors.erase(idx);
+    for (int predecessor : predecessors) {
+      successors_[predecessor].push_back(idx);
+    }
+    num_predecessors_[idx] = static_cast<int>(predecessors.size());
+  }
+}
+
+void ParallelNet::WorkerLoop(ScratchBuffer *scratch_buffer) {
+  ScratchBufferGuard scratch_buffer_guard(scratch_buffer);
+  ThreadPoolGuard thread_pool_guard(device_->cpu_runtime()->thread_pool());
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cond_.wait(lock, [this] { return stop_ || !ready_ops_.empty(); });
+    if (stop_) {
+      break;
+    }
+    const int idx = ready_ops_.front();
+    ready_ops_.pop_front();
+    ++num_running_;
+    lock.unlock();
+
+    MaceStatus status = MaceStatus::MACE_SUCCESS;
+    RunControlGuard run_control_guard(run_control_);
+    if (run_control_ != nullptr) {
+      device_->cpu_runtime()->thread_pool()->priority_gate()->Yield(
+          run_control_);
+      if (run_control_->Stopped()) {
+        status = MaceStatus::MACE_CANCELLED;
+      }
+    }
+    if (weight_pager_ != nullptr) {
+      weight_pager_->WillRun(idx);
+    }
+    CallStats call_stats;
+    PageFaults page_faults = {0, 0};
+    if (collect_stats_) {
+      call_stats.start_micros = NowMicros();
+      page_faults = GetPageFaults();
+    }
+    if (status == MaceStatus::MACE_SUCCESS) {
+      status = operators_[idx]->Run(nullptr);
+    }
+    if (collect_stats_) {
+      call_stats.end_micros = NowMicros();
+      page_faults = PageFaultsSince(page_faults);
+    }
+    if (weight_pager_ != nullptr) {
+      weight_pager_->DidRun(idx);
+    }
+
+    lock.lock();
+    --num_running_;
+    if (collect_stats_) {
+      call_stats_[idx] = call_stats;
+      page_faults_[idx] = page_faults;
+    }
+    if (status != MaceStatus::MACE_SUCCESS) {
+      if (status != MaceStatus::MACE_CANCELLED) {
+        VLOG(0) << "Mace runtime failure: operator "
+                << operators_[idx]->debug_def().name();
+      }
+      status_ = status;
+      ready_ops_.clear();
+    } else if (status_ == MaceStatus::MACE_SUCCESS) {
+      for (int successor : successors_[idx]) {
+        if (--pending_predecessors_[successor] == 0) {
+          ready_ops_.push_back(successor);
+          cond_.notify_one();
+        }
+      }
+    }
+    if (ready_ops_.empty() && num_running_ == 0) {
+      done_cond_.notify_one();
+    }
+  }
+}
+
+MaceStatus ParallelNet::Run(RunMetadata *run_metadata) {
+  MACE_MEMORY_LOGGING_GUARD();
+  MACE_LATENCY_LOGGER(1, "Running net");
+  ThreadPool *thread_pool = device_->cpu_runtime()->thread_pool();
+  run_control_ = RunControl::current();
+  PriorityGate::Scope priority_scope(thread_pool->priority_gate(),
+                                     run_control_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  collect_stats_ = run_metadata != nullptr;
+  if (collect_stats_) {
+    call_stats_.assign(operators_.size(), CallStats());
+    page_faults_.assign(operators_.size(), PageFaults());
+  }
+  pending_predecessors_ = num_predecessors_;
+  status_ = MaceStatus::MACE_SUCCESS;
+  for (size_t idx = 0; idx < operators_.size(); ++idx) {
+    if (num_predecessors_[idx] == 0) {
+      ready_ops_.push_back(static_cast<int>(idx));
+    }
+  }
+  cond_.notify_all();
+  done_cond_.wait(lock, [this] {
+    return ready_ops_.empty() && num_running_ == 0;
+  });
+  MaceStatus status = status_;
+  lock.unlock();
+  // The last operators may have stopped early
+  if (status == MaceStatus::MACE_SUCCESS && run_control_ != nullptr
+      && run_control_->Stopped()) {
+    status = MaceStatus::MACE_CANCELLED;
+  }
+
+  if (status == MaceStatus::MACE_SUCCESS && run_metadata != nullptr) {
+    for (size_t idx = 0; idx < operators_.size(); ++idx) {
+      AddOperatorStats(operators_[idx].get(), call_stats_[idx],
+                       page_faults_[idx], run_metadata);
+    }
+  }
+  return status;
+}
+
 std::unique_ptr<NetBase> CreateNet(
     const std::shared_ptr<const OperatorRegistryBase> op_registry,
     const NetDef &net_def,
     Workspace *ws,
     Device *device,
-    const NetMode mode) {
+    const NetMode mode,
+    const int num_inter_op_threads) {
   std::shared_ptr<NetDef> tmp_net_def(new NetDef(net_def));
-  return CreateNet(op_registry, tmp_net_def, ws, device, mode);
+  return CreateNet(op_registry, tmp_net_def, ws, device, mode,
+                   num_inter_op_threads);
 }
 
 std::unique_ptr<NetBase> CreateNet(
@@ -191,9 +542,16 @@ std::unique_ptr<NetBase> CreateNet(
     const std::shared_ptr<const NetDef> net_def,
     Workspace *ws,
     Device *device,
-    const NetMode mode) {
-  std::unique_ptr<NetBase> net(
-      new SerialNet(op_registry, net_def, ws, device, mode));
+    const NetMode mode,
+    const int num_inter_op_threads) {
+  std::unique_ptr<NetBase> net;
+  if (num_inter_op_threads > 1 && mode == NetMode::NORMAL
+      && device->device_type() == DeviceType::CPU) {
+    net.reset(new ParallelNet(op_registry, net_def, ws, device,
+                              num_inter_op_threads));
+  } else {
+    net.reset(new SerialNet(op_registry, net_def, ws, device, mode));
+  }
   return net;
 }
 
@@ -15,13 +15,18 @@
 #ifndef MACE_CORE_NET_H_
 #define MACE_CORE_NET_H_
 
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <deque>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 #include <unordered_map>
 #include <sstream>
 
 #include "mace/core/operator.h"
+#include "mace/core/weight_pager.h"
 #include "mace/utils/string_util.h"
 
 #define kBinSize 2048
@@ -29,6 +34,7 @@
 namespace mace {
 
 class RunMetadata;
+class RunControl;
 class OperatorBase;
 class Workspace;
 
@@ -42,6 +48,17 @@ class NetBase {
 
   virtual MaceStatus Run(RunMetadata *run_metadata = nullptr) = 0;
 
+  // Runs the operators in order from *next_op on, until budget_micros is
+  // spent, and moves *next_op past those run. Runs at least one operator
+  // and never splits one, so a step overruns the budget by up to the time
+  // of its last operator. *done tells whether all have run.
+  virtual MaceStatus RunStep(size_t *next_op,
+                             const int64_t budget_micros,
+                             bool *done) = 0;
+
+  // Pages in the weights of the operators as they run.
+  virtual void SetWeightPager(std::unique_ptr<WeightPager> weight_pager);
+
   const std::string &Name() const { return name_; }
 
  protected:
@@ -59,28 +76,95 @@ class SerialNet : public NetBase {
             Device *device,
             const NetMode mode = NetMode::NORMAL);
 
+  // Runs the plan unless the run is profiled, paged or debugged (i.e. with
+  // VLOG level 2 or MACE_LOG_TENSOR_RANGE set when the net is created).
   MaceStatus Run(RunMetadata *run_metadata = nullptr) override;
 
+  // Also runs the operators of a ParallelNet one after another
+  MaceStatus RunStep(size_t *next_op,
+                     const int64_t budget_micros,
+                     bool *done) override;
+
+  void SetWeightPager(std::unique_ptr<WeightPager> weight_pager) override;
+
  protected:
+  // Runs the operators in order with nothing else per op, waiting only for
+  // the last one on GPU.
+  MaceStatus RunPlan();
+
   std::vector<std::unique_ptr<OperatorBase> > operators_;
   Device *device_;
   std::unique_ptr<OpKernelContext> op_kernel_context_;
+  std::unique_ptr<WeightPager> weight_pager_;
+  bool log_tensor_range_;
+  bool debug_;
+  // The operators, resolved once at construction
+  std::vector<OperatorBase *> plan_;
 
   MACE_DISABLE_COPY_AND_ASSIGN(SerialNet);
 };
 
+// Runs operators as soon as their dependencies are done, so independent
+// branches of the graph (e.g. Inception blocks) execute concurrently on
+// a pool of worker threads. Dependencies are derived from the operators'
+// inputs and outputs; tensors sharing a preallocated buffer (mem_id) or
+// aliasing another tensor's buffer (e.g. Reshape) are treated as the same
+// resource, so a reused buffer is never overwritten before all readers
+// of its previous content are done.
+class ParallelNet : public SerialNet {
+ public:
+  ParallelNet(const std::shared_ptr<const OperatorRegistryBase> op_registry,
+              const std::shared_ptr<const NetDef> net_def,
+              Workspace *ws,
+              Device *device,
+              const int num_threads);
+  ~ParallelNet() noexcept override;
+
+  MaceStatus Run(RunMetadata *run_metadata = nullptr) override;
+
+ private:
+  void BuildDependencies(const Workspace *ws);
+  void WorkerLoop(ScratchBuffer *scratch_buffer);
+
+  std::vector<std::vector<int>> successors_;
+  std::vector<int> num_predecessors_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::condition_variable done_cond_;
+  std::deque<int> ready_ops_;
+  std::vector<int> pending_predecessors_;
+  std::vector<CallStats> call_stats_;
+  std::vector<PageFaults> page_faults_;
+  int num_running_;
+  bool collect_stats_;
+  // Of the current run, set before the workers are woken up
+  const RunControl *run_control_;
+  bool stop_;
+  MaceStatus status_;
+
+  std::vector<std::unique_ptr<ScratchBuffer>> scratch_buffers_;
+  std::vector<std::thread> workers_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(ParallelNet);
+};
+
 std::unique_ptr<NetBase> CreateNet(
     const std::shared_ptr<const OperatorRegistryBase> op_registry,
     const NetDef &net_def,
     Workspace *ws,
     Device *device,
-    const NetMode mode = NetMode::NORMAL);
+    const NetMode mode = NetMode::NORMAL,
+    const int num_inter_op_threads = 1);
+// A ParallelNet is created only for the NORMAL mode net on CPU when
+// num_inter_op_threads > 1, otherwise operators run in a SerialNet.
 std::unique_ptr<NetBase> CreateNet(
     const std::shared_ptr<const OperatorRegistryBase> op_registry,
     const std::shared_ptr<const NetDef> net_def,
     Workspace *ws,
     Device *device,
-    const NetMode mode = NetMode::NORMAL);
+    const NetMode mode = NetMode::NORMAL,
+    const int num_inter_op_threads = 1);
 
 }  // namespace mace
 
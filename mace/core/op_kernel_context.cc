@@ -14,11 +14,18 @@
 
 #include "mace/core/op_kernel_context.h"
 
+#include <utility>
+
 namespace mace {
 
 OpKernelContext::OpKernelContext(Workspace *ws, Device *device)
     : device_(device), ws_(ws) {}
 
+OpKernelContext::OpKernelContext(Workspace *ws,
+                                 Device *device,
+                                 std::shared_ptr<const NetDef> net_def)
+    : device_(device), ws_(ws), net_def_(std::move(net_def)) {}
+
 OpKernelContext::~OpKernelContext() = default;
 
 Device* OpKernelContext::device() {
@@ -29,4 +36,8 @@ Workspace* OpKernelContext::workspace() {
   return ws_;
 }
 
+const std::shared_ptr<const NetDef> &OpKernelContext::net_def() {
+  return net_def_;
+}
+
 }  // namespace mace
@@ -15,6 +15,8 @@
 #ifndef MACE_CORE_OP_KERNEL_CONTEXT_H_
 #define MACE_CORE_OP_KERNEL_CONTEXT_H_
 
+#include <memory>
+
 #include "mace/core/device.h"
 #include "mace/core/workspace.h"
 namespace mace {
@@ -22,12 +24,19 @@ namespace mace {
 class OpKernelContext {
  public:
   OpKernelContext(Workspace *ws, Device *device);
+  // The operators created with the context are defined by ops of net_def,
+  // which they keep alive instead of copying their OperatorDef.
+  OpKernelContext(Workspace *ws,
+                  Device *device,
+                  std::shared_ptr<const NetDef> net_def);
   ~OpKernelContext();
   Device *device();
   Workspace *workspace();
+  const std::shared_ptr<const NetDef> &net_def();
  private:
   Device *device_;
   Workspace *ws_;
+  std::shared_ptr<const NetDef> net_def_;
 };
 
 }  // namespace mace
@@ -14,6 +14,7 @@
 
 #include <sstream>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -22,10 +23,99 @@
 
 namespace mace {
 
+namespace {
+
+OperatorAttributes DecodeAttributes(const OperatorDef &operator_def,
+                                    const ProtoArgHelper &arg_helper) {
+  OperatorAttributes attributes;
+  attributes.data_type = static_cast<DataType>(
+      arg_helper.GetOptionalArg<int>("T", static_cast<int>(DT_FLOAT)));
+  const std::string &type = operator_def.type();
+  attributes.has_conv_pool_args =
+      type == "Conv2D" || type == "FusedConv2D"
+          || type == "DepthwiseConv2d" || type == "Pooling";
+  attributes.kernels_from_filter = type != "Pooling";
+  attributes.conv_pool_args.padding_type = -1;
+  if (attributes.has_conv_pool_args) {
+    ConvPoolArgs *args = &attributes.conv_pool_args;
+    args->strides = arg_helper.GetRepeatedArgs<int>("strides");
+    args->padding_type = arg_helper.GetOptionalArg<int>("padding", -1);
+    args->paddings = arg_helper.GetRepeatedArgs<int>("padding_values");
+    args->dilations = arg_helper.GetRepeatedArgs<int>("dilations");
+    if (!attributes.kernels_from_filter) {
+      args->kernels = arg_helper.GetRepeatedArgs<int64_t>("kernels");
+    }
+  }
+  return attributes;
+}
+
+}  // namespace
+
 OperatorBase::OperatorBase(const OperatorDef &operator_def,
                            OpKernelContext *context)
-    : operator_def_(std::make_shared<OperatorDef>(operator_def)) {
-  MACE_UNUSED(context);
+    : operator_def_(context != nullptr && context->net_def() != nullptr
+                        ? std::shared_ptr<const OperatorDef>(
+                              context->net_def(), &operator_def)
+                        : std::make_shared<OperatorDef>(operator_def)),
+      arg_helper_(*operator_def_),
+      attributes_(DecodeAttributes(*operator_def_, arg_helper_)) {}
+
+void OperatorBase::set_debug_def(
+    const std::shared_ptr<const OperatorDef> &operator_def) {
+  operator_def_ = operator_def;
+  arg_helper_ = ProtoArgHelper(*operator_def_);
+  attributes_ = DecodeAttributes(*operator_def_, arg_helper_);
+}
+
+void CreateOutputTensors(const OperatorDef &operator_def,
+                         OpKernelContext *context,
+                         DataType default_type) {
+  Workspace *ws = context->workspace();
+  for (int i = 0; i < operator_def.output_size(); ++i) {
+    const std::string &output_str = operator_def.output(i);
+    // Those of the const workspace are shadowed, as in CreateTensor
+    if (ws->HasOwnTensor(output_str)) {
+      continue;
+    }
+    MACE_CHECK(
+      operator_def.output_type_size() == 0
+      || operator_def.output_size() == operator_def.output_type_size(),
+      "operator output size != operator output type size",
+      operator_def.output_size(),
+      operator_def.output_type_size());
+    DataType output_type;
+    if (i < operator_def.output_type_size()) {
+      output_type = operator_def.output_type(i);
+    } else {
+      output_type = default_type;
+    }
+    Tensor *output = MACE_CHECK_NOTNULL(ws->CreateTensor(
+      output_str, context->device()->allocator(), output_type));
+
+    if (i < operator_def.output_shape_size()) {
+      std::vector<index_t>
+          shape_configured(operator_def.output_shape(i).dims_size());
+      for (size_t dim = 0; dim < shape_configured.size(); ++dim) {
+        shape_configured[dim] = operator_def.output_shape(i).dims(dim);
+      }
+      output->SetShapeConfigured(shape_configured);
+    }
+  }
+}
+
+bool IsBufferReuseOp(const OperatorDef &op_def) {
+  static const std::set<std::string> kBufferReuseOps {
+      "Reshape", "Identity", "Squeeze", "ExpandDims"
+  };
+  return kBufferReuseOps.find(op_def.type()) != kBufferReuseOps.end();
+}
+
+bool IsInPlaceOp(const OperatorDef &op_def) {
+  static const std::set<std::string> kInPlaceOps {
+      "Activation", "BiasAdd", "BatchNorm", "FoldedBatchNorm", "Eltwise",
+      "ScalarMath"
+  };
+  return kInPlaceOps.find(op_def.type()) != kInPlaceOps.end();
 }
 
 OpKeyBuilder::OpKeyBuilder(const char *op_name) : op_name_(op_name) {}
@@ -30,6 +30,17 @@
 
 namespace mace {
 
+// The attributes of an operator which the net reads while running it,
+// decoded once when the operator is created.
+struct OperatorAttributes {
+  DataType data_type;
+  // Convolution and pooling ops report their window in the run metadata
+  bool has_conv_pool_args;
+  // Whether the kernel size is the filter shape rather than an argument
+  bool kernels_from_filter;
+  ConvPoolArgs conv_pool_args;
+};
+
 class OperatorBase {
  public:
   explicit OperatorBase(const OperatorDef &operator_def, OpKernelContext *);
@@ -39,17 +50,17 @@ class OperatorBase {
   inline T GetOptionalArg(const std::string &name,
                           const T &default_value) const {
     MACE_CHECK(operator_def_, "operator_def was null!");
-    return ProtoArgHelper::GetOptionalArg<OperatorDef, T>(
-        *operator_def_, name, default_value);
+    return arg_helper_.GetOptionalArg<T>(name, default_value);
   }
   template <typename T>
   inline std::vector<T> GetRepeatedArgs(
       const std::string &name, const std::vector<T> &default_value = {}) const {
     MACE_CHECK(operator_def_, "operator_def was null!");
-    return ProtoArgHelper::GetRepeatedArgs<OperatorDef, T>(
-        *operator_def_, name, default_value);
+    return arg_helper_.GetRepeatedArgs<T>(name, default_value);
   }
 
+  inline const OperatorAttributes &attributes() const { return attributes_; }
+
   inline const Tensor *Input(unsigned int idx) {
     MACE_CHECK(idx < inputs_.size());
     return inputs_[idx];
@@ -70,21 +81,28 @@ class OperatorBase {
     return *operator_def_;
   }
 
-  inline void set_debug_def(
-      const std::shared_ptr<const OperatorDef> &operator_def) {
-    operator_def_ = operator_def;
-  }
+  void set_debug_def(const std::shared_ptr<const OperatorDef> &operator_def);
 
   inline bool has_debug_def() const { return operator_def_ != nullptr; }
 
  protected:
   std::shared_ptr<const OperatorDef> operator_def_;
+  ProtoArgHelper arg_helper_;
+  OperatorAttributes attributes_;
   std::vector<const Tensor *> inputs_;
   std::vector<Tensor *> outputs_;
 
   MACE_DISABLE_COPY_AND_ASSIGN(OperatorBase);
 };
 
+// Creates the outputs of the operator which are not in the workspace yet,
+// of the output_type of operator_def or else default_type. Once they all
+// exist, constructing the operator only reads the workspace, so a net can
+// construct its operators concurrently after creating their outputs.
+void CreateOutputTensors(const OperatorDef &operator_def,
+                         OpKernelContext *context,
+                         DataType default_type);
+
 template <DeviceType D, class T>
 class Operator : public OperatorBase {
  public:
@@ -98,35 +116,9 @@ class Operator : public OperatorBase {
       inputs_.push_back(tensor);
     }
 
-    for (int i = 0; i < operator_def.output_size(); ++i) {
-      const std::string output_str = operator_def.output(i);
-      if (ws->HasTensor(output_str)) {
-        outputs_.push_back(ws->GetTensor(output_str));
-      } else {
-        MACE_CHECK(
-          operator_def.output_type_size() == 0
-          || operator_def.output_size() == operator_def.output_type_size(),
-          "operator output size != operator output type size",
-          operator_def.output_size(),
-          operator_def.output_type_size());
-        DataType output_type;
-        if (i < operator_def.output_type_size()) {
-          output_type = operator_def.output_type(i);
-        } else {
-          output_type = DataTypeToEnum<T>::v();
-        }
-        outputs_.push_back(MACE_CHECK_NOTNULL(ws->CreateTensor(
-          output_str, context->device()->allocator(), output_type)));
-
-        if (i < operator_def.output_shape_size()) {
-          std::vector<index_t>
-              shape_configured(operator_def.output_shape(i).dims_size());
-          for (size_t dim = 0; dim < shape_configured.size(); ++dim) {
-            shape_configured[dim] = operator_def.output_shape(i).dims(dim);
-          }
-          ws->GetTensor(output_str)->SetShapeConfigured(shape_configured);
-        }
-      }
+    CreateOutputTensors(operator_def, context, DataTypeToEnum<T>::v());
+    for (const std::string &output_str : operator_def.output()) {
+      outputs_.push_back(MACE_CHECK_NOTNULL(ws->GetTensor(output_str)));
     }
   }
   MaceStatus Run(StatsFuture *future) override = 0;
@@ -148,6 +140,18 @@ class Operator : public OperatorBase {
 #define MACE_OP_OUTPUT_TAGS(first_input, ...) \
   enum _OutputTags { first_input = 0, __VA_ARGS__ }
 
+// Op traits the memory planners rely on, which hold for every kernel of
+// the op type.
+//
+// The output of a buffer reuse op is its input 0 with another shape, so it
+// is not allocated but shares the buffer of input 0.
+bool IsBufferReuseOp(const OperatorDef &op_def);
+// The CPU kernels of an in place op compute every output element from the
+// input elements at the same index only, so the output can be written over
+// input 0 if both have the same shape and data type, and nothing reads
+// input 0 afterwards.
+bool IsInPlaceOp(const OperatorDef &op_def);
+
 class OpKeyBuilder {
  public:
   explicit OpKeyBuilder(const char *op_name);
@@ -0,0 +1,479 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/pipeline.h"
+
+#include <algorithm>
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <limits>
+#include <map>
+#include <set>
+#include <thread>  // NOLINT(build/c++11)
+#include <unordered_map>
+#include <utility>
+
+#include "mace/core/device.h"
+#include "mace/core/net.h"
+#include "mace/core/runtime/cpu/cpu_runtime.h"
+#include "mace/utils/env_time.h"
+#include "mace/utils/logging.h"
+#include "mace/utils/string_util.h"
+
+namespace mace {
+
+namespace {
+
+// Two buffers let a stage fill one while the next stage reads the other
+constexpr int kNumStageBuffers = 2;
+constexpr int64_t kSpinMicros = 200;
+
+// A bounded queue of one producer thread and one consumer thread. Push and
+// Pop are lock-free while the queue is neither full nor empty; a thread
+// finding it so spins for a while, then sleeps until the other one wakes
+// it up.
+template <typename T>
+class SPSCQueue {
+ public:
+  explicit SPSCQueue(const size_t capacity)
+      : size_(capacity + 1), items_(size_), head_(0), tail_(0),
+        num_sleepers_(0) {}
+
+  void Push(const T &item) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t next = (tail + 1) % size_;
+    Wait([this, next] { return next != head_.load(); });
+    items_[tail] = item;
+    tail_.store(next);
+    Wake();
+  }
+
+  T Pop() {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    Wait([this, head] { return head != tail_.load(); });
+    T item = items_[head];
+    head_.store((head + 1) % size_);
+    Wake();
+    return item;
+  }
+
+ private:
+  template <typename Ready>
+  void Wait(const Ready &ready) {
+    const int64_t spin_end_micros = NowMicros() + kSpinMicros;
+    while (!ready()) {
+      if (NowMicros() > spin_end_micros) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++num_sleepers_;
+        cond_.wait(lock, ready);
+        --num_sleepers_;
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  // The sleeper counts itself before checking the queue, and the other
+  // end checks the count after updating the queue, so one of them sees the
+  // other (the accesses are sequentially consistent).
+  void Wake() {
+    if (num_sleepers_.load() > 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cond_.notify_all();
+    }
+  }
+
+  const size_t size_;
+  std::vector<T> items_;
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+  std::atomic<int> num_sleepers_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(SPSCQueue);
+};
+
+bool IsNormalCPUOp(const OperatorDef &op_def) {
+  const int op_mode = ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+      op_def, "mode", static_cast<int>(NetMode::NORMAL));
+  const int op_device = ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+      op_def, "device", static_cast<int>(DeviceType::CPU));
+  return op_mode == NetMode::NORMAL && op_device == DeviceType::CPU;
+}
+
+// The multiply-adds of an op whose input 1 is a weight tensor, e.g.
+// Conv2D, FullyConnected or MatMul with a const operand, from the shape of
+// its output: each output element takes the weights of one output channel.
+// The size of the outputs for the other ops.
+int64_t EstimateOpCost(
+    const OperatorDef &op_def,
+    const std::unordered_map<std::string, int64_t> &weight_sizes) {
+  int64_t cost = 0;
+  for (auto &output_shape : op_def.output_shape()) {
+    int64_t size = 1;
+    for (auto dim : output_shape.dims()) {
+      size *= dim;
+    }
+    cost += size;
+  }
+  if (op_def.input_size() < 2 || op_def.output_shape_size() == 0) {
+    return std::max<int64_t>(cost, 1);
+  }
+  auto weight_size = weight_sizes.find(op_def.input(1));
+  const auto &dims = op_def.output_shape(0).dims();
+  if (weight_size != weight_sizes.end() && dims.size() > 0) {
+    int64_t channels = dims[dims.size() - 1];
+    if (dims.size() == 4
+        && ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+            op_def, "data_format", NHWC) == NCHW) {
+      channels = dims[1];
+    }
+    cost *= std::max<int64_t>(weight_size->second / std::max<int64_t>(
+        channels, 1), 1);
+  }
+  return std::max<int64_t>(cost, 1);
+}
+
+MaceStatus CopyTensors(const std::vector<std::string> &names,
+                       const Workspace *src_ws,
+                       Workspace *dst_ws) {
+  for (auto &name : names) {
+    const Tensor *src = src_ws->GetTensor(name);
+    Tensor *dst = dst_ws->GetTensor(name);
+    dst->SetDtype(src->dtype());
+    MACE_RETURN_IF_ERROR(dst->ResizeLike(src));
+    Tensor::MappingGuard src_guard(src);
+    dst->CopyBytes(src->raw_data(), src->size() * src->SizeOfType());
+    dst->SetScale(src->scale());
+    dst->SetZeroPoint(src->zero_point());
+    dst->SetMinVal(src->minval());
+    dst->SetMaxVal(src->maxval());
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+}  // namespace
+
+std::vector<int> SplitIntoStages(const std::vector<int64_t> &op_costs,
+                                 const int num_stages) {
+  const int num_ops = static_cast<int>(op_costs.size());
+  MACE_CHECK(num_stages > 0 && num_stages <= num_ops,
+             "Can't split ", num_ops, " ops into ", num_stages, " stages");
+  std::vector<int64_t> prefix_costs(num_ops + 1, 0);
+  for (int i = 0; i < num_ops; ++i) {
+    prefix_costs[i + 1] = prefix_costs[i] + op_costs[i];
+  }
+  // costs[k][i]: the cost of the most costly stage when splitting the
+  // first i ops into k + 1 stages, the last starting at starts[k][i].
+  std::vector<std::vector<int64_t>> costs(
+      num_stages, std::vector<int64_t>(num_ops + 1,
+                                       std::numeric_limits<int64_t>::max()));
+  std::vector<std::vector<int>> starts(num_stages,
+                                       std::vector<int>(num_ops + 1, 0));
+  for (int i = 1; i <= num_ops; ++i) {
+    costs[0][i] = prefix_costs[i];
+  }
+  for (int k = 1; k < num_stages; ++k) {
+    for (int i = k + 1; i <= num_ops; ++i) {
+      for (int j = k; j < i; ++j) {
+        const int64_t cost =
+            std::max(costs[k - 1][j], prefix_costs[i] - prefix_costs[j]);
+        if (cost < costs[k][i]) {
+          costs[k][i] = cost;
+          starts[k][i] = j;
+        }
+      }
+    }
+  }
+  std::vector<int> stage_starts(num_stages, 0);
+  for (int k = num_stages - 1, end = num_ops; k > 0; --k) {
+    stage_starts[k] = starts[k][end];
+    end = stage_starts[k];
+  }
+  return stage_starts;
+}
+
+struct Pipeline::Frame {
+  OutputFn output_fn;
+  // The input buffer of the stage it is queued to
+  int buffer;
+  MaceStatus status;
+};
+
+struct Pipeline::Stage {
+  Stage() : ready_frames(kNumStageBuffers + 1),
+            free_buffers(kNumStageBuffers),
+            busy_micros(0) {}
+
+  std::shared_ptr<NetDef> net_def;
+  std::vector<int> cpu_ids;
+  std::unique_ptr<Device> device;
+  std::unique_ptr<Workspace> ws;
+  std::unique_ptr<NetBase> net;
+  // The boundary tensors the stage reads and those it hands over
+  std::vector<std::string> input_tensors;
+  std::vector<std::string> output_tensors;
+  // The input buffers, holding the input tensors of a frame each
+  std::unique_ptr<Workspace> buffers[kNumStageBuffers];
+  // Frames whose inputs are in a buffer, and the buffers not in use. A
+  // null frame stops the stage.
+  SPSCQueue<Frame *> ready_frames;
+  SPSCQueue<int> free_buffers;
+  std::atomic<int64_t> busy_micros;
+  std::thread thread;
+};
+
+Pipeline::Pipeline(
+    const std::shared_ptr<const OperatorRegistryBase> op_registry,
+    const std::shared_ptr<const NetDef> net_def,
+    const Workspace *const_workspace,
+    const std::vector<std::string> &input_tensors,
+    const std::vector<std::string> &output_tensors,
+    const std::vector<std::vector<int>> &stage_cpu_ids,
+    const bool use_gemmlowp)
+    : op_registry_(op_registry),
+      net_def_(net_def),
+      const_workspace_(const_workspace),
+      input_tensors_(input_tensors),
+      output_tensors_(output_tensors),
+      stage_cpu_ids_(stage_cpu_ids),
+      use_gemmlowp_(use_gemmlowp),
+      start_micros_(-1),
+      num_frames_(0) {}
+
+Pipeline::~Pipeline() {
+  if (stages_.empty()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(submit_mutex_);
+    stages_.front()->ready_frames.Push(nullptr);
+  }
+  for (auto &stage : stages_) {
+    if (stage->thread.joinable()) {
+      stage->thread.join();
+    }
+  }
+}
+
+MaceStatus Pipeline::Init() {
+  std::vector<const OperatorDef *> op_defs;
+  for (auto &op_def : net_def_->op()) {
+    if (IsNormalCPUOp(op_def)) {
+      op_defs.push_back(&op_def);
+    }
+  }
+  const int num_ops = static_cast<int>(op_defs.size());
+  if (num_ops == 0 || stage_cpu_ids_.empty()) {
+    LOG(ERROR) << "Pipeline needs CPU operators and stages";
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  const int num_stages =
+      std::min(static_cast<int>(stage_cpu_ids_.size()), num_ops);
+  if (num_stages < static_cast<int>(stage_cpu_ids_.size())) {
+    LOG(WARNING) << "Pipeline of " << num_ops << " operators has "
+                 << num_stages << " stages only";
+  }
+
+  std::unordered_map<std::string, int64_t> weight_sizes;
+  for (auto &const_tensor : net_def_->tensors()) {
+    weight_sizes[const_tensor.name()] = const_tensor.data_size();
+  }
+  std::vector<int64_t> op_costs;
+  for (const OperatorDef *op_def : op_defs) {
+    op_costs.push_back(EstimateOpCost(*op_def, weight_sizes));
+  }
+  std::vector<int> stage_starts = SplitIntoStages(op_costs, num_stages);
+  stage_starts.push_back(num_ops);
+
+  // A tensor is live between the stage producing it, -1 for the model
+  // inputs, and the last stage reading it, num_stages for the outputs.
+  // The other tensors the ops read are const.
+  std::map<std::string, std::pair<int, int>> live_stages;
+  for (auto &name : input_tensors_) {
+    live_stages[name] = std::make_pair(-1, 0);
+  }
+  for (int stage_idx = 0; stage_idx < num_stages; ++stage_idx) {
+    for (int i = stage_starts[stage_idx]; i < stage_starts[stage_idx + 1];
+         ++i) {
+      for (auto &input : op_defs[i]->input()) {
+        auto iter = live_stages.find(input);
+        if (iter != live_stages.end()) {
+          iter->second.second = std::max(iter->second.second, stage_idx);
+        }
+      }
+      for (auto &output : op_defs[i]->output()) {
+        live_stages[output] = std::make_pair(stage_idx, stage_idx);
+      }
+    }
+  }
+  for (auto &name : output_tensors_) {
+    auto iter = live_stages.find(name);
+    if (iter != live_stages.end()) {
+      iter->second.second = num_stages;
+    }
+  }
+
+  for (int stage_idx = 0; stage_idx < num_stages; ++stage_idx) {
+    std::unique_ptr<Stage> stage(new Stage());
+    for (auto &live : live_stages) {
+      if (live.second.first < stage_idx && live.second.second >= stage_idx) {
+        stage->input_tensors.push_back(live.first);
+      }
+      if (live.second.first <= stage_idx && live.second.second > stage_idx
+          && stage_idx + 1 < num_stages) {
+        stage->output_tensors.push_back(live.first);
+      }
+    }
+
+    // The ops of the stage, with the memory blocks they use. The boundary
+    // tensors are the inputs and outputs of the stage's net, so that the
+    // memory planned at runtime keeps them.
+    stage->net_def.reset(new NetDef());
+    stage->net_def->set_name(MakeString(net_def_->name(), "_stage_",
+                                        stage_idx));
+    std::set<int> mem_ids;
+    for (int i = stage_starts[stage_idx]; i < stage_starts[stage_idx + 1];
+         ++i) {
+      *stage->net_def->add_op() = *op_defs[i];
+      mem_ids.insert(op_defs[i]->mem_id().begin(), op_defs[i]->mem_id().end());
+    }
+    for (auto &mem_block : net_def_->mem_arena().mem_block()) {
+      if (mem_ids.count(mem_block.mem_id()) > 0) {
+        *stage->net_def->mutable_mem_arena()->add_mem_block() = mem_block;
+      }
+    }
+    for (auto &name : stage->input_tensors) {
+      stage->net_def->add_input_info()->set_name(name);
+    }
+    for (auto &name : stage_idx + 1 < num_stages ? stage->output_tensors
+                                                 : output_tensors_) {
+      stage->net_def->add_output_info()->set_name(name);
+    }
+
+    stage->cpu_ids = stage_cpu_ids_[stage_idx];
+    stage->device.reset(new CPUDevice(
+        std::max(static_cast<int>(stage->cpu_ids.size()), 1),
+        CPUAffinityPolicy::AFFINITY_NONE, use_gemmlowp_, stage->cpu_ids));
+    stage->ws.reset(new Workspace(const_workspace_));
+    for (int buffer = 0; buffer < kNumStageBuffers; ++buffer) {
+      stage->buffers[buffer].reset(new Workspace());
+    }
+    for (auto &name : stage->input_tensors) {
+      stage->ws->CreateTensor(name, stage->device->allocator(), DT_FLOAT);
+      for (auto &buffer : stage->buffers) {
+        buffer->CreateTensor(name, stage->device->allocator(), DT_FLOAT);
+      }
+    }
+    MACE_RETURN_IF_ERROR(stage->ws->CreateContextTensors(
+        *stage->net_def, stage->device.get()));
+    stage->net = CreateNet(op_registry_, stage->net_def, stage->ws.get(),
+                           stage->device.get());
+    for (int buffer = 0; buffer < kNumStageBuffers; ++buffer) {
+      stage->free_buffers.Push(buffer);
+    }
+    VLOG(1) << "Pipeline stage " << stage_idx << ": "
+            << stage->net_def->op_size() << " operators from "
+            << stage->net_def->op(0).name() << " on cores "
+            << MakeString(stage->cpu_ids) << ", "
+            << stage->input_tensors.size() << " input tensors";
+    stages_.emplace_back(std::move(stage));
+  }
+  for (int stage_idx = 0; stage_idx < num_stages; ++stage_idx) {
+    stages_[stage_idx]->thread =
+        std::thread(&Pipeline::StageLoop, this, stage_idx);
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus Pipeline::Submit(const InputFn &input_fn,
+                            const OutputFn &output_fn) {
+  MACE_CHECK(!stages_.empty(), "Pipeline is not initialized");
+  std::lock_guard<std::mutex> lock(submit_mutex_);
+  Stage *stage = stages_.front().get();
+  const int buffer = stage->free_buffers.Pop();
+  int64_t no_start = -1;
+  start_micros_.compare_exchange_strong(no_start, NowMicros());
+  Frame *frame = new Frame;
+  frame->output_fn = output_fn;
+  frame->buffer = buffer;
+  frame->status = input_fn(stage->buffers[buffer].get());
+  stage->ready_frames.Push(frame);
+  return MaceStatus::MACE_SUCCESS;
+}
+
+void Pipeline::StageLoop(const int stage_idx) {
+  Stage *stage = stages_[stage_idx].get();
+  Stage *next_stage = stage_idx + 1 < static_cast<int>(stages_.size())
+                      ? stages_[stage_idx + 1].get() : nullptr;
+  if (!stage->cpu_ids.empty()
+      && SetCurrentThreadAffinity(stage->cpu_ids) != MACE_SUCCESS) {
+    LOG(WARNING) << "Failed to bind pipeline stage " << stage_idx
+                 << " to cores " << MakeString(stage->cpu_ids);
+  }
+  while (true) {
+    Frame *frame = stage->ready_frames.Pop();
+    if (frame == nullptr) {
+      if (next_stage != nullptr) {
+        next_stage->ready_frames.Push(nullptr);
+      }
+      break;
+    }
+    int64_t start_micros = NowMicros();
+    if (frame->status == MaceStatus::MACE_SUCCESS) {
+      frame->status = CopyTensors(stage->input_tensors,
+                                  stage->buffers[frame->buffer].get(),
+                                  stage->ws.get());
+    }
+    // The stage before can fill the buffer while the operators run
+    stage->free_buffers.Push(frame->buffer);
+    if (frame->status == MaceStatus::MACE_SUCCESS) {
+      frame->status = stage->net->Run();
+    }
+    int64_t busy_micros = NowMicros() - start_micros;
+
+    if (next_stage != nullptr) {
+      frame->buffer = next_stage->free_buffers.Pop();
+      start_micros = NowMicros();
+      if (frame->status == MaceStatus::MACE_SUCCESS) {
+        frame->status = CopyTensors(
+            stage->output_tensors, stage->ws.get(),
+            next_stage->buffers[frame->buffer].get());
+      }
+      next_stage->ready_frames.Push(frame);
+    } else {
+      // Counted before output_fn, which may wake up a GetStats caller
+      ++num_frames_;
+      start_micros = NowMicros();
+      frame->output_fn(frame->status, stage->ws.get());
+      delete frame;
+    }
+    busy_micros += NowMicros() - start_micros;
+    stage->busy_micros += busy_micros;
+  }
+}
+
+void Pipeline::GetStats(PipelineStats *stats) const {
+  MACE_CHECK_NOTNULL(stats);
+  const int64_t start_micros = start_micros_.load();
+  stats->frames = num_frames_.load();
+  stats->elapsed_micros = start_micros < 0 ? 0 : NowMicros() - start_micros;
+  stats->stages.clear();
+  for (auto &stage : stages_) {
+    stats->stages.push_back({stage->net_def->op_size(),
+                             stage->busy_micros.load()});
+  }
+}
+
+}  // namespace mace
@@ -0,0 +1,110 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_PIPELINE_H_
+#define MACE_CORE_PIPELINE_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "mace/core/operator.h"
+#include "mace/core/workspace.h"
+#include "mace/proto/mace.pb.h"
+#include "mace/public/mace.h"
+
+namespace mace {
+
+// Runs the NORMAL mode CPU operators of a net as a pipeline, so that
+// several frames are in flight: while a stage runs its operators on a
+// frame, the stage before it runs on the next one. The operators are split
+// in model order into stages of about the same estimated cost, each run by
+// a thread of its own on a thread pool pinned to the cores of the stage.
+//
+// A stage has its own workspace, sharing the const tensors of the engine.
+// The tensors a frame still needs after a stage (the boundary tensors) are
+// handed to the next stage through one of its two input buffers, so that
+// a stage can hand the next frame over while the following stage is still
+// reading the previous one. The frames and the free buffers go between the
+// stages through bounded lock-free queues.
+class Pipeline {
+ public:
+  // Fills the input tensors of a frame, in the workspace of the first
+  // buffer of the pipeline.
+  typedef std::function<MaceStatus(Workspace *ws)> InputFn;
+  // Reads the output tensors of a frame from the workspace of the last
+  // stage, unless status tells the frame failed.
+  typedef std::function<void(MaceStatus status, Workspace *ws)> OutputFn;
+
+  // input_tensors and output_tensors are the names of the tensors of the
+  // model inputs and outputs in the workspaces. Each stage runs on
+  // as many threads as it has cores in stage_cpu_ids, or on one thread not
+  // bound to a core if it has none.
+  Pipeline(const std::shared_ptr<const OperatorRegistryBase> op_registry,
+           const std::shared_ptr<const NetDef> net_def,
+           const Workspace *const_workspace,
+           const std::vector<std::string> &input_tensors,
+           const std::vector<std::string> &output_tensors,
+           const std::vector<std::vector<int>> &stage_cpu_ids,
+           const bool use_gemmlowp);
+  // Completes the submitted frames.
+  ~Pipeline();
+
+  // Creates the stages and starts their threads. There are fewer stages
+  // than asked if the net has fewer operators.
+  MaceStatus Init();
+
+  // Calls input_fn on the calling thread once the first stage has a free
+  // input buffer, and queues the frame. output_fn is called on the thread
+  // of the last stage when it is done. Frames complete in submission
+  // order, a failed one with the status of the first failing step.
+  MaceStatus Submit(const InputFn &input_fn, const OutputFn &output_fn);
+
+  void GetStats(PipelineStats *stats) const;
+
+ private:
+  struct Frame;
+  struct Stage;
+
+  void StageLoop(const int stage_idx);
+
+  const std::shared_ptr<const OperatorRegistryBase> op_registry_;
+  const std::shared_ptr<const NetDef> net_def_;
+  const Workspace *const_workspace_;
+  const std::vector<std::string> input_tensors_;
+  const std::vector<std::string> output_tensors_;
+  const std::vector<std::vector<int>> stage_cpu_ids_;
+  const bool use_gemmlowp_;
+
+  std::vector<std::unique_ptr<Stage>> stages_;
+  // Serializes the submitters, the single producer of the first stage
+  std::mutex submit_mutex_;
+  std::atomic<int64_t> start_micros_;
+  std::atomic<int64_t> num_frames_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(Pipeline);
+};
+
+// Splits ops of the given costs, in order, into num_stages non-empty
+// stages minimizing the cost of the most costly one. Returns the index of
+// the first op of each stage. num_stages must not exceed the ops.
+std::vector<int> SplitIntoStages(const std::vector<int64_t> &op_costs,
+                                 const int num_stages);
+
+}  // namespace mace
+
+#endif  // MACE_CORE_PIPELINE_H_
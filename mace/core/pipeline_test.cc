@@ -0,0 +1,105 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mace/core/pipeline.h"
+#include "mace/core/testing/test_net_util.h"
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace test {
+
+TEST(PipelineTest, SplitIntoStages) {
+  EXPECT_EQ(std::vector<int>({0}), SplitIntoStages({5, 1, 1}, 1));
+  EXPECT_EQ(std::vector<int>({0, 1}), SplitIntoStages({5, 1, 1}, 2));
+  EXPECT_EQ(std::vector<int>({0, 2, 3}),
+            SplitIntoStages({2, 2, 4, 1, 1, 1, 1}, 3));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), SplitIntoStages({1, 1, 1, 1}, 4));
+}
+
+TEST(PipelineTest, Frames) {
+  NetDef net_def;
+  std::vector<float> model_data;
+  BuildResidualNet(&net_def, &model_data);
+  Device *device = ops::test::OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  std::shared_ptr<OperatorRegistryBase> op_registry(new OperatorRegistry());
+  auto input_data = [](int frame, index_t i) {
+    return (static_cast<int>(i % 9) - 4) * 0.25f * (frame + 1);
+  };
+
+  const int num_frames = 6;
+  std::vector<std::vector<float>> expected(num_frames);
+  for (int frame = 0; frame < num_frames; ++frame) {
+    Workspace ws;
+    ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+              ws.LoadModelTensor(
+                  net_def, device,
+                  reinterpret_cast<const unsigned char *>(model_data.data())));
+    Tensor *input = ws.CreateTensor("Input", device->allocator(), DT_FLOAT);
+    input->Resize({1, 2, 4, 4});
+    for (index_t i = 0; i < input->size(); ++i) {
+      input->mutable_data<float>()[i] = input_data(frame, i);
+    }
+    auto net = CreateNet(op_registry, net_def, &ws, device);
+    ASSERT_EQ(MaceStatus::MACE_SUCCESS, net->Run());
+    const Tensor *output = ws.GetTensor("Output");
+    expected[frame].assign(output->data<float>(),
+                           output->data<float>() + output->size());
+  }
+
+  // B1 is read two stages after the one computing it
+  Workspace const_ws;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            const_ws.LoadModelTensor(
+                net_def, device,
+                reinterpret_cast<const unsigned char *>(model_data.data())));
+  std::shared_ptr<NetDef> shared_net_def(new NetDef(net_def));
+  std::vector<std::vector<float>> outputs(num_frames);
+  std::vector<MaceStatus> statuses(num_frames, MaceStatus::MACE_INVALID_ARGS);
+  {
+    Pipeline pipeline(op_registry, shared_net_def, &const_ws, {"Input"},
+                      {"Output"}, {{}, {}, {}}, false);
+    ASSERT_EQ(MaceStatus::MACE_SUCCESS, pipeline.Init());
+    for (int frame = 0; frame < num_frames; ++frame) {
+      ASSERT_EQ(MaceStatus::MACE_SUCCESS, pipeline.Submit(
+          [&, frame](Workspace *ws) {
+            Tensor *input = ws->GetTensor("Input");
+            MACE_RETURN_IF_ERROR(input->Resize({1, 2, 4, 4}));
+            for (index_t i = 0; i < input->size(); ++i) {
+              input->mutable_data<float>()[i] = input_data(frame, i);
+            }
+            return MaceStatus::MACE_SUCCESS;
+          },
+          [&, frame](MaceStatus status, Workspace *ws) {
+            statuses[frame] = status;
+            const Tensor *output = ws->GetTensor("Output");
+            outputs[frame].assign(output->data<float>(),
+                                  output->data<float>() + output->size());
+          }));
+    }
+  }
+  for (int frame = 0; frame < num_frames; ++frame) {
+    EXPECT_EQ(MaceStatus::MACE_SUCCESS, statuses[frame]);
+    ASSERT_EQ(expected[frame].size(), outputs[frame].size());
+    for (size_t i = 0; i < expected[frame].size(); ++i) {
+      EXPECT_NEAR(expected[frame][i], outputs[frame][i], 1e-5);
+    }
+  }
+}
+
+}  // namespace test
+}  // namespace mace
@@ -42,6 +42,16 @@ class PreallocatedPooledAllocator {
     }
   }
 
+  std::unique_ptr<BufferBase> ReleaseBuffer(int mem_id) {
+    std::unique_ptr<BufferBase> buffer;
+    auto iter = buffers_.find(mem_id);
+    if (iter != buffers_.end()) {
+      buffer = std::move(iter->second);
+      buffers_.erase(iter);
+    }
+    return buffer;
+  }
+
   virtual bool HasBuffer(int mem_id) {
     return buffers_.find(mem_id) != buffers_.end();
   }
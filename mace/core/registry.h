@@ -19,6 +19,7 @@
 #include <map>
 #include <memory>
 #include <mutex>  // NOLINT(build/c++11)
+#include <set>
 #include <string>
 #include <vector>
 
@@ -34,12 +35,27 @@ class Registry {
   Registry() : registry_() {}
 
   void Register(const SrcType &key, Creator creator) {
-    VLOG(3) << "Registering: " << key;
     std::lock_guard<std::mutex> lock(register_mutex_);
+    if (selected_keys_ != nullptr && selected_keys_->count(key) == 0) {
+      VLOG(3) << "Skipping unselected: " << key;
+      return;
+    }
+    VLOG(3) << "Registering: " << key;
     MACE_CHECK(registry_.count(key) == 0, "Key already registered: ", key);
     registry_[key] = creator;
   }
 
+  // Registers only these keys from then on, e.g. those the deployed models
+  // use; the others are skipped.
+  void Select(const std::set<SrcType> &keys) {
+    std::lock_guard<std::mutex> lock(register_mutex_);
+    selected_keys_.reset(new std::set<SrcType>(keys));
+  }
+
+  bool Has(const SrcType &key) const {
+    return registry_.count(key) > 0;
+  }
+
   std::unique_ptr<ObjectType> Create(const SrcType &key, Args... args) const {
     if (registry_.count(key) == 0) {
       LOG(FATAL) << "Key not registered: " << key;
@@ -49,6 +65,7 @@ class Registry {
 
  private:
   std::map<SrcType, Creator> registry_;
+  std::unique_ptr<std::set<SrcType>> selected_keys_;
   std::mutex register_mutex_;
 
   MACE_DISABLE_COPY_AND_ASSIGN(Registry);
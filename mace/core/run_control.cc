@@ -0,0 +1,134 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/run_control.h"
+
+#include <map>
+
+#include "mace/utils/logging.h"
+
+namespace mace {
+
+namespace {
+// How often a yielding run looks whether it is stopped
+constexpr int kYieldCheckMillis = 1;
+
+thread_local const RunControl *current_run_control = nullptr;
+
+// A run without options has the normal priority
+RunPriority PriorityOf(const RunControl *run_control) {
+  return run_control == nullptr ? RUN_PRIORITY_NORMAL
+                                : run_control->priority();
+}
+}  // namespace
+
+RunControl::RunControl(const RunOptions &options)
+    : cancellation_token_(options.cancellation_token),
+      deadline_(options.deadline),
+      priority_(options.priority),
+      stopped_(false) {
+  MACE_CHECK(priority_ >= RUN_PRIORITY_LOW && priority_ <= RUN_PRIORITY_HIGH,
+             "Invalid run priority: ", priority_);
+}
+
+bool RunControl::Stopped() const {
+  if (stopped_.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  if ((cancellation_token_ != nullptr && cancellation_token_->IsCancelled())
+      || (deadline_ != std::chrono::steady_clock::time_point::max()
+          && std::chrono::steady_clock::now() >= deadline_)) {
+    stopped_.store(true, std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+const RunControl *RunControl::current() {
+  return current_run_control;
+}
+
+RunControlGuard::RunControlGuard(const RunControl *run_control)
+    : prev_run_control_(current_run_control) {
+  current_run_control = run_control;
+}
+
+RunControlGuard::~RunControlGuard() {
+  current_run_control = prev_run_control_;
+}
+
+PriorityGate::PriorityGate() {
+  for (auto &num_runs : num_runs_) {
+    num_runs.store(0, std::memory_order_relaxed);
+  }
+}
+
+PriorityGate::Scope::Scope(PriorityGate *gate, const RunControl *run_control)
+    : gate_(gate), run_control_(run_control) {
+  gate_->num_runs_[PriorityOf(run_control_)].fetch_add(
+      1, std::memory_order_acq_rel);
+}
+
+PriorityGate::Scope::~Scope() {
+  {
+    // Under the mutex, not to be missed by a run about to wait
+    std::lock_guard<std::mutex> lock(gate_->mutex_);
+    gate_->num_runs_[PriorityOf(run_control_)].fetch_sub(
+        1, std::memory_order_acq_rel);
+  }
+  gate_->cond_.notify_all();
+}
+
+void PriorityGate::Yield(const RunControl *run_control) {
+  const int priority = PriorityOf(run_control);
+  auto higher_priority_running = [this, priority]() {
+    for (int p = priority + 1; p < kNumPriorities; ++p) {
+      if (num_runs_[p].load(std::memory_order_acquire) > 0) {
+        return true;
+      }
+    }
+    return false;
+  };
+  if (!higher_priority_running()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (higher_priority_running()
+         && (run_control == nullptr || !run_control->Stopped())) {
+    cond_.wait_for(lock, std::chrono::milliseconds(kYieldCheckMillis));
+  }
+}
+
+std::shared_ptr<PriorityGate> PriorityGate::ForExecutor(
+    const Executor *executor) {
+  static std::mutex mutex;
+  static auto *gates =
+      new std::map<const Executor *, std::weak_ptr<PriorityGate>>();
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto iter = gates->begin(); iter != gates->end();) {
+    if (iter->second.expired()) {
+      iter = gates->erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  std::shared_ptr<PriorityGate> gate = (*gates)[executor].lock();
+  if (gate == nullptr) {
+    gate.reset(new PriorityGate());
+    (*gates)[executor] = gate;
+  }
+  return gate;
+}
+
+}  // namespace mace
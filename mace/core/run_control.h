@@ -0,0 +1,104 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_RUN_CONTROL_H_
+#define MACE_CORE_RUN_CONTROL_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+
+#include "mace/public/mace.h"
+#include "mace/utils/utils.h"
+
+namespace mace {
+
+// The cancellation token, the deadline and the priority of a run. The
+// engine makes it the control of the thread running the net, which checks
+// it between the operators; kernels with long loops read it on the calling
+// thread and check it between their blocks, and simply stop early.
+class RunControl {
+ public:
+  explicit RunControl(const RunOptions &options);
+
+  // Whether the run is cancelled or past its deadline, which stays so
+  bool Stopped() const;
+
+  RunPriority priority() const { return priority_; }
+
+  // The control of the calling thread, or nullptr
+  static const RunControl *current();
+
+ private:
+  const CancellationToken *cancellation_token_;
+  const std::chrono::steady_clock::time_point deadline_;
+  const RunPriority priority_;
+  mutable std::atomic<bool> stopped_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(RunControl);
+};
+
+// Makes run_control the control of the calling thread while alive.
+class RunControlGuard {
+ public:
+  explicit RunControlGuard(const RunControl *run_control);
+  ~RunControlGuard();
+
+ private:
+  const RunControl *prev_run_control_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(RunControlGuard);
+};
+
+// Where the runs sharing a thread pool meet: between its operators, a run
+// waits while runs of a higher priority are in progress.
+class PriorityGate {
+ public:
+  PriorityGate();
+
+  // Counts a run in progress while alive, of normal priority for a null
+  // control.
+  class Scope {
+   public:
+    Scope(PriorityGate *gate, const RunControl *run_control);
+    ~Scope();
+
+   private:
+    PriorityGate *gate_;
+    const RunControl *run_control_;
+
+    MACE_DISABLE_COPY_AND_ASSIGN(Scope);
+  };
+
+  // Returns once no run of a higher priority than run_control's is in
+  // progress, or run_control is stopped.
+  void Yield(const RunControl *run_control);
+
+  // The gate of the pools running on executor, shared while any is alive
+  static std::shared_ptr<PriorityGate> ForExecutor(const Executor *executor);
+
+ private:
+  static constexpr int kNumPriorities = RUN_PRIORITY_HIGH + 1;
+
+  std::atomic<int> num_runs_[kNumPriorities];
+  std::mutex mutex_;
+  std::condition_variable cond_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(PriorityGate);
+};
+
+}  // namespace mace
+
+#endif  // MACE_CORE_RUN_CONTROL_H_
@@ -0,0 +1,138 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mace/core/run_control.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
+#include "mace/core/testing/test_net_util.h"
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace test {
+
+namespace {
+// Runs the chunks in order on the calling thread
+class InlineExecutor : public Executor {
+ public:
+  int num_threads() const override { return 1; }
+
+  void Run(int num_chunks,
+           const std::function<void(int)> &chunk_fn) override {
+    for (int i = 0; i < num_chunks; ++i) {
+      chunk_fn(i);
+    }
+  }
+};
+}  // namespace
+
+TEST(RunControlTest, CancelAndDeadline) {
+  NetDef net_def;
+  std::vector<float> model_data;
+  BuildResidualNet(&net_def, &model_data);
+  // Loads the model and the input into ws
+  Workspace ws;
+  std::vector<float> expected;
+  RunResidualNet(net_def, model_data, &ws, &expected);
+
+  Device *device = ops::test::OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  std::shared_ptr<OperatorRegistryBase> op_registry(new OperatorRegistry());
+  for (int num_inter_op_threads : {1, 2}) {
+    auto net = CreateNet(op_registry, net_def, &ws, device, NetMode::NORMAL,
+                         num_inter_op_threads);
+    CancellationToken token;
+    RunOptions options;
+    options.cancellation_token = &token;
+    options.deadline =
+        std::chrono::steady_clock::now() + std::chrono::hours(1);
+    RunControl run_control(options);
+    {
+      RunControlGuard run_control_guard(&run_control);
+      EXPECT_EQ(&run_control, RunControl::current());
+      ASSERT_EQ(MaceStatus::MACE_SUCCESS, net->Run());
+      const Tensor *output = ws.GetTensor("Output");
+      ASSERT_EQ(static_cast<index_t>(expected.size()), output->size());
+      for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_NEAR(expected[i], output->data<float>()[i], 1e-5);
+      }
+
+      token.Cancel();
+      EXPECT_TRUE(run_control.Stopped());
+      EXPECT_EQ(MaceStatus::MACE_CANCELLED, net->Run());
+    }
+    EXPECT_EQ(nullptr, RunControl::current());
+
+    RunOptions past_deadline;
+    past_deadline.deadline = std::chrono::steady_clock::now();
+    RunControl expired_run_control(past_deadline);
+    {
+      RunControlGuard run_control_guard(&expired_run_control);
+      EXPECT_EQ(MaceStatus::MACE_CANCELLED, net->Run());
+    }
+    EXPECT_EQ(MaceStatus::MACE_SUCCESS, net->Run());
+  }
+}
+
+TEST(RunControlTest, PriorityGate) {
+  RunOptions options;
+  options.priority = RUN_PRIORITY_LOW;
+  RunControl low(options);
+  options.priority = RUN_PRIORITY_HIGH;
+  RunControl high(options);
+
+  PriorityGate gate;
+  // Nothing of a higher priority in progress
+  gate.Yield(&low);
+  gate.Yield(nullptr);
+  std::unique_ptr<PriorityGate::Scope> high_scope(
+      new PriorityGate::Scope(&gate, &high));
+  gate.Yield(&high);
+
+  std::atomic<bool> yielded(false);
+  std::thread low_thread([&]() {
+    PriorityGate::Scope low_scope(&gate, &low);
+    gate.Yield(&low);
+    yielded = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(yielded.load());
+  high_scope.reset();
+  low_thread.join();
+  EXPECT_TRUE(yielded.load());
+
+  // A stopped run does not wait
+  CancellationToken token;
+  token.Cancel();
+  options.priority = RUN_PRIORITY_LOW;
+  options.cancellation_token = &token;
+  RunControl cancelled(options);
+  PriorityGate::Scope normal_scope(&gate, nullptr);
+  gate.Yield(&cancelled);
+
+  // The pools on an executor share its gate
+  auto executor = std::make_shared<InlineExecutor>();
+  ThreadPool pool(executor);
+  ThreadPool other_pool(executor);
+  ThreadPool own_pool(1, {});
+  EXPECT_EQ(pool.priority_gate(), other_pool.priority_gate());
+  EXPECT_NE(pool.priority_gate(), own_pool.priority_gate());
+}
+
+}  // namespace test
+}  // namespace mace
@@ -14,16 +14,15 @@
 
 #include "mace/core/runtime/cpu/cpu_runtime.h"
 
-#ifdef MACE_ENABLE_OPENMP
-#include <omp.h>
-#endif
-
 #include <errno.h>
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
 #include <string.h>
 #include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
 #include <utility>
 #include <vector>
 
@@ -33,8 +32,6 @@
 
 namespace mace {
 
-int MaceOpenMPThreadCount = 1;
-
 namespace {
 
 int GetCPUCount() {
@@ -127,90 +124,105 @@ MaceStatus GetCPUBigLittleCoreIDs(std::vector<int> *big_core_ids,
   return MACE_SUCCESS;
 }
 
-MaceStatus SetOpenMPThreadsAndAffinityCPUs(int omp_num_threads,
-                                           const std::vector<int> &cpu_ids) {
-  MaceOpenMPThreadCount = omp_num_threads;
-
-#ifdef MACE_ENABLE_OPENMP
-  VLOG(1) << "Set OpenMP threads number: " << omp_num_threads
-          << ", CPU core IDs: " << MakeString(cpu_ids);
-  omp_set_num_threads(omp_num_threads);
-#else
-  MACE_UNUSED(omp_num_threads);
-  LOG(WARNING) << "Set OpenMP threads number failed: OpenMP not enabled.";
-#endif
+}  // namespace
 
-  // compute mask
+MaceStatus SetCurrentThreadAffinity(const std::vector<int> &cpu_ids) {
   cpu_set_t mask;
   CPU_ZERO(&mask);
   for (auto cpu_id : cpu_ids) {
     CPU_SET(cpu_id, &mask);
   }
-#ifdef MACE_ENABLE_OPENMP
-  std::vector<MaceStatus> status(omp_num_threads);
-#pragma omp parallel for
-  for (int i = 0; i < omp_num_threads; ++i) {
-    VLOG(1) << "Set affinity for OpenMP thread " << omp_get_thread_num()
-            << "/" << omp_get_num_threads();
-    status[i] = SetThreadAffinity(mask);
-  }
-  for (int i = 0; i < omp_num_threads; ++i) {
-    if (status[i] != MACE_SUCCESS)
-      return MACE_INVALID_ARGS;
-  }
-  return MACE_SUCCESS;
-#else
-  MaceStatus status = SetThreadAffinity(mask);
-  VLOG(1) << "Set affinity without OpenMP: " << mask.__bits[0];
-  return status;
-#endif
+  return SetThreadAffinity(mask);
 }
 
-}  // namespace
-
-MaceStatus CPURuntime::SetOpenMPThreadsAndAffinityPolicy(
-    int omp_num_threads_hint,
+MaceStatus CPURuntime::CreateThreadPool(
+    int num_threads_hint,
     CPUAffinityPolicy policy,
+    const std::vector<int> &cpu_ids,
     gemmlowp::GemmContext *gemm_context) {
-  if (policy == CPUAffinityPolicy::AFFINITY_NONE) {
+  if (executor_ != nullptr) {
+    // The multiplications are split over the executor instead
     if (gemm_context) {
-      gemm_context->set_max_num_threads(std::max(0, omp_num_threads_hint));
-    }
-#ifdef MACE_ENABLE_OPENMP
-    if (omp_num_threads_hint > 0) {
-      omp_set_num_threads(std::min(omp_num_threads_hint, omp_get_num_procs()));
+      gemm_context->set_max_num_threads(1);
     }
-#else
-    LOG(WARNING) << "Set OpenMP threads number failed: OpenMP not enabled.";
-#endif
+    thread_pool_.reset(new ThreadPool(executor_));
+    num_threads_ = thread_pool_->num_threads();
     return MACE_SUCCESS;
   }
-
-  std::vector<int> big_core_ids;
-  std::vector<int> little_core_ids;
-  MaceStatus res = GetCPUBigLittleCoreIDs(&big_core_ids, &little_core_ids);
-  if (res != MACE_SUCCESS) {
-    return res;
+  std::vector<int> use_cpu_ids = cpu_ids;
+  MaceStatus status = MACE_SUCCESS;
+  if (use_cpu_ids.empty() && policy != CPUAffinityPolicy::AFFINITY_NONE) {
+    std::vector<int> big_core_ids;
+    std::vector<int> little_core_ids;
+    status = GetCPUBigLittleCoreIDs(&big_core_ids, &little_core_ids);
+    if (status == MACE_SUCCESS) {
+      use_cpu_ids = policy == CPUAffinityPolicy::AFFINITY_BIG_ONLY
+                    ? big_core_ids : little_core_ids;
+    }
   }
 
-  std::vector<int> use_cpu_ids;
-  if (policy == CPUAffinityPolicy::AFFINITY_BIG_ONLY) {
-    use_cpu_ids = std::move(big_core_ids);
-  } else {
-    use_cpu_ids = std::move(little_core_ids);
+  const int max_num_threads = use_cpu_ids.empty()
+      ? std::max(1, GetCPUCount()) : static_cast<int>(use_cpu_ids.size());
+  if (num_threads_hint <= 0 || (cpu_ids.empty()
+                                && num_threads_hint > max_num_threads)) {
+    num_threads_hint = max_num_threads;
   }
-
-  if (omp_num_threads_hint <= 0 ||
-      omp_num_threads_hint > static_cast<int>(use_cpu_ids.size())) {
-    omp_num_threads_hint = use_cpu_ids.size();
+  if (gemm_context) {
+    gemm_context->set_max_num_threads(num_threads_hint);
   }
+  num_threads_ = num_threads_hint;
+  thread_pool_.reset(new ThreadPool(num_threads_, use_cpu_ids));
+  return status;
+}
 
-  if (gemm_context) {
-    gemm_context->set_max_num_threads(omp_num_threads_hint);
+gemmlowp::GemmContext *CPURuntime::GetThreadGemmlowpContext() {
+  thread_local std::unique_ptr<gemmlowp::GemmContext> gemm_context;
+  if (!gemm_context) {
+    gemm_context.reset(new gemmlowp::GemmContext());
+    gemm_context->set_max_num_threads(1);
   }
+  return gemm_context.get();
+}
 
-  return SetOpenMPThreadsAndAffinityCPUs(omp_num_threads_hint, use_cpu_ids);
+std::string GetCPUFingerprint() {
+  std::stringstream fingerprint;
+#if defined(__aarch64__)
+  fingerprint << "arm64";
+#elif defined(__arm__)
+  fingerprint << "arm";
+#elif defined(__x86_64__)
+  fingerprint << "x86_64";
+#else
+  fingerprint << "unknown";
+#endif
+#ifdef MACE_ENABLE_NEON
+  fingerprint << "+neon";
+#endif
+  const int cpu_count = GetCPUCount();
+  fingerprint << ";cpus=" << cpu_count << ";freqs=";
+  for (int cpu_id = 0; cpu_id < cpu_count; ++cpu_id) {
+    std::ifstream freq_file(MakeString(
+        "/sys/devices/system/cpu/cpu", cpu_id, "/cpufreq/cpuinfo_max_freq"));
+    int freq = 0;
+    freq_file >> freq;
+    fingerprint << freq << ",";
+  }
+  // The cores of the SoC, as named by the kernel
+  std::set<std::string> models;
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line)) {
+    for (const char *key : {"model name", "CPU implementer", "CPU part",
+                            "Hardware"}) {
+      if (line.compare(0, strlen(key), key) == 0) {
+        models.insert(line);
+      }
+    }
+  }
+  for (auto &model : models) {
+    fingerprint << ";" << model;
+  }
+  return fingerprint.str();
 }
 
 }  // namespace mace
-
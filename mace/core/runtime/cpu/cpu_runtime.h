@@ -16,31 +16,41 @@
 #define MACE_CORE_RUNTIME_CPU_CPU_RUNTIME_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "public/gemmlowp.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/public/mace.h"
 #include "mace/utils/logging.h"
 
 namespace mace {
 
-extern int MaceOpenMPThreadCount;
+// Identifies the CPU model and cores, for the state computed for one CPU
+// not to be reused on another.
+std::string GetCPUFingerprint();
+
+MaceStatus SetCurrentThreadAffinity(const std::vector<int> &cpu_ids);
 
 class CPURuntime {
  public:
+  // Runs the operators on a thread pool of its own, of num_threads
+  // threads pinned to cpu_ids if not empty, or else chosen by the policy,
+  // or on the executor if not null.
   CPURuntime(const int num_threads,
              CPUAffinityPolicy policy,
-             bool use_gemmlowp)
+             bool use_gemmlowp,
+             const std::vector<int> &cpu_ids = {},
+             std::shared_ptr<Executor> executor = nullptr)
       : num_threads_(num_threads),
         policy_(policy),
-        gemm_context_(nullptr) {
+        gemm_context_(nullptr),
+        executor_(executor) {
     if (use_gemmlowp) {
       MACE_CHECK_NOTNULL(GetGemmlowpContext());
     }
 
-    SetOpenMPThreadsAndAffinityPolicy(num_threads_,
-                                      policy_,
-                                      gemm_context_.get());
+    CreateThreadPool(num_threads_, policy_, cpu_ids, gemm_context_.get());
   }
   ~CPURuntime() = default;
 
@@ -51,19 +61,33 @@ class CPURuntime {
     return gemm_context_.get();
   }
 
+  // A single-threaded context of the calling thread, for the blocks of a
+  // multiplication split over the thread pool
+  static gemmlowp::GemmContext *GetThreadGemmlowpContext();
+
   int num_threads() const {
     return num_threads_;
   }
 
+  ThreadPool *thread_pool() {
+    return thread_pool_.get();
+  }
+
+  Executor *executor() {
+    return executor_.get();
+  }
+
  private:
-  MaceStatus SetOpenMPThreadsAndAffinityPolicy(
-      int omp_num_threads_hint,
-      CPUAffinityPolicy policy,
-      gemmlowp::GemmContext *gemm_context);
+  MaceStatus CreateThreadPool(int num_threads_hint,
+                              CPUAffinityPolicy policy,
+                              const std::vector<int> &cpu_ids,
+                              gemmlowp::GemmContext *gemm_context);
 
   int num_threads_;
   CPUAffinityPolicy policy_;
   std::unique_ptr<gemmlowp::GemmContext> gemm_context_;
+  std::shared_ptr<Executor> executor_;
+  std::unique_ptr<ThreadPool> thread_pool_;
 };
 }  // namespace mace
 
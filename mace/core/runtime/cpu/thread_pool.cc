@@ -0,0 +1,212 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/runtime/cpu/thread_pool.h"
+
+#include <new>
+
+#include "mace/core/runtime/cpu/cpu_runtime.h"
+#include "mace/utils/logging.h"
+#include "mace/utils/timer.h"
+
+namespace mace {
+
+namespace {
+// How long the workers wait for the next job before sleeping, which is
+// longer than the gap between the parallel loops of consecutive operators
+constexpr int64_t kSpinMicros = 200;
+// Chunks per thread range, which can be stolen
+constexpr index_t kChunksPerThread = 4;
+
+thread_local ThreadPool *thread_pool = nullptr;
+// Whether the thread runs a job, so that nested loops run inline
+thread_local bool in_job = false;
+}  // namespace
+
+ThreadPool::ThreadPool(const int num_threads,
+                       const std::vector<int> &cpu_ids)
+    : priority_gate_(new PriorityGate()),
+      num_threads_(std::max(1, num_threads)),
+      range_buffer_(
+          new char[num_threads_ * sizeof(Range) + kCacheLineSize - 1]),
+      ranges_(nullptr),
+      chunk_size_(1),
+      fn_(nullptr),
+      generation_(0),
+      num_running_workers_(0),
+      stop_(false) {
+  void *buffer = range_buffer_.get();
+  size_t buffer_size = num_threads_ * sizeof(Range) + kCacheLineSize - 1;
+  ranges_ = static_cast<Range *>(std::align(
+      kCacheLineSize, num_threads_ * sizeof(Range), buffer, buffer_size));
+  for (int i = 0; i < num_threads_; ++i) {
+    new (&ranges_[i]) Range();
+  }
+  VLOG(1) << "Create thread pool with " << num_threads_ << " threads"
+          << (cpu_ids.empty() ? "" : ", CPU core IDs: " + MakeString(cpu_ids));
+  for (int i = 1; i < num_threads_; ++i) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this, i,
+                          cpu_ids.empty() ? -1
+                                          : cpu_ids[(i - 1) % cpu_ids.size()]);
+  }
+}
+
+ThreadPool::ThreadPool(std::shared_ptr<Executor> executor)
+    : executor_(executor),
+      priority_gate_(PriorityGate::ForExecutor(executor.get())),
+      num_threads_(std::max(1, executor->num_threads())),
+      range_buffer_(nullptr),
+      ranges_(nullptr),
+      chunk_size_(1),
+      fn_(nullptr),
+      generation_(0),
+      num_running_workers_(0),
+      stop_(false) {
+  VLOG(1) << "Create thread pool on an executor of " << num_threads_
+          << " threads";
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_.store(true, std::memory_order_relaxed);
+    generation_.fetch_add(1, std::memory_order_release);
+  }
+  job_cond_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Run(const index_t size,
+                     const std::function<void(index_t, index_t)> &fn) {
+  if (in_job) {
+    fn(0, size);
+    return;
+  }
+  if (executor_ != nullptr) {
+    RunOnExecutor(size, fn);
+    return;
+  }
+  std::unique_lock<std::mutex> job_lock(job_mutex_, std::try_to_lock);
+  if (!job_lock.owns_lock()) {
+    fn(0, size);
+    return;
+  }
+  // Static ranges, as the OpenMP default schedule, in chunks to steal
+  const index_t range_size = (size + num_threads_ - 1) / num_threads_;
+  chunk_size_ = std::max<index_t>(1, range_size / kChunksPerThread);
+  for (int i = 0; i < num_threads_; ++i) {
+    ranges_[i].next.store(std::min(size, i * range_size),
+                          std::memory_order_relaxed);
+    ranges_[i].end = std::min(size, (i + 1) * range_size);
+  }
+  fn_ = &fn;
+  num_running_workers_.store(num_threads_ - 1, std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_.fetch_add(1, std::memory_order_release);
+  }
+  job_cond_.notify_all();
+
+  in_job = true;
+  RunChunks(0);
+  in_job = false;
+
+  // The workers may still run the last chunks they took
+  const int64_t spin_end_micros = NowMicros() + kSpinMicros;
+  while (num_running_workers_.load(std::memory_order_acquire) > 0) {
+    if (NowMicros() > spin_end_micros) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_cond_.wait(lock, [this] {
+        return num_running_workers_.load(std::memory_order_acquire) == 0;
+      });
+      break;
+    }
+    std::this_thread::yield();
+  }
+  fn_ = nullptr;
+}
+
+// The executor balances the chunks over its threads, and may run jobs
+// submitted concurrently at the same time
+void ThreadPool::RunOnExecutor(
+    const index_t size, const std::function<void(index_t, index_t)> &fn) {
+  const index_t num_chunks = std::min(size, num_threads_ * kChunksPerThread);
+  executor_->Run(static_cast<int>(num_chunks), [&](int chunk) {
+    const bool was_in_job = in_job;
+    in_job = true;
+    fn(size * chunk / num_chunks, size * (chunk + 1) / num_chunks);
+    in_job = was_in_job;
+  });
+}
+
+void ThreadPool::RunChunks(const int thread_id) {
+  for (int i = 0; i < num_threads_; ++i) {
+    Range &range = ranges_[(thread_id + i) % num_threads_];
+    while (true) {
+      const index_t start =
+          range.next.fetch_add(chunk_size_, std::memory_order_relaxed);
+      if (start >= range.end) {
+        break;
+      }
+      (*fn_)(start, std::min(start + chunk_size_, range.end));
+    }
+  }
+}
+
+void ThreadPool::WorkerLoop(const int thread_id, const int cpu_id) {
+  if (cpu_id >= 0) {
+    SetCurrentThreadAffinity({cpu_id});
+  }
+  in_job = true;
+  uint64_t generation = 0;
+  while (true) {
+    const int64_t spin_end_micros = NowMicros() + kSpinMicros;
+    while (generation_.load(std::memory_order_acquire) == generation
+           && NowMicros() <= spin_end_micros) {
+      std::this_thread::yield();
+    }
+    if (generation_.load(std::memory_order_acquire) == generation) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_cond_.wait(lock, [this, generation] {
+        return generation_.load(std::memory_order_acquire) != generation;
+      });
+    }
+    generation = generation_.load(std::memory_order_acquire);
+    if (stop_.load(std::memory_order_relaxed)) {
+      break;
+    }
+    RunChunks(thread_id);
+    if (num_running_workers_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_cond_.notify_one();
+    }
+  }
+}
+
+ThreadPoolGuard::ThreadPoolGuard(ThreadPool *pool)
+    : prev_thread_pool_(thread_pool) {
+  thread_pool = pool;
+}
+
+ThreadPoolGuard::~ThreadPoolGuard() {
+  thread_pool = prev_thread_pool_;
+}
+
+ThreadPool *ThreadPoolGuard::current() {
+  return thread_pool;
+}
+
+}  // namespace mace
@@ -0,0 +1,223 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_RUNTIME_CPU_THREAD_POOL_H_
+#define MACE_CORE_RUNTIME_CPU_THREAD_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "mace/core/run_control.h"
+#include "mace/core/types.h"
+#include "mace/public/mace.h"
+#include "mace/utils/utils.h"
+
+namespace mace {
+
+// The threads running the operators of an engine. A job is split in one
+// range of iterations per thread, which the thread runs in chunks and,
+// once done, steals chunks of the others' ranges, so that uneven work or a
+// slower core do not hold the job up. The calling thread takes part in
+// the job; the workers spin for a while after it and then sleep until the
+// next one. Jobs are run one at a time: a job submitted while another one
+// runs, e.g. by an operator run concurrently by ParallelNet or from within
+// a job, is run by the submitting thread alone.
+//
+// With an Executor of the application, the pool has no threads of its own
+// and hands the chunks of each job to the executor instead.
+class ThreadPool {
+ public:
+  // Creates num_threads - 1 workers, each pinned to one of cpu_ids in turn
+  // if not empty. The calling thread is never pinned.
+  ThreadPool(const int num_threads, const std::vector<int> &cpu_ids);
+  explicit ThreadPool(std::shared_ptr<Executor> executor);
+  ~ThreadPool();
+
+  int num_threads() const { return num_threads_; }
+
+  // Shared by the pools of an executor
+  PriorityGate *priority_gate() const { return priority_gate_.get(); }
+
+  // Calls fn(start, end) on disjoint ranges covering [0, size), and returns
+  // when all are done.
+  void Run(const index_t size,
+           const std::function<void(index_t, index_t)> &fn);
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  // A thread's range of the current job, padded to a cache line
+  struct Range {
+    std::atomic<index_t> next;
+    index_t end;
+    char padding[kCacheLineSize - sizeof(std::atomic<index_t>)
+                 - sizeof(index_t)];
+  };
+
+  void WorkerLoop(const int thread_id, const int cpu_id);
+  void RunChunks(const int thread_id);
+  void RunOnExecutor(const index_t size,
+                     const std::function<void(index_t, index_t)> &fn);
+
+  std::shared_ptr<Executor> executor_;
+  std::shared_ptr<PriorityGate> priority_gate_;
+  const int num_threads_;
+  // new[] only aligns to alignof(std::max_align_t), so the ranges are put
+  // on cache line boundaries in a larger buffer to keep the threads off each
+  // other's lines
+  std::unique_ptr<char[]> range_buffer_;
+  Range *ranges_;
+  index_t chunk_size_;
+  const std::function<void(index_t, index_t)> *fn_;
+  // Bumped for each job and when stopping
+  std::atomic<uint64_t> generation_;
+  std::atomic<int> num_running_workers_;
+  std::atomic<bool> stop_;
+  std::mutex mutex_;
+  std::condition_variable job_cond_;
+  std::condition_variable done_cond_;
+  std::mutex job_mutex_;
+  std::vector<std::thread> workers_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(ThreadPool);
+};
+
+// Makes the ParallelFor of the calling thread run on the pool while the
+// guard is alive, i.e. while a net runs the operators of a device.
+class ThreadPoolGuard {
+ public:
+  explicit ThreadPoolGuard(ThreadPool *thread_pool);
+  ~ThreadPoolGuard();
+
+  // The pool of the calling thread, or nullptr
+  static ThreadPool *current();
+
+ private:
+  ThreadPool *prev_thread_pool_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(ThreadPoolGuard);
+};
+
+// The number of threads ParallelFor runs on in the calling thread
+inline int ParallelThreadCount() {
+  ThreadPool *thread_pool = ThreadPoolGuard::current();
+  return thread_pool == nullptr ? 1 : thread_pool->num_threads();
+}
+
+namespace internal {
+inline index_t NumSteps(const index_t begin, const index_t end,
+                        const index_t step) {
+  return end > begin ? (end - begin + step - 1) / step : 0;
+}
+
+// Runs fn(start, end) on [0, size) on the pool of the calling thread, or
+// inline if there is none
+inline void ParallelRun(const index_t size,
+                        const std::function<void(index_t, index_t)> &fn) {
+  ThreadPool *thread_pool = ThreadPoolGuard::current();
+  if (thread_pool == nullptr || thread_pool->num_threads() == 1
+      || size <= 1) {
+    if (size > 0) {
+      fn(0, size);
+    }
+  } else {
+    thread_pool->Run(size, fn);
+  }
+}
+}  // namespace internal
+
+// Calls fn(i) for i from begin to end (excluded) by step, in parallel on
+// the thread pool of the calling thread, as an OpenMP parallel for.
+template <typename Func>
+void ParallelFor(const index_t begin, const index_t end, const index_t step,
+                 const Func &fn) {
+  internal::ParallelRun(
+      internal::NumSteps(begin, end, step),
+      [&](index_t start, index_t stop) {
+        for (index_t k = start; k < stop; ++k) {
+          fn(begin + k * step);
+        }
+      });
+}
+
+template <typename Func>
+void ParallelFor(const index_t begin, const index_t end, const Func &fn) {
+  ParallelFor(begin, end, 1, fn);
+}
+
+// Calls fn(i, j) over the two loops, as an OpenMP parallel for collapse(2).
+template <typename Func>
+void ParallelFor2D(const index_t begin0, const index_t end0,
+                   const index_t step0,
+                   const index_t begin1, const index_t end1,
+                   const index_t step1,
+                   const Func &fn) {
+  const index_t size1 = internal::NumSteps(begin1, end1, step1);
+  internal::ParallelRun(
+      internal::NumSteps(begin0, end0, step0) * size1,
+      [&](index_t start, index_t stop) {
+        index_t k0 = start / size1;
+        index_t k1 = start % size1;
+        for (index_t k = start; k < stop; ++k) {
+          fn(begin0 + k0 * step0, begin1 + k1 * step1);
+          if (++k1 == size1) {
+            k1 = 0;
+            ++k0;
+          }
+        }
+      });
+}
+
+template <typename Func>
+void ParallelFor2D(const index_t begin0, const index_t end0,
+                   const index_t begin1, const index_t end1,
+                   const Func &fn) {
+  ParallelFor2D(begin0, end0, 1, begin1, end1, 1, fn);
+}
+
+// Calls fn(i, j, k) over the three loops, as an OpenMP parallel for
+// collapse(3).
+template <typename Func>
+void ParallelFor3D(const index_t begin0, const index_t end0,
+                   const index_t step0,
+                   const index_t begin1, const index_t end1,
+                   const index_t step1,
+                   const index_t begin2, const index_t end2,
+                   const index_t step2,
+                   const Func &fn) {
+  const index_t size1 = internal::NumSteps(begin1, end1, step1);
+  const index_t size2 = internal::NumSteps(begin2, end2, step2);
+  ParallelFor2D(begin0, end0, step0, 0, size1 * size2, 1,
+                [&](index_t i, index_t k) {
+                  fn(i, begin1 + k / size2 * step1, begin2 + k % size2 * step2);
+                });
+}
+
+template <typename Func>
+void ParallelFor3D(const index_t begin0, const index_t end0,
+                   const index_t begin1, const index_t end1,
+                   const index_t begin2, const index_t end2,
+                   const Func &fn) {
+  ParallelFor3D(begin0, end0, 1, begin1, end1, 1, begin2, end2, 1, fn);
+}
+
+}  // namespace mace
+
+#endif  // MACE_CORE_RUNTIME_CPU_THREAD_POOL_H_
@@ -0,0 +1,90 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
+
+namespace mace {
+namespace test {
+
+TEST(ThreadPoolTest, ParallelFor) {
+  // Each iteration is run once, whatever the pool of the thread
+  auto check = [](int num_threads) {
+    ThreadPool thread_pool(num_threads, {});
+    ThreadPoolGuard thread_pool_guard(&thread_pool);
+    EXPECT_EQ(num_threads, ParallelThreadCount());
+
+    std::vector<std::atomic<int>> counts(1000);
+    for (auto &count : counts) count = 0;
+    ParallelFor(3, 1000, 7, [&](index_t i) { ++counts[i]; });
+    for (index_t i = 0; i < 1000; ++i) {
+      ASSERT_EQ(i >= 3 && (i - 3) % 7 == 0 ? 1 : 0, counts[i].load());
+    }
+
+    for (auto &count : counts) count = 0;
+    ParallelFor2D(0, 10, 1, 0, 100, 3, [&](index_t i, index_t j) {
+      ++counts[i * 100 + j];
+    });
+    for (index_t i = 0; i < 1000; ++i) {
+      ASSERT_EQ(i % 100 % 3 == 0 ? 1 : 0, counts[i].load());
+    }
+
+    for (auto &count : counts) count = 0;
+    ParallelFor3D(0, 10, 2, 0, 10, 1, 0, 10, 1,
+                  [&](index_t i, index_t j, index_t k) {
+      // Nested, run by the calling thread
+      ParallelFor(0, 2, [&](index_t) { ++counts[(i * 10 + j) * 10 + k]; });
+    });
+    for (index_t i = 0; i < 1000; ++i) {
+      ASSERT_EQ(i / 100 % 2 == 0 ? 2 : 0, counts[i].load());
+    }
+
+    ParallelFor(5, 5, [&](index_t) { ADD_FAILURE(); });
+  };
+  check(1);
+  check(3);
+}
+
+TEST(ThreadPoolTest, TwoPools) {
+  // Two pools of different sizes used at the same time
+  ThreadPool pool2(2, {});
+  ThreadPool pool4(4, {});
+  std::atomic<int64_t> sum2(0);
+  std::atomic<int64_t> sum4(0);
+  std::thread thread([&]() {
+    ThreadPoolGuard thread_pool_guard(&pool2);
+    EXPECT_EQ(2, ParallelThreadCount());
+    for (int n = 0; n < 100; ++n) {
+      ParallelFor(0, 100, [&](index_t i) { sum2 += i; });
+    }
+  });
+  {
+    ThreadPoolGuard thread_pool_guard(&pool4);
+    EXPECT_EQ(4, ParallelThreadCount());
+    for (int n = 0; n < 100; ++n) {
+      ParallelFor(0, 100, [&](index_t i) { sum4 += i; });
+    }
+  }
+  thread.join();
+  EXPECT_EQ(100 * 4950, sum2.load());
+  EXPECT_EQ(100 * 4950, sum4.load());
+  EXPECT_EQ(1, ParallelThreadCount());
+}
+
+}  // namespace test
+}  // namespace mace
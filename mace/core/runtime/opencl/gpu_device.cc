@@ -25,8 +25,11 @@ GPUDevice::GPUDevice(Tuner<uint32_t> *tuner,
                      KVStorage *opencl_binary_storage,
                      const int num_threads,
                      CPUAffinityPolicy cpu_affinity_policy,
-                     bool use_gemmlowp) :
-    CPUDevice(num_threads, cpu_affinity_policy, use_gemmlowp),
+                     bool use_gemmlowp,
+                     const std::vector<int> &cpu_ids,
+                     std::shared_ptr<Executor> executor) :
+    CPUDevice(num_threads, cpu_affinity_policy, use_gemmlowp, cpu_ids,
+              executor),
     runtime_(new OpenCLRuntime(opencl_cache_storage, priority, perf,
                                opencl_binary_storage, tuner)),
     allocator_(new OpenCLAllocator(runtime_.get())),
@@ -16,6 +16,7 @@
 #define MACE_CORE_RUNTIME_OPENCL_GPU_DEVICE_H_
 
 #include <memory>
+#include <vector>
 
 #include "mace/core/device_context.h"
 #include "mace/core/device.h"
@@ -32,7 +33,9 @@ class GPUDevice : public CPUDevice {
             KVStorage *opencl_binary_storage = nullptr,
             const int num_threads = -1,
             CPUAffinityPolicy cpu_affinity_policy = AFFINITY_NONE,
-            bool use_gemmlowp = false);
+            bool use_gemmlowp = false,
+            const std::vector<int> &cpu_ids = {},
+            std::shared_ptr<Executor> executor = nullptr);
   ~GPUDevice();
   OpenCLRuntime *opencl_runtime() override;
   Allocator *allocator() override;
@@ -283,8 +283,16 @@ class Tensor {
       MACE_CHECK(!has_opencl_image(),
                  name_, ": Cannot resize image, use ResizeImage.");
       if (raw_size() + MACE_EXTRA_BUFFER_PAD_SIZE > buffer_->size()) {
-        LOG(WARNING) << name_ << ": Resize buffer from size " << buffer_->size()
-                     << " to " << raw_size() + MACE_EXTRA_BUFFER_PAD_SIZE;
+        // Empty blocks, e.g. of a new memory plan, are sized by their first
+        // run, which is expected
+        if (buffer_->size() > 0) {
+          LOG(WARNING) << name_ << ": Resize buffer from size "
+                       << buffer_->size() << " to "
+                       << raw_size() + MACE_EXTRA_BUFFER_PAD_SIZE;
+        } else {
+          VLOG(3) << name_ << ": Allocate buffer of size "
+                  << raw_size() + MACE_EXTRA_BUFFER_PAD_SIZE;
+        }
         return buffer_->Resize(raw_size() + MACE_EXTRA_BUFFER_PAD_SIZE);
       }
       return MaceStatus::MACE_SUCCESS;
@@ -311,6 +319,16 @@ class Tensor {
     image_shape_ = other.image_shape_;
   }
 
+  // Make this tensor use a buffer it does not own, e.g. memory of the user.
+  // With a null buffer, the tensor allocates its own one on next Resize.
+  inline void SetBuffer(BufferBase *buffer) {
+    if (is_buffer_owner_ && buffer_ != nullptr) {
+      delete buffer_;
+    }
+    buffer_ = buffer;
+    is_buffer_owner_ = buffer == nullptr;
+  }
+
   inline MaceStatus ResizeImage(const std::vector<index_t> &shape,
                                 const std::vector<size_t> &image_shape) {
     shape_ = shape;
@@ -403,7 +421,13 @@ class Tensor {
     explicit MappingGuard(const Tensor *tensor) : tensor_(tensor) {
       if (tensor_ != nullptr) {
         MACE_CHECK_NOTNULL(tensor_->buffer_);
-        tensor_->buffer_->Map(&mapped_image_pitch_);
+        // Host memory is accessed directly, skip mapping it so that tensors
+        // shared by concurrent runs (e.g. weights) can be read at once.
+        if (tensor_->buffer_->OnHost()) {
+          tensor_ = nullptr;
+        } else {
+          tensor_->buffer_->Map(&mapped_image_pitch_);
+        }
       }
     }
 
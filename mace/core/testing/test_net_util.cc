@@ -0,0 +1,131 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/testing/test_net_util.h"
+
+#include <memory>
+
+#include "mace/kernels/conv_pool_2d_util.h"
+#include "mace/kernels/eltwise.h"
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace test {
+
+void AddOpDef(const std::string &type,
+              const std::vector<std::string> &inputs,
+              const std::string &output,
+              const std::vector<int64_t> &output_shape,
+              NetDef *net_def) {
+  OperatorDef *op_def = net_def->add_op();
+  op_def->set_name(output);
+  op_def->set_type(type);
+  for (auto &input : inputs) {
+    op_def->add_input(input);
+  }
+  op_def->add_output(output);
+  if (!output_shape.empty()) {
+    OutputShape *shape = op_def->add_output_shape();
+    for (auto dim : output_shape) {
+      shape->add_dims(dim);
+    }
+  }
+}
+
+void AddFloatConst(const std::string &name,
+                   const std::vector<int64_t> &dims,
+                   const std::vector<float> &data,
+                   NetDef *net_def,
+                   std::vector<float> *model_data) {
+  ConstTensor *tensor = net_def->add_tensors();
+  tensor->set_name(name);
+  tensor->set_data_type(DT_FLOAT);
+  for (auto dim : dims) {
+    tensor->add_dims(dim);
+  }
+  tensor->set_offset(model_data->size() * sizeof(float));
+  tensor->set_data_size(data.size());
+  model_data->insert(model_data->end(), data.begin(), data.end());
+}
+
+void BuildResidualNet(NetDef *net_def, std::vector<float> *model_data) {
+  AddOpDef("Identity", {"Input"}, "X", {1, 2, 4, 4}, net_def);
+  AddOpDef("Conv2D", {"X", "Filter1"}, "C1", {1, 3, 4, 4}, net_def);
+  AddOpDef("FoldedBatchNorm", {"C1", "Scale", "Offset"}, "B1",
+           {1, 3, 4, 4}, net_def);
+  AddOpDef("Conv2D", {"B1", "Filter2"}, "C2", {1, 3, 4, 4}, net_def);
+  AddOpDef("BiasAdd", {"C2", "Bias2"}, "D2", {1, 3, 4, 4}, net_def);
+  AddOpDef("Eltwise", {"D2", "B1"}, "E", {1, 3, 4, 4}, net_def);
+  AddOpDef("Activation", {"E"}, "Output", {1, 3, 4, 4}, net_def);
+  for (int i : {1, 3}) {
+    OperatorDef *conv = net_def->mutable_op(i);
+    Argument *strides = conv->add_arg();
+    strides->set_name("strides");
+    strides->add_ints(1);
+    strides->add_ints(1);
+    Argument *padding = conv->add_arg();
+    padding->set_name("padding");
+    padding->set_i(Padding::SAME);
+  }
+  Argument *data_format = net_def->mutable_op(4)->add_arg();
+  data_format->set_name("data_format");
+  data_format->set_i(NCHW);
+  Argument *eltwise_type = net_def->mutable_op(5)->add_arg();
+  eltwise_type->set_name("type");
+  eltwise_type->set_i(static_cast<int>(kernels::EltwiseType::SUM));
+  Argument *activation = net_def->mutable_op(6)->add_arg();
+  activation->set_name("activation");
+  activation->set_s("RELU");
+  net_def->add_output_info()->set_name("Output");
+
+  std::vector<float> filter1(3 * 2 * 3 * 3), filter2(3 * 3 * 3 * 3);
+  for (size_t i = 0; i < filter1.size(); ++i) {
+    filter1[i] = (static_cast<int>(i % 7) - 3) * 0.1f;
+  }
+  for (size_t i = 0; i < filter2.size(); ++i) {
+    filter2[i] = (static_cast<int>(i % 5) - 2) * 0.1f;
+  }
+  AddFloatConst("Filter1", {3, 2, 3, 3}, filter1, net_def, model_data);
+  AddFloatConst("Scale", {3}, {0.5f, -1.f, 2.f}, net_def, model_data);
+  AddFloatConst("Offset", {3}, {0.1f, 0.2f, -0.3f}, net_def, model_data);
+  AddFloatConst("Filter2", {3, 3, 3, 3}, filter2, net_def, model_data);
+  AddFloatConst("Bias2", {3}, {-0.5f, 0.f, 0.5f}, net_def, model_data);
+}
+
+void RunResidualNet(const NetDef &net_def,
+                    const std::vector<float> &model_data,
+                    Workspace *ws,
+                    std::vector<float> *output_data) {
+  Device *device = ops::test::OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            ws->LoadModelTensor(
+                net_def, device,
+                reinterpret_cast<const unsigned char *>(model_data.data())));
+  Tensor *input = ws->CreateTensor("Input", device->allocator(), DT_FLOAT);
+  input->Resize({1, 2, 4, 4});
+  float *input_data = input->mutable_data<float>();
+  for (index_t i = 0; i < input->size(); ++i) {
+    input_data[i] = (static_cast<int>(i % 9) - 4) * 0.25f;
+  }
+
+  std::shared_ptr<OperatorRegistryBase> op_registry(new OperatorRegistry());
+  auto net = CreateNet(op_registry, net_def, ws, device);
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS, net->Run());
+  const Tensor *output = ws->GetTensor("Output");
+  output_data->assign(output->data<float>(),
+                      output->data<float>() + output->size());
+}
+
+}  // namespace test
+}  // namespace mace
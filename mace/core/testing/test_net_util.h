@@ -0,0 +1,56 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Small nets shared by the tests of the core modules.
+#ifndef MACE_CORE_TESTING_TEST_NET_UTIL_H_
+#define MACE_CORE_TESTING_TEST_NET_UTIL_H_
+
+#include <string>
+#include <vector>
+
+#include "mace/core/workspace.h"
+#include "mace/proto/mace.pb.h"
+
+namespace mace {
+namespace test {
+
+// Adds an operator without arguments, with output_shape if not empty
+void AddOpDef(const std::string &type,
+              const std::vector<std::string> &inputs,
+              const std::string &output,
+              const std::vector<int64_t> &output_shape,
+              NetDef *net_def);
+
+// Adds a float tensor stored at the end of model_data
+void AddFloatConst(const std::string &name,
+                   const std::vector<int64_t> &dims,
+                   const std::vector<float> &data,
+                   NetDef *net_def,
+                   std::vector<float> *model_data);
+
+// Input -> Identity -> Conv2D -> FoldedBatchNorm -> Conv2D -> BiasAdd
+//   -> Eltwise(SUM, with the batch norm output) -> Relu, all NCHW
+void BuildResidualNet(NetDef *net_def, std::vector<float> *model_data);
+
+// Loads the model and a fixed input of BuildResidualNet into ws, and runs
+// the net on CPU
+void RunResidualNet(const NetDef &net_def,
+                    const std::vector<float> &model_data,
+                    Workspace *ws,
+                    std::vector<float> *output_data);
+
+}  // namespace test
+}  // namespace mace
+
+#endif  // MACE_CORE_TESTING_TEST_NET_UTIL_H_
@@ -0,0 +1,119 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/weight_pager.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "mace/utils/logging.h"
+
+namespace mace {
+
+namespace {
+void AdvisePages(const std::vector<std::pair<uintptr_t, uintptr_t>> &pages,
+                 const int advice) {
+  for (auto &range : pages) {
+    madvise(reinterpret_cast<void *>(range.first),
+            range.second - range.first, advice);
+  }
+}
+}  // namespace
+
+WeightPager::WeightPager(const unsigned char *data,
+                         const size_t size,
+                         const int prefetch_distance,
+                         const std::set<std::string> &locked_ops,
+                         const std::set<std::string> &released_ops)
+    : begin_(reinterpret_cast<uintptr_t>(data)),
+      end_(reinterpret_cast<uintptr_t>(data) + size),
+      page_size_(static_cast<size_t>(sysconf(_SC_PAGESIZE))),
+      prefetch_distance_(prefetch_distance),
+      locked_ops_(locked_ops),
+      released_ops_(released_ops) {}
+
+WeightPager::~WeightPager() {
+  for (auto &pages : locked_pages_) {
+    munlock(reinterpret_cast<void *>(pages.first),
+            pages.second - pages.first);
+  }
+}
+
+void WeightPager::DisableReadahead() {
+  const uintptr_t begin = begin_ & ~(page_size_ - 1);
+  if (madvise(reinterpret_cast<void *>(begin), end_ - begin,
+              MADV_RANDOM) != 0) {
+    LOG(WARNING) << "madvise(MADV_RANDOM) failed: " << strerror(errno);
+  }
+}
+
+void WeightPager::AddOp(const OperatorBase *op) {
+  std::vector<PageRange> pages;
+  std::vector<PageRange> released_pages;
+  const bool released =
+      released_ops_.find(op->debug_def().name()) != released_ops_.end();
+  for (const Tensor *input : op->Inputs()) {
+    if (!input->is_weight() || input->raw_size() == 0) continue;
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(input->raw_data());
+    const uintptr_t end = begin + input->raw_size();
+    if (begin < begin_ || end > end_) continue;
+    // The pages the weights overlap
+    pages.emplace_back(begin & ~(page_size_ - 1),
+                       (end + page_size_ - 1) & ~(page_size_ - 1));
+    // The pages the weights cover, shared with no other tensor
+    const uintptr_t inner_begin = (begin + page_size_ - 1) & ~(page_size_ - 1);
+    const uintptr_t inner_end = end & ~(page_size_ - 1);
+    if (released && inner_begin < inner_end) {
+      released_pages.emplace_back(inner_begin, inner_end);
+    }
+  }
+
+  if (locked_ops_.find(op->debug_def().name()) != locked_ops_.end()) {
+    for (auto &range : pages) {
+      if (mlock(reinterpret_cast<void *>(range.first),
+                range.second - range.first) != 0) {
+        LOG(WARNING) << "Failed to lock the weights of "
+                     << op->debug_def().name() << ": " << strerror(errno);
+        break;
+      }
+      locked_pages_.push_back(range);
+    }
+  }
+  op_pages_.push_back(std::move(pages));
+  released_pages_.push_back(std::move(released_pages));
+}
+
+void WeightPager::WillRun(const size_t op_idx) const {
+  if (prefetch_distance_ <= 0) return;
+  // The first op prefetches itself and the ops ahead of it, the others
+  // the op coming into reach.
+  const size_t last = op_idx + prefetch_distance_;
+  const size_t first = op_idx == 0 ? 0 : last;
+  for (size_t idx = first; idx <= last && idx < op_pages_.size(); ++idx) {
+    AdvisePages(op_pages_[idx], MADV_WILLNEED);
+  }
+}
+
+void WeightPager::DidRun(const size_t op_idx) const {
+  if (op_idx < released_pages_.size()) {
+    // Fails harmlessly on locked pages
+    AdvisePages(released_pages_[op_idx], MADV_DONTNEED);
+  }
+}
+
+}  // namespace mace
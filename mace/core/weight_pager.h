@@ -0,0 +1,76 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_WEIGHT_PAGER_H_
+#define MACE_CORE_WEIGHT_PAGER_H_
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mace/core/operator.h"
+
+namespace mace {
+
+// Pages in the weights of a model mapped from a file just before the ops
+// reading them run, instead of faulting them in one page at a time while
+// the ops compute. The weights of locked ops stay in memory, and those of
+// released ops are dropped after they run, to be read from the file again
+// when needed. The pages of other mappings are never touched, so tensors
+// created at runtime are skipped.
+class WeightPager {
+ public:
+  WeightPager(const unsigned char *data,
+              const size_t size,
+              const int prefetch_distance,
+              const std::set<std::string> &locked_ops,
+              const std::set<std::string> &released_ops);
+  ~WeightPager();
+
+  // Asks the kernel not to read ahead around the faulting pages, since
+  // the pages are prefetched as the ops run.
+  void DisableReadahead();
+
+  // Adds the next op in run order.
+  void AddOp(const OperatorBase *op);
+
+  // Prefetches the weights of the ops up to prefetch_distance after the
+  // op, which is about to run. Thread-safe.
+  void WillRun(const size_t op_idx) const;
+
+  // Drops the weights of the op if it is released. Thread-safe.
+  void DidRun(const size_t op_idx) const;
+
+ private:
+  typedef std::pair<uintptr_t, uintptr_t> PageRange;
+
+  uintptr_t begin_;
+  uintptr_t end_;
+  size_t page_size_;
+  int prefetch_distance_;
+  std::set<std::string> locked_ops_;
+  std::set<std::string> released_ops_;
+  // The pages holding the weights of each op, and of the released ops the
+  // pages holding nothing else.
+  std::vector<std::vector<PageRange>> op_pages_;
+  std::vector<std::vector<PageRange>> released_pages_;
+  std::vector<PageRange> locked_pages_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(WeightPager);
+};
+
+}  // namespace mace
+
+#endif  // MACE_CORE_WEIGHT_PAGER_H_
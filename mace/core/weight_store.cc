@@ -0,0 +1,87 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/weight_store.h"
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "mace/utils/utils.h"
+
+namespace mace {
+
+WeightStore *WeightStore::Get() {
+  static WeightStore *store = new WeightStore;
+  return store;
+}
+
+std::shared_ptr<Buffer> WeightStore::Find(const std::string &key,
+                                          const unsigned char *source,
+                                          size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto iter = weights_.find(key);
+  if (iter == weights_.end()) {
+    return nullptr;
+  }
+  std::shared_ptr<Weight> weight = iter->second.lock();
+  if (weight == nullptr) {
+    weights_.erase(iter);
+    return nullptr;
+  }
+  if (weight->source.size() != size
+      || memcmp(weight->source.data(), source, size) != 0) {
+    return nullptr;
+  }
+  return std::shared_ptr<Buffer>(weight, &weight->buffer);
+}
+
+std::shared_ptr<Buffer> WeightStore::Insert(const std::string &key,
+                                            std::shared_ptr<Weight> weight) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::weak_ptr<Weight> &stored = weights_[key];
+  std::shared_ptr<Weight> stored_weight = stored.lock();
+  if (stored_weight != nullptr) {
+    return std::shared_ptr<Buffer>(stored_weight, &stored_weight->buffer);
+  }
+  stored = weight;
+  // Drop the entries of the freed weights
+  for (auto iter = weights_.begin(); iter != weights_.end();) {
+    if (iter->second.expired()) {
+      iter = weights_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  return std::shared_ptr<Buffer>(weight, &weight->buffer);
+}
+
+size_t WeightStore::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t size = 0;
+  for (auto &entry : weights_) {
+    size += !entry.second.expired();
+  }
+  return size;
+}
+
+std::string WeightContentKey(const unsigned char *data, size_t size) {
+  char key[48];
+  snprintf(key, sizeof(key), "%zu:%016llx", size,
+           static_cast<unsigned long long>(  // NOLINT(runtime/int)
+               Hash64(data, size, 0)));
+  return key;
+}
+
+}  // namespace mace
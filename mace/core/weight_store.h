@@ -0,0 +1,76 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_WEIGHT_STORE_H_
+#define MACE_CORE_WEIGHT_STORE_H_
+
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mace/core/buffer.h"
+
+namespace mace {
+
+// The weights the workspaces of the process materialize from the model
+// data, e.g. dequantized, keyed by what they are made from (see
+// WeightContentKey), so that engines loading the same weights share a
+// buffer. The store only keeps weak references: a buffer is freed when
+// the last workspace holding it is.
+class WeightStore {
+ public:
+  // A buffer with a copy of the model data bytes it is made from, which
+  // tell the contents with the same key apart.
+  struct Weight {
+    Weight(Allocator *allocator, const unsigned char *data, size_t size)
+        : source(data, data + size), buffer(allocator) {}
+
+    std::vector<unsigned char> source;
+    Buffer buffer;
+  };
+
+  static WeightStore *Get();
+
+  // Returns the buffer of the weight stored for key if it is made from
+  // the size bytes at source, or nullptr.
+  std::shared_ptr<Buffer> Find(const std::string &key,
+                               const unsigned char *source,
+                               size_t size);
+
+  // Stores weight for key and returns its buffer, unless another
+  // workspace stored one meanwhile, whose buffer is returned instead.
+  std::shared_ptr<Buffer> Insert(const std::string &key,
+                                 std::shared_ptr<Weight> weight);
+
+  // The number of buffers in use
+  size_t size();
+
+ private:
+  WeightStore() = default;
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::weak_ptr<Weight>> weights_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(WeightStore);
+};
+
+// A key of size bytes of data, built from their size and hash. Different
+// contents may have the same key: Find compares the bytes.
+std::string WeightContentKey(const unsigned char *data, size_t size);
+
+}  // namespace mace
+
+#endif  // MACE_CORE_WEIGHT_STORE_H_
@@ -0,0 +1,124 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mace/core/weight_store.h"
+#include "mace/core/workspace.h"
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace test {
+
+TEST(WeightStoreTest, WeightDedup) {
+  // Float weights and quantized ones, a few with the same bytes
+  NetDef net_def;
+  std::vector<unsigned char> model_data;
+  auto add_tensor = [&](const std::string &name, DataType data_type,
+                        int seed, float scale) {
+    ConstTensor *tensor = net_def.add_tensors();
+    tensor->set_name(name);
+    tensor->set_data_type(data_type);
+    tensor->add_dims(1000);
+    tensor->set_offset(model_data.size());
+    tensor->set_data_size(1000);
+    tensor->set_quantized(data_type == DT_UINT8);
+    tensor->set_scale(scale);
+    tensor->set_zero_point(data_type == DT_UINT8 ? 128 : 0);
+    for (index_t i = 0;
+         i < static_cast<index_t>(1000 * GetEnumTypeSize(data_type)); ++i) {
+      model_data.push_back(static_cast<unsigned char>(i * seed % 251));
+    }
+  };
+  add_tensor("Float0", DT_FLOAT, 3, 0.f);
+  add_tensor("Float1", DT_FLOAT, 3, 0.f);
+  add_tensor("Float2", DT_FLOAT, 5, 0.f);
+  add_tensor("Quantized0", DT_UINT8, 7, 0.5f);
+  add_tensor("Quantized1", DT_UINT8, 7, 0.5f);
+  add_tensor("Quantized2", DT_UINT8, 7, 0.25f);
+
+  Device *device = ops::test::OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  Workspace ws;
+  ws.SetWeightDedup(true, true);
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            ws.LoadModelTensor(net_def, device, model_data.data()));
+  EXPECT_EQ(ws.GetTensor("Float0")->raw_data(),
+            ws.GetTensor("Float1")->raw_data());
+  EXPECT_NE(ws.GetTensor("Float0")->raw_data(),
+            ws.GetTensor("Float2")->raw_data());
+  EXPECT_EQ(ws.GetTensor("Quantized0")->raw_data(),
+            ws.GetTensor("Quantized1")->raw_data());
+  EXPECT_NE(ws.GetTensor("Quantized0")->raw_data(),
+            ws.GetTensor("Quantized2")->raw_data());
+  for (auto &const_tensor : net_def.tensors()) {
+    const Tensor *tensor = ws.GetTensor(const_tensor.name());
+    ASSERT_EQ(DT_FLOAT, tensor->dtype());
+    ASSERT_EQ(const_tensor.data_size(), tensor->size());
+    const unsigned char *data = model_data.data() + const_tensor.offset();
+    for (index_t i = 0; i < tensor->size(); ++i) {
+      if (const_tensor.quantized()) {
+        ASSERT_EQ(const_tensor.scale()
+                      * (data[i] - const_tensor.zero_point()),
+                  tensor->data<float>()[i]);
+      } else {
+        ASSERT_EQ(0, memcmp(data + i * sizeof(float),
+                            tensor->data<float>() + i, sizeof(float)));
+      }
+    }
+  }
+
+  // Another workspace loading a copy of the model data shares the
+  // dequantized weights, which are freed with the last workspace
+  std::vector<unsigned char> model_data_copy(model_data);
+  const size_t num_stored = WeightStore::Get()->size();
+  {
+    Workspace other_ws;
+    other_ws.SetWeightDedup(true, true);
+    ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+              other_ws.LoadModelTensor(net_def, device,
+                                       model_data_copy.data()));
+    EXPECT_EQ(ws.GetTensor("Quantized0")->raw_data(),
+              other_ws.GetTensor("Quantized1")->raw_data());
+    EXPECT_EQ(ws.GetTensor("Quantized2")->raw_data(),
+              other_ws.GetTensor("Quantized2")->raw_data());
+    EXPECT_NE(ws.GetTensor("Float0")->raw_data(),
+              other_ws.GetTensor("Float0")->raw_data());
+    EXPECT_EQ(num_stored, WeightStore::Get()->size());
+  }
+  Workspace unshared_ws;
+  unshared_ws.SetWeightDedup(true, false);
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            unshared_ws.LoadModelTensor(net_def, device,
+                                        model_data_copy.data()));
+  EXPECT_NE(ws.GetTensor("Quantized0")->raw_data(),
+            unshared_ws.GetTensor("Quantized0")->raw_data());
+
+  // Contents with the same key are told apart by their bytes
+  std::shared_ptr<WeightStore::Weight> weight(
+      new WeightStore::Weight(GetCPUAllocator(), model_data.data(), 16));
+  WeightStore::Get()->Insert("WeightDedupKey", weight);
+  EXPECT_EQ(&weight->buffer,
+            WeightStore::Get()->Find("WeightDedupKey", model_data.data(),
+                                     16).get());
+  EXPECT_EQ(nullptr,
+            WeightStore::Get()->Find("WeightDedupKey", model_data.data() + 1,
+                                     16));
+}
+
+}  // namespace test
+}  // namespace mace
@@ -14,10 +14,16 @@
 
 #include "mace/core/workspace.h"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <unordered_set>
 #include <utility>
 
 #include "mace/core/arg_helper.h"
+#include "mace/core/memory_planner.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
+#include "mace/core/weight_store.h"
 #include "mace/utils/quantize.h"
 
 #ifdef MACE_ENABLE_OPENCL
@@ -34,6 +40,26 @@ bool ShouldPreallocateMemoryForOp(const OperatorDef &op) {
   return reuse_buffer_ops.find(op.type()) == reuse_buffer_ops.end();
 }
 
+bool IsInitModeOp(const OperatorDef &op) {
+  return ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+      op, "mode", static_cast<int>(NetMode::NORMAL)) == NetMode::INIT;
+}
+
+// Whether the converter planned the memory of the device
+bool HasMemoryPlan(const NetDef &net_def, const DeviceType device_type) {
+  for (auto &mem_block : net_def.mem_arena().mem_block()) {
+    if (mem_block.device_type() == device_type) {
+      return true;
+    }
+  }
+  for (auto &op : net_def.op()) {
+    if (!op.mem_id().empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
 bool HasQuantizeOp(const NetDef &net_def) {
   for (auto &op : net_def.op()) {
     if (op.type() == "Quantize") {
@@ -42,14 +68,141 @@ bool HasQuantizeOp(const NetDef &net_def) {
   }
   return false;
 }
+
+// Dequantizes the weights in chunks spread over the threads of the device,
+// so that many small tensors are done in parallel as well as a large one.
+// Every element is computed as by Dequantize, whatever the schedule.
+void DequantizeTensors(
+    Device *device,
+    const std::vector<std::pair<const Tensor *, Tensor *>> &tensors) {
+  const index_t kChunkSize = 1 << 16;
+  struct Chunk {
+    const uint8_t *input;
+    index_t size;
+    float scale;
+    int32_t zero_point;
+    float *output;
+  };
+  std::vector<Chunk> chunks;
+  std::vector<std::unique_ptr<Tensor::MappingGuard>> guards;
+  for (auto &tensor : tensors) {
+    const Tensor *quantized = tensor.first;
+    guards.emplace_back(new Tensor::MappingGuard(quantized));
+    guards.emplace_back(new Tensor::MappingGuard(tensor.second));
+    const uint8_t *input = quantized->data<uint8_t>();
+    float *output = tensor.second->mutable_data<float>();
+    for (index_t begin = 0; begin < quantized->size(); begin += kChunkSize) {
+      chunks.push_back({input + begin,
+                        std::min(kChunkSize, quantized->size() - begin),
+                        quantized->scale(),
+                        quantized->zero_point(),
+                        output + begin});
+    }
+  }
+  ThreadPoolGuard thread_pool_guard(device->cpu_runtime()->thread_pool());
+  ParallelFor(0, static_cast<index_t>(chunks.size()), [&](index_t i) {
+    const Chunk &chunk = chunks[i];
+    Dequantize(chunk.input, chunk.size, chunk.scale, chunk.zero_point,
+               chunk.output);
+  });
+}
+
+// Where the bytes of the const tensors are loaded
+struct ConstTensorLayout {
+  // The index of the first const tensor with the same bytes, which a
+  // duplicate is loaded as a slice of
+  std::vector<int> first;
+  // The offset of the bytes of each const tensor in the loaded buffer
+  std::vector<index_t> offsets;
+  index_t size;
+};
+
+index_t ConstTensorBytes(const ConstTensor &const_tensor) {
+  return const_tensor.data_size() * GetEnumTypeSize(const_tensor.data_type());
+}
+
+// With dedup, the duplicates are found by their sizes and hashes and
+// compared byte by byte. With pack, the layout leaves out the duplicates
+// and other bytes no tensor holds, for the devices the model data is
+// copied to.
+ConstTensorLayout LayoutConstTensors(const NetDef &net_def,
+                                     const unsigned char *model_data,
+                                     const index_t model_data_size,
+                                     const bool dedup,
+                                     const bool pack) {
+  const int num_tensors = net_def.tensors_size();
+  ConstTensorLayout layout;
+  layout.first.resize(num_tensors);
+  layout.offsets.resize(num_tensors);
+  layout.size = pack ? 0 : model_data_size;
+  std::unordered_map<std::string, std::vector<int>> tensors_by_key;
+  for (int i = 0; i < num_tensors; ++i) {
+    const ConstTensor &const_tensor = net_def.tensors(i);
+    const unsigned char *data = model_data + const_tensor.offset();
+    const index_t bytes = ConstTensorBytes(const_tensor);
+    layout.first[i] = i;
+    if (dedup) {
+      std::vector<int> &candidates = tensors_by_key[MakeString(
+          bytes, ":", Hash64(data, bytes, 0))];
+      for (int candidate : candidates) {
+        if (memcmp(model_data + net_def.tensors(candidate).offset(), data,
+                   bytes) == 0) {
+          layout.first[i] = candidate;
+          break;
+        }
+      }
+      if (layout.first[i] == i) {
+        candidates.push_back(i);
+      }
+    }
+    if (layout.first[i] != i) {
+      layout.offsets[i] = layout.offsets[layout.first[i]];
+    } else if (pack) {
+      // Aligned for the kernels taking the offset in elements
+      layout.offsets[i] = RoundUp<index_t>(layout.size, 16);
+      layout.size = layout.offsets[i] + bytes;
+    } else {
+      layout.offsets[i] = const_tensor.offset();
+    }
+  }
+  return layout;
+}
+
+// The key of the weights dequantized from the bytes of a const tensor
+std::string DequantizedKey(const std::string &bytes_key,
+                           const ConstTensor &const_tensor) {
+  const float scale = const_tensor.scale();
+  uint32_t scale_bits;
+  memcpy(&scale_bits, &scale, sizeof(scale_bits));
+  return MakeString(bytes_key, ";scale=", scale_bits,
+                    ";zero_point=", const_tensor.zero_point());
+}
 }  // namespace
 
-Workspace::Workspace() = default;
+Workspace::Workspace()
+    : const_workspace_(nullptr),
+      fused_buffer_(false),
+      weight_dedup_(false),
+      share_weights_(false),
+      memory_plan_(nullptr) {}
+
+Workspace::Workspace(const Workspace *const_workspace)
+    : const_workspace_(const_workspace),
+      fused_buffer_(false),
+      weight_dedup_(false),
+      share_weights_(false),
+      memory_plan_(nullptr) {}
+
+void Workspace::SetWeightDedup(bool enabled, bool share_across_workspaces) {
+  weight_dedup_ = enabled;
+  share_weights_ = enabled && share_across_workspaces;
+}
 
 Tensor *Workspace::CreateTensor(const std::string &name,
                                 Allocator *alloc,
                                 DataType type) {
-  if (HasTensor(name)) {
+  // Tensors of the const workspace are shadowed, not reused.
+  if (HasOwnTensor(name)) {
     VLOG(3) << "Tensor " << name << " already exists. Skipping.";
   } else {
     VLOG(3) << "Creating Tensor " << name;
@@ -62,6 +215,8 @@ Tensor *Workspace::CreateTensor(const std::string &name,
 const Tensor *Workspace::GetTensor(const std::string &name) const {
   if (tensor_map_.count(name)) {
     return tensor_map_.at(name).get();
+  } else if (const_workspace_ != nullptr && const_workspace_->HasTensor(name)) {
+    return const_workspace_->GetTensor(name);
   } else {
     LOG(WARNING) << "Tensor " << name << " does not exist.";
   }
@@ -73,6 +228,11 @@ Tensor *Workspace::GetTensor(const std::string &name) {
       static_cast<const Workspace *>(this)->GetTensor(name));
 }
 
+int Workspace::GetTensorMemId(const std::string &name) const {
+  auto iter = tensor_mem_ids_.find(name);
+  return iter == tensor_mem_ids_.end() ? -1 : iter->second;
+}
+
 std::vector<std::string> Workspace::Tensors() const {
   std::vector<std::string> names;
   for (auto &entry : tensor_map_) {
@@ -139,6 +299,11 @@ MaceStatus Workspace::LoadModelTensor(const NetDef &net_def,
 #else
     {
 #endif
+      // Model data on CPU is used in place, so the duplicates are only
+      // packed out of the copies to other devices
+      const ConstTensorLayout layout = LayoutConstTensors(
+          net_def, model_data, model_data_size, weight_dedup_,
+          weight_dedup_ && device_type != DeviceType::CPU);
       if (device_type == DeviceType::CPU) {
         tensor_buffer_ = std::unique_ptr<Buffer>(
             new Buffer(device->allocator(),
@@ -147,14 +312,36 @@ MaceStatus Workspace::LoadModelTensor(const NetDef &net_def,
       } else {
         tensor_buffer_ = std::unique_ptr<Buffer>(
             new Buffer(device->allocator()));
-        MACE_RETURN_IF_ERROR(tensor_buffer_->Allocate(model_data_size));
+        MACE_RETURN_IF_ERROR(tensor_buffer_->Allocate(layout.size));
         tensor_buffer_->Map(nullptr);
-        tensor_buffer_->Copy(const_cast<unsigned char*>(model_data),
-                             0, model_data_size);
+        if (layout.size == model_data_size) {
+          tensor_buffer_->Copy(const_cast<unsigned char*>(model_data),
+                               0, model_data_size);
+        } else {
+          unsigned char *data = reinterpret_cast<unsigned char *>(
+              tensor_buffer_->raw_mutable_data());
+          for (int i = 0; i < net_def.tensors_size(); ++i) {
+            if (layout.first[i] == i) {
+              const ConstTensor &const_tensor = net_def.tensors(i);
+              memcpy(data + layout.offsets[i],
+                     model_data + const_tensor.offset(),
+                     ConstTensorBytes(const_tensor));
+            }
+          }
+        }
         tensor_buffer_->UnMap();
       }
       bool has_quantize_op = HasQuantizeOp(net_def);
-      for (auto &const_tensor : net_def.tensors()) {
+      std::vector<std::unique_ptr<Tensor>> quantized_tensors;
+      std::vector<std::pair<const Tensor *, Tensor *>> dequantize_tensors;
+      // The dequantized buffers by key, and those to add to the weight store
+      std::unordered_map<std::string, std::shared_ptr<Buffer>>
+          dequantized_buffers;
+      std::vector<std::pair<std::string, std::shared_ptr<WeightStore::Weight>>>
+          new_shared_weights;
+      index_t dedup_bytes = 0;
+      for (int i = 0; i < net_def.tensors_size(); ++i) {
+        const ConstTensor &const_tensor = net_def.tensors(i);
         MACE_LATENCY_LOGGER(2, "Load tensor ", const_tensor.name());
         VLOG(3) << "Tensor name: " << const_tensor.name()
                 << ", data type: " << const_tensor.data_type() << ", shape: "
@@ -164,12 +351,16 @@ MaceStatus Workspace::LoadModelTensor(const NetDef &net_def,
         for (const index_t d : const_tensor.dims()) {
           dims.push_back(d);
         }
+        if (layout.first[i] != i) {
+          VLOG(3) << "Tensor " << const_tensor.name() << " is a duplicate of "
+                  << net_def.tensors(layout.first[i]).name();
+          dedup_bytes += ConstTensorBytes(const_tensor);
+        }
 
         std::unique_ptr<Tensor> tensor(
             new Tensor(BufferSlice(
-                tensor_buffer_.get(), const_tensor.offset(),
-                const_tensor.data_size() *
-                    GetEnumTypeSize(const_tensor.data_type())),
+                tensor_buffer_.get(), layout.offsets[i],
+                ConstTensorBytes(const_tensor)),
                        const_tensor.data_type(),
                        true,
                        const_tensor.name()));
@@ -180,22 +371,70 @@ MaceStatus Workspace::LoadModelTensor(const NetDef &net_def,
 
         // Only weights are quantized
         if (const_tensor.quantized() && !has_quantize_op) {
-          std::unique_ptr<Tensor> dequantized_tensor(new Tensor(true));
-          dequantized_tensor->Resize(dims);
-          Tensor::MappingGuard quantize_guard(tensor.get());
-          Tensor::MappingGuard dequantize_guard(dequantized_tensor.get());
-          auto quantized_data = tensor->data<uint8_t>();
-          auto dequantized_data = dequantized_tensor->mutable_data<float>();
-          Dequantize(quantized_data,
-                     tensor->size(),
-                     tensor->scale(),
-                     tensor->zero_point(),
-                     dequantized_data);
+          std::unique_ptr<Tensor> dequantized_tensor;
+          if (!weight_dedup_) {
+            dequantized_tensor.reset(new Tensor(true));
+            dequantized_tensor->Resize(dims);
+            dequantize_tensors.emplace_back(tensor.get(),
+                                            dequantized_tensor.get());
+          } else {
+            // Keyed by the first tensor with the bytes in the workspace, and
+            // by the content across workspaces
+            const std::string key = DequantizedKey(
+                MakeString(layout.first[i]), const_tensor);
+            std::shared_ptr<Buffer> &buffer = dequantized_buffers[key];
+            const unsigned char *source = model_data + const_tensor.offset();
+            const index_t source_bytes = ConstTensorBytes(const_tensor);
+            std::string shared_key;
+            if (buffer == nullptr && share_weights_) {
+              shared_key = DequantizedKey(
+                  WeightContentKey(source, source_bytes), const_tensor);
+              buffer = WeightStore::Get()->Find(shared_key, source,
+                                                source_bytes);
+            }
+            const bool loaded = buffer != nullptr;
+            if (!loaded) {
+              if (share_weights_) {
+                std::shared_ptr<WeightStore::Weight> weight(
+                    new WeightStore::Weight(GetCPUAllocator(), source,
+                                            source_bytes));
+                buffer = std::shared_ptr<Buffer>(weight, &weight->buffer);
+                new_shared_weights.emplace_back(shared_key, weight);
+              } else {
+                buffer.reset(new Buffer(GetCPUAllocator()));
+              }
+              MACE_RETURN_IF_ERROR(
+                  buffer->Allocate(const_tensor.data_size() * sizeof(float)));
+            } else {
+              dedup_bytes += const_tensor.data_size() * sizeof(float);
+            }
+            weight_buffers_.push_back(buffer);
+            dequantized_tensor.reset(
+                new Tensor(buffer.get(), DT_FLOAT, true));
+            dequantized_tensor->Reshape(dims);
+            if (!loaded) {
+              dequantize_tensors.emplace_back(tensor.get(),
+                                              dequantized_tensor.get());
+            }
+          }
+          quantized_tensors.emplace_back(std::move(tensor));
           tensor_map_[const_tensor.name()] = std::move(dequantized_tensor);
         } else {
           tensor_map_[const_tensor.name()] = std::move(tensor);
         }
       }
+      if (!dequantize_tensors.empty()) {
+        MACE_LATENCY_LOGGER(2, "Dequantize ", dequantize_tensors.size(),
+                            " tensors");
+        DequantizeTensors(device, dequantize_tensors);
+      }
+      // Added once filled, since the other workspaces read them
+      for (auto &shared_weight : new_shared_weights) {
+        WeightStore::Get()->Insert(shared_weight.first, shared_weight.second);
+      }
+      if (dedup_bytes > 0) {
+        VLOG(1) << "Weight dedup saved " << dedup_bytes << " bytes";
+      }
       fused_buffer_ = true;
     }
   }
@@ -206,25 +445,83 @@ MaceStatus Workspace::LoadModelTensor(const NetDef &net_def,
   }
 
   if (device_type == DeviceType::CPU) {
-    for (const auto &op : net_def.op()) {
-      VLOG(2) << "Add quantize info for op: " << op.name();
-      MACE_CHECK(op.quantize_info().empty()
-                     || op.quantize_info().size() == op.output().size(),
-                 "quantize info size must be equal to output size or empty");
-      for (int i = 0; i < op.quantize_info().size(); ++i) {
-        auto &quantize_info = op.quantize_info(i);
-        Tensor *tensor = GetTensor(op.output(i));
-        tensor->SetScale(quantize_info.scale());
-        tensor->SetZeroPoint(quantize_info.zero_point());
-        tensor->SetMinVal(quantize_info.minval());
-        tensor->SetMaxVal(quantize_info.maxval());
-      }
+    SetOutputQuantizeInfo(net_def);
+  }
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
+bool Workspace::ExportMemoryPlan(NetDef *net_def) const {
+  if (planned_mem_ids_.empty()
+      || static_cast<int>(planned_mem_ids_.size()) != net_def->op_size()) {
+    return false;
+  }
+  for (auto size : planned_buffer_sizes_) {
+    if (size > std::numeric_limits<uint32_t>::max()) return false;
+  }
+  MemoryArena *mem_arena = net_def->mutable_mem_arena();
+  mem_arena->Clear();
+  for (size_t mem_id = 0; mem_id < planned_buffer_sizes_.size(); ++mem_id) {
+    MemoryBlock *mem_block = mem_arena->add_mem_block();
+    mem_block->set_mem_id(mem_id);
+    mem_block->set_device_type(DeviceType::CPU);
+    mem_block->set_mem_type(MemoryType::CPU_BUFFER);
+    mem_block->set_x(planned_buffer_sizes_[mem_id]);
+    mem_block->set_y(1);
+  }
+  for (int op_idx = 0; op_idx < net_def->op_size(); ++op_idx) {
+    OperatorDef *op = net_def->mutable_op(op_idx);
+    const std::vector<int> &mem_ids = planned_mem_ids_[op_idx];
+    op->clear_mem_id();
+    for (int mem_id : mem_ids) {
+      op->add_mem_id(mem_id);
+    }
+    // The planned outputs without a type take the type of the op, as
+    // they do when planned at load time
+    const DataType op_dtype = static_cast<DataType>(
+        ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+            *op, "T", static_cast<int>(DT_FLOAT)));
+    for (size_t i = op->output_type_size(); i < mem_ids.size(); ++i) {
+      op->add_output_type(op_dtype);
     }
   }
+  return true;
+}
 
+MaceStatus Workspace::CreateContextTensors(const NetDef &net_def,
+                                           Device *device) {
+  MACE_CHECK(const_workspace_ != nullptr,
+             "Context tensors need a workspace holding the const tensors");
+  const DeviceType device_type = device->device_type();
+  if (device_type == DeviceType::CPU || device_type == DeviceType::GPU) {
+    MACE_RETURN_IF_ERROR(CreateOutputTensorBuffer(net_def, device));
+  }
+  if (device_type == DeviceType::CPU) {
+    SetOutputQuantizeInfo(net_def);
+  }
   return MaceStatus::MACE_SUCCESS;
 }
 
+void Workspace::SetOutputQuantizeInfo(const NetDef &net_def) {
+  for (const auto &op : net_def.op()) {
+    if (const_workspace_ != nullptr && IsInitModeOp(op)) {
+      continue;
+    }
+    VLOG(2) << "Add quantize info for op: " << op.name();
+    MACE_CHECK(op.quantize_info().empty()
+                   || op.quantize_info().size() == op.output().size(),
+               "quantize info size must be equal to output size or empty");
+    for (int i = 0; i < op.quantize_info().size(); ++i) {
+      auto &quantize_info = op.quantize_info(i);
+      Tensor *tensor = GetTensor(op.output(i));
+      tensor->SetScale(quantize_info.scale());
+      tensor->SetZeroPoint(quantize_info.zero_point());
+      tensor->SetMinVal(quantize_info.minval());
+      tensor->SetMaxVal(quantize_info.maxval());
+    }
+  }
+}
+
 MaceStatus Workspace::CreateOutputTensorBuffer(const NetDef &net_def,
                                                Device *device) {
   DeviceType device_type = device->device_type();
@@ -252,10 +549,48 @@ MaceStatus Workspace::CreateOutputTensorBuffer(const NetDef &net_def,
     }
     MACE_CHECK(dtype != DataType::DT_INVALID, "data type is invalid.");
   }
+  // Plan the CPU buffers if the model was converted without memory
+  // optimization, as models built by other tools may be. A plan made by
+  // the converter is planned again as well, so that models converted
+  // before the in place rule run in place, and replaced if that takes no
+  // more memory.
+  std::vector<std::vector<int>> planned_mem_ids;
+  if (device_type == DeviceType::CPU) {
+    const bool has_memory_plan = HasMemoryPlan(net_def, device_type);
+    index_t arena_size = 0;
+    for (auto &mem_block : net_def.mem_arena().mem_block()) {
+      if (mem_block.device_type() == device_type) {
+        arena_size += mem_block.x();
+      }
+    }
+    CPUMemoryPlanner planner;
+    auto should_plan = [device_type](const OperatorDef &op) {
+      const int op_device = ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+          op, "device", static_cast<int>(device_type));
+      return op_device == device_type && !IsInitModeOp(op);
+    };
+    if (planner.Plan(net_def, should_plan)
+        && (!has_memory_plan || planner.planned_size() <= arena_size)) {
+      LOG(INFO) << "Planned CPU memory: " << planner.planned_size()
+                << " bytes in " << planner.buffer_sizes().size()
+                << " buffers, naive: " << planner.naive_size() << " bytes";
+      const std::vector<index_t> &buffer_sizes = planner.buffer_sizes();
+      for (size_t mem_id = 0; mem_id < buffer_sizes.size(); ++mem_id) {
+        std::unique_ptr<BufferBase> tensor_buf(
+            new Buffer(GetCPUAllocator()));
+        MACE_RETURN_IF_ERROR(tensor_buf->Allocate(
+            buffer_sizes[mem_id] + MACE_EXTRA_BUFFER_PAD_SIZE));
+        preallocated_allocator_.SetBuffer(mem_id, std::move(tensor_buf));
+      }
+      planned_mem_ids = planner.op_mem_ids();
+      planned_buffer_sizes_ = buffer_sizes;
+      planned_mem_ids_ = planned_mem_ids;
+    }
+  }
   // TODO(liyin): memory block should not have concept of type, but to be
   // consistent with gpu, all memory block use float/half as unit
   for (auto &mem_block : net_def.mem_arena().mem_block()) {
-    if (mem_block.device_type() == device_type) {
+    if (mem_block.device_type() == device_type && planned_mem_ids.empty()) {
       VLOG(3) << "Preallocate memory block. id: " << mem_block.mem_id()
               << ", device type: " << mem_block.device_type()
               << ", memory type: " << mem_block.mem_type();
@@ -285,20 +620,32 @@ MaceStatus Workspace::CreateOutputTensorBuffer(const NetDef &net_def,
     }
   }
   VLOG(3) << "Preallocate buffer to tensors";
-  for (auto &op : net_def.op()) {
+  for (int op_idx = 0; op_idx < net_def.op_size(); ++op_idx) {
+    const OperatorDef &op = net_def.op(op_idx);
     // TODO(liuqi): refactor to add device_type to OperatorDef
     const int op_device =
         ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
             op, "device", static_cast<int>(device_type));
+    // Outputs of the INIT-mode net are shared with the const workspace.
+    if (const_workspace_ != nullptr && IsInitModeOp(op)) {
+      continue;
+    }
     if (op_device == device_type) {
-      if (!op.mem_id().empty()
+      std::vector<int> mem_ids(op.mem_id().begin(), op.mem_id().end());
+      if (!planned_mem_ids.empty()) {
+        mem_ids = planned_mem_ids[op_idx];
+      }
+      if (!mem_ids.empty()
           && ShouldPreallocateMemoryForOp(op)) {
-        auto mem_ids = op.mem_id();
         int count = mem_ids.size();
         for (int i = 0; i < count; ++i) {
           DataType output_type;
           if (i < op.output_type_size()) {
             output_type = op.output_type(i);
+          } else if (!planned_mem_ids.empty()) {
+            output_type = static_cast<DataType>(
+                ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+                    op, "T", static_cast<int>(DT_FLOAT)));
           } else {
             output_type = dtype;
           }
@@ -319,6 +666,10 @@ MaceStatus Workspace::CreateOutputTensorBuffer(const NetDef &net_def,
                     << " Mem: " << mem_ids[i]
                     << ", Buffer size: " << tensor->UnderlyingBuffer()->size();
           }
+          if (device_type == DeviceType::CPU) {
+            cpu_block_tensors_.emplace_back(tensor.get(), mem_ids[i]);
+          }
+          tensor_mem_ids_[op.output(i)] = mem_ids[i];
           tensor_map_[op.output(i)] = std::move(tensor);
         }
       } else {
@@ -358,6 +709,41 @@ MaceStatus Workspace::CreateOutputTensorBuffer(const NetDef &net_def,
   return MaceStatus::MACE_SUCCESS;
 }
 
+void Workspace::EnableMemoryPlanCache(const int capacity) {
+  memory_plan_cache_.reset(new MemoryPlanCache(capacity));
+}
+
+void Workspace::SwitchMemoryPlan(const std::vector<index_t> &shape_key) {
+  MACE_CHECK(memory_plan_cache_ != nullptr, "memory plan cache is disabled");
+  if (memory_plan_ != nullptr && memory_plan_->shape_key() == shape_key) {
+    return;
+  }
+  MemoryPlan *plan = memory_plan_cache_->Get(shape_key);
+  if (plan == nullptr) {
+    VLOG(1) << "Plan memory for input shape " << MakeString(shape_key);
+    std::unique_ptr<MemoryPlan> new_plan(new MemoryPlan(shape_key));
+    PreallocatedPooledAllocator *buffers = new_plan->buffers();
+    for (auto &tensor_mem_id : cpu_block_tensors_) {
+      const int mem_id = tensor_mem_id.second;
+      if (!buffers->HasBuffer(mem_id)) {
+        // The first plan takes over the arena planned offline.
+        std::unique_ptr<BufferBase> buffer =
+            preallocated_allocator_.ReleaseBuffer(mem_id);
+        if (buffer == nullptr) {
+          buffer.reset(new Buffer(GetCPUAllocator()));
+        }
+        buffers->SetBuffer(mem_id, std::move(buffer));
+      }
+    }
+    plan = memory_plan_cache_->Put(std::move(new_plan));
+  }
+  for (auto &tensor_mem_id : cpu_block_tensors_) {
+    tensor_mem_id.first->SetBuffer(
+        plan->buffers()->GetBuffer(tensor_mem_id.second));
+  }
+  memory_plan_ = plan;
+}
+
 void Workspace::RemoveUnusedBuffer() {
   auto iter = tensor_map_.begin();
   auto end_iter = tensor_map_.end();
@@ -17,10 +17,13 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <memory>
 
 #include "mace/core/device.h"
+#include "mace/core/memory_plan_cache.h"
 #include "mace/core/preallocated_pooled_allocator.h"
 #include "mace/core/tensor.h"
 #include "mace/public/mace.h"
@@ -32,6 +35,10 @@ class Workspace {
   typedef std::map<std::string, std::unique_ptr<Tensor>> TensorMap;
 
   Workspace();
+  // Creates a workspace which looks up the tensors it does not own (const
+  // tensors and outputs of the INIT-mode net) in `const_workspace`, so that
+  // several workspaces can run one model with a single copy of the weights.
+  explicit Workspace(const Workspace *const_workspace);
   ~Workspace() {}
 
   Tensor *CreateTensor(const std::string &name,
@@ -39,6 +46,12 @@ class Workspace {
                        DataType type);
 
   inline bool HasTensor(const std::string &name) const {
+    return tensor_map_.find(name) != tensor_map_.end() ||
+        (const_workspace_ != nullptr && const_workspace_->HasTensor(name));
+  }
+
+  // Whether the tensor is created in this workspace, not in the const one
+  inline bool HasOwnTensor(const std::string &name) const {
     return tensor_map_.find(name) != tensor_map_.end();
   }
 
@@ -46,12 +59,41 @@ class Workspace {
 
   Tensor *GetTensor(const std::string &name);
 
+  // Returns the mem id of the preallocated block holding the tensor, which
+  // the converter or the runtime memory planner assigned, or -1.
+  int GetTensorMemId(const std::string &name) const;
+
   std::vector<std::string> Tensors() const;
 
+  // Makes LoadModelTensor load the const tensors with the same bytes once,
+  // as slices of one buffer, and dequantize them once. With
+  // share_across_workspaces, the dequantized weights are also shared with
+  // the other workspaces of the process through the WeightStore.
+  void SetWeightDedup(bool enabled, bool share_across_workspaces);
+
   MaceStatus LoadModelTensor(const NetDef &net_def,
                              Device *device,
                              const unsigned char *model_data);
 
+  // Creates the activation tensors of a workspace sharing the const tensors
+  // of another one, i.e. everything LoadModelTensor creates except the const
+  // tensors and the outputs of the INIT-mode net.
+  MaceStatus CreateContextTensors(const NetDef &net_def, Device *device);
+
+  // Keeps CPU memory blocks for each input shape instead of using the arena
+  // planned offline only, keeping those of `capacity` shapes. The blocks
+  // are sized lazily, by the first run of each shape.
+  void EnableMemoryPlanCache(const int capacity);
+
+  // Makes the preallocated CPU tensors use the blocks kept for
+  // shape_key, which are created empty if the shape was not seen recently.
+  void SwitchMemoryPlan(const std::vector<index_t> &shape_key);
+
+  // Writes the CPU memory plan made when loading the model into net_def,
+  // which must have the ops of the loaded net, as if the converter had
+  // planned it. Returns false if no plan was made.
+  bool ExportMemoryPlan(NetDef *net_def) const;
+
   void RemoveUnusedBuffer();
 
   void RemoveAndReloadBuffer(const NetDef &net_def,
@@ -62,14 +104,35 @@ class Workspace {
   MaceStatus CreateOutputTensorBuffer(const NetDef &net_def,
                                       Device *device);
 
+  void SetOutputQuantizeInfo(const NetDef &net_def);
+
+  // The weights materialized by LoadModelTensor with dedup, which may be
+  // shared with other workspaces; they outlive the tensors in tensor_map_.
+  std::vector<std::shared_ptr<Buffer>> weight_buffers_;
+
   TensorMap tensor_map_;
 
+  const Workspace *const_workspace_;
+
   std::unique_ptr<BufferBase> tensor_buffer_;
 
   PreallocatedPooledAllocator preallocated_allocator_;
 
   bool fused_buffer_;
 
+  bool weight_dedup_;
+  bool share_weights_;
+
+  // Mem ids of all the preallocated tensors
+  std::unordered_map<std::string, int> tensor_mem_ids_;
+  // Tensors preallocated in CPU memory blocks, with their mem ids
+  std::vector<std::pair<Tensor *, int>> cpu_block_tensors_;
+  // The plan made by the runtime planner when loading the model
+  std::vector<index_t> planned_buffer_sizes_;
+  std::vector<std::vector<int>> planned_mem_ids_;
+  std::unique_ptr<MemoryPlanCache> memory_plan_cache_;
+  MemoryPlan *memory_plan_;
+
   MACE_DISABLE_COPY_AND_ASSIGN(Workspace);
 };
 
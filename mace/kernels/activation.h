@@ -22,6 +22,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/core/types.h"
 #include "mace/kernels/kernel.h"
@@ -67,31 +68,31 @@ void DoActivation(const T *input_ptr,
 
   switch (type) {
     case NOOP:
+      // nothing to do in place
+      if (output_ptr != input_ptr) {
+        std::copy(input_ptr, input_ptr + size, output_ptr);
+      }
       break;
     case RELU:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output_ptr[i] = std::max(input_ptr[i], static_cast<T>(0));
-      }
+      });
       break;
     case RELUX:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output_ptr[i] = std::min(std::max(input_ptr[i], static_cast<T>(0)),
                                  static_cast<T>(relux_max_limit));
-      }
+      });
       break;
     case TANH:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output_ptr[i] = std::tanh(input_ptr[i]);
-      }
+      });
       break;
     case SIGMOID:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output_ptr[i] = 1 / (1 + std::exp(-input_ptr[i]));
-      }
+      });
       break;
     default:
       LOG(FATAL) << "Unknown activation type: " << type;
@@ -105,19 +106,15 @@ void PReLUActivation(const T *input_ptr,
                      const index_t inner_size,
                      const T *alpha_ptr,
                      T *output_ptr) {
-#pragma omp parallel for collapse(3)
-  for (index_t i = 0; i < outer_size; ++i) {
-    for (index_t chan_idx = 0; chan_idx < input_chan; ++chan_idx) {
-      for (index_t j = 0; j < inner_size; ++j) {
-        index_t idx = i * input_chan * inner_size + chan_idx * inner_size + j;
-        if (input_ptr[idx] < 0) {
-          output_ptr[idx] = input_ptr[idx] * alpha_ptr[chan_idx];
-        } else {
-          output_ptr[idx] = input_ptr[idx];
-        }
-      }
+  ParallelFor3D(0, outer_size, 0, input_chan, 0, inner_size,
+                [&](index_t i, index_t chan_idx, index_t j) {
+    index_t idx = i * input_chan * inner_size + chan_idx * inner_size + j;
+    if (input_ptr[idx] < 0) {
+      output_ptr[idx] = input_ptr[idx] * alpha_ptr[chan_idx];
+    } else {
+      output_ptr[idx] = input_ptr[idx];
     }
-  }
+  });
 }
 
 template <DeviceType D, typename T>
@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 
@@ -56,8 +57,7 @@ struct AddNFunctor : OpKernel {
       mappers.emplace_back(Tensor::MappingGuard(input_tensors[i]));
     }
 
-#pragma omp parallel for
-    for (int64_t i = 0; i < size; i += element_per_group) {
+    ParallelFor(0, size, element_per_group, [&](int64_t i) {
       int64_t count = std::min(element_per_group, size - i);
       int nn = count >> 2;
       int remain = count - (nn << 2);
@@ -86,7 +86,7 @@ struct AddNFunctor : OpKernel {
           ++output_ptr;
         }
       }
-    }
+    });
     return MACE_SUCCESS;
   }
 };
@@ -22,6 +22,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 #include "mace/public/mace.h"
@@ -63,8 +64,7 @@ struct ArgMaxFunctor : OpKernel {
     index_t outer_size = output->size();
     index_t inner_size = input->dim(axis_value);
 
-#pragma omp parallel for
-    for (index_t i = 0; i < outer_size; ++i) {
+    ParallelFor(0, outer_size, [&](index_t i) {
       int idx = 0;
       T max_value = std::numeric_limits<T>::lowest();
       const T *input_ptr = input_data + i * inner_size;
@@ -75,7 +75,7 @@ struct ArgMaxFunctor : OpKernel {
         }
       }
       output_data[i] = idx;
-    }
+    });
 
     return MACE_SUCCESS;
   }
@@ -16,6 +16,7 @@
 #include <arm_neon.h>
 #endif
 
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/kernels/arm/conv_2d_neon.h"
 
 namespace mace {
@@ -87,47 +88,102 @@ void Conv2dNeonK5x5S1(const float *input,
   const index_t in_batch_size = in_shape[1] * in_image_size;
   const index_t out_batch_size = out_shape[1] * out_image_size;
 
-#pragma omp parallel for collapse(2)
-  for (index_t b = 0; b < out_shape[0]; ++b) {
-    for (index_t m = 0; m < out_shape[1]; m += 4) {
-      const index_t out_channels = out_shape[1];
-      const index_t out_height = out_shape[2];
-      const index_t out_width = out_shape[3];
-      const index_t in_channels = in_shape[1];
-      const index_t in_width = in_shape[3];
-      if (m + 3 < out_channels) {
-        float *out_ptr0_base = output + b * out_batch_size + m * out_image_size;
+  ParallelFor2D(0, out_shape[0], 1, 0, out_shape[1], 4,
+                [&](index_t b, index_t m) {
+    const index_t out_channels = out_shape[1];
+    const index_t out_height = out_shape[2];
+    const index_t out_width = out_shape[3];
+    const index_t in_channels = in_shape[1];
+    const index_t in_width = in_shape[3];
+    if (m + 3 < out_channels) {
+      float *out_ptr0_base = output + b * out_batch_size + m * out_image_size;
 #if defined(MACE_ENABLE_NEON) && !defined(__aarch64__)
-        float *out_ptr1_base =
-            output + b * out_batch_size + (m + 1) * out_image_size;
-        float *out_ptr2_base =
-            output + b * out_batch_size + (m + 2) * out_image_size;
-        float *out_ptr3_base =
-            output + b * out_batch_size + (m + 3) * out_image_size;
+      float *out_ptr1_base =
+          output + b * out_batch_size + (m + 1) * out_image_size;
+      float *out_ptr2_base =
+          output + b * out_batch_size + (m + 2) * out_image_size;
+      float *out_ptr3_base =
+          output + b * out_batch_size + (m + 3) * out_image_size;
 #endif
+      for (index_t c = 0; c < in_channels; ++c) {
+        const float *in_ptr_base =
+            input + b * in_batch_size + c * in_image_size;
+        const float *filter_ptr0 = filter + m * in_channels * 25 + c * 25;
+#if defined(MACE_ENABLE_NEON) && !defined(__aarch64__)
+        const float *filter_ptr1 =
+            filter + (m + 1) * in_channels * 25 + c * 25;
+        const float *filter_ptr2 =
+            filter + (m + 2) * in_channels * 25 + c * 25;
+        const float *filter_ptr3 =
+            filter + (m + 3) * in_channels * 25 + c * 25;
+        for (index_t h = 0; h < out_height; ++h) {
+          for (index_t w = 0; w + 3 < out_width; w += 4) {
+            // input offset
+            index_t in_offset = h * in_width + w;
+            // output (4 outch x 1 height x 4 width): vo_outch_height
+            float32x4_t vo0, vo1, vo2, vo3;
+            // load output
+            index_t out_offset = h * out_width + w;
+            vo0 = vld1q_f32(out_ptr0_base + out_offset);
+            vo1 = vld1q_f32(out_ptr1_base + out_offset);
+            vo2 = vld1q_f32(out_ptr2_base + out_offset);
+            vo3 = vld1q_f32(out_ptr3_base + out_offset);
+            for (index_t r = 0; r < 5; ++r) {
+              // input (3 slide)
+              float32x4_t vi0, vi1, vi2, vi3, vi4;
+              // load input
+              vi0 = vld1q_f32(in_ptr_base + in_offset);
+              vi4 = vld1q_f32(in_ptr_base + in_offset + 4);
+              vi1 = vextq_f32(vi0, vi4, 1);
+              vi2 = vextq_f32(vi0, vi4, 2);
+              vi3 = vextq_f32(vi0, vi4, 3);
+
+              MACE_Conv2dNeonK5x5SnLoadCalc4;
+
+              in_offset += in_width;
+              filter_ptr0 += 5;
+              filter_ptr1 += 5;
+              filter_ptr2 += 5;
+              filter_ptr3 += 5;
+            }  // r
+
+            vst1q_f32(out_ptr0_base + out_offset, vo0);
+            vst1q_f32(out_ptr1_base + out_offset, vo1);
+            vst1q_f32(out_ptr2_base + out_offset, vo2);
+            vst1q_f32(out_ptr3_base + out_offset, vo3);
+
+            filter_ptr0 -= 25;
+            filter_ptr1 -= 25;
+            filter_ptr2 -= 25;
+            filter_ptr3 -= 25;
+          }  // w
+        }    // h
+#else
+        for (index_t oc = 0; oc < 4; ++oc) {
+          Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0 + oc * in_channels * 25,
+                             in_width, 5, 5, out_height, out_width,
+                             out_ptr0_base + oc * out_image_size, 1);
+        }
+#endif
+      }  // c
+    } else {
+      for (index_t mm = m; mm < out_channels; ++mm) {
+        float *out_ptr0_base =
+            output + b * out_batch_size + mm * out_image_size;
         for (index_t c = 0; c < in_channels; ++c) {
           const float *in_ptr_base =
               input + b * in_batch_size + c * in_image_size;
-          const float *filter_ptr0 = filter + m * in_channels * 25 + c * 25;
+          const float *filter_ptr0 = filter + mm * in_channels * 25 + c * 25;
 #if defined(MACE_ENABLE_NEON) && !defined(__aarch64__)
-          const float *filter_ptr1 =
-              filter + (m + 1) * in_channels * 25 + c * 25;
-          const float *filter_ptr2 =
-              filter + (m + 2) * in_channels * 25 + c * 25;
-          const float *filter_ptr3 =
-              filter + (m + 3) * in_channels * 25 + c * 25;
           for (index_t h = 0; h < out_height; ++h) {
             for (index_t w = 0; w + 3 < out_width; w += 4) {
               // input offset
               index_t in_offset = h * in_width + w;
-              // output (4 outch x 1 height x 4 width): vo_outch_height
-              float32x4_t vo0, vo1, vo2, vo3;
+              // output (1 outch x 1 height x 4 width): vo_outch_height
+              float32x4_t vo0;
               // load output
               index_t out_offset = h * out_width + w;
               vo0 = vld1q_f32(out_ptr0_base + out_offset);
-              vo1 = vld1q_f32(out_ptr1_base + out_offset);
-              vo2 = vld1q_f32(out_ptr2_base + out_offset);
-              vo3 = vld1q_f32(out_ptr3_base + out_offset);
               for (index_t r = 0; r < 5; ++r) {
                 // input (3 slide)
                 float32x4_t vi0, vi1, vi2, vi3, vi4;
@@ -138,81 +194,24 @@ void Conv2dNeonK5x5S1(const float *input,
                 vi2 = vextq_f32(vi0, vi4, 2);
                 vi3 = vextq_f32(vi0, vi4, 3);
 
-                MACE_Conv2dNeonK5x5SnLoadCalc4;
+                MACE_Conv2dNeonK5x5SnLoadCalc1;
 
                 in_offset += in_width;
                 filter_ptr0 += 5;
-                filter_ptr1 += 5;
-                filter_ptr2 += 5;
-                filter_ptr3 += 5;
               }  // r
 
               vst1q_f32(out_ptr0_base + out_offset, vo0);
-              vst1q_f32(out_ptr1_base + out_offset, vo1);
-              vst1q_f32(out_ptr2_base + out_offset, vo2);
-              vst1q_f32(out_ptr3_base + out_offset, vo3);
-
               filter_ptr0 -= 25;
-              filter_ptr1 -= 25;
-              filter_ptr2 -= 25;
-              filter_ptr3 -= 25;
             }  // w
           }    // h
 #else
-          for (index_t oc = 0; oc < 4; ++oc) {
-            Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0 + oc * in_channels * 25,
-                               in_width, 5, 5, out_height, out_width,
-                               out_ptr0_base + oc * out_image_size, 1);
-          }
+          Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0, in_width, 5, 5,
+                             out_height, out_width, out_ptr0_base, 1);
 #endif
         }  // c
-      } else {
-        for (index_t mm = m; mm < out_channels; ++mm) {
-          float *out_ptr0_base =
-              output + b * out_batch_size + mm * out_image_size;
-          for (index_t c = 0; c < in_channels; ++c) {
-            const float *in_ptr_base =
-                input + b * in_batch_size + c * in_image_size;
-            const float *filter_ptr0 = filter + mm * in_channels * 25 + c * 25;
-#if defined(MACE_ENABLE_NEON) && !defined(__aarch64__)
-            for (index_t h = 0; h < out_height; ++h) {
-              for (index_t w = 0; w + 3 < out_width; w += 4) {
-                // input offset
-                index_t in_offset = h * in_width + w;
-                // output (1 outch x 1 height x 4 width): vo_outch_height
-                float32x4_t vo0;
-                // load output
-                index_t out_offset = h * out_width + w;
-                vo0 = vld1q_f32(out_ptr0_base + out_offset);
-                for (index_t r = 0; r < 5; ++r) {
-                  // input (3 slide)
-                  float32x4_t vi0, vi1, vi2, vi3, vi4;
-                  // load input
-                  vi0 = vld1q_f32(in_ptr_base + in_offset);
-                  vi4 = vld1q_f32(in_ptr_base + in_offset + 4);
-                  vi1 = vextq_f32(vi0, vi4, 1);
-                  vi2 = vextq_f32(vi0, vi4, 2);
-                  vi3 = vextq_f32(vi0, vi4, 3);
-
-                  MACE_Conv2dNeonK5x5SnLoadCalc1;
-
-                  in_offset += in_width;
-                  filter_ptr0 += 5;
-                }  // r
-
-                vst1q_f32(out_ptr0_base + out_offset, vo0);
-                filter_ptr0 -= 25;
-              }  // w
-            }    // h
-#else
-            Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0, in_width, 5, 5,
-                               out_height, out_width, out_ptr0_base, 1);
-#endif
-          }  // c
-        }    // mm
-      }      // if
-    }        // m
-  }          // b
+      }    // mm
+    }      // if
+  });          // b
 }
 
 }  // namespace kernels
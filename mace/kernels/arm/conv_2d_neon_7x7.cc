@@ -16,6 +16,7 @@
 #include <arm_neon.h>
 #endif
 
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/kernels/arm/conv_2d_neon.h"
 
 namespace mace {
@@ -164,47 +165,110 @@ void Conv2dNeonK7x7S1(const float *input,
   const index_t in_batch_size = in_shape[1] * in_image_size;
   const index_t out_batch_size = out_shape[1] * out_image_size;
 
-#pragma omp parallel for collapse(2)
-  for (index_t b = 0; b < out_shape[0]; ++b) {
-    for (index_t m = 0; m < out_shape[1]; m += 4) {
-      const index_t out_channels = out_shape[1];
-      const index_t out_height = out_shape[2];
-      const index_t out_width = out_shape[3];
-      const index_t in_channels = in_shape[1];
-      const index_t in_width = in_shape[3];
-      if (m + 3 < out_channels) {
-        float *out_ptr0_base = output + b * out_batch_size + m * out_image_size;
+  ParallelFor2D(0, out_shape[0], 1, 0, out_shape[1], 4,
+                [&](index_t b, index_t m) {
+    const index_t out_channels = out_shape[1];
+    const index_t out_height = out_shape[2];
+    const index_t out_width = out_shape[3];
+    const index_t in_channels = in_shape[1];
+    const index_t in_width = in_shape[3];
+    if (m + 3 < out_channels) {
+      float *out_ptr0_base = output + b * out_batch_size + m * out_image_size;
 #if defined(MACE_ENABLE_NEON)
-        float *out_ptr1_base =
-            output + b * out_batch_size + (m + 1) * out_image_size;
-        float *out_ptr2_base =
-            output + b * out_batch_size + (m + 2) * out_image_size;
-        float *out_ptr3_base =
-            output + b * out_batch_size + (m + 3) * out_image_size;
+      float *out_ptr1_base =
+          output + b * out_batch_size + (m + 1) * out_image_size;
+      float *out_ptr2_base =
+          output + b * out_batch_size + (m + 2) * out_image_size;
+      float *out_ptr3_base =
+          output + b * out_batch_size + (m + 3) * out_image_size;
 #endif
+      for (index_t c = 0; c < in_channels; ++c) {
+        const float *in_ptr_base =
+            input + b * in_batch_size + c * in_image_size;
+        const float *filter_ptr0 = filter + m * in_channels * 49 + c * 49;
+#if defined(MACE_ENABLE_NEON)
+        const float *filter_ptr1 =
+            filter + (m + 1) * in_channels * 49 + c * 49;
+        const float *filter_ptr2 =
+            filter + (m + 2) * in_channels * 49 + c * 49;
+        const float *filter_ptr3 =
+            filter + (m + 3) * in_channels * 49 + c * 49;
+        for (index_t h = 0; h < out_height; ++h) {
+          for (index_t w = 0; w + 3 < out_width; w += 4) {
+            // input offset
+            index_t in_offset = h * in_width + w;
+            // output (4 outch x 1 height x 4 width): vo_outch_height
+            float32x4_t vo0, vo1, vo2, vo3;
+            // load output
+            index_t out_offset = h * out_width + w;
+            vo0 = vld1q_f32(out_ptr0_base + out_offset);
+            vo1 = vld1q_f32(out_ptr1_base + out_offset);
+            vo2 = vld1q_f32(out_ptr2_base + out_offset);
+            vo3 = vld1q_f32(out_ptr3_base + out_offset);
+            for (index_t r = 0; r < 7; ++r) {
+              // input (3 slide)
+              float32x4_t vi0, vi1, vi2, vi3, vi4, vi5, vi6;
+              float32x4_t vi8;  // for tmp use
+              // load input
+              vi0 = vld1q_f32(in_ptr_base + in_offset);
+              vi4 = vld1q_f32(in_ptr_base + in_offset + 4);
+              vi8 = vld1q_f32(in_ptr_base + in_offset + 8);
+              vi1 = vextq_f32(vi0, vi4, 1);
+              vi2 = vextq_f32(vi0, vi4, 2);
+              vi3 = vextq_f32(vi0, vi4, 3);
+              vi5 = vextq_f32(vi4, vi8, 1);
+              vi6 = vextq_f32(vi4, vi8, 2);
+
+#if defined(__aarch64__)
+              MACE_Conv2dArmv8NeonK7x7SnLoadCalc4;
+#else
+              MACE_Conv2dArmv7NeonK7x7SnLoadCalc4;
+#endif
+
+              in_offset += in_width;
+              filter_ptr0 += 7;
+              filter_ptr1 += 7;
+              filter_ptr2 += 7;
+              filter_ptr3 += 7;
+            }  // r
+
+            vst1q_f32(out_ptr0_base + out_offset, vo0);
+            vst1q_f32(out_ptr1_base + out_offset, vo1);
+            vst1q_f32(out_ptr2_base + out_offset, vo2);
+            vst1q_f32(out_ptr3_base + out_offset, vo3);
+
+            filter_ptr0 -= 49;
+            filter_ptr1 -= 49;
+            filter_ptr2 -= 49;
+            filter_ptr3 -= 49;
+          }  // w
+        }    // h
+#else
+        for (index_t oc = 0; oc < 4; ++oc) {
+          Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0 + oc * in_channels * 49,
+                             in_width, 7, 7, out_height, out_width,
+                             out_ptr0_base + oc * out_image_size, 1);
+        }
+#endif
+      }  // c
+    } else {
+      for (index_t mm = m; mm < out_channels; ++mm) {
+        float *out_ptr0_base =
+            output + b * out_batch_size + mm * out_image_size;
         for (index_t c = 0; c < in_channels; ++c) {
           const float *in_ptr_base =
               input + b * in_batch_size + c * in_image_size;
-          const float *filter_ptr0 = filter + m * in_channels * 49 + c * 49;
+          const float *filter_ptr0 = filter + mm * in_channels * 49 + c * 49;
 #if defined(MACE_ENABLE_NEON)
-          const float *filter_ptr1 =
-              filter + (m + 1) * in_channels * 49 + c * 49;
-          const float *filter_ptr2 =
-              filter + (m + 2) * in_channels * 49 + c * 49;
-          const float *filter_ptr3 =
-              filter + (m + 3) * in_channels * 49 + c * 49;
           for (index_t h = 0; h < out_height; ++h) {
             for (index_t w = 0; w + 3 < out_width; w += 4) {
               // input offset
               index_t in_offset = h * in_width + w;
-              // output (4 outch x 1 height x 4 width): vo_outch_height
-              float32x4_t vo0, vo1, vo2, vo3;
+              // output (1 outch x 1 height x 4 width): vo_outch_height
+              float32x4_t vo0;
               // load output
               index_t out_offset = h * out_width + w;
               vo0 = vld1q_f32(out_ptr0_base + out_offset);
-              vo1 = vld1q_f32(out_ptr1_base + out_offset);
-              vo2 = vld1q_f32(out_ptr2_base + out_offset);
-              vo3 = vld1q_f32(out_ptr3_base + out_offset);
               for (index_t r = 0; r < 7; ++r) {
                 // input (3 slide)
                 float32x4_t vi0, vi1, vi2, vi3, vi4, vi5, vi6;
@@ -220,92 +284,27 @@ void Conv2dNeonK7x7S1(const float *input,
                 vi6 = vextq_f32(vi4, vi8, 2);
 
 #if defined(__aarch64__)
-                MACE_Conv2dArmv8NeonK7x7SnLoadCalc4;
+                MACE_Conv2dArmv8NeonK7x7SnLoadCalc1;
 #else
-                MACE_Conv2dArmv7NeonK7x7SnLoadCalc4;
+                MACE_Conv2dArmv7NeonK7x7SnLoadCalc1;
 #endif
 
                 in_offset += in_width;
                 filter_ptr0 += 7;
-                filter_ptr1 += 7;
-                filter_ptr2 += 7;
-                filter_ptr3 += 7;
               }  // r
 
               vst1q_f32(out_ptr0_base + out_offset, vo0);
-              vst1q_f32(out_ptr1_base + out_offset, vo1);
-              vst1q_f32(out_ptr2_base + out_offset, vo2);
-              vst1q_f32(out_ptr3_base + out_offset, vo3);
-
               filter_ptr0 -= 49;
-              filter_ptr1 -= 49;
-              filter_ptr2 -= 49;
-              filter_ptr3 -= 49;
             }  // w
           }    // h
 #else
-          for (index_t oc = 0; oc < 4; ++oc) {
-            Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0 + oc * in_channels * 49,
-                               in_width, 7, 7, out_height, out_width,
-                               out_ptr0_base + oc * out_image_size, 1);
-          }
+          Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0, in_width, 7, 7,
+                             out_height, out_width, out_ptr0_base, 1);
 #endif
         }  // c
-      } else {
-        for (index_t mm = m; mm < out_channels; ++mm) {
-          float *out_ptr0_base =
-              output + b * out_batch_size + mm * out_image_size;
-          for (index_t c = 0; c < in_channels; ++c) {
-            const float *in_ptr_base =
-                input + b * in_batch_size + c * in_image_size;
-            const float *filter_ptr0 = filter + mm * in_channels * 49 + c * 49;
-#if defined(MACE_ENABLE_NEON)
-            for (index_t h = 0; h < out_height; ++h) {
-              for (index_t w = 0; w + 3 < out_width; w += 4) {
-                // input offset
-                index_t in_offset = h * in_width + w;
-                // output (1 outch x 1 height x 4 width): vo_outch_height
-                float32x4_t vo0;
-                // load output
-                index_t out_offset = h * out_width + w;
-                vo0 = vld1q_f32(out_ptr0_base + out_offset);
-                for (index_t r = 0; r < 7; ++r) {
-                  // input (3 slide)
-                  float32x4_t vi0, vi1, vi2, vi3, vi4, vi5, vi6;
-                  float32x4_t vi8;  // for tmp use
-                  // load input
-                  vi0 = vld1q_f32(in_ptr_base + in_offset);
-                  vi4 = vld1q_f32(in_ptr_base + in_offset + 4);
-                  vi8 = vld1q_f32(in_ptr_base + in_offset + 8);
-                  vi1 = vextq_f32(vi0, vi4, 1);
-                  vi2 = vextq_f32(vi0, vi4, 2);
-                  vi3 = vextq_f32(vi0, vi4, 3);
-                  vi5 = vextq_f32(vi4, vi8, 1);
-                  vi6 = vextq_f32(vi4, vi8, 2);
-
-#if defined(__aarch64__)
-                  MACE_Conv2dArmv8NeonK7x7SnLoadCalc1;
-#else
-                  MACE_Conv2dArmv7NeonK7x7SnLoadCalc1;
-#endif
-
-                  in_offset += in_width;
-                  filter_ptr0 += 7;
-                }  // r
-
-                vst1q_f32(out_ptr0_base + out_offset, vo0);
-                filter_ptr0 -= 49;
-              }  // w
-            }    // h
-#else
-            Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0, in_width, 7, 7,
-                               out_height, out_width, out_ptr0_base, 1);
-#endif
-          }  // c
-        }    // mm
-      }      // if
-    }        // m
-  }          // b
+      }    // mm
+    }      // if
+  });          // b
 }
 
 // Ho = 1, Wo = 4, Co = 4
@@ -319,49 +318,117 @@ void Conv2dNeonK7x7S2(const float *input,
   const index_t in_batch_size = in_shape[1] * in_image_size;
   const index_t out_batch_size = out_shape[1] * out_image_size;
 
-#pragma omp parallel for collapse(2)
-  for (index_t b = 0; b < out_shape[0]; ++b) {
-    for (index_t m = 0; m < out_shape[1]; m += 4) {
-      const index_t out_channels = out_shape[1];
-      const index_t out_height = out_shape[2];
-      const index_t out_width = out_shape[3];
-      const index_t in_channels = in_shape[1];
-      const index_t in_width = in_shape[3];
-      if (m + 3 < out_channels) {
-        float *out_ptr0_base = output + b * out_batch_size + m * out_image_size;
+  ParallelFor2D(0, out_shape[0], 1, 0, out_shape[1], 4,
+                [&](index_t b, index_t m) {
+    const index_t out_channels = out_shape[1];
+    const index_t out_height = out_shape[2];
+    const index_t out_width = out_shape[3];
+    const index_t in_channels = in_shape[1];
+    const index_t in_width = in_shape[3];
+    if (m + 3 < out_channels) {
+      float *out_ptr0_base = output + b * out_batch_size + m * out_image_size;
 #if defined(MACE_ENABLE_NEON)
-        float *out_ptr1_base =
-            output + b * out_batch_size + (m + 1) * out_image_size;
-        float *out_ptr2_base =
-            output + b * out_batch_size + (m + 2) * out_image_size;
-        float *out_ptr3_base =
-            output + b * out_batch_size + (m + 3) * out_image_size;
+      float *out_ptr1_base =
+          output + b * out_batch_size + (m + 1) * out_image_size;
+      float *out_ptr2_base =
+          output + b * out_batch_size + (m + 2) * out_image_size;
+      float *out_ptr3_base =
+          output + b * out_batch_size + (m + 3) * out_image_size;
+#endif
+      for (index_t c = 0; c < in_channels; ++c) {
+        const float *in_ptr_base =
+            input + b * in_batch_size + c * in_image_size;
+        const float *filter_ptr0 = filter + m * in_channels * 49 + c * 49;
+#if defined(MACE_ENABLE_NEON)
+        const float *filter_ptr1 =
+            filter + (m + 1) * in_channels * 49 + c * 49;
+        const float *filter_ptr2 =
+            filter + (m + 2) * in_channels * 49 + c * 49;
+        const float *filter_ptr3 =
+            filter + (m + 3) * in_channels * 49 + c * 49;
+        for (index_t h = 0; h < out_height; ++h) {
+          for (index_t w = 0; w + 3 < out_width; w += 4) {
+            // input offset
+            index_t in_h = h * 2;
+            index_t in_w = w * 2;
+            index_t in_offset = in_h * in_width + in_w;
+            // output (4 outch x 1 height x 4 width): vo_outch_height
+            float32x4_t vo0, vo1, vo2, vo3;
+            // load output
+            index_t out_offset = h * out_width + w;
+            vo0 = vld1q_f32(out_ptr0_base + out_offset);
+            vo1 = vld1q_f32(out_ptr1_base + out_offset);
+            vo2 = vld1q_f32(out_ptr2_base + out_offset);
+            vo3 = vld1q_f32(out_ptr3_base + out_offset);
+            for (index_t r = 0; r < 7; ++r) {
+              // input (3 slide)
+              float32x4x2_t vvi0, vvi1;  // to de-interleave
+              float32x4_t vi0, vi1, vi2, vi3, vi4, vi5, vi6;
+              // load input
+              // [0.2.4.6, 1.3.5.7]
+              vvi0 = vld2q_f32(in_ptr_base + in_offset);
+              // [8.10.12.14, 9.11.13.15]
+              vvi1 = vld2q_f32(in_ptr_base + in_offset + 8);
+              vi0 = vvi0.val[0];                     // [0.2.4.6]
+              vi1 = vvi0.val[1];                     // [1.3.5.7]
+              vi2 = vextq_f32(vi0, vvi1.val[0], 1);  // [2.4.6.8]
+              vi3 = vextq_f32(vi1, vvi1.val[1], 1);  // [3.5.7.9]
+              vi4 = vextq_f32(vi0, vvi1.val[0], 2);  // [4.6.8.10]
+              vi5 = vextq_f32(vi1, vvi1.val[1], 2);  // [5.7.9.11]
+              vi6 = vextq_f32(vi0, vvi1.val[0], 3);  // [6.8.10.12]
+
+#if defined(__aarch64__)
+              MACE_Conv2dArmv8NeonK7x7SnLoadCalc4;
+#else
+              MACE_Conv2dArmv7NeonK7x7SnLoadCalc4;
 #endif
+
+              in_offset += in_width;
+              filter_ptr0 += 7;
+              filter_ptr1 += 7;
+              filter_ptr2 += 7;
+              filter_ptr3 += 7;
+            }  // r
+
+            vst1q_f32(out_ptr0_base + out_offset, vo0);
+            vst1q_f32(out_ptr1_base + out_offset, vo1);
+            vst1q_f32(out_ptr2_base + out_offset, vo2);
+            vst1q_f32(out_ptr3_base + out_offset, vo3);
+
+            filter_ptr0 -= 49;
+            filter_ptr1 -= 49;
+            filter_ptr2 -= 49;
+            filter_ptr3 -= 49;
+          }  // w
+        }    // h
+#else
+        for (index_t oc = 0; oc < 4; ++oc) {
+          Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0 + oc * in_channels * 49,
+                             in_width, 7, 7, out_height, out_width,
+                             out_ptr0_base + oc * out_image_size, 2);
+        }
+#endif
+      }  // c
+    } else {
+      for (index_t mm = m; mm < out_channels; ++mm) {
+        float *out_ptr0_base =
+            output + b * out_batch_size + mm * out_image_size;
         for (index_t c = 0; c < in_channels; ++c) {
           const float *in_ptr_base =
               input + b * in_batch_size + c * in_image_size;
-          const float *filter_ptr0 = filter + m * in_channels * 49 + c * 49;
+          const float *filter_ptr0 = filter + mm * in_channels * 49 + c * 49;
 #if defined(MACE_ENABLE_NEON)
-          const float *filter_ptr1 =
-              filter + (m + 1) * in_channels * 49 + c * 49;
-          const float *filter_ptr2 =
-              filter + (m + 2) * in_channels * 49 + c * 49;
-          const float *filter_ptr3 =
-              filter + (m + 3) * in_channels * 49 + c * 49;
           for (index_t h = 0; h < out_height; ++h) {
             for (index_t w = 0; w + 3 < out_width; w += 4) {
               // input offset
               index_t in_h = h * 2;
               index_t in_w = w * 2;
               index_t in_offset = in_h * in_width + in_w;
-              // output (4 outch x 1 height x 4 width): vo_outch_height
-              float32x4_t vo0, vo1, vo2, vo3;
-              // load output
+              // output (1 outch x 1 height x 4 width): vo_outch_height
+              float32x4_t vo0;
+              // load ouput
               index_t out_offset = h * out_width + w;
               vo0 = vld1q_f32(out_ptr0_base + out_offset);
-              vo1 = vld1q_f32(out_ptr1_base + out_offset);
-              vo2 = vld1q_f32(out_ptr2_base + out_offset);
-              vo3 = vld1q_f32(out_ptr3_base + out_offset);
               for (index_t r = 0; r < 7; ++r) {
                 // input (3 slide)
                 float32x4x2_t vvi0, vvi1;  // to de-interleave
@@ -380,97 +447,27 @@ void Conv2dNeonK7x7S2(const float *input,
                 vi6 = vextq_f32(vi0, vvi1.val[0], 3);  // [6.8.10.12]
 
 #if defined(__aarch64__)
-                MACE_Conv2dArmv8NeonK7x7SnLoadCalc4;
+                MACE_Conv2dArmv8NeonK7x7SnLoadCalc1;
 #else
-                MACE_Conv2dArmv7NeonK7x7SnLoadCalc4;
+                MACE_Conv2dArmv7NeonK7x7SnLoadCalc1;
 #endif
 
                 in_offset += in_width;
                 filter_ptr0 += 7;
-                filter_ptr1 += 7;
-                filter_ptr2 += 7;
-                filter_ptr3 += 7;
               }  // r
 
               vst1q_f32(out_ptr0_base + out_offset, vo0);
-              vst1q_f32(out_ptr1_base + out_offset, vo1);
-              vst1q_f32(out_ptr2_base + out_offset, vo2);
-              vst1q_f32(out_ptr3_base + out_offset, vo3);
-
               filter_ptr0 -= 49;
-              filter_ptr1 -= 49;
-              filter_ptr2 -= 49;
-              filter_ptr3 -= 49;
             }  // w
           }    // h
 #else
-          for (index_t oc = 0; oc < 4; ++oc) {
-            Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0 + oc * in_channels * 49,
-                               in_width, 7, 7, out_height, out_width,
-                               out_ptr0_base + oc * out_image_size, 2);
-          }
+          Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0, in_width, 7, 7,
+                             out_height, out_width, out_ptr0_base, 2);
 #endif
         }  // c
-      } else {
-        for (index_t mm = m; mm < out_channels; ++mm) {
-          float *out_ptr0_base =
-              output + b * out_batch_size + mm * out_image_size;
-          for (index_t c = 0; c < in_channels; ++c) {
-            const float *in_ptr_base =
-                input + b * in_batch_size + c * in_image_size;
-            const float *filter_ptr0 = filter + mm * in_channels * 49 + c * 49;
-#if defined(MACE_ENABLE_NEON)
-            for (index_t h = 0; h < out_height; ++h) {
-              for (index_t w = 0; w + 3 < out_width; w += 4) {
-                // input offset
-                index_t in_h = h * 2;
-                index_t in_w = w * 2;
-                index_t in_offset = in_h * in_width + in_w;
-                // output (1 outch x 1 height x 4 width): vo_outch_height
-                float32x4_t vo0;
-                // load ouput
-                index_t out_offset = h * out_width + w;
-                vo0 = vld1q_f32(out_ptr0_base + out_offset);
-                for (index_t r = 0; r < 7; ++r) {
-                  // input (3 slide)
-                  float32x4x2_t vvi0, vvi1;  // to de-interleave
-                  float32x4_t vi0, vi1, vi2, vi3, vi4, vi5, vi6;
-                  // load input
-                  // [0.2.4.6, 1.3.5.7]
-                  vvi0 = vld2q_f32(in_ptr_base + in_offset);
-                  // [8.10.12.14, 9.11.13.15]
-                  vvi1 = vld2q_f32(in_ptr_base + in_offset + 8);
-                  vi0 = vvi0.val[0];                     // [0.2.4.6]
-                  vi1 = vvi0.val[1];                     // [1.3.5.7]
-                  vi2 = vextq_f32(vi0, vvi1.val[0], 1);  // [2.4.6.8]
-                  vi3 = vextq_f32(vi1, vvi1.val[1], 1);  // [3.5.7.9]
-                  vi4 = vextq_f32(vi0, vvi1.val[0], 2);  // [4.6.8.10]
-                  vi5 = vextq_f32(vi1, vvi1.val[1], 2);  // [5.7.9.11]
-                  vi6 = vextq_f32(vi0, vvi1.val[0], 3);  // [6.8.10.12]
-
-#if defined(__aarch64__)
-                  MACE_Conv2dArmv8NeonK7x7SnLoadCalc1;
-#else
-                  MACE_Conv2dArmv7NeonK7x7SnLoadCalc1;
-#endif
-
-                  in_offset += in_width;
-                  filter_ptr0 += 7;
-                }  // r
-
-                vst1q_f32(out_ptr0_base + out_offset, vo0);
-                filter_ptr0 -= 49;
-              }  // w
-            }    // h
-#else
-            Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0, in_width, 7, 7,
-                               out_height, out_width, out_ptr0_base, 2);
-#endif
-          }  // c
-        }    // mm
-      }      // if
-    }        // m
-  }          // b
+      }    // mm
+    }      // if
+  });          // b
 }
 
 // Ho = 1, Wo = 4, Co = 4
@@ -484,49 +481,117 @@ void Conv2dNeonK7x7S3(const float *input,
   const index_t in_batch_size = in_shape[1] * in_image_size;
   const index_t out_batch_size = out_shape[1] * out_image_size;
 
-#pragma omp parallel for collapse(2)
-  for (index_t b = 0; b < out_shape[0]; ++b) {
-    for (index_t m = 0; m < out_shape[1]; m += 4) {
-      const index_t out_channels = out_shape[1];
-      const index_t out_height = out_shape[2];
-      const index_t out_width = out_shape[3];
-      const index_t in_channels = in_shape[1];
-      const index_t in_width = in_shape[3];
-      if (m + 3 < out_channels) {
-        float *out_ptr0_base = output + b * out_batch_size + m * out_image_size;
+  ParallelFor2D(0, out_shape[0], 1, 0, out_shape[1], 4,
+                [&](index_t b, index_t m) {
+    const index_t out_channels = out_shape[1];
+    const index_t out_height = out_shape[2];
+    const index_t out_width = out_shape[3];
+    const index_t in_channels = in_shape[1];
+    const index_t in_width = in_shape[3];
+    if (m + 3 < out_channels) {
+      float *out_ptr0_base = output + b * out_batch_size + m * out_image_size;
+#if defined(MACE_ENABLE_NEON)
+      float *out_ptr1_base =
+          output + b * out_batch_size + (m + 1) * out_image_size;
+      float *out_ptr2_base =
+          output + b * out_batch_size + (m + 2) * out_image_size;
+      float *out_ptr3_base =
+          output + b * out_batch_size + (m + 3) * out_image_size;
+#endif
+      for (index_t c = 0; c < in_channels; ++c) {
+        const float *in_ptr_base =
+            input + b * in_batch_size + c * in_image_size;
+        const float *filter_ptr0 = filter + m * in_channels * 49 + c * 49;
 #if defined(MACE_ENABLE_NEON)
-        float *out_ptr1_base =
-            output + b * out_batch_size + (m + 1) * out_image_size;
-        float *out_ptr2_base =
-            output + b * out_batch_size + (m + 2) * out_image_size;
-        float *out_ptr3_base =
-            output + b * out_batch_size + (m + 3) * out_image_size;
+        const float *filter_ptr1 =
+            filter + (m + 1) * in_channels * 49 + c * 49;
+        const float *filter_ptr2 =
+            filter + (m + 2) * in_channels * 49 + c * 49;
+        const float *filter_ptr3 =
+            filter + (m + 3) * in_channels * 49 + c * 49;
+        for (index_t h = 0; h < out_height; ++h) {
+          for (index_t w = 0; w + 3 < out_width; w += 4) {
+            // input offset
+            index_t in_h = h * 3;
+            index_t in_w = w * 3;
+            index_t in_offset = in_h * in_width + in_w;
+            // output (4 outch x 1 height x 4 width): vo_outch_height
+            float32x4_t vo0, vo1, vo2, vo3;
+            // load output
+            index_t out_offset = h * out_width + w;
+            vo0 = vld1q_f32(out_ptr0_base + out_offset);
+            vo1 = vld1q_f32(out_ptr1_base + out_offset);
+            vo2 = vld1q_f32(out_ptr2_base + out_offset);
+            vo3 = vld1q_f32(out_ptr3_base + out_offset);
+            for (index_t r = 0; r < 7; ++r) {
+              // input (3 slide)
+              float32x4x3_t vvi0, vvi1;  // to de-interleave
+              float32x4_t vi0, vi1, vi2, vi3, vi4, vi5, vi6;
+              // load input
+              // [0.3.6.9, 1.4.7.10, 2.5.8.11]
+              vvi0 = vld3q_f32(in_ptr_base + in_offset);
+              // [12.15.xx.xx, 13.xx.xx.xx, 14.xx.xx.xx]
+              vvi1 = vld3q_f32(in_ptr_base + in_offset + 12);
+              vi0 = vvi0.val[0];                     // [0.3.6.9]
+              vi1 = vvi0.val[1];                     // [1.4.7.10]
+              vi2 = vvi0.val[2];                     // [2.5.8.11]
+              vi3 = vextq_f32(vi0, vvi1.val[0], 1);  // [3.6.9.12]
+              vi4 = vextq_f32(vi1, vvi1.val[1], 1);  // [4.7.10.13]
+              vi5 = vextq_f32(vi2, vvi1.val[2], 1);  // [5.8.11.14]
+              vi6 = vextq_f32(vi0, vvi1.val[0], 2);  // [6.9.12.15]
+
+#if defined(__aarch64__)
+              MACE_Conv2dArmv8NeonK7x7SnLoadCalc4;
+#else
+              MACE_Conv2dArmv7NeonK7x7SnLoadCalc4;
 #endif
+
+              in_offset += in_width;
+              filter_ptr0 += 7;
+              filter_ptr1 += 7;
+              filter_ptr2 += 7;
+              filter_ptr3 += 7;
+            }  // r
+
+            vst1q_f32(out_ptr0_base + out_offset, vo0);
+            vst1q_f32(out_ptr1_base + out_offset, vo1);
+            vst1q_f32(out_ptr2_base + out_offset, vo2);
+            vst1q_f32(out_ptr3_base + out_offset, vo3);
+
+            filter_ptr0 -= 49;
+            filter_ptr1 -= 49;
+            filter_ptr2 -= 49;
+            filter_ptr3 -= 49;
+          }  // w
+        }    // h
+#else
+        for (index_t oc = 0; oc < 4; ++oc) {
+          Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0 + oc * in_channels * 49,
+                             in_width, 7, 7, out_height, out_width,
+                             out_ptr0_base + oc * out_image_size, 3);
+        }
+#endif
+      }  // c
+    } else {
+      for (index_t mm = m; mm < out_channels; ++mm) {
+        float *out_ptr0_base =
+            output + b * out_batch_size + mm * out_image_size;
         for (index_t c = 0; c < in_channels; ++c) {
           const float *in_ptr_base =
               input + b * in_batch_size + c * in_image_size;
-          const float *filter_ptr0 = filter + m * in_channels * 49 + c * 49;
+          const float *filter_ptr0 = filter + mm * in_channels * 49 + c * 49;
 #if defined(MACE_ENABLE_NEON)
-          const float *filter_ptr1 =
-              filter + (m + 1) * in_channels * 49 + c * 49;
-          const float *filter_ptr2 =
-              filter + (m + 2) * in_channels * 49 + c * 49;
-          const float *filter_ptr3 =
-              filter + (m + 3) * in_channels * 49 + c * 49;
           for (index_t h = 0; h < out_height; ++h) {
             for (index_t w = 0; w + 3 < out_width; w += 4) {
               // input offset
               index_t in_h = h * 3;
               index_t in_w = w * 3;
               index_t in_offset = in_h * in_width + in_w;
-              // output (4 outch x 1 height x 4 width): vo_outch_height
-              float32x4_t vo0, vo1, vo2, vo3;
+              // output (1 outch x 1 height x 4 width): vo_outch_height
+              float32x4_t vo0;
               // load output
               index_t out_offset = h * out_width + w;
               vo0 = vld1q_f32(out_ptr0_base + out_offset);
-              vo1 = vld1q_f32(out_ptr1_base + out_offset);
-              vo2 = vld1q_f32(out_ptr2_base + out_offset);
-              vo3 = vld1q_f32(out_ptr3_base + out_offset);
               for (index_t r = 0; r < 7; ++r) {
                 // input (3 slide)
                 float32x4x3_t vvi0, vvi1;  // to de-interleave
@@ -545,97 +610,27 @@ void Conv2dNeonK7x7S3(const float *input,
                 vi6 = vextq_f32(vi0, vvi1.val[0], 2);  // [6.9.12.15]
 
 #if defined(__aarch64__)
-                MACE_Conv2dArmv8NeonK7x7SnLoadCalc4;
+                MACE_Conv2dArmv8NeonK7x7SnLoadCalc1;
 #else
-                MACE_Conv2dArmv7NeonK7x7SnLoadCalc4;
+                MACE_Conv2dArmv7NeonK7x7SnLoadCalc1;
 #endif
 
                 in_offset += in_width;
                 filter_ptr0 += 7;
-                filter_ptr1 += 7;
-                filter_ptr2 += 7;
-                filter_ptr3 += 7;
               }  // r
 
               vst1q_f32(out_ptr0_base + out_offset, vo0);
-              vst1q_f32(out_ptr1_base + out_offset, vo1);
-              vst1q_f32(out_ptr2_base + out_offset, vo2);
-              vst1q_f32(out_ptr3_base + out_offset, vo3);
-
               filter_ptr0 -= 49;
-              filter_ptr1 -= 49;
-              filter_ptr2 -= 49;
-              filter_ptr3 -= 49;
             }  // w
           }    // h
 #else
-          for (index_t oc = 0; oc < 4; ++oc) {
-            Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0 + oc * in_channels * 49,
-                               in_width, 7, 7, out_height, out_width,
-                               out_ptr0_base + oc * out_image_size, 3);
-          }
+          Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0, in_width, 7, 7,
+                             out_height, out_width, out_ptr0_base, 3);
 #endif
         }  // c
-      } else {
-        for (index_t mm = m; mm < out_channels; ++mm) {
-          float *out_ptr0_base =
-              output + b * out_batch_size + mm * out_image_size;
-          for (index_t c = 0; c < in_channels; ++c) {
-            const float *in_ptr_base =
-                input + b * in_batch_size + c * in_image_size;
-            const float *filter_ptr0 = filter + mm * in_channels * 49 + c * 49;
-#if defined(MACE_ENABLE_NEON)
-            for (index_t h = 0; h < out_height; ++h) {
-              for (index_t w = 0; w + 3 < out_width; w += 4) {
-                // input offset
-                index_t in_h = h * 3;
-                index_t in_w = w * 3;
-                index_t in_offset = in_h * in_width + in_w;
-                // output (1 outch x 1 height x 4 width): vo_outch_height
-                float32x4_t vo0;
-                // load output
-                index_t out_offset = h * out_width + w;
-                vo0 = vld1q_f32(out_ptr0_base + out_offset);
-                for (index_t r = 0; r < 7; ++r) {
-                  // input (3 slide)
-                  float32x4x3_t vvi0, vvi1;  // to de-interleave
-                  float32x4_t vi0, vi1, vi2, vi3, vi4, vi5, vi6;
-                  // load input
-                  // [0.3.6.9, 1.4.7.10, 2.5.8.11]
-                  vvi0 = vld3q_f32(in_ptr_base + in_offset);
-                  // [12.15.xx.xx, 13.xx.xx.xx, 14.xx.xx.xx]
-                  vvi1 = vld3q_f32(in_ptr_base + in_offset + 12);
-                  vi0 = vvi0.val[0];                     // [0.3.6.9]
-                  vi1 = vvi0.val[1];                     // [1.4.7.10]
-                  vi2 = vvi0.val[2];                     // [2.5.8.11]
-                  vi3 = vextq_f32(vi0, vvi1.val[0], 1);  // [3.6.9.12]
-                  vi4 = vextq_f32(vi1, vvi1.val[1], 1);  // [4.7.10.13]
-                  vi5 = vextq_f32(vi2, vvi1.val[2], 1);  // [5.8.11.14]
-                  vi6 = vextq_f32(vi0, vvi1.val[0], 2);  // [6.9.12.15]
-
-#if defined(__aarch64__)
-                  MACE_Conv2dArmv8NeonK7x7SnLoadCalc1;
-#else
-                  MACE_Conv2dArmv7NeonK7x7SnLoadCalc1;
-#endif
-
-                  in_offset += in_width;
-                  filter_ptr0 += 7;
-                }  // r
-
-                vst1q_f32(out_ptr0_base + out_offset, vo0);
-                filter_ptr0 -= 49;
-              }  // w
-            }    // h
-#else
-            Conv2dCPUKHxKWCalc(in_ptr_base, filter_ptr0, in_width, 7, 7,
-                               out_height, out_width, out_ptr0_base, 3);
-#endif
-          }  // c
-        }    // mm
-      }      // if
-    }        // m
-  }          // b
+      }    // mm
+    }      // if
+  });          // b
 }
 
 }  // namespace kernels
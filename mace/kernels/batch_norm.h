@@ -22,6 +22,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/activation.h"
 #include "mace/public/mace.h"
@@ -84,11 +85,10 @@ struct BatchNormFunctor<DeviceType::CPU, float> : OpKernel {
       Tensor::MappingGuard var_mapper(var);
       const float *mean_ptr = mean->data<float>();
       const float *var_ptr = var->data<float>();
-#pragma omp parallel for
-      for (index_t c = 0; c < channels; ++c) {
+      ParallelFor(0, channels, [&](index_t c) {
         new_scale[c] = scale_ptr[c] / std::sqrt(var_ptr[c] + epsilon);
         new_offset[c] = offset_ptr[c] - mean_ptr[c] * new_scale[c];
-      }
+      });
     }
 
     const float *scale_data = folded_constant_ ? scale_ptr : new_scale.data();
@@ -99,16 +99,13 @@ struct BatchNormFunctor<DeviceType::CPU, float> : OpKernel {
     index_t batch_size = channels * channel_size;
 
     // NEON is slower, so stick to the trivial implementaion
-#pragma omp parallel for collapse(2)
-    for (index_t b = 0; b < batch; ++b) {
-      for (index_t c = 0; c < channels; ++c) {
-        index_t offset = b * batch_size + c * channel_size;
-        for (index_t hw = 0; hw < height * width; ++hw) {
-          output_ptr[offset + hw] =
-            scale_data[c] * input_ptr[offset + hw] + offset_data[c];
-        }
+    ParallelFor2D(0, batch, 0, channels, [&](index_t b, index_t c) {
+      index_t offset = b * batch_size + c * channel_size;
+      for (index_t hw = 0; hw < height * width; ++hw) {
+        output_ptr[offset + hw] =
+          scale_data[c] * input_ptr[offset + hw] + offset_data[c];
       }
-    }
+    });
     DoActivation(output_ptr, output_ptr, output->size(), activation_,
                  relux_max_limit_);
 
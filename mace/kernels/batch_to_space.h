@@ -20,6 +20,7 @@
 #include <algorithm>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 #include "mace/public/mace.h"
@@ -130,52 +131,47 @@ struct BatchToSpaceFunctor<DeviceType::CPU, float> : BatchToSpaceFunctorBase {
         std::max(static_cast<index_t>(1), 8 * 1024 / block_shape_w / out_width);
 
     // make channel outter loop so we can make best use of cache
-#pragma omp parallel for collapse(3)
-    for (index_t c = 0; c < channels; ++c) {
-      for (index_t block_h = 0; block_h < in_height;
-           block_h += block_h_size) {
-        for (index_t in_b = 0; in_b < in_batches; ++in_b) {
-          const index_t b = in_b % out_batches;
-          const index_t tile_index = in_b / out_batches;
-          const index_t tile_h = tile_index / block_shape_w;
-          const index_t tile_w = tile_index % block_shape_w;
-          const index_t valid_h_start = std::max(block_h,
-                                                 (pad_top - tile_h
-                                                     + block_shape_h - 1)
-                                                     / block_shape_h);
-          const index_t valid_h_end = std::min(in_height,
-                                               std::min(
-                                                   block_h + block_h_size,
-                                                   (out_height + pad_top
-                                                       - tile_h
-                                                       + block_shape_h - 1)
-                                                       / block_shape_h));
-          const index_t valid_w_start = std::max(static_cast<index_t>(0),
-                                                 (pad_left - tile_w
-                                                     + block_shape_w - 1)
-                                                     / block_shape_w);
-          const index_t valid_w_end = std::min(in_width,
-                                               (out_width + pad_left - tile_w
-                                                   + block_shape_w - 1)
-                                                   / block_shape_w);
-          const float *input_base =
-              input_data + (in_b * channels + c) * in_height * in_width;
-          float *output_base =
-              output_data + (b * channels + c) * out_height * out_width;
-
-          index_t h = valid_h_start * block_shape_h + tile_h - pad_top;
-          for (index_t in_h = valid_h_start; in_h < valid_h_end; ++in_h) {
-            index_t w = valid_w_start * block_shape_w + tile_w - pad_left;
-            for (index_t in_w = valid_w_start; in_w < valid_w_end; ++in_w) {
-              output_base[h * out_width + w] =
-                  input_base[in_h * in_width + in_w];
-              w += block_shape_w;
-            }  // w
-            h += block_shape_h;
-          }  // h
-        }  // b
-      }  // block_h
-    }  // c
+    ParallelFor3D(0, channels, 1, 0, in_height, block_h_size, 0, in_batches, 1,
+                  [&](index_t c, index_t block_h, index_t in_b) {
+      const index_t b = in_b % out_batches;
+      const index_t tile_index = in_b / out_batches;
+      const index_t tile_h = tile_index / block_shape_w;
+      const index_t tile_w = tile_index % block_shape_w;
+      const index_t valid_h_start = std::max(block_h,
+                                             (pad_top - tile_h
+                                                 + block_shape_h - 1)
+                                                 / block_shape_h);
+      const index_t valid_h_end = std::min(in_height,
+                                           std::min(
+                                               block_h + block_h_size,
+                                               (out_height + pad_top
+                                                   - tile_h
+                                                   + block_shape_h - 1)
+                                                   / block_shape_h));
+      const index_t valid_w_start = std::max(static_cast<index_t>(0),
+                                             (pad_left - tile_w
+                                                 + block_shape_w - 1)
+                                                 / block_shape_w);
+      const index_t valid_w_end = std::min(in_width,
+                                           (out_width + pad_left - tile_w
+                                               + block_shape_w - 1)
+                                               / block_shape_w);
+      const float *input_base =
+          input_data + (in_b * channels + c) * in_height * in_width;
+      float *output_base =
+          output_data + (b * channels + c) * out_height * out_width;
+
+      index_t h = valid_h_start * block_shape_h + tile_h - pad_top;
+      for (index_t in_h = valid_h_start; in_h < valid_h_end; ++in_h) {
+        index_t w = valid_w_start * block_shape_w + tile_w - pad_left;
+        for (index_t in_w = valid_w_start; in_w < valid_w_end; ++in_w) {
+          output_base[h * out_width + w] =
+              input_base[in_h * in_width + in_w];
+          w += block_shape_w;
+        }  // w
+        h += block_shape_h;
+      }  // h
+    });  // c
 
     return MACE_SUCCESS;
   }
@@ -222,8 +218,7 @@ struct BatchToSpaceFunctor<CPU, uint8_t> : BatchToSpaceFunctorBase {
     index_t out_width = space_tensor->dim(2);
     index_t channels = space_tensor->dim(3);
 
-#pragma omp parallel for
-    for (index_t in_b = 0; in_b < in_batches; ++in_b) {
+    ParallelFor(0, in_batches, [&](index_t in_b) {
       const index_t b = in_b % out_batches;
       const index_t tile_index = in_b / out_batches;
       const index_t tile_h = tile_index / block_shape_w;
@@ -262,7 +257,7 @@ struct BatchToSpaceFunctor<CPU, uint8_t> : BatchToSpaceFunctorBase {
         }  // w
         h += block_shape_h;
       }  // h
-    }  // b
+    });  // b
 
     return MACE_SUCCESS;
   }
@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 #include "mace/public/mace.h"
@@ -63,28 +64,24 @@ struct BiasAddFunctor<DeviceType::CPU, float> : BiasAddFunctorBase {
       const index_t channels = input->dim(1);
       const index_t height_width = input->dim(2) * input->dim(3);
 
-#pragma omp parallel for collapse(2)
-      for (index_t n = 0; n < batch; ++n) {
-        for (index_t c = 0; c < channels; ++c) {
-          for (index_t hw = 0; hw < height_width; ++hw) {
-            index_t pos = (n * channels + c) * height_width + hw;
-            output_ptr[pos] = input_ptr[pos] + bias_ptr[c];
-          }
+      ParallelFor2D(0, batch, 0, channels, [&](index_t n, index_t c) {
+        for (index_t hw = 0; hw < height_width; ++hw) {
+          index_t pos = (n * channels + c) * height_width + hw;
+          output_ptr[pos] = input_ptr[pos] + bias_ptr[c];
         }
-      }
+      });
     } else {
       const std::vector<index_t> &shape = input->shape();
       const index_t fused_batch = std::accumulate(
           shape.begin(), shape.end() - 1, 1, std::multiplies<index_t>());
       const index_t channels = *shape.rbegin();
-#pragma omp parallel for
-      for (index_t n = 0; n < fused_batch; ++n) {
+      ParallelFor(0, fused_batch, [&](index_t n) {
         index_t pos = n * channels;
         for (index_t c = 0; c < channels; ++c) {
           output_ptr[pos] = input_ptr[pos] + bias_ptr[c];
           ++pos;
         }
-      }
+      });
     }
 
     return MACE_SUCCESS;
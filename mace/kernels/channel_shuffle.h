@@ -19,6 +19,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 
@@ -50,19 +51,16 @@ struct ChannelShuffleFunctor : OpKernel {
     index_t batch_size = channels * image_size;
     index_t channels_per_group = channels / groups_;
 
-#pragma omp parallel for collapse(2)
-    for (index_t b = 0; b < batch; ++b) {
-      for (index_t c = 0; c < channels; ++c) {
-        const T *input_base = input_ptr + b * batch_size;
-        T *output_base = output_ptr + b * batch_size;
-        index_t g = c % groups_;
-        index_t idx = c / groups_;
-        for (index_t hw = 0; hw < height * width; ++hw) {
-          output_base[c * image_size + hw] = input_base[
-              (g * channels_per_group + idx) * image_size + hw];
-        }
+    ParallelFor2D(0, batch, 0, channels, [&](index_t b, index_t c) {
+      const T *input_base = input_ptr + b * batch_size;
+      T *output_base = output_ptr + b * batch_size;
+      index_t g = c % groups_;
+      index_t idx = c / groups_;
+      for (index_t hw = 0; hw < height * width; ++hw) {
+        output_base[c * image_size + hw] = input_base[
+            (g * channels_per_group + idx) * image_size + hw];
       }
-    }
+    });
 
     return MACE_SUCCESS;
   }
@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/activation.h"
 #include "mace/kernels/conv_pool_2d_util.h"
@@ -97,49 +98,134 @@ struct Conv2dFunctor<DeviceType::CPU, float> : Conv2dFunctorBase {
     const index_t out_batch_size = filter_shape[0] * out_image_size;
     const index_t filter_size = filter_shape[2] * filter_shape[3];
 
-#pragma omp parallel for collapse(2)
-    for (index_t b = 0; b < in_shape[0]; b++) {
-      for (index_t m = 0; m < filter_shape[0]; m += 4) {
-        const index_t in_width = in_shape[3];
-        const index_t out_height = out_shape[2];
-        const index_t out_width = out_shape[3];
-        const index_t out_channels = filter_shape[0];
-        const index_t in_channels = filter_shape[1];
-
-        const int stride_h = stride_hw[0];
-        const int stride_w = stride_hw[1];
-        const int dilation_h = dilation_hw[0];
-        const int dilation_w = dilation_hw[1];
-        if (m + 3 < out_channels) {
+    ParallelFor2D(0, in_shape[0], 1, 0, filter_shape[0], 4,
+                  [&](index_t b, index_t m) {
+      const index_t in_width = in_shape[3];
+      const index_t out_height = out_shape[2];
+      const index_t out_width = out_shape[3];
+      const index_t out_channels = filter_shape[0];
+      const index_t in_channels = filter_shape[1];
+
+      const int stride_h = stride_hw[0];
+      const int stride_w = stride_hw[1];
+      const int dilation_h = dilation_hw[0];
+      const int dilation_w = dilation_hw[1];
+      if (m + 3 < out_channels) {
+        float *out_ptr0_base =
+            output + b * out_batch_size + m * out_image_size;
+        float *out_ptr1_base = out_ptr0_base + out_image_size;
+        float *out_ptr2_base = out_ptr1_base + out_image_size;
+        float *out_ptr3_base = out_ptr2_base + out_image_size;
+        for (index_t c = 0; c < in_channels; ++c) {
+          const float *in_ptr_base =
+              input + b * in_batch_size + c * in_image_size;
+          const float *filter_ptr0 =
+              filter + m * in_channels * filter_size + c * filter_size;
+          const float *filter_ptr1 = filter_ptr0 + in_channels * filter_size;
+          const float *filter_ptr2 = filter_ptr1 + in_channels * filter_size;
+          const float *filter_ptr3 = filter_ptr2 + in_channels * filter_size;
+          for (index_t h = 0; h < out_height; ++h) {
+            for (index_t w = 0; w + 3 < out_width; w += 4) {
+               // input offset
+              index_t ih = h * stride_h;
+              index_t iw = w * stride_w;
+              index_t in_offset = ih * in_width + iw;
+              // output (4 outch x 1 height x 4 width): vo_outch_height
+              float vo0[4], vo1[4], vo2[4], vo3[4];
+              // load output
+              index_t out_offset = h * out_width + w;
+              for (index_t ow = 0; ow < 4; ++ow) {
+                 vo0[ow] = out_ptr0_base[out_offset + ow];
+                 vo1[ow] = out_ptr1_base[out_offset + ow];
+                 vo2[ow] = out_ptr2_base[out_offset + ow];
+                 vo3[ow] = out_ptr3_base[out_offset + ow];
+              }
+              // calc by row
+              for (index_t kh = 0; kh < filter_shape[2]; ++kh) {
+                for (index_t kw = 0; kw < filter_shape[3]; ++kw) {
+                  // outch 0
+                  vo0[0] += in_ptr_base[in_offset
+                      + kw * dilation_w] * filter_ptr0[kw];
+                  vo0[1] += in_ptr_base[in_offset + stride_w
+                      + kw * dilation_w] * filter_ptr0[kw];
+                  vo0[2] += in_ptr_base[in_offset + 2 * stride_w
+                      + kw * dilation_w] * filter_ptr0[kw];
+                  vo0[3] += in_ptr_base[in_offset + 3 * stride_w
+                      + kw * dilation_w] * filter_ptr0[kw];
+                  // outch 1
+                  vo1[0] += in_ptr_base[in_offset
+                      + kw * dilation_w] * filter_ptr1[kw];
+                  vo1[1] += in_ptr_base[in_offset + stride_w
+                      + kw * dilation_w] * filter_ptr1[kw];
+                  vo1[2] += in_ptr_base[in_offset + 2 * stride_w
+                      + kw * dilation_w] * filter_ptr1[kw];
+                  vo1[3] += in_ptr_base[in_offset + 3 * stride_w
+                      + kw * dilation_w] * filter_ptr1[kw];
+                  // outch 2
+                  vo2[0] += in_ptr_base[in_offset
+                      + kw * dilation_w] * filter_ptr2[kw];
+                  vo2[1] += in_ptr_base[in_offset + stride_w
+                      + kw * dilation_w] * filter_ptr2[kw];
+                  vo2[2] += in_ptr_base[in_offset + 2 * stride_w
+                      + kw * dilation_w] * filter_ptr2[kw];
+                  vo2[3] += in_ptr_base[in_offset + 3 * stride_w
+                      + kw * dilation_w] * filter_ptr2[kw];
+                  // outch 3
+                  vo3[0] += in_ptr_base[in_offset
+                      + kw * dilation_w] * filter_ptr3[kw];
+                  vo3[1] += in_ptr_base[in_offset + stride_w
+                      + kw * dilation_w] * filter_ptr3[kw];
+                  vo3[2] += in_ptr_base[in_offset + 2 * stride_w
+                      + kw * dilation_w] * filter_ptr3[kw];
+                  vo3[3] += in_ptr_base[in_offset + 3 * stride_w
+                      + kw * dilation_w] * filter_ptr3[kw];
+                }  // kw
+
+                in_offset += dilation_h * in_width;
+                filter_ptr0 += filter_shape[3];
+                filter_ptr1 += filter_shape[3];
+                filter_ptr2 += filter_shape[3];
+                filter_ptr3 += filter_shape[3];
+              }  // kh
+
+              for (index_t ow = 0; ow < 4; ++ow) {
+                out_ptr0_base[out_offset + ow] = vo0[ow];
+                out_ptr1_base[out_offset + ow] = vo1[ow];
+                out_ptr2_base[out_offset + ow] = vo2[ow];
+                out_ptr3_base[out_offset + ow] = vo3[ow];
+              }
+
+              filter_ptr0 -= filter_size;
+              filter_ptr1 -= filter_size;
+              filter_ptr2 -= filter_size;
+              filter_ptr3 -= filter_size;
+            }  // w
+          }  // h
+        }  // c
+      } else {
+        for (index_t mm = m; mm < out_channels; ++mm) {
           float *out_ptr0_base =
-              output + b * out_batch_size + m * out_image_size;
-          float *out_ptr1_base = out_ptr0_base + out_image_size;
-          float *out_ptr2_base = out_ptr1_base + out_image_size;
-          float *out_ptr3_base = out_ptr2_base + out_image_size;
+              output + b * out_batch_size + mm * out_image_size;
           for (index_t c = 0; c < in_channels; ++c) {
             const float *in_ptr_base =
                 input + b * in_batch_size + c * in_image_size;
             const float *filter_ptr0 =
-                filter + m * in_channels * filter_size + c * filter_size;
-            const float *filter_ptr1 = filter_ptr0 + in_channels * filter_size;
-            const float *filter_ptr2 = filter_ptr1 + in_channels * filter_size;
-            const float *filter_ptr3 = filter_ptr2 + in_channels * filter_size;
+                filter + mm * in_channels * filter_size + c * filter_size;
+
             for (index_t h = 0; h < out_height; ++h) {
               for (index_t w = 0; w + 3 < out_width; w += 4) {
-                 // input offset
+                // input offset
                 index_t ih = h * stride_h;
                 index_t iw = w * stride_w;
                 index_t in_offset = ih * in_width + iw;
-                // output (4 outch x 1 height x 4 width): vo_outch_height
-                float vo0[4], vo1[4], vo2[4], vo3[4];
+                // output (1 outch x 1 height x 4 width): vo_outch_height
+                float vo0[4];
                 // load output
                 index_t out_offset = h * out_width + w;
                 for (index_t ow = 0; ow < 4; ++ow) {
                    vo0[ow] = out_ptr0_base[out_offset + ow];
-                   vo1[ow] = out_ptr1_base[out_offset + ow];
-                   vo2[ow] = out_ptr2_base[out_offset + ow];
-                   vo3[ow] = out_ptr3_base[out_offset + ow];
                 }
+
                 // calc by row
                 for (index_t kh = 0; kh < filter_shape[2]; ++kh) {
                   for (index_t kw = 0; kw < filter_shape[3]; ++kw) {
@@ -152,109 +238,22 @@ struct Conv2dFunctor<DeviceType::CPU, float> : Conv2dFunctorBase {
                         + kw * dilation_w] * filter_ptr0[kw];
                     vo0[3] += in_ptr_base[in_offset + 3 * stride_w
                         + kw * dilation_w] * filter_ptr0[kw];
-                    // outch 1
-                    vo1[0] += in_ptr_base[in_offset
-                        + kw * dilation_w] * filter_ptr1[kw];
-                    vo1[1] += in_ptr_base[in_offset + stride_w
-                        + kw * dilation_w] * filter_ptr1[kw];
-                    vo1[2] += in_ptr_base[in_offset + 2 * stride_w
-                        + kw * dilation_w] * filter_ptr1[kw];
-                    vo1[3] += in_ptr_base[in_offset + 3 * stride_w
-                        + kw * dilation_w] * filter_ptr1[kw];
-                    // outch 2
-                    vo2[0] += in_ptr_base[in_offset
-                        + kw * dilation_w] * filter_ptr2[kw];
-                    vo2[1] += in_ptr_base[in_offset + stride_w
-                        + kw * dilation_w] * filter_ptr2[kw];
-                    vo2[2] += in_ptr_base[in_offset + 2 * stride_w
-                        + kw * dilation_w] * filter_ptr2[kw];
-                    vo2[3] += in_ptr_base[in_offset + 3 * stride_w
-                        + kw * dilation_w] * filter_ptr2[kw];
-                    // outch 3
-                    vo3[0] += in_ptr_base[in_offset
-                        + kw * dilation_w] * filter_ptr3[kw];
-                    vo3[1] += in_ptr_base[in_offset + stride_w
-                        + kw * dilation_w] * filter_ptr3[kw];
-                    vo3[2] += in_ptr_base[in_offset + 2 * stride_w
-                        + kw * dilation_w] * filter_ptr3[kw];
-                    vo3[3] += in_ptr_base[in_offset + 3 * stride_w
-                        + kw * dilation_w] * filter_ptr3[kw];
                   }  // kw
 
                   in_offset += dilation_h * in_width;
                   filter_ptr0 += filter_shape[3];
-                  filter_ptr1 += filter_shape[3];
-                  filter_ptr2 += filter_shape[3];
-                  filter_ptr3 += filter_shape[3];
                 }  // kh
 
                 for (index_t ow = 0; ow < 4; ++ow) {
                   out_ptr0_base[out_offset + ow] = vo0[ow];
-                  out_ptr1_base[out_offset + ow] = vo1[ow];
-                  out_ptr2_base[out_offset + ow] = vo2[ow];
-                  out_ptr3_base[out_offset + ow] = vo3[ow];
                 }
-
                 filter_ptr0 -= filter_size;
-                filter_ptr1 -= filter_size;
-                filter_ptr2 -= filter_size;
-                filter_ptr3 -= filter_size;
               }  // w
             }  // h
           }  // c
-        } else {
-          for (index_t mm = m; mm < out_channels; ++mm) {
-            float *out_ptr0_base =
-                output + b * out_batch_size + mm * out_image_size;
-            for (index_t c = 0; c < in_channels; ++c) {
-              const float *in_ptr_base =
-                  input + b * in_batch_size + c * in_image_size;
-              const float *filter_ptr0 =
-                  filter + mm * in_channels * filter_size + c * filter_size;
-
-              for (index_t h = 0; h < out_height; ++h) {
-                for (index_t w = 0; w + 3 < out_width; w += 4) {
-                  // input offset
-                  index_t ih = h * stride_h;
-                  index_t iw = w * stride_w;
-                  index_t in_offset = ih * in_width + iw;
-                  // output (1 outch x 1 height x 4 width): vo_outch_height
-                  float vo0[4];
-                  // load output
-                  index_t out_offset = h * out_width + w;
-                  for (index_t ow = 0; ow < 4; ++ow) {
-                     vo0[ow] = out_ptr0_base[out_offset + ow];
-                  }
-
-                  // calc by row
-                  for (index_t kh = 0; kh < filter_shape[2]; ++kh) {
-                    for (index_t kw = 0; kw < filter_shape[3]; ++kw) {
-                      // outch 0
-                      vo0[0] += in_ptr_base[in_offset
-                          + kw * dilation_w] * filter_ptr0[kw];
-                      vo0[1] += in_ptr_base[in_offset + stride_w
-                          + kw * dilation_w] * filter_ptr0[kw];
-                      vo0[2] += in_ptr_base[in_offset + 2 * stride_w
-                          + kw * dilation_w] * filter_ptr0[kw];
-                      vo0[3] += in_ptr_base[in_offset + 3 * stride_w
-                          + kw * dilation_w] * filter_ptr0[kw];
-                    }  // kw
-
-                    in_offset += dilation_h * in_width;
-                    filter_ptr0 += filter_shape[3];
-                  }  // kh
-
-                  for (index_t ow = 0; ow < 4; ++ow) {
-                    out_ptr0_base[out_offset + ow] = vo0[ow];
-                  }
-                  filter_ptr0 -= filter_size;
-                }  // w
-              }  // h
-            }  // c
-          }  // mm
-        }  // if
-      }  // m
-    }  // b
+        }  // mm
+      }  // if
+    });  // b
   }
 
   MaceStatus operator()(const Tensor *input,   // NCHW
@@ -262,6 +261,17 @@ struct Conv2dFunctor<DeviceType::CPU, float> : Conv2dFunctorBase {
                         const Tensor *bias,
                         Tensor *output,        // NCHW
                         StatsFuture *future) {
+    return (*this)(input, filter, bias, nullptr, output, future);
+  }
+
+  // Adds residual (NCHW, the shape of output) to the output before the
+  // activation, for the residual connections fused into the convolution.
+  MaceStatus operator()(const Tensor *input,     // NCHW
+                        const Tensor *filter,    // OIHW
+                        const Tensor *bias,
+                        const Tensor *residual,  // NCHW
+                        Tensor *output,          // NCHW
+                        StatsFuture *future) {
     MACE_UNUSED(future);
     MACE_CHECK_NOTNULL(input);
     MACE_CHECK_NOTNULL(filter);
@@ -331,11 +341,17 @@ struct Conv2dFunctor<DeviceType::CPU, float> : Conv2dFunctorBase {
     Tensor::MappingGuard input_guard(input);
     Tensor::MappingGuard filter_guard(filter);
     Tensor::MappingGuard bias_guard(bias);
+    Tensor::MappingGuard residual_guard(residual);
     Tensor::MappingGuard output_guard(output);
 
     auto filter_data = filter->data<float>();
     auto bias_data = bias == nullptr ? nullptr : bias->data<float>();
+    auto residual_data =
+        residual == nullptr ? nullptr : residual->data<float>();
     auto output_data = output->mutable_data<float>();
+    MACE_CHECK(residual == nullptr || residual->shape() == output->shape(),
+               "residual shape ", MakeString(residual->shape()),
+               " != output shape ", MakeString(output->shape()));
 
     std::function<void(const float *input, float *output)> conv_func;
 
@@ -681,33 +697,35 @@ struct Conv2dFunctor<DeviceType::CPU, float> : Conv2dFunctorBase {
 
     // unpack output
     if (extra_output_height != height || extra_output_width != width) {
-#pragma omp parallel for collapse(2)
-      for (index_t b = 0; b < batch; ++b) {
-        for (index_t c = 0; c < channels; ++c) {
-          for (index_t h = 0; h < height; ++h) {
-            memcpy(
-              output_data + b * channels * height * width + c * height * width
-                + h * width,
-              pad_output_data
-                + b * channels * extra_output_height * extra_output_width
-                + c * extra_output_height * extra_output_width
-                + h * extra_output_width,
-              sizeof(float) * width);
-          }
+      ParallelFor2D(0, batch, 0, channels, [&](index_t b, index_t c) {
+        for (index_t h = 0; h < height; ++h) {
+          memcpy(
+            output_data + b * channels * height * width + c * height * width
+              + h * width,
+            pad_output_data
+              + b * channels * extra_output_height * extra_output_width
+              + c * extra_output_height * extra_output_width
+              + h * extra_output_width,
+            sizeof(float) * width);
         }
-      }
+      });
     }
 
-    if (bias_data != nullptr) {
-#pragma omp parallel for collapse(2)
-      for (index_t b = 0; b < batch; ++b) {
-        for (index_t c = 0; c < channels; ++c) {
-          for (index_t i = 0; i < height * width; ++i) {
-            output_data[(b * channels + c) * height * width + i] +=
-              bias_data[c];
-          }
+    if (residual_data != nullptr) {
+      ParallelFor2D(0, batch, 0, channels, [&](index_t b, index_t c) {
+        const float bias_value = bias_data == nullptr ? 0.f : bias_data[c];
+        const index_t offset = (b * channels + c) * height * width;
+        for (index_t i = 0; i < height * width; ++i) {
+          output_data[offset + i] += bias_value + residual_data[offset + i];
         }
-      }
+      });
+    } else if (bias_data != nullptr) {
+      ParallelFor2D(0, batch, 0, channels, [&](index_t b, index_t c) {
+        for (index_t i = 0; i < height * width; ++i) {
+          output_data[(b * channels + c) * height * width + i] +=
+            bias_data[c];
+        }
+      });
     }
 
     DoActivation(output_data, output_data, output->size(), activation_,
@@ -747,77 +765,73 @@ struct Conv2dFunctor<DeviceType::CPU, uint8_t> : Conv2dFunctorBase {
     const index_t input_row_size = in_shape[2] * in_shape[3];
     const index_t patch_row_size = filter_w * in_shape[3];
 
-#pragma omp parallel for collapse(3)
-    for (index_t b = 0; b < out_shape[0]; ++b) {
-      for (index_t h = 0; h < out_shape[1]; ++h) {
-        for (index_t w = 0; w < out_shape[2]; ++w) {
-          // Reshape a patch of input to column, which is corresponding to
-          // a column of output(:, column).
-          const index_t ih_begin = h * stride_h - (pad_height >> 1);
-          const index_t ih_end = ih_begin + filter_h;
-          const index_t iw_begin = w * stride_w - (pad_width >> 1);
-          const index_t iw_end = iw_begin + filter_w;
-          // gate height and width to separate padding
-          const index_t ih_begin_gated = std::max<index_t>(0, ih_begin);
-          const index_t ih_end_gated = std::min<index_t>(ih_end, in_shape[1]);
-          const index_t iw_begin_gated = std::max<index_t>(0, iw_begin);
-          const index_t iw_end_gated = std::min<index_t>(iw_end, in_shape[2]);
-          const index_t pad_top = std::max<index_t>(0, -ih_begin);
-          const index_t pad_bottom = ih_end - ih_end_gated;
-          const index_t pad_left = std::max<index_t>(0, -iw_begin);
-          const index_t pad_right = iw_end - iw_end_gated;
-          index_t im2col_column_offset =
-              ((b * out_shape[1] + h) * out_shape[2] + w) * depth;
-
-          // fill in padding top
-          if (pad_top > 0) {
-            std::fill_n(im2col_data + im2col_column_offset,
-                        pad_top * patch_row_size, zero_point);
-          }
-
-          const index_t patch_row_size_gated =
-              std::min(filter_w - pad_left,
-                       in_shape[2] - iw_begin_gated) * in_shape[3];
-          MACE_CHECK(patch_row_size_gated ==
-              ((filter_w - (pad_left + pad_right)) * in_shape[3]));
-          const index_t pad_left_size = pad_left * in_shape[3];
-          const index_t pad_right_size = pad_right * in_shape[3];
-          index_t im2col_offset = im2col_column_offset +
-              (pad_top * filter_w + pad_left) * in_shape[3];
-          index_t in_offset = ((b * in_shape[1] + ih_begin_gated) * in_shape[2]
-              + iw_begin_gated) * in_shape[3];
-
-          // fill in effective rows
-          for (index_t ih = ih_begin_gated; ih < ih_end_gated; ++ih) {
-            // fill in padding left
-            if (pad_left > 0) {
-              const index_t left_offset = im2col_offset - pad_left_size;
-              std::fill_n(im2col_data + left_offset, pad_left_size, zero_point);
-            }
-            // copy effective data
-            std::copy_n(in_data + in_offset, patch_row_size_gated,
-                        im2col_data + im2col_offset);
-            // fill in padding right
-            if (pad_right > 0) {
-              const index_t right_offset = im2col_offset + patch_row_size_gated;
-              std::fill_n(im2col_data + right_offset, pad_right_size,
-                          zero_point);
-            }
-            in_offset += input_row_size;
-            im2col_offset += patch_row_size;
-          }
-
-          // fill in padding bottom
-          if (pad_bottom > 0) {
-            const index_t pad_bottom_size = pad_bottom * patch_row_size;
-            const index_t bottom_offset =
-                im2col_column_offset + depth - pad_bottom_size;
-            std::fill_n(im2col_data + bottom_offset, pad_bottom_size,
-                        zero_point);
-          }
+    ParallelFor3D(0, out_shape[0], 0, out_shape[1], 0, out_shape[2],
+                  [&](index_t b, index_t h, index_t w) {
+      // Reshape a patch of input to column, which is corresponding to
+      // a column of output(:, column).
+      const index_t ih_begin = h * stride_h - (pad_height >> 1);
+      const index_t ih_end = ih_begin + filter_h;
+      const index_t iw_begin = w * stride_w - (pad_width >> 1);
+      const index_t iw_end = iw_begin + filter_w;
+      // gate height and width to separate padding
+      const index_t ih_begin_gated = std::max<index_t>(0, ih_begin);
+      const index_t ih_end_gated = std::min<index_t>(ih_end, in_shape[1]);
+      const index_t iw_begin_gated = std::max<index_t>(0, iw_begin);
+      const index_t iw_end_gated = std::min<index_t>(iw_end, in_shape[2]);
+      const index_t pad_top = std::max<index_t>(0, -ih_begin);
+      const index_t pad_bottom = ih_end - ih_end_gated;
+      const index_t pad_left = std::max<index_t>(0, -iw_begin);
+      const index_t pad_right = iw_end - iw_end_gated;
+      index_t im2col_column_offset =
+          ((b * out_shape[1] + h) * out_shape[2] + w) * depth;
+
+      // fill in padding top
+      if (pad_top > 0) {
+        std::fill_n(im2col_data + im2col_column_offset,
+                    pad_top * patch_row_size, zero_point);
+      }
+
+      const index_t patch_row_size_gated =
+          std::min(filter_w - pad_left,
+                   in_shape[2] - iw_begin_gated) * in_shape[3];
+      MACE_CHECK(patch_row_size_gated ==
+          ((filter_w - (pad_left + pad_right)) * in_shape[3]));
+      const index_t pad_left_size = pad_left * in_shape[3];
+      const index_t pad_right_size = pad_right * in_shape[3];
+      index_t im2col_offset = im2col_column_offset +
+          (pad_top * filter_w + pad_left) * in_shape[3];
+      index_t in_offset = ((b * in_shape[1] + ih_begin_gated) * in_shape[2]
+          + iw_begin_gated) * in_shape[3];
+
+      // fill in effective rows
+      for (index_t ih = ih_begin_gated; ih < ih_end_gated; ++ih) {
+        // fill in padding left
+        if (pad_left > 0) {
+          const index_t left_offset = im2col_offset - pad_left_size;
+          std::fill_n(im2col_data + left_offset, pad_left_size, zero_point);
         }
+        // copy effective data
+        std::copy_n(in_data + in_offset, patch_row_size_gated,
+                    im2col_data + im2col_offset);
+        // fill in padding right
+        if (pad_right > 0) {
+          const index_t right_offset = im2col_offset + patch_row_size_gated;
+          std::fill_n(im2col_data + right_offset, pad_right_size,
+                      zero_point);
+        }
+        in_offset += input_row_size;
+        im2col_offset += patch_row_size;
       }
-    }
+
+      // fill in padding bottom
+      if (pad_bottom > 0) {
+        const index_t pad_bottom_size = pad_bottom * patch_row_size;
+        const index_t bottom_offset =
+            im2col_column_offset + depth - pad_bottom_size;
+        std::fill_n(im2col_data + bottom_offset, pad_bottom_size,
+                    zero_point);
+      }
+    });
   }
 
   MaceStatus operator()(const Tensor *input,   // NHWC
@@ -829,9 +843,6 @@ struct Conv2dFunctor<DeviceType::CPU, uint8_t> : Conv2dFunctorBase {
     MACE_CHECK(dilations_[0] == 1 && dilations_[1] == 1,
                "Quantization convolution does not support dilation > 1 yet.");
 
-    auto gemm_context = context_->device()->cpu_runtime()->GetGemmlowpContext();
-    MACE_CHECK_NOTNULL(gemm_context);
-
     std::vector<index_t> output_shape(4);
     std::vector<int> paddings(2);
     if (paddings_.empty()) {
@@ -942,14 +953,15 @@ struct Conv2dFunctor<DeviceType::CPU, uint8_t> : Conv2dFunctorBase {
     gemmlowp::MatrixMap<uint8_t, gemmlowp::MapOrder::ColMajor>
         output_matrix(output_data, gemm_output_rows, gemm_output_cols);
 
-    const auto &output_pipeline = GemmlowpOutputPipeline::Make(
-        bias_data, channels, filter->scale(), input->scale(), output->scale(),
-        output->zero_point());
-
     using BitDepthParams = gemmlowp::L8R8WithLhsNonzeroBitDepthParams;
-    gemmlowp::GemmWithOutputPipeline<uint8_t, uint8_t, BitDepthParams>(
-        gemm_context, filter_matrix, input_matrix, &output_matrix,
-        -filter->zero_point(), -input->zero_point(), output_pipeline);
+    GemmlowpMultiply<BitDepthParams>(
+        context_->device()->cpu_runtime(), filter_matrix, input_matrix,
+        &output_matrix, -filter->zero_point(), -input->zero_point(),
+        [&](index_t start_row, index_t rows) {
+          return GemmlowpOutputPipeline::Make(
+              bias_data + start_row, rows, filter->scale(), input->scale(),
+              output->scale(), output->zero_point());
+        });
 
     return MACE_SUCCESS;
   }
@@ -18,6 +18,8 @@
 #include <cmath>
 #include <vector>
 
+#include "mace/core/runtime/cpu/thread_pool.h"
+
 namespace mace {
 namespace kernels {
 
@@ -395,18 +397,15 @@ MaceStatus ConstructNCHWInputWithSpecificPadding(const Tensor *input_tensor,
   const index_t in_batch_size = channels * in_image_size;
   const index_t out_batch_size = channels * out_image_size;
 
-#pragma omp parallel for collapse(2)
-  for (int i = 0; i < batch; ++i) {
-    for (int j = 0; j < channels; ++j) {
-      for (int k = 0; k < height; ++k) {
-        memcpy(output_data + i * out_batch_size + j * out_image_size
-                 + (pad_top + k) * output_width + pad_left,
-               input + i * in_batch_size + j * in_image_size + k * width,
-               width * sizeof(float));
-      }
-      // Skip the padded bottom in this channel and top in the next channel
+  ParallelFor2D(0, batch, 0, channels, [&](int i, int j) {
+    for (int k = 0; k < height; ++k) {
+      memcpy(output_data + i * out_batch_size + j * out_image_size
+               + (pad_top + k) * output_width + pad_left,
+             input + i * in_batch_size + j * in_image_size + k * width,
+             width * sizeof(float));
     }
-  }
+    // Skip the padded bottom in this channel and top in the next channel
+  });
 
   return MACE_SUCCESS;
 }
@@ -443,21 +442,16 @@ MaceStatus ConstructNHWCInputWithPadding(const Tensor *input_tensor,
   if (padding_same_value) {
     LOG(FATAL) << "Not implemented";
   } else {
-#pragma omp parallel for collapse(3)
-    for (int n = 0; n < batch; ++n) {
-      for (int h = 0; h < height; ++h) {
-        for (int w = 0; w < width; ++w) {
-          const float *input_ptr =
-              input + ((n * height + h) * width + w) * channels;
-          float *output_ptr =
-              output_data +
-              ((n * output_height + h + padded_top) * output_width + w +
-               padded_left) *
-                  channels;
-          memcpy(output_ptr, input_ptr, channels * sizeof(float));
-        }
-      }
-    }
+    ParallelFor3D(0, batch, 0, height, 0, width, [&](int n, int h, int w) {
+      const float *input_ptr =
+          input + ((n * height + h) * width + w) * channels;
+      float *output_ptr =
+          output_data +
+          ((n * output_height + h + padded_top) * output_width + w +
+           padded_left) *
+              channels;
+      memcpy(output_ptr, input_ptr, channels * sizeof(float));
+    });
   }
 
   return MACE_SUCCESS;
@@ -19,6 +19,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/core/types.h"
 #include "mace/kernels/kernel.h"
@@ -46,21 +47,17 @@ struct CropFunctor : OpKernel {
     const index_t in_img_size =
         input_shape[1] * input_shape[2] * input_shape[3];
     const index_t in_hw = input_shape[2] * input_shape[3];
-#pragma omp parallel for collapse(3)
-    for (int b = 0; b < output_shape[0]; ++b) {
-      for (int c = 0; c < output_shape[1]; ++c) {
-        for (int h = 0; h < output_shape[2]; ++h) {
-          T* out_ptr =
-              output_data + b * out_img_size + c * out_hw + h * output_shape[3];
-          const T* in_ptr_bch =
-              input_data + (b + offsets[0]) * in_img_size +
-                  (c + offsets[1]) * in_hw +
-                  (h + offsets[2]) * input_shape[3] + offsets[3];
-          memcpy(out_ptr, in_ptr_bch,
-                 output_shape[3] * sizeof(T));
-        }
-      }
-    }
+    ParallelFor3D(0, output_shape[0], 0, output_shape[1], 0, output_shape[2],
+                  [&](int b, int c, int h) {
+      T* out_ptr =
+          output_data + b * out_img_size + c * out_hw + h * output_shape[3];
+      const T* in_ptr_bch =
+          input_data + (b + offsets[0]) * in_img_size +
+              (c + offsets[1]) * in_hw +
+              (h + offsets[2]) * input_shape[3] + offsets[3];
+      memcpy(out_ptr, in_ptr_bch,
+             output_shape[3] * sizeof(T));
+    });
   }
 
   MaceStatus operator()(const std::vector<const Tensor *> &input_list,
@@ -25,6 +25,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/activation.h"
 #include "mace/kernels/arm/deconv_2d_neon.h"
@@ -209,31 +210,27 @@ struct Deconv2dFunctor<DeviceType::CPU, float>: Deconv2dFunctorBase {
     const index_t out_channels = out_shape[1];
     const index_t in_channels = in_shape[1];
 
-#pragma omp parallel for collapse(4)
-    for (int b = 0; b < batch; ++b) {
-      for (int oc = 0; oc < out_channels; ++oc) {
-        for (int i = 0; i < in_height; ++i) {
-          for (int j = 0; j < in_width; ++j) {
-            float *out_base =
-                output + (b * out_channels + oc) * out_img_size;
-            const index_t out_offset =
-                i * strides[0] * out_width + j * strides[1];
-            for (int ic = 0; ic < in_channels; ++ic) {
-              const index_t input_idx =
-                  (b * in_channels + ic) * in_img_size + i * in_width + j;
-              const float val = input[input_idx];
-              const index_t kernel_offset =
-                  (oc * in_channels + ic) * kernel_size;
-              for (int k = 0; k < kernel_size; ++k) {
-                const index_t out_idx = out_offset + index_map[k];
-                const index_t kernel_idx = kernel_offset + k;
-                out_base[out_idx] += val * filter[kernel_idx];
-              }
-            }
+    ParallelFor3D(0, batch, 0, out_channels, 0, in_height,
+                  [&](int b, int oc, int i) {
+      for (int j = 0; j < in_width; ++j) {
+        float *out_base =
+            output + (b * out_channels + oc) * out_img_size;
+        const index_t out_offset =
+            i * strides[0] * out_width + j * strides[1];
+        for (int ic = 0; ic < in_channels; ++ic) {
+          const index_t input_idx =
+              (b * in_channels + ic) * in_img_size + i * in_width + j;
+          const float val = input[input_idx];
+          const index_t kernel_offset =
+              (oc * in_channels + ic) * kernel_size;
+          for (int k = 0; k < kernel_size; ++k) {
+            const index_t out_idx = out_offset + index_map[k];
+            const index_t kernel_idx = kernel_offset + k;
+            out_base[out_idx] += val * filter[kernel_idx];
           }
         }
       }
-    }
+    });
   }
 
   void CropPadOut(const float *input,
@@ -249,18 +246,14 @@ struct Deconv2dFunctor<DeviceType::CPU, float>: Deconv2dFunctorBase {
 
     const index_t out_height = out_shape[2];
     const index_t out_width = out_shape[3];
-#pragma omp parallel for collapse(3)
-    for (int i = 0; i < batch; ++i) {
-      for (int j = 0; j < channel; ++j) {
-        for (int k = 0; k < out_height; ++k) {
-          const float *input_base =
-              input + ((i * channel + j) * in_height + (k + pad_h)) * in_width;
-          float *output_base =
-              output + ((i * channel + j) * out_height + k)* out_width;
-          memcpy(output_base, input_base + pad_w, out_width * sizeof(float));
-        }
-      }
-    }
+    ParallelFor3D(0, batch, 0, channel, 0, out_height,
+        [&](int i, int j, int k) {
+      const float *input_base =
+          input + ((i * channel + j) * in_height + (k + pad_h)) * in_width;
+      float *output_base =
+          output + ((i * channel + j) * out_height + k)* out_width;
+      memcpy(output_base, input_base + pad_w, out_width * sizeof(float));
+    });
   }
 
   MaceStatus operator()(const Tensor *input,   // NCHW
@@ -441,15 +434,11 @@ struct Deconv2dFunctor<DeviceType::CPU, float>: Deconv2dFunctorBase {
       const index_t batch = output_shape[0];
       const index_t channels = output_shape[1];
       const index_t img_size = output_shape[2] * output_shape[3];
-#pragma omp parallel for collapse(3)
-      for (index_t b = 0; b < batch; ++b) {
-        for (index_t c = 0; c < channels; ++c) {
-          for (index_t i = 0; i < img_size; ++i) {
-            output_data[(b * channels + c) * img_size + i] +=
-                bias_data[c];
-          }
-        }
-      }
+      ParallelFor3D(0, batch, 0, channels, 0, img_size,
+                    [&](index_t b, index_t c, index_t i) {
+        output_data[(b * channels + c) * img_size + i] +=
+            bias_data[c];
+      });
     }
 
     deconv_func(input_data,
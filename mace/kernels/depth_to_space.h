@@ -18,6 +18,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 #include "mace/public/mace.h"
@@ -60,8 +61,7 @@ struct DepthToSpaceOpFunctor : OpKernel {
     const T *input_ptr = input->data<T>();
     T *output_ptr = output->mutable_data<T>();
 
-#pragma omp parallel for
-    for (index_t b = 0; b < batch_size; ++b) {
+    ParallelFor(0, batch_size, [&](index_t b) {
       for (index_t d = 0; d < output_depth; ++d) {
         for (index_t h = 0; h < output_height; ++h) {
           const index_t in_h = h / block_size_;
@@ -83,7 +83,7 @@ struct DepthToSpaceOpFunctor : OpKernel {
           }
         }
       }
-    }
+    });
 
 
     return MACE_SUCCESS;
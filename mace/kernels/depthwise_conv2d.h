@@ -27,6 +27,7 @@
 #include "tensorflow/contrib/lite/kernels/internal/optimized/depthwiseconv_uint8.h"
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/kernels/conv_pool_2d_util.h"
 #include "mace/kernels/activation.h"
 #include "mace/kernels/arm/depthwise_conv2d_neon.h"
@@ -95,44 +96,42 @@ struct DepthwiseConv2dFunctor<DeviceType::CPU, float>
                               const int *pad_hw,
                               float *output) {
     const index_t multiplier = filter_shape[0] / filter_shape[1];
-#pragma omp parallel for collapse(2)
-    for (index_t b = 0; b < in_shape[0]; ++b) {
-      for (index_t m = 0; m < filter_shape[0]; ++m) {
-        for (index_t h = 0; h < out_shape[2]; ++h) {
-          for (index_t w = 0; w < out_shape[3]; ++w) {
-            const index_t out_channels = filter_shape[0];
-            const index_t in_channels = filter_shape[1];
-            const index_t filter_height = filter_shape[2];
-            const index_t filter_width = filter_shape[3];
-            const index_t in_height = in_shape[2];
-            const index_t in_width = in_shape[3];
-            const index_t out_height = out_shape[2];
-            const index_t out_width = out_shape[3];
-            index_t out_offset =
-              ((b * out_channels + m) * out_height + h) * out_width + w;
-            index_t c = m / multiplier;
-            index_t o = m % multiplier;
-            float sum = 0;
-            for (index_t kh = 0; kh < filter_height; ++kh) {
-              for (index_t kw = 0; kw < filter_width; ++kw) {
-                index_t ih = h * stride_hw[0] + kh * dilation_hw[0] - pad_hw[0];
-                index_t iw = w * stride_hw[1] + kw * dilation_hw[1] - pad_hw[1];
-                if (ih >= 0 && ih < in_height && iw >= 0 && iw < in_width) {
-                  index_t in_offset =
-                    ((b * in_channels + c) * in_height + ih) * in_width + iw;
-                  index_t filter_offset =
-                    (((o * in_channels) + c) * filter_height + kh)
-                        * filter_width + kw;
-
-                  sum += input[in_offset] * filter[filter_offset];
-                }
+    ParallelFor2D(0, in_shape[0], 0, filter_shape[0],
+        [&](index_t b, index_t m) {
+      for (index_t h = 0; h < out_shape[2]; ++h) {
+        for (index_t w = 0; w < out_shape[3]; ++w) {
+          const index_t out_channels = filter_shape[0];
+          const index_t in_channels = filter_shape[1];
+          const index_t filter_height = filter_shape[2];
+          const index_t filter_width = filter_shape[3];
+          const index_t in_height = in_shape[2];
+          const index_t in_width = in_shape[3];
+          const index_t out_height = out_shape[2];
+          const index_t out_width = out_shape[3];
+          index_t out_offset =
+            ((b * out_channels + m) * out_height + h) * out_width + w;
+          index_t c = m / multiplier;
+          index_t o = m % multiplier;
+          float sum = 0;
+          for (index_t kh = 0; kh < filter_height; ++kh) {
+            for (index_t kw = 0; kw < filter_width; ++kw) {
+              index_t ih = h * stride_hw[0] + kh * dilation_hw[0] - pad_hw[0];
+              index_t iw = w * stride_hw[1] + kw * dilation_hw[1] - pad_hw[1];
+              if (ih >= 0 && ih < in_height && iw >= 0 && iw < in_width) {
+                index_t in_offset =
+                  ((b * in_channels + c) * in_height + ih) * in_width + iw;
+                index_t filter_offset =
+                  (((o * in_channels) + c) * filter_height + kh)
+                      * filter_width + kw;
+
+                sum += input[in_offset] * filter[filter_offset];
               }
             }
-            output[out_offset] = sum;
           }
+          output[out_offset] = sum;
         }
       }
-    }
+    });
   }
 
   MaceStatus operator()(const Tensor *input,   // NCHW
@@ -274,15 +273,12 @@ struct DepthwiseConv2dFunctor<DeviceType::CPU, float>
     conv_func(input_data, output_data);
 
     if (bias_data != nullptr) {
-#pragma omp parallel for collapse(2)
-      for (index_t b = 0; b < batch; ++b) {
-        for (index_t c = 0; c < channels; ++c) {
-          for (index_t i = 0; i < height * width; ++i) {
-            output_data[(b * channels + c) * height * width + i] +=
-              bias_data[c];
-          }
+      ParallelFor2D(0, batch, 0, channels, [&](index_t b, index_t c) {
+        for (index_t i = 0; i < height * width; ++i) {
+          output_data[(b * channels + c) * height * width + i] +=
+            bias_data[c];
         }
-      }
+      });
     }
 
     DoActivation(output_data, output_data, output->size(), activation_,
@@ -324,54 +320,51 @@ struct DepthwiseConv2dFunctor<DeviceType::CPU, uint8_t>
                               const int *dilation_hw,
                               const int *pad_hw,
                               uint8_t *output) {
-#pragma omp parallel for collapse(2)
-    for (index_t b = 0; b < out_shape[0]; ++b) {
-      for (index_t h = 0; h < out_shape[1]; ++h) {
-        for (index_t w = 0; w < out_shape[2]; ++w) {
-          for (index_t m = 0; m < out_shape[3]; ++m) {
-            const index_t filter_height = filter_shape[0];
-            const index_t filter_width = filter_shape[1];
-            const index_t in_channels = filter_shape[2];
-            const index_t depth_multiplier = filter_shape[3];
-            const index_t in_height = in_shape[1];
-            const index_t in_width = in_shape[2];
-            const index_t out_height = out_shape[1];
-            const index_t out_width = out_shape[2];
-            const index_t out_channels = out_shape[3];
-            index_t out_offset =
-                ((b * out_height + h) * out_width + w) * out_channels + m;
-            index_t c = m / depth_multiplier;
-            index_t o = m % depth_multiplier;
-            index_t ih_base = h * stride_hw[0] - pad_hw[0];
-            index_t iw_base = w * stride_hw[1] - pad_hw[1];
-            int32_t sum = 0;
-            for (index_t kh = 0; kh < filter_height; ++kh) {
-              const index_t ih = ih_base + kh * dilation_hw[0];
-              for (index_t kw = 0; kw < filter_width; ++kw) {
-                const index_t iw = iw_base + kw * dilation_hw[1];
-                if (ih >= 0 && ih < in_height && iw >= 0 && iw < in_width) {
-                  index_t in_offset =
-                      ((b * in_height + ih) * in_width + iw) * in_channels + c;
-                  index_t filter_offset =
-                      ((kh * filter_width + kw) * in_channels + c)
-                          * depth_multiplier + o;
-
-                  sum += (input[in_offset] - input_zero) *
-                      (filter[filter_offset] - filter_zero);
-                }
+    ParallelFor2D(0, out_shape[0], 0, out_shape[1], [&](index_t b, index_t h) {
+      for (index_t w = 0; w < out_shape[2]; ++w) {
+        for (index_t m = 0; m < out_shape[3]; ++m) {
+          const index_t filter_height = filter_shape[0];
+          const index_t filter_width = filter_shape[1];
+          const index_t in_channels = filter_shape[2];
+          const index_t depth_multiplier = filter_shape[3];
+          const index_t in_height = in_shape[1];
+          const index_t in_width = in_shape[2];
+          const index_t out_height = out_shape[1];
+          const index_t out_width = out_shape[2];
+          const index_t out_channels = out_shape[3];
+          index_t out_offset =
+              ((b * out_height + h) * out_width + w) * out_channels + m;
+          index_t c = m / depth_multiplier;
+          index_t o = m % depth_multiplier;
+          index_t ih_base = h * stride_hw[0] - pad_hw[0];
+          index_t iw_base = w * stride_hw[1] - pad_hw[1];
+          int32_t sum = 0;
+          for (index_t kh = 0; kh < filter_height; ++kh) {
+            const index_t ih = ih_base + kh * dilation_hw[0];
+            for (index_t kw = 0; kw < filter_width; ++kw) {
+              const index_t iw = iw_base + kw * dilation_hw[1];
+              if (ih >= 0 && ih < in_height && iw >= 0 && iw < in_width) {
+                index_t in_offset =
+                    ((b * in_height + ih) * in_width + iw) * in_channels + c;
+                index_t filter_offset =
+                    ((kh * filter_width + kw) * in_channels + c)
+                        * depth_multiplier + o;
+
+                sum += (input[in_offset] - input_zero) *
+                    (filter[filter_offset] - filter_zero);
               }
             }
-            if (bias) {
-              sum += bias[m];
-            }
-            sum = static_cast<int32_t>(std::round(sum * output_multiplier));
-            sum += output_zero;
-            output[out_offset] =
-                static_cast<uint8_t>(std::min(255, std::max(0, sum)));
           }
+          if (bias) {
+            sum += bias[m];
+          }
+          sum = static_cast<int32_t>(std::round(sum * output_multiplier));
+          sum += output_zero;
+          output[out_offset] =
+              static_cast<uint8_t>(std::min(255, std::max(0, sum)));
         }
       }
-    }
+    });
   }
 
   inline tflite::Dims<4> ShapeToTfliteDims(const std::vector<index_t> &shape) {
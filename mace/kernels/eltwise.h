@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 #include "mace/utils/quantize.h"
@@ -215,140 +216,99 @@ inline void TensorBroadcastEltwise(const EltwiseType type,
   switch (type) {
     case SUM:
       if (coeff.empty()) {
-#pragma omp parallel for collapse(2)
-        for (index_t d = 0; d < diff_size; ++d) {
-          for (index_t i = 0; i < common_size; ++i) {
-            output[i + d * common_size] =
-                input0[i + d * common_size] + input1[i];
-          }
-        }
+        ParallelFor2D(0, diff_size, 0, common_size, [&](index_t d, index_t i) {
+          output[i + d * common_size] =
+              input0[i + d * common_size] + input1[i];
+        });
       } else {
         std::vector<float> coeff_copy = coeff;
         if (swapped) {
           std::swap(coeff_copy[0], coeff_copy[1]);
         }
-#pragma omp parallel for collapse(2)
-        for (index_t d = 0; d < diff_size; ++d) {
-          for (index_t i = 0; i < common_size; ++i) {
-            output[i + d * common_size] =
-                input0[i + d * common_size] * coeff_copy[0] +
-                input1[i] * coeff_copy[1];
-          }
-        }
+        ParallelFor2D(0, diff_size, 0, common_size, [&](index_t d, index_t i) {
+          output[i + d * common_size] =
+              input0[i + d * common_size] * coeff_copy[0] +
+              input1[i] * coeff_copy[1];
+        });
       }
       break;
     case SUB:
       if (!swapped) {
-#pragma omp parallel for collapse(2)
-        for (index_t d = 0; d < diff_size; ++d) {
-          for (index_t i = 0; i < common_size; ++i) {
-            output[i + d * common_size] =
-                input0[i + d * common_size] - input1[i];
-          }
-        }
+        ParallelFor2D(0, diff_size, 0, common_size, [&](index_t d, index_t i) {
+          output[i + d * common_size] =
+              input0[i + d * common_size] - input1[i];
+        });
       } else {
-#pragma omp parallel for collapse(2)
-        for (index_t d = 0; d < diff_size; ++d) {
-          for (index_t i = 0; i < common_size; ++i) {
-            output[i + d * common_size] =
-                input1[i] - input0[i + d * common_size];
-          }
-        }
+        ParallelFor2D(0, diff_size, 0, common_size, [&](index_t d, index_t i) {
+          output[i + d * common_size] =
+              input1[i] - input0[i + d * common_size];
+        });
       }
       break;
     case PROD:
-#pragma omp parallel for collapse(2)
-      for (index_t d = 0; d < diff_size; ++d) {
-        for (index_t i = 0; i < common_size; ++i) {
-          output[i + d * common_size] = input0[i + d * common_size] * input1[i];
-        }
-      }
+      ParallelFor2D(0, diff_size, 0, common_size, [&](index_t d, index_t i) {
+        output[i + d * common_size] = input0[i + d * common_size] * input1[i];
+      });
       break;
     case DIV:
       if (!swapped) {
-#pragma omp parallel for collapse(2)
-        for (index_t d = 0; d < diff_size; ++d) {
-          for (index_t i = 0; i < common_size; ++i) {
-            output[i + d * common_size] =
-                input0[i + d * common_size] / input1[i];
-          }
-        }
+        ParallelFor2D(0, diff_size, 0, common_size, [&](index_t d, index_t i) {
+          output[i + d * common_size] =
+              input0[i + d * common_size] / input1[i];
+        });
       } else {
-#pragma omp parallel for collapse(2)
-        for (index_t d = 0; d < diff_size; ++d) {
-          for (index_t i = 0; i < common_size; ++i) {
-            output[i + d * common_size] =
-                input1[i] / input0[i + d * common_size];
-          }
-        }
+        ParallelFor2D(0, diff_size, 0, common_size, [&](index_t d, index_t i) {
+          output[i + d * common_size] =
+              input1[i] / input0[i + d * common_size];
+        });
       }
       break;
     case MIN:
-#pragma omp parallel for collapse(2)
-      for (index_t d = 0; d < diff_size; ++d) {
-        for (index_t i = 0; i < common_size; ++i) {
-          output[i + d * common_size] =
-              std::min(input0[i + d * common_size], input1[i]);
-        }
-      }
+      ParallelFor2D(0, diff_size, 0, common_size, [&](index_t d, index_t i) {
+        output[i + d * common_size] =
+            std::min(input0[i + d * common_size], input1[i]);
+      });
       break;
     case MAX:
-#pragma omp parallel for collapse(2)
-      for (index_t d = 0; d < diff_size; ++d) {
-        for (index_t i = 0; i < common_size; ++i) {
-          output[i + d * common_size] =
-              std::max(input0[i + d * common_size], input1[i]);
-        }
-      }
+      ParallelFor2D(0, diff_size, 0, common_size, [&](index_t d, index_t i) {
+        output[i + d * common_size] =
+            std::max(input0[i + d * common_size], input1[i]);
+      });
       break;
     case SQR_DIFF:
-#pragma omp parallel for collapse(2)
-      for (index_t d = 0; d < diff_size; ++d) {
-        for (index_t i = 0; i < common_size; ++i) {
-          output[i + d * common_size] =
-              std::pow(input0[i + d * common_size] - input1[i], 2.f);
-        }
-      }
+      ParallelFor2D(0, diff_size, 0, common_size, [&](index_t d, index_t i) {
+        output[i + d * common_size] =
+            std::pow(input0[i + d * common_size] - input1[i], 2.f);
+      });
       break;
     case POW:
       if (!swapped) {
-#pragma omp parallel for collapse(2)
-        for (index_t d = 0; d < diff_size; ++d) {
-          for (index_t i = 0; i < common_size; ++i) {
-            output[i + d * common_size] =
-                std::pow(input0[i + d * common_size], input1[i]);
-          }
-        }
+        ParallelFor2D(0, diff_size, 0, common_size, [&](index_t d, index_t i) {
+          output[i + d * common_size] =
+              std::pow(input0[i + d * common_size], input1[i]);
+        });
       } else {
-#pragma omp parallel for collapse(2)
-        for (index_t d = 0; d < diff_size; ++d) {
-          for (index_t i = 0; i < common_size; ++i) {
-            output[i + d * common_size] =
-                std::pow(input1[i], input0[i + d * common_size]);
-          }
-        }
+        ParallelFor2D(0, diff_size, 0, common_size, [&](index_t d, index_t i) {
+          output[i + d * common_size] =
+              std::pow(input1[i], input0[i + d * common_size]);
+        });
       }
       break;
     case NEG:
-#pragma omp parallel for
-      for (index_t i = 0; i < diff_size * common_size; ++i) {
+      ParallelFor(0, diff_size * common_size, [&](index_t i) {
         output[i] = -input0[i];
-      }
+      });
       break;
     case ABS:
-#pragma omp parallel for
-      for (index_t i = 0; i < diff_size * common_size; ++i) {
+      ParallelFor(0, diff_size * common_size, [&](index_t i) {
         output[i] = std::fabs(input0[i]);
-      }
+      });
       break;
     case EQUAL:
-#pragma omp parallel for collapse(2)
-      for (index_t d = 0; d < diff_size; ++d) {
-        for (index_t i = 0; i < common_size; ++i) {
-          output[i + d * common_size] =
-              input0[i + d * common_size] == input1[i];
-        }
-      }
+      ParallelFor2D(0, diff_size, 0, common_size, [&](index_t d, index_t i) {
+        output[i + d * common_size] =
+            input0[i + d * common_size] == input1[i];
+      });
       break;
     default:
       LOG(FATAL) << "Eltwise op not support type " << type;
@@ -367,84 +327,73 @@ inline void TensorEltwise(const EltwiseType type,
   switch (type) {
     case SUM:
       if (coeff.empty()) {
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = input0[i] + input1[i];
-        }
+        });
 
       } else {
         std::vector<float> coeff_copy = coeff;
         if (swapped) {
           std::swap(coeff_copy[0], coeff_copy[1]);
         }
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = input0[i] * coeff_copy[0] + input1[i] * coeff_copy[1];
-        }
+        });
       }
       break;
     case SUB:
       if (!swapped) {
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = input0[i] - input1[i];
-        }
+        });
 
       } else {
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = input1[i] - input0[i];
-        }
+        });
       }
       break;
     case PROD:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = input0[i] * input1[i];
-      }
+      });
 
       break;
     case DIV:
       if (!swapped) {
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = input0[i] / input1[i];
-        }
+        });
 
       } else {
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = input1[i] / input0[i];
-        }
+        });
       }
       break;
     case MIN:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = std::min(input0[i], input1[i]);
-      }
+      });
 
       break;
     case MAX:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = std::max(input0[i], input1[i]);
-      }
+      });
 
       break;
     case SQR_DIFF:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = std::pow(input0[i] - input1[i], 2.f);
-      }
+      });
 
       break;
     case POW:
       if (!swapped) {
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = std::pow(input0[i], input1[i]);
-        }
+        });
       } else {
         for (index_t i = 0; i < size; ++i) {
           output[i] = std::pow(input1[i], input0[i]);
@@ -452,22 +401,19 @@ inline void TensorEltwise(const EltwiseType type,
       }
       break;
     case NEG:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = -input0[i];
-      }
+      });
       break;
     case ABS:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = std::fabs(input0[i]);
-      }
+      });
       break;
     case EQUAL:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = input0[i] == input1[i];
-      }
+      });
       break;
     default:
       LOG(FATAL) << "Eltwise op not support type " << type;
@@ -486,84 +432,73 @@ inline void TensorScalarEltwise(const EltwiseType type,
   switch (type) {
     case SUM:
       if (coeff.empty()) {
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = input0[i] + input1;
-        }
+        });
 
       } else {
         std::vector<float> coeff_copy = coeff;
         if (swapped) {
           std::swap(coeff_copy[0], coeff_copy[1]);
         }
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = input0[i] * coeff_copy[0] + input1 * coeff_copy[1];
-        }
+        });
       }
       break;
     case SUB:
       if (!swapped) {
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = input0[i] - input1;
-        }
+        });
 
       } else {
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = input1 - input0[i];
-        }
+        });
       }
       break;
     case PROD:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = input0[i] * input1;
-      }
+      });
 
       break;
     case DIV:
       if (!swapped) {
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = input0[i] / input1;
-        }
+        });
 
       } else {
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = input1 / input0[i];
-        }
+        });
       }
       break;
     case MIN:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = std::min(input0[i], input1);
-      }
+      });
 
       break;
     case MAX:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = std::max(input0[i], input1);
-      }
+      });
 
       break;
     case SQR_DIFF:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = std::pow(input0[i] - input1, 2.f);
-      }
+      });
 
       break;
     case POW:
       if (!swapped) {
-#pragma omp parallel for
-        for (index_t i = 0; i < size; ++i) {
+        ParallelFor(0, size, [&](index_t i) {
           output[i] = std::pow(input0[i], input1);
-        }
+        });
       } else {
         for (index_t i = 0; i < size; ++i) {
           output[i] = std::pow(input1, input0[i]);
@@ -571,22 +506,19 @@ inline void TensorScalarEltwise(const EltwiseType type,
       }
       break;
     case NEG:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = -input0[i];
-      }
+      });
       break;
     case ABS:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = std::fabs(input0[i]);
-      }
+      });
       break;
     case EQUAL:
-#pragma omp parallel for
-      for (index_t i = 0; i < size; ++i) {
+      ParallelFor(0, size, [&](index_t i) {
         output[i] = input0[i] == input1;
-      }
+      });
 
       break;
     default:
@@ -608,193 +540,152 @@ inline void TensorEltwisePerChannel(const EltwiseType type,
   switch (type) {
     case SUM:
       if (coeff.empty()) {
-#pragma omp parallel for collapse(2)
-        for (index_t b = 0; b < batch0; ++b) {
-          for (index_t c = 0; c < channel; ++c) {
-            const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
-            const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
-            DstType *out_ptr = output + ((b * channel) + c) * image_size;
-            for (index_t i = 0; i < image_size; ++i) {
-              out_ptr[i] = in0_ptr[i] + in1_ptr[c];
-            }
+        ParallelFor2D(0, batch0, 0, channel, [&](index_t b, index_t c) {
+          const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
+          const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
+          DstType *out_ptr = output + ((b * channel) + c) * image_size;
+          for (index_t i = 0; i < image_size; ++i) {
+            out_ptr[i] = in0_ptr[i] + in1_ptr[c];
           }
-        }
+        });
       } else {
         std::vector<float> coeff_copy = coeff;
         if (swapped) {
           std::swap(coeff_copy[0], coeff_copy[1]);
         }
-#pragma omp parallel for collapse(2)
-        for (index_t b = 0; b < batch0; ++b) {
-          for (index_t c = 0; c < channel; ++c) {
-            const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
-            const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
-            DstType *out_ptr = output + ((b * channel) + c) * image_size;
-            for (index_t i = 0; i < image_size; ++i) {
-              out_ptr[i] =
-                  in0_ptr[i] * coeff_copy[0] + in1_ptr[c] * coeff_copy[1];
-            }
+        ParallelFor2D(0, batch0, 0, channel, [&](index_t b, index_t c) {
+          const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
+          const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
+          DstType *out_ptr = output + ((b * channel) + c) * image_size;
+          for (index_t i = 0; i < image_size; ++i) {
+            out_ptr[i] =
+                in0_ptr[i] * coeff_copy[0] + in1_ptr[c] * coeff_copy[1];
           }
-        }
+        });
       }
       break;
     case SUB:
       if (!swapped) {
-#pragma omp parallel for collapse(2)
-        for (index_t b = 0; b < batch0; ++b) {
-          for (index_t c = 0; c < channel; ++c) {
-            const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
-            const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
-            DstType *out_ptr = output + ((b * channel) + c) * image_size;
-            for (index_t i = 0; i < image_size; ++i) {
-              out_ptr[i] = in0_ptr[i] - in1_ptr[c];
-            }
+        ParallelFor2D(0, batch0, 0, channel, [&](index_t b, index_t c) {
+          const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
+          const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
+          DstType *out_ptr = output + ((b * channel) + c) * image_size;
+          for (index_t i = 0; i < image_size; ++i) {
+            out_ptr[i] = in0_ptr[i] - in1_ptr[c];
           }
-        }
+        });
       } else {
-#pragma omp parallel for collapse(2)
-        for (index_t b = 0; b < batch0; ++b) {
-          for (index_t c = 0; c < channel; ++c) {
-            const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
-            const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
-            DstType *out_ptr = output + ((b * channel) + c) * image_size;
-            for (index_t i = 0; i < image_size; ++i) {
-              out_ptr[i] = in1_ptr[c] - in0_ptr[i];
-            }
-          }
-        }
-      }
-      break;
-    case PROD:
-#pragma omp parallel for collapse(2)
-      for (index_t b = 0; b < batch0; ++b) {
-        for (index_t c = 0; c < channel; ++c) {
+        ParallelFor2D(0, batch0, 0, channel, [&](index_t b, index_t c) {
           const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
           const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
           DstType *out_ptr = output + ((b * channel) + c) * image_size;
           for (index_t i = 0; i < image_size; ++i) {
-            out_ptr[i] = in0_ptr[i] * in1_ptr[c];
+            out_ptr[i] = in1_ptr[c] - in0_ptr[i];
           }
-        }
+        });
       }
       break;
-    case DIV:
-      if (!swapped) {
-#pragma omp parallel for collapse(2)
-        for (index_t b = 0; b < batch0; ++b) {
-          for (index_t c = 0; c < channel; ++c) {
-            const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
-            const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
-            DstType *out_ptr = output + ((b * channel) + c) * image_size;
-            for (index_t i = 0; i < image_size; ++i) {
-              out_ptr[i] = in0_ptr[i] / in1_ptr[c];
-            }
-          }
-        }
-      } else {
-#pragma omp parallel for collapse(2)
-        for (index_t b = 0; b < batch0; ++b) {
-          for (index_t c = 0; c < channel; ++c) {
-            const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
-            const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
-            DstType *out_ptr = output + ((b * channel) + c) * image_size;
-            for (index_t i = 0; i < image_size; ++i) {
-              out_ptr[i] = in1_ptr[c] / in0_ptr[i];
-            }
-          }
+    case PROD:
+      ParallelFor2D(0, batch0, 0, channel, [&](index_t b, index_t c) {
+        const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
+        const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
+        DstType *out_ptr = output + ((b * channel) + c) * image_size;
+        for (index_t i = 0; i < image_size; ++i) {
+          out_ptr[i] = in0_ptr[i] * in1_ptr[c];
         }
-      }
+      });
       break;
-    case MIN:
-#pragma omp parallel for collapse(2)
-      for (index_t b = 0; b < batch0; ++b) {
-        for (index_t c = 0; c < channel; ++c) {
+    case DIV:
+      if (!swapped) {
+        ParallelFor2D(0, batch0, 0, channel, [&](index_t b, index_t c) {
           const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
           const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
           DstType *out_ptr = output + ((b * channel) + c) * image_size;
           for (index_t i = 0; i < image_size; ++i) {
-            out_ptr[i] = std::min(in0_ptr[i], in1_ptr[c]);
+            out_ptr[i] = in0_ptr[i] / in1_ptr[c];
           }
-        }
-      }
-      break;
-    case MAX:
-#pragma omp parallel for collapse(2)
-      for (index_t b = 0; b < batch0; ++b) {
-        for (index_t c = 0; c < channel; ++c) {
+        });
+      } else {
+        ParallelFor2D(0, batch0, 0, channel, [&](index_t b, index_t c) {
           const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
           const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
           DstType *out_ptr = output + ((b * channel) + c) * image_size;
           for (index_t i = 0; i < image_size; ++i) {
-            out_ptr[i] = std::max(in0_ptr[i], in1_ptr[c]);
+            out_ptr[i] = in1_ptr[c] / in0_ptr[i];
           }
-        }
+        });
       }
       break;
+    case MIN:
+      ParallelFor2D(0, batch0, 0, channel, [&](index_t b, index_t c) {
+        const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
+        const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
+        DstType *out_ptr = output + ((b * channel) + c) * image_size;
+        for (index_t i = 0; i < image_size; ++i) {
+          out_ptr[i] = std::min(in0_ptr[i], in1_ptr[c]);
+        }
+      });
+      break;
+    case MAX:
+      ParallelFor2D(0, batch0, 0, channel, [&](index_t b, index_t c) {
+        const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
+        const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
+        DstType *out_ptr = output + ((b * channel) + c) * image_size;
+        for (index_t i = 0; i < image_size; ++i) {
+          out_ptr[i] = std::max(in0_ptr[i], in1_ptr[c]);
+        }
+      });
+      break;
     case SQR_DIFF:
-#pragma omp parallel for collapse(2)
-      for (index_t b = 0; b < batch0; ++b) {
-        for (index_t c = 0; c < channel; ++c) {
-          const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
-          const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
-          DstType *out_ptr = output + ((b * channel) + c) * image_size;
-          for (index_t i = 0; i < image_size; ++i) {
-            out_ptr[i] = std::pow(in0_ptr[i] - in1_ptr[c], 2.f);
-          }
+      ParallelFor2D(0, batch0, 0, channel, [&](index_t b, index_t c) {
+        const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
+        const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
+        DstType *out_ptr = output + ((b * channel) + c) * image_size;
+        for (index_t i = 0; i < image_size; ++i) {
+          out_ptr[i] = std::pow(in0_ptr[i] - in1_ptr[c], 2.f);
         }
-      }
+      });
       break;
     case POW:
       if (!swapped) {
-#pragma omp parallel for collapse(2)
-        for (index_t b = 0; b < batch0; ++b) {
-          for (index_t c = 0; c < channel; ++c) {
-            const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
-            const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
-            DstType *out_ptr = output + ((b * channel) + c) * image_size;
-            for (index_t i = 0; i < image_size; ++i) {
-              out_ptr[i] = std::pow(in0_ptr[i], in1_ptr[c]);
-            }
+        ParallelFor2D(0, batch0, 0, channel, [&](index_t b, index_t c) {
+          const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
+          const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
+          DstType *out_ptr = output + ((b * channel) + c) * image_size;
+          for (index_t i = 0; i < image_size; ++i) {
+            out_ptr[i] = std::pow(in0_ptr[i], in1_ptr[c]);
           }
-        }
+        });
       } else {
-#pragma omp parallel for collapse(2)
-        for (index_t b = 0; b < batch0; ++b) {
-          for (index_t c = 0; c < channel; ++c) {
-            const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
-            const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
-            DstType *out_ptr = output + ((b * channel) + c) * image_size;
-            for (index_t i = 0; i < image_size; ++i) {
-              out_ptr[i] = std::pow(in1_ptr[c], in0_ptr[i]);
-            }
+        ParallelFor2D(0, batch0, 0, channel, [&](index_t b, index_t c) {
+          const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
+          const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
+          DstType *out_ptr = output + ((b * channel) + c) * image_size;
+          for (index_t i = 0; i < image_size; ++i) {
+            out_ptr[i] = std::pow(in1_ptr[c], in0_ptr[i]);
           }
-        }
+        });
       }
       break;
     case NEG:
-#pragma omp parallel for
-      for (index_t i = 0; i < batch0 * channel * image_size; ++i) {
+      ParallelFor(0, batch0 * channel * image_size, [&](index_t i) {
         output[i] = -input0[i];
-      }
+      });
       break;
     case ABS:
-#pragma omp parallel for
-      for (index_t i = 0; i < batch0 * channel * image_size; ++i) {
+      ParallelFor(0, batch0 * channel * image_size, [&](index_t i) {
         output[i] = std::fabs(input0[i]);
-      }
+      });
       break;
     case EQUAL:
-#pragma omp parallel for collapse(2)
-      for (index_t b = 0; b < batch0; ++b) {
-        for (index_t c = 0; c < channel; ++c) {
-          const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
-          const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
-          DstType *out_ptr = output + ((b * channel) + c) * image_size;
-          for (index_t i = 0; i < image_size; ++i) {
-            out_ptr[i] = in0_ptr[i] == in1_ptr[c];
-          }
+      ParallelFor2D(0, batch0, 0, channel, [&](index_t b, index_t c) {
+        const T *in0_ptr = input0 + ((b * channel) + c) * image_size;
+        const T *in1_ptr = input1 + (batch1 > 1 ? b * channel : 0);
+        DstType *out_ptr = output + ((b * channel) + c) * image_size;
+        for (index_t i = 0; i < image_size; ++i) {
+          out_ptr[i] = in0_ptr[i] == in1_ptr[c];
         }
-      }
+      });
       break;
     default:
       LOG(FATAL) << "Eltwise op not support type " << type;
@@ -1000,8 +891,7 @@ struct EltwiseFunctor<DeviceType::CPU, uint8_t> : OpKernel {
 
     index_t handled_output_size = 0;
 #ifdef MACE_ENABLE_NEON
-#pragma omp parallel for
-    for (index_t i = handled_output_size; i <= output->size() - 8; i += 8) {
+    ParallelFor(handled_output_size, output->size() - 7, 8, [&](index_t i) {
       const auto input0_val = vld1_u8(input0_ptr + i);
       const auto input1_val = vld1_u8(input1_ptr + i);
       const auto input0_val_s16 =
@@ -1043,11 +933,10 @@ struct EltwiseFunctor<DeviceType::CPU, uint8_t> : OpKernel {
                                                      sum_high_s16),
                                         vdupq_n_s16(output->zero_point()));
       vst1_u8(output_ptr + i, vqmovun_s16(output_val));
-    }
+    });
     handled_output_size = output->size() - output->size() % 8;
 #endif  // NEON
-#pragma omp parallel for
-    for (index_t i = handled_output_size; i < output->size(); ++i) {
+    ParallelFor(handled_output_size, output->size(), [&](index_t i) {
       const int32_t offset_input0 = input0_ptr[i] - input0->zero_point();
       const int32_t offset_input1 = input1_ptr[i] - input1->zero_point();
       const int32_t shifted_input0 = offset_input0 * (1 << left_shift);
@@ -1069,7 +958,7 @@ struct EltwiseFunctor<DeviceType::CPU, uint8_t> : OpKernel {
                                                           output_multiplier),
               -output_shift) + output->zero_point();
       output_ptr[i] = Saturate<uint8_t>(output_val);
-    }
+    });
 
     return MACE_SUCCESS;
   }
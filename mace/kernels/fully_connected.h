@@ -100,9 +100,6 @@ struct FullyConnectedFunctor<DeviceType::CPU, uint8_t>: FullyConnectedBase {
                         Tensor *output,
                         StatsFuture *future) {
     MACE_UNUSED(future);
-    auto gemm_context = context_->device()->cpu_runtime()->GetGemmlowpContext();
-    MACE_CHECK_NOTNULL(gemm_context);
-
     std::vector<index_t> output_shape = {input->dim(0), 1, 1, weight->dim(0)};
     MACE_RETURN_IF_ERROR(output->Resize(output_shape));
     const int N = static_cast<int>(output->dim(0));
@@ -137,14 +134,15 @@ struct FullyConnectedFunctor<DeviceType::CPU, uint8_t>: FullyConnectedBase {
     gemmlowp::MatrixMap<uint8_t, gemmlowp::MapOrder::ColMajor>
         output_matrix(output_ptr, output_size, N);
 
-    const auto &output_pipeline = GemmlowpOutputPipeline::Make(
-        bias_ptr, output_size, weight->scale(), input->scale(), output->scale(),
-        output->zero_point());
-
     using BitDepthParams = gemmlowp::L8R8WithLhsNonzeroBitDepthParams;
-    gemmlowp::GemmWithOutputPipeline<uint8_t, uint8_t, BitDepthParams>(
-        gemm_context, weight_matrix, input_matrix, &output_matrix,
-        -weight->zero_point(), -input->zero_point(), output_pipeline);
+    GemmlowpMultiply<BitDepthParams>(
+        context_->device()->cpu_runtime(), weight_matrix, input_matrix,
+        &output_matrix, -weight->zero_point(), -input->zero_point(),
+        [&](index_t start_row, index_t rows) {
+          return GemmlowpOutputPipeline::Make(
+              bias_ptr + start_row, rows, weight->scale(), input->scale(),
+              output->scale(), output->zero_point());
+        });
 
     return MACE_SUCCESS;
   }
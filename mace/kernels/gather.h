@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 #include "mace/public/mace.h"
@@ -80,23 +81,19 @@ struct GatherFunctor<DeviceType::CPU, float> : GatherBase {
                         params->shape().end(), 1, std::multiplies<index_t>());
     index_t index_size = indices->size();
 
-#pragma omp parallel for collapse(2)
-    for (index_t l = 0; l < lhs_size; ++l) {
-      for (index_t idx = 0; idx < index_size; ++idx) {
-        MACE_ASSERT(indices_data[idx] < axis_dim_size, "idx out of bound: ",
-                    indices_data[idx]);
-        memcpy(
-            output_data + ((l * index_size) + idx) * rhs_size,
-            params_data + ((l * axis_dim_size) + indices_data[idx]) * rhs_size,
-            sizeof(float) * rhs_size);
-      }
-    }
+    ParallelFor2D(0, lhs_size, 0, index_size, [&](index_t l, index_t idx) {
+      MACE_ASSERT(indices_data[idx] < axis_dim_size, "idx out of bound: ",
+                  indices_data[idx]);
+      memcpy(
+          output_data + ((l * index_size) + idx) * rhs_size,
+          params_data + ((l * axis_dim_size) + indices_data[idx]) * rhs_size,
+          sizeof(float) * rhs_size);
+    });
 
     if (std::fabs(y_ - 1.0) > 1e-6) {
-#pragma omp parallel for
-      for (index_t i = 0; i < output->size(); ++i) {
+      ParallelFor(0, output->size(), [&](index_t i) {
         output_data[i] *= y_;
-      }
+      });
     }
 
     return MACE_SUCCESS;
@@ -17,7 +17,7 @@
 #include <vector>
 
 #include "mace/core/tensor.h"
-#include "mace/core/runtime/cpu/cpu_runtime.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/kernels/gemm.h"
 
 /**
@@ -1269,7 +1269,7 @@ void Gemm(const float *A,
   memset(C, 0, sizeof(float) * batch * height * width);
 
   std::vector<index_t> block_size_dims {height, width, K};
-  index_t thread_count = MaceOpenMPThreadCount;
+  index_t thread_count = ParallelThreadCount();
   MACE_CHECK(thread_count >= 1, "thread should be ge 1");
   // TODO(liyin): apply gcd ?
   if (height % thread_count == 0) {
@@ -1303,88 +1303,84 @@ void Gemm(const float *A,
                              K % block_tile[2]};
 
 
-#pragma omp parallel for collapse(3)
-  for (index_t n = 0; n < batch; ++n) {
-    for (index_t bh = 0; bh < block_tile[0]; ++bh) {
-      for (index_t bw = 0; bw < block_tile[1]; ++bw) {
-        const index_t remain_height = remain[0];
-        const index_t remain_width = remain[1];
-        const index_t remain_k = remain[2];
-
-        const index_t block_size_height = block_size_dims[0];
-        const index_t block_size_width = block_size_dims[1];
-        const index_t block_size_k = block_size_dims[2];
-
-        const index_t this_block_size_height =
-            block_size_height + (bh < remain_height ? 1 : 0);
-        const index_t this_block_size_width =
-            block_size_width + (bw < remain_width ? 1 : 0);
-
-        const float *a_base = A + n * height * K;
-        const float *b_base = B + n * K * width;
-        float *c_base = C + n * height * width;
-
-        const index_t ih_begin =
-            bh * block_size_height + (bh < remain_height ? bh : remain_height);
-        const index_t
-            ih_end = std::min(height, ih_begin + this_block_size_height);
-        const index_t iw_begin =
-            bw * block_size_width + (bw < remain_width ? bw : remain_width);
-        const index_t
-            iw_end = std::min(width, iw_begin + this_block_size_width);
-
-        for (index_t bk = 0; bk < block_tile[2]; ++bk) {
-          const index_t
-              this_block_size_k = block_size_k + (bk < remain_k ? 1 : 0);
-
-          const index_t
-              ik_begin = bk * block_size_k + (bk < remain_k ? bk : remain_k);
-          const index_t ik_end = std::min(K, ik_begin + this_block_size_k);
-
-          Tensor trans_a(GetCPUAllocator(), DataType::DT_FLOAT);
-          Tensor trans_b(GetCPUAllocator(), DataType::DT_FLOAT);
-          const float *real_a = nullptr;
-          const float *real_b = nullptr;
-          float *real_c = c_base + (ih_begin * width + iw_begin);
-          index_t stride_a;
-          index_t stride_b;
-          index_t stride_c = width;
-
-          if (transpose_a) {
-            trans_a.Resize({this_block_size_height, this_block_size_k});
-            float *trans_a_data = trans_a.mutable_data<float>();
-            // A[K, H] -> A[H, K]
-            Transpose(a_base + (ik_begin * height + ih_begin),
-                      ik_end - ik_begin, ih_end - ih_begin, height,
-                      trans_a_data);
-            real_a = trans_a_data;
-            stride_a = ik_end - ik_begin;
-          } else {
-            real_a = a_base + (ih_begin * K + ik_begin);
-            stride_a = K;
-          }
-
-          if (transpose_b) {
-            trans_b.Resize({this_block_size_k, this_block_size_width});
-            float *trans_b_data = trans_b.mutable_data<float>();
-            // B[W, K] -> B[K, W]
-            Transpose(b_base + (iw_begin * K + ik_begin), iw_end - iw_begin,
-                      ik_end - ik_begin, K, trans_b_data);
-            real_b = trans_b_data;
-            stride_b = iw_end - iw_begin;
-          } else {
-            real_b = b_base + (ik_begin * width + iw_begin);
-            stride_b = width;
-          }
-
-          // inside block:
-          // calculate C[bh, bw] += A[bh, bk] * B[bk, bw] for one k
-          GemmTile(real_a, real_b, ih_end - ih_begin, ik_end - ik_begin,
-                   iw_end - iw_begin, stride_a, stride_b, stride_c, real_c);
-        }  // bk
-      }    // bw
-    }      // bh
-  }        // n
+  ParallelFor3D(0, batch, 0, block_tile[0], 0, block_tile[1],
+                [&](index_t n, index_t bh, index_t bw) {
+    const index_t remain_height = remain[0];
+    const index_t remain_width = remain[1];
+    const index_t remain_k = remain[2];
+
+    const index_t block_size_height = block_size_dims[0];
+    const index_t block_size_width = block_size_dims[1];
+    const index_t block_size_k = block_size_dims[2];
+
+    const index_t this_block_size_height =
+        block_size_height + (bh < remain_height ? 1 : 0);
+    const index_t this_block_size_width =
+        block_size_width + (bw < remain_width ? 1 : 0);
+
+    const float *a_base = A + n * height * K;
+    const float *b_base = B + n * K * width;
+    float *c_base = C + n * height * width;
+
+    const index_t ih_begin =
+        bh * block_size_height + (bh < remain_height ? bh : remain_height);
+    const index_t
+        ih_end = std::min(height, ih_begin + this_block_size_height);
+    const index_t iw_begin =
+        bw * block_size_width + (bw < remain_width ? bw : remain_width);
+    const index_t
+        iw_end = std::min(width, iw_begin + this_block_size_width);
+
+    for (index_t bk = 0; bk < block_tile[2]; ++bk) {
+      const index_t
+          this_block_size_k = block_size_k + (bk < remain_k ? 1 : 0);
+
+      const index_t
+          ik_begin = bk * block_size_k + (bk < remain_k ? bk : remain_k);
+      const index_t ik_end = std::min(K, ik_begin + this_block_size_k);
+
+      Tensor trans_a(GetCPUAllocator(), DataType::DT_FLOAT);
+      Tensor trans_b(GetCPUAllocator(), DataType::DT_FLOAT);
+      const float *real_a = nullptr;
+      const float *real_b = nullptr;
+      float *real_c = c_base + (ih_begin * width + iw_begin);
+      index_t stride_a;
+      index_t stride_b;
+      index_t stride_c = width;
+
+      if (transpose_a) {
+        trans_a.Resize({this_block_size_height, this_block_size_k});
+        float *trans_a_data = trans_a.mutable_data<float>();
+        // A[K, H] -> A[H, K]
+        Transpose(a_base + (ik_begin * height + ih_begin),
+                  ik_end - ik_begin, ih_end - ih_begin, height,
+                  trans_a_data);
+        real_a = trans_a_data;
+        stride_a = ik_end - ik_begin;
+      } else {
+        real_a = a_base + (ih_begin * K + ik_begin);
+        stride_a = K;
+      }
+
+      if (transpose_b) {
+        trans_b.Resize({this_block_size_k, this_block_size_width});
+        float *trans_b_data = trans_b.mutable_data<float>();
+        // B[W, K] -> B[K, W]
+        Transpose(b_base + (iw_begin * K + ik_begin), iw_end - iw_begin,
+                  ik_end - ik_begin, K, trans_b_data);
+        real_b = trans_b_data;
+        stride_b = iw_end - iw_begin;
+      } else {
+        real_b = b_base + (ik_begin * width + iw_begin);
+        stride_b = width;
+      }
+
+      // inside block:
+      // calculate C[bh, bw] += A[bh, bk] * B[bk, bw] for one k
+      GemmTile(real_a, real_b, ih_end - ih_begin, ik_end - ik_begin,
+               iw_end - iw_begin, stride_a, stride_b, stride_c, real_c);
+    }  // bk
+  });        // n
 }
 
 // A: height x K, B: K x width, C: height x width
@@ -1448,14 +1444,11 @@ void GemvRef(const float *m_ptr,
              const index_t height,
              float *out_ptr) {
   memset(out_ptr, 0, batch * height * sizeof(float));
-#pragma omp parallel for collapse(2)
-  for (int b = 0; b < batch; ++b) {
-    for (int h = 0; h < height; ++h) {
-      for (int w = 0; w < width; ++w) {
-        out_ptr[b * height + h] += v_ptr[b * width + w] * m_ptr[h * width + w];
-      }
+  ParallelFor2D(0, batch, 0, height, [&](int b, int h) {
+    for (int w = 0; w < width; ++w) {
+      out_ptr[b * height + h] += v_ptr[b * width + w] * m_ptr[h * width + w];
     }
-  }
+  });
 }
 
 void Gemv(const float *m_ptr,
@@ -1466,75 +1459,72 @@ void Gemv(const float *m_ptr,
           float *out_ptr) {
 #if defined(MACE_ENABLE_NEON)
 
-#pragma omp parallel for collapse(2)
-  for (index_t b = 0; b < batch; ++b) {
-    for (index_t h = 0; h < height; ++h) {
-      const float *m_ptr0 = m_ptr + h * width;
-      const float *v_ptr0 = v_ptr + b * width;
-      float *out_ptr0 = out_ptr + b * height + h;
-
-      float32x4_t vm0, vm1, vm2, vm3;
-      float32x4_t vv0, vv1, vv2, vv3;
-      float32x4_t vsum0 = vdupq_n_f32(0.f);
-      float32x4_t vsum1 = vdupq_n_f32(0.f);
-      float32x4_t vsum2 = vdupq_n_f32(0.f);
-      float32x4_t vsum3 = vdupq_n_f32(0.f);
-
-      index_t w;
-      for (w = 0; w + 15 < width; w += 16) {
-        vm0 = vld1q_f32(m_ptr0);
-        vv0 = vld1q_f32(v_ptr0);
-        vm1 = vld1q_f32(m_ptr0 + 4);
-        vv1 = vld1q_f32(v_ptr0 + 4);
-        vm2 = vld1q_f32(m_ptr0 + 8);
-        vv2 = vld1q_f32(v_ptr0 + 8);
-        vm3 = vld1q_f32(m_ptr0 + 12);
-        vv3 = vld1q_f32(v_ptr0 + 12);
-
-        vsum0 = vmlaq_f32(vsum0, vm0, vv0);
-        vsum1 = vmlaq_f32(vsum1, vm1, vv1);
-        vsum2 = vmlaq_f32(vsum2, vm2, vv2);
-        vsum3 = vmlaq_f32(vsum3, vm3, vv3);
-
-        m_ptr0 += 16;
-        v_ptr0 += 16;
-      }
+  ParallelFor2D(0, batch, 0, height, [&](index_t b, index_t h) {
+    const float *m_ptr0 = m_ptr + h * width;
+    const float *v_ptr0 = v_ptr + b * width;
+    float *out_ptr0 = out_ptr + b * height + h;
+
+    float32x4_t vm0, vm1, vm2, vm3;
+    float32x4_t vv0, vv1, vv2, vv3;
+    float32x4_t vsum0 = vdupq_n_f32(0.f);
+    float32x4_t vsum1 = vdupq_n_f32(0.f);
+    float32x4_t vsum2 = vdupq_n_f32(0.f);
+    float32x4_t vsum3 = vdupq_n_f32(0.f);
+
+    index_t w;
+    for (w = 0; w + 15 < width; w += 16) {
+      vm0 = vld1q_f32(m_ptr0);
+      vv0 = vld1q_f32(v_ptr0);
+      vm1 = vld1q_f32(m_ptr0 + 4);
+      vv1 = vld1q_f32(v_ptr0 + 4);
+      vm2 = vld1q_f32(m_ptr0 + 8);
+      vv2 = vld1q_f32(v_ptr0 + 8);
+      vm3 = vld1q_f32(m_ptr0 + 12);
+      vv3 = vld1q_f32(v_ptr0 + 12);
+
+      vsum0 = vmlaq_f32(vsum0, vm0, vv0);
+      vsum1 = vmlaq_f32(vsum1, vm1, vv1);
+      vsum2 = vmlaq_f32(vsum2, vm2, vv2);
+      vsum3 = vmlaq_f32(vsum3, vm3, vv3);
+
+      m_ptr0 += 16;
+      v_ptr0 += 16;
+    }
 
-      for (; w + 7 < width; w += 8) {
-        vm0 = vld1q_f32(m_ptr0);
-        vv0 = vld1q_f32(v_ptr0);
-        vm1 = vld1q_f32(m_ptr0 + 4);
-        vv1 = vld1q_f32(v_ptr0 + 4);
+    for (; w + 7 < width; w += 8) {
+      vm0 = vld1q_f32(m_ptr0);
+      vv0 = vld1q_f32(v_ptr0);
+      vm1 = vld1q_f32(m_ptr0 + 4);
+      vv1 = vld1q_f32(v_ptr0 + 4);
 
-        vsum0 = vmlaq_f32(vsum0, vm0, vv0);
-        vsum1 = vmlaq_f32(vsum1, vm1, vv1);
+      vsum0 = vmlaq_f32(vsum0, vm0, vv0);
+      vsum1 = vmlaq_f32(vsum1, vm1, vv1);
 
-        m_ptr0 += 8;
-        v_ptr0 += 8;
-      }
+      m_ptr0 += 8;
+      v_ptr0 += 8;
+    }
 
-      for (; w + 3 < width; w += 4) {
-        vm0 = vld1q_f32(m_ptr0);
-        vv0 = vld1q_f32(v_ptr0);
-        vsum0 = vmlaq_f32(vsum0, vm0, vv0);
+    for (; w + 3 < width; w += 4) {
+      vm0 = vld1q_f32(m_ptr0);
+      vv0 = vld1q_f32(v_ptr0);
+      vsum0 = vmlaq_f32(vsum0, vm0, vv0);
 
-        m_ptr0 += 4;
-        v_ptr0 += 4;
-      }
-      vsum0 += vsum1;
-      vsum2 += vsum3;
-      vsum0 += vsum2;
-      float sum0 = vaddvq_f32(vsum0);
-
-      // handle remaining w
-      for (; w < width; ++w) {
-        sum0 += m_ptr0[0] * v_ptr0[0];
-        m_ptr0++;
-        v_ptr0++;
-      }
-      *out_ptr0++ = sum0;
-    }    // h
-  }      // b
+      m_ptr0 += 4;
+      v_ptr0 += 4;
+    }
+    vsum0 += vsum1;
+    vsum2 += vsum3;
+    vsum0 += vsum2;
+    float sum0 = vaddvq_f32(vsum0);
+
+    // handle remaining w
+    for (; w < width; ++w) {
+      sum0 += m_ptr0[0] * v_ptr0[0];
+      m_ptr0++;
+      v_ptr0++;
+    }
+    *out_ptr0++ = sum0;
+  });      // b
 #else
   GemvRef(m_ptr, v_ptr, batch, width, height, out_ptr);
 #endif
@@ -15,10 +15,13 @@
 #ifndef MACE_KERNELS_GEMMLOWP_UTIL_H_
 #define MACE_KERNELS_GEMMLOWP_UTIL_H_
 
+#include <algorithm>
 #include <tuple>
 
 #include "public/gemmlowp.h"
+#include "mace/core/runtime/cpu/cpu_runtime.h"
 #include "mace/kernels/quantize.h"
+#include "mace/utils/utils.h"
 
 namespace mace {
 
@@ -72,6 +75,58 @@ struct GemmlowpOutputPipeline {
     return std::make_tuple(quantize_down_stage, saturating_cast_stage);
   }
 };
+
+// Multiplies lhs by rhs into result with gemmlowp, on the gemmlowp threads.
+// With an executor, they would compete with the threads of the
+// application, so the result is split in blocks of rows or columns,
+// whichever are more, which run on the thread pool of the calling thread
+// with a single-threaded context each. make_pipeline(start_row, rows)
+// makes the output pipeline of the result rows from start_row.
+template <typename BitDepthParams,
+          gemmlowp::MapOrder LhsOrder,
+          gemmlowp::MapOrder RhsOrder,
+          gemmlowp::MapOrder ResultOrder,
+          typename MakePipeline>
+void GemmlowpMultiply(CPURuntime *cpu_runtime,
+                      const gemmlowp::MatrixMap<const uint8_t, LhsOrder> &lhs,
+                      const gemmlowp::MatrixMap<const uint8_t, RhsOrder> &rhs,
+                      gemmlowp::MatrixMap<uint8_t, ResultOrder> *result,
+                      const int lhs_offset,
+                      const int rhs_offset,
+                      const MakePipeline &make_pipeline) {
+  const int rows = result->rows();
+  const int cols = result->cols();
+  if (cpu_runtime->executor() == nullptr) {
+    gemmlowp::GemmWithOutputPipeline<uint8_t, uint8_t, BitDepthParams>(
+        cpu_runtime->GetGemmlowpContext(), lhs, rhs, result, lhs_offset,
+        rhs_offset, make_pipeline(0, rows));
+    return;
+  }
+
+  // Blocks of at least a few kernel widths
+  const int kMinBlockSize = 16;
+  const bool split_rows = rows >= cols;
+  const int size = split_rows ? rows : cols;
+  const int num_blocks =
+      std::max(1, std::min(ParallelThreadCount(), size / kMinBlockSize));
+  const int block_size = RoundUp(RoundUpDiv(size, num_blocks), 4);
+  ParallelFor(0, size, block_size, [&](index_t start) {
+    const int block = std::min<int>(block_size, size - start);
+    gemmlowp::GemmContext *gemm_context =
+        CPURuntime::GetThreadGemmlowpContext();
+    if (split_rows) {
+      auto result_block = result->block(start, 0, block, cols);
+      gemmlowp::GemmWithOutputPipeline<uint8_t, uint8_t, BitDepthParams>(
+          gemm_context, lhs.block(start, 0, block, lhs.cols()), rhs,
+          &result_block, lhs_offset, rhs_offset, make_pipeline(start, block));
+    } else {
+      auto result_block = result->block(0, start, rows, block);
+      gemmlowp::GemmWithOutputPipeline<uint8_t, uint8_t, BitDepthParams>(
+          gemm_context, lhs, rhs.block(0, start, rhs.rows(), block),
+          &result_block, lhs_offset, rhs_offset, make_pipeline(0, rows));
+    }
+  });
+}
 }  // namespace mace
 
 #endif  // MACE_KERNELS_GEMMLOWP_UTIL_H_
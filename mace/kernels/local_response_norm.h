@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 
@@ -57,26 +58,23 @@ struct LocalResponseNormFunctor<DeviceType::CPU, float> : OpKernel {
     index_t image_size = height * width;
     index_t batch_size = channels * image_size;
 
-#pragma omp parallel for collapse(2)
-    for (index_t b = 0; b < batch; ++b) {
-      for (index_t c = 0; c < channels; ++c) {
-        const int begin_input_c = std::max(static_cast<index_t>(0),
-                                           c - depth_radius);
-        const int end_input_c = std::min(channels, c + depth_radius + 1);
+    ParallelFor2D(0, batch, 0, channels, [&](index_t b, index_t c) {
+      const int begin_input_c = std::max(static_cast<index_t>(0),
+                                         c - depth_radius);
+      const int end_input_c = std::min(channels, c + depth_radius + 1);
 
-        index_t pos = b * batch_size;
-        for (index_t hw = 0; hw < height * width; ++hw, ++pos) {
-          float accum = 0.f;
-          for (int input_c = begin_input_c; input_c < end_input_c; ++input_c) {
-            const float input_val = input_ptr[pos + input_c * image_size];
-            accum += input_val * input_val;
-          }
-          const float multiplier = std::pow(bias + alpha * accum, -beta);
-          output_ptr[pos + c * image_size] =
-            input_ptr[pos + c * image_size] * multiplier;
+      index_t pos = b * batch_size;
+      for (index_t hw = 0; hw < height * width; ++hw, ++pos) {
+        float accum = 0.f;
+        for (int input_c = begin_input_c; input_c < end_input_c; ++input_c) {
+          const float input_val = input_ptr[pos + input_c * image_size];
+          accum += input_val * input_val;
         }
+        const float multiplier = std::pow(bias + alpha * accum, -beta);
+        output_ptr[pos + c * image_size] =
+          input_ptr[pos + c * image_size] * multiplier;
       }
-    }
+    });
 
     return MACE_SUCCESS;
   }
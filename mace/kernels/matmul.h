@@ -126,9 +126,6 @@ struct MatMulFunctor<CPU, uint8_t> : OpKernel {
                   const index_t K,
                   const index_t width,
                   Tensor *C) {
-    auto gemm_context = context_->device()->cpu_runtime()->GetGemmlowpContext();
-    MACE_CHECK_NOTNULL(gemm_context);
-
     Tensor::MappingGuard guarda(A);
     Tensor::MappingGuard guardb(B);
     Tensor::MappingGuard guardc(C);
@@ -153,9 +150,10 @@ struct MatMulFunctor<CPU, uint8_t> : OpKernel {
           c_matrix(c_ptr_base + i * c_size, height, width);
 
       using BitDepthParams = gemmlowp::L8R8WithLhsNonzeroBitDepthParams;
-      gemmlowp::GemmWithOutputPipeline<uint8_t, uint8_t, BitDepthParams>(
-          gemm_context, a_matrix, b_matrix, &c_matrix, -A->zero_point(),
-          -B->zero_point(), output_pipeline);
+      GemmlowpMultiply<BitDepthParams>(
+          context_->device()->cpu_runtime(), a_matrix, b_matrix, &c_matrix,
+          -A->zero_point(), -B->zero_point(),
+          [&](index_t, index_t) { return output_pipeline; });
     }
   }
 
@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 
@@ -61,21 +62,17 @@ struct PadFunctor : OpKernel {
     const index_t channel = input->dim(1);
     const index_t height = input->dim(2);
     const index_t width = input->dim(3);
-#pragma omp parallel for collapse(3)
-    for (index_t b = 0; b < batch; ++b) {
-      for (index_t c = 0; c < channel; ++c) {
-        for (index_t h = 0; h < height; ++h) {
-          const index_t in_offset = (((b * channel + c) * height) + h) * width;
-          const index_t out_offset = (((b + this->paddings_[0]) * output->dim(1)
-              + (c + this->paddings_[2])) * output->dim(2)
-              + (h + this->paddings_[4])) * output->dim(3)
-              + this->paddings_[6];
-          memcpy(output_ptr + out_offset,
-                 input_ptr + in_offset,
-                 width * sizeof(T));
-        }
-      }
-    }
+    ParallelFor3D(0, batch, 0, channel, 0, height,
+                  [&](index_t b, index_t c, index_t h) {
+      const index_t in_offset = (((b * channel + c) * height) + h) * width;
+      const index_t out_offset = (((b + this->paddings_[0]) * output->dim(1)
+          + (c + this->paddings_[2])) * output->dim(2)
+          + (h + this->paddings_[4])) * output->dim(3)
+          + this->paddings_[6];
+      memcpy(output_ptr + out_offset,
+             input_ptr + in_offset,
+             width * sizeof(T));
+    });
 
     return MACE_SUCCESS;
   }
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/conv_pool_2d_util.h"
 #include "mace/kernels/kernel.h"
@@ -95,37 +96,34 @@ struct PoolingFunctor<DeviceType::CPU, float>: PoolingFunctorBase {
     const index_t in_batch_size = in_shape[1] * in_image_size;
     const index_t out_batch_size = out_shape[1] * out_image_size;
 
-#pragma omp parallel for collapse(2)
-    for (index_t b = 0; b < out_shape[0]; ++b) {
-      for (index_t c = 0; c < out_shape[1]; ++c) {
-        const index_t out_base = b * out_batch_size + c * out_image_size;
-        const index_t in_base = b * in_batch_size + c * in_image_size;
-        const index_t out_height = out_shape[2];
-        const index_t out_width = out_shape[3];
-        const index_t in_height = in_shape[2];
-        const index_t in_width = in_shape[3];
-
-        for (index_t h = 0; h < out_height; ++h) {
-          for (index_t w = 0; w < out_width; ++w) {
-            const index_t out_offset = out_base + h * out_width + w;
-            float res = std::numeric_limits<float>::lowest();
-            for (int fh = 0; fh < filter_hw[0]; ++fh) {
-              for (int fw = 0; fw < filter_hw[1]; ++fw) {
-                index_t inh =
-                    h * stride_hw[0] + dilation_hw[0] * fh - pad_hw[0];
-                index_t inw =
-                    w * stride_hw[1] + dilation_hw[1] * fw - pad_hw[1];
-                if (inh >= 0 && inh < in_height && inw >= 0 && inw < in_width) {
-                  index_t input_offset = in_base + inh * in_width + inw;
-                  res = std::max(res, input[input_offset]);
-                }
+    ParallelFor2D(0, out_shape[0], 0, out_shape[1], [&](index_t b, index_t c) {
+      const index_t out_base = b * out_batch_size + c * out_image_size;
+      const index_t in_base = b * in_batch_size + c * in_image_size;
+      const index_t out_height = out_shape[2];
+      const index_t out_width = out_shape[3];
+      const index_t in_height = in_shape[2];
+      const index_t in_width = in_shape[3];
+
+      for (index_t h = 0; h < out_height; ++h) {
+        for (index_t w = 0; w < out_width; ++w) {
+          const index_t out_offset = out_base + h * out_width + w;
+          float res = std::numeric_limits<float>::lowest();
+          for (int fh = 0; fh < filter_hw[0]; ++fh) {
+            for (int fw = 0; fw < filter_hw[1]; ++fw) {
+              index_t inh =
+                  h * stride_hw[0] + dilation_hw[0] * fh - pad_hw[0];
+              index_t inw =
+                  w * stride_hw[1] + dilation_hw[1] * fw - pad_hw[1];
+              if (inh >= 0 && inh < in_height && inw >= 0 && inw < in_width) {
+                index_t input_offset = in_base + inh * in_width + inw;
+                res = std::max(res, input[input_offset]);
               }
             }
-            output[out_offset] = res;
           }
+          output[out_offset] = res;
         }
       }
-    }
+    });
   }
 
   void AvgPooling(const float *input,
@@ -141,38 +139,35 @@ struct PoolingFunctor<DeviceType::CPU, float>: PoolingFunctorBase {
     const index_t in_batch_size = in_shape[1] * in_image_size;
     const index_t out_batch_size = out_shape[1] * out_image_size;
 
-#pragma omp parallel for collapse(2)
-    for (index_t b = 0; b < out_shape[0]; ++b) {
-      for (index_t c = 0; c < out_shape[1]; ++c) {
-        const index_t out_base = b * out_batch_size + c * out_image_size;
-        const index_t in_base = b * in_batch_size + c * in_image_size;
-        const index_t in_height = in_shape[2];
-        const index_t in_width = in_shape[3];
-        const index_t out_height = out_shape[2];
-        const index_t out_width = out_shape[3];
-        for (index_t h = 0; h < out_height; ++h) {
-          for (index_t w = 0; w < out_width; ++w) {
-            const index_t out_offset = out_base + h * out_width + w;
-            float res = 0;
-            int block_size = 0;
-            for (int fh = 0; fh < filter_hw[0]; ++fh) {
-              for (int fw = 0; fw < filter_hw[1]; ++fw) {
-                index_t inh =
-                    h * stride_hw[0] + dilation_hw[0] * fh - pad_hw[0];
-                index_t inw =
-                    w * stride_hw[1] + dilation_hw[1] * fw - pad_hw[1];
-                if (inh >= 0 && inh < in_height && inw >= 0 && inw < in_width) {
-                  index_t input_offset = in_base + inh * in_width + inw;
-                  res += input[input_offset];
-                  ++block_size;
-                }
+    ParallelFor2D(0, out_shape[0], 0, out_shape[1], [&](index_t b, index_t c) {
+      const index_t out_base = b * out_batch_size + c * out_image_size;
+      const index_t in_base = b * in_batch_size + c * in_image_size;
+      const index_t in_height = in_shape[2];
+      const index_t in_width = in_shape[3];
+      const index_t out_height = out_shape[2];
+      const index_t out_width = out_shape[3];
+      for (index_t h = 0; h < out_height; ++h) {
+        for (index_t w = 0; w < out_width; ++w) {
+          const index_t out_offset = out_base + h * out_width + w;
+          float res = 0;
+          int block_size = 0;
+          for (int fh = 0; fh < filter_hw[0]; ++fh) {
+            for (int fw = 0; fw < filter_hw[1]; ++fw) {
+              index_t inh =
+                  h * stride_hw[0] + dilation_hw[0] * fh - pad_hw[0];
+              index_t inw =
+                  w * stride_hw[1] + dilation_hw[1] * fw - pad_hw[1];
+              if (inh >= 0 && inh < in_height && inw >= 0 && inw < in_width) {
+                index_t input_offset = in_base + inh * in_width + inw;
+                res += input[input_offset];
+                ++block_size;
               }
             }
-            output[out_offset] = res / block_size;
           }
+          output[out_offset] = res / block_size;
         }
       }
-    }
+    });
   }
 
   MaceStatus operator()(const Tensor *input_tensor,  // NCHW
@@ -257,54 +252,50 @@ struct PoolingFunctor<DeviceType::CPU, uint8_t>: PoolingFunctorBase {
                   const int *stride_hw,
                   const int *pad_hw,
                   uint8_t *output) {
-#pragma omp parallel for collapse(3)
-    for (index_t b = 0; b < out_shape[0]; ++b) {
-      for (index_t h = 0; h < out_shape[1]; ++h) {
-        for (index_t w = 0; w < out_shape[2]; ++w) {
-          const index_t out_height = out_shape[1];
-          const index_t out_width = out_shape[2];
-          const index_t channels = out_shape[3];
-          const index_t in_height = in_shape[1];
-          const index_t in_width = in_shape[2];
-          const index_t in_h_base = h * stride_hw[0] - pad_hw[0];
-          const index_t in_w_base = w * stride_hw[1] - pad_hw[1];
-          const index_t in_h_begin = std::max<index_t>(0, in_h_base);
-          const index_t in_w_begin = std::max<index_t>(0, in_w_base);
-          const index_t in_h_end =
-              std::min(in_height, in_h_base + filter_hw[0]);
-          const index_t in_w_end =
-              std::min(in_width, in_w_base + filter_hw[1]);
-
-          uint8_t *out_ptr =
-              output + ((b * out_height + h) * out_width + w) * channels;
-          std::fill_n(out_ptr, channels, 0);
-          for (index_t ih = in_h_begin; ih < in_h_end; ++ih) {
-            for (index_t iw = in_w_begin; iw < in_w_end; ++iw) {
-              const uint8_t *in_ptr = input +
-                  ((b * in_height + ih) * in_width + iw) * channels;
-              index_t c = 0;
+    ParallelFor3D(0, out_shape[0], 0, out_shape[1], 0, out_shape[2],
+                  [&](index_t b, index_t h, index_t w) {
+      const index_t out_height = out_shape[1];
+      const index_t out_width = out_shape[2];
+      const index_t channels = out_shape[3];
+      const index_t in_height = in_shape[1];
+      const index_t in_width = in_shape[2];
+      const index_t in_h_base = h * stride_hw[0] - pad_hw[0];
+      const index_t in_w_base = w * stride_hw[1] - pad_hw[1];
+      const index_t in_h_begin = std::max<index_t>(0, in_h_base);
+      const index_t in_w_begin = std::max<index_t>(0, in_w_base);
+      const index_t in_h_end =
+          std::min(in_height, in_h_base + filter_hw[0]);
+      const index_t in_w_end =
+          std::min(in_width, in_w_base + filter_hw[1]);
+
+      uint8_t *out_ptr =
+          output + ((b * out_height + h) * out_width + w) * channels;
+      std::fill_n(out_ptr, channels, 0);
+      for (index_t ih = in_h_begin; ih < in_h_end; ++ih) {
+        for (index_t iw = in_w_begin; iw < in_w_end; ++iw) {
+          const uint8_t *in_ptr = input +
+              ((b * in_height + ih) * in_width + iw) * channels;
+          index_t c = 0;
 #if defined(MACE_ENABLE_NEON)
-              for (; c <= channels - 16; c += 16) {
-                uint8x16_t out_vec = vld1q_u8(out_ptr + c);
-                uint8x16_t in_vec = vld1q_u8(in_ptr + c);
-                out_vec = vmaxq_u8(out_vec, in_vec);
-                vst1q_u8(out_ptr + c, out_vec);
-              }
-              for (; c <= channels - 8; c += 8) {
-                uint8x8_t out_vec = vld1_u8(out_ptr + c);
-                uint8x8_t in_vec = vld1_u8(in_ptr + c);
-                out_vec = vmax_u8(out_vec, in_vec);
-                vst1_u8(out_ptr + c, out_vec);
-              }
+          for (; c <= channels - 16; c += 16) {
+            uint8x16_t out_vec = vld1q_u8(out_ptr + c);
+            uint8x16_t in_vec = vld1q_u8(in_ptr + c);
+            out_vec = vmaxq_u8(out_vec, in_vec);
+            vst1q_u8(out_ptr + c, out_vec);
+          }
+          for (; c <= channels - 8; c += 8) {
+            uint8x8_t out_vec = vld1_u8(out_ptr + c);
+            uint8x8_t in_vec = vld1_u8(in_ptr + c);
+            out_vec = vmax_u8(out_vec, in_vec);
+            vst1_u8(out_ptr + c, out_vec);
+          }
 #endif
-              for (; c < channels; ++c) {
-                out_ptr[c] = std::max(out_ptr[c], in_ptr[c]);
-              }
-            }
+          for (; c < channels; ++c) {
+            out_ptr[c] = std::max(out_ptr[c], in_ptr[c]);
           }
         }
       }
-    }
+    });
   }
 
   void AvgPooling(const uint8_t *input,
@@ -314,67 +305,63 @@ struct PoolingFunctor<DeviceType::CPU, uint8_t>: PoolingFunctorBase {
                   const int *stride_hw,
                   const int *pad_hw,
                   uint8_t *output) {
-#pragma omp parallel for collapse(3)
-    for (index_t b = 0; b < out_shape[0]; ++b) {
-      for (index_t h = 0; h < out_shape[1]; ++h) {
-        for (index_t w = 0; w < out_shape[2]; ++w) {
-          const index_t out_height = out_shape[1];
-          const index_t out_width = out_shape[2];
-          const index_t channels = out_shape[3];
-          const index_t in_height = in_shape[1];
-          const index_t in_width = in_shape[2];
-          const index_t in_h_base = h * stride_hw[0] - pad_hw[0];
-          const index_t in_w_base = w * stride_hw[1] - pad_hw[1];
-          const index_t in_h_begin = std::max<index_t>(0, in_h_base);
-          const index_t in_w_begin = std::max<index_t>(0, in_w_base);
-          const index_t in_h_end =
-              std::min(in_height, in_h_base + filter_hw[0]);
-          const index_t in_w_end =
-              std::min(in_width, in_w_base + filter_hw[1]);
-          const index_t block_size =
-              (in_h_end - in_h_begin) * (in_w_end - in_w_begin);
-          MACE_CHECK(block_size > 0);
-
-          std::vector<uint16_t> average_buffer(channels);
-          uint16_t *avg_buffer = average_buffer.data();
-          std::fill_n(avg_buffer, channels, 0);
-          for (index_t ih = in_h_begin; ih < in_h_end; ++ih) {
-            for (index_t iw = in_w_begin; iw < in_w_end; ++iw) {
-              const uint8_t *in_ptr = input +
-                  ((b * in_height + ih) * in_width + iw) * channels;
-              index_t c = 0;
+    ParallelFor3D(0, out_shape[0], 0, out_shape[1], 0, out_shape[2],
+                  [&](index_t b, index_t h, index_t w) {
+      const index_t out_height = out_shape[1];
+      const index_t out_width = out_shape[2];
+      const index_t channels = out_shape[3];
+      const index_t in_height = in_shape[1];
+      const index_t in_width = in_shape[2];
+      const index_t in_h_base = h * stride_hw[0] - pad_hw[0];
+      const index_t in_w_base = w * stride_hw[1] - pad_hw[1];
+      const index_t in_h_begin = std::max<index_t>(0, in_h_base);
+      const index_t in_w_begin = std::max<index_t>(0, in_w_base);
+      const index_t in_h_end =
+          std::min(in_height, in_h_base + filter_hw[0]);
+      const index_t in_w_end =
+          std::min(in_width, in_w_base + filter_hw[1]);
+      const index_t block_size =
+          (in_h_end - in_h_begin) * (in_w_end - in_w_begin);
+      MACE_CHECK(block_size > 0);
+
+      std::vector<uint16_t> average_buffer(channels);
+      uint16_t *avg_buffer = average_buffer.data();
+      std::fill_n(avg_buffer, channels, 0);
+      for (index_t ih = in_h_begin; ih < in_h_end; ++ih) {
+        for (index_t iw = in_w_begin; iw < in_w_end; ++iw) {
+          const uint8_t *in_ptr = input +
+              ((b * in_height + ih) * in_width + iw) * channels;
+          index_t c = 0;
 #if defined(MACE_ENABLE_NEON)
-              for (; c <= channels - 16; c += 16) {
-                uint16x8_t avg_vec[2];
-                avg_vec[0] = vld1q_u16(avg_buffer + c);
-                avg_vec[1] = vld1q_u16(avg_buffer + c + 8);
-                uint8x16_t in_vec = vld1q_u8(in_ptr + c);
-                avg_vec[0] = vaddw_u8(avg_vec[0], vget_low_u8(in_vec));
-                avg_vec[1] = vaddw_u8(avg_vec[1], vget_high_u8(in_vec));
-                vst1q_u16(avg_buffer + c, avg_vec[0]);
-                vst1q_u16(avg_buffer + c + 8, avg_vec[1]);
-              }
-              for (; c <= channels - 8; c += 8) {
-                uint16x8_t avg_vec = vld1q_u16(avg_buffer + c);
-                uint8x8_t in_vec = vld1_u8(in_ptr + c);
-                avg_vec = vaddw_u8(avg_vec, in_vec);
-                vst1q_u16(avg_buffer + c, avg_vec);
-              }
-#endif
-              for (; c < channels; ++c) {
-                avg_buffer[c] += in_ptr[c];
-              }
-            }
+          for (; c <= channels - 16; c += 16) {
+            uint16x8_t avg_vec[2];
+            avg_vec[0] = vld1q_u16(avg_buffer + c);
+            avg_vec[1] = vld1q_u16(avg_buffer + c + 8);
+            uint8x16_t in_vec = vld1q_u8(in_ptr + c);
+            avg_vec[0] = vaddw_u8(avg_vec[0], vget_low_u8(in_vec));
+            avg_vec[1] = vaddw_u8(avg_vec[1], vget_high_u8(in_vec));
+            vst1q_u16(avg_buffer + c, avg_vec[0]);
+            vst1q_u16(avg_buffer + c + 8, avg_vec[1]);
           }
-          uint8_t *out_ptr =
-              output + ((b * out_height + h) * out_width + w) * channels;
-          for (index_t c = 0; c < channels; ++c) {
-            out_ptr[c] = static_cast<uint8_t>(
-                (avg_buffer[c] + block_size / 2) / block_size);
+          for (; c <= channels - 8; c += 8) {
+            uint16x8_t avg_vec = vld1q_u16(avg_buffer + c);
+            uint8x8_t in_vec = vld1_u8(in_ptr + c);
+            avg_vec = vaddw_u8(avg_vec, in_vec);
+            vst1q_u16(avg_buffer + c, avg_vec);
+          }
+#endif
+          for (; c < channels; ++c) {
+            avg_buffer[c] += in_ptr[c];
           }
         }
       }
-    }
+      uint8_t *out_ptr =
+          output + ((b * out_height + h) * out_width + w) * channels;
+      for (index_t c = 0; c < channels; ++c) {
+        out_ptr[c] = static_cast<uint8_t>(
+            (avg_buffer[c] + block_size / 2) / block_size);
+      }
+    });
   }
 
   MaceStatus operator()(const Tensor *input_tensor,  // NHWC
@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 #include "mace/public/mace.h"
@@ -54,8 +55,7 @@ inline std::vector<std::vector<float>> GenerateAnchors(
   std::vector<std::vector<float>> anchors(scales_size * ratios_size,
                                           std::vector<float>(4));
 
-#pragma omp parallel for
-  for (size_t ratio_idx = 0; ratio_idx < ratios_size; ++ratio_idx) {
+  ParallelFor(0, ratios_size, [&](size_t ratio_idx) {
     float ws = ::roundf(::sqrtf(size / ratios[ratio_idx]));
     float hs = ::roundf(ws * ratios[ratio_idx]);
     std::vector<float> tmp_anchor(4);
@@ -73,7 +73,7 @@ inline std::vector<std::vector<float>> GenerateAnchors(
       anchors[idx][2] = window[2] + (ws - 1) / 2;
       anchors[idx][3] = window[3] + (hs - 1) / 2;
     }
-  }
+  });
   return anchors;
 }
 
@@ -162,57 +162,49 @@ struct ProposalFunctor : OpKernel {
         anchors_size * feat_height * feat_width,
         std::vector<float>(4));
 
-#pragma omp parallel for collapse(3)
-    for (int h_idx = 0; h_idx < feat_height; ++h_idx) {
-      for (int w_idx = 0; w_idx < feat_width; ++w_idx) {
-        for (int a_idx = 0; a_idx < anchors_size; ++a_idx) {
-          const int shift_h = h_idx * feat_stride_;
-          const int shift_w = w_idx * feat_stride_;
-          const index_t sanc_idx = (h_idx * feat_width + w_idx) * anchors_size
-              + a_idx;
-          proposals[sanc_idx][0] = anchors_[a_idx][0] + shift_w;
-          proposals[sanc_idx][1] = anchors_[a_idx][1] + shift_h;
-          proposals[sanc_idx][2] = anchors_[a_idx][2] + shift_w;
-          proposals[sanc_idx][3] = anchors_[a_idx][3] + shift_h;
-        }
-      }
-    }
+    ParallelFor3D(0, feat_height, 0, feat_width, 0, anchors_size,
+                  [&](int h_idx, int w_idx, int a_idx) {
+      const int shift_h = h_idx * feat_stride_;
+      const int shift_w = w_idx * feat_stride_;
+      const index_t sanc_idx = (h_idx * feat_width + w_idx) * anchors_size
+          + a_idx;
+      proposals[sanc_idx][0] = anchors_[a_idx][0] + shift_w;
+      proposals[sanc_idx][1] = anchors_[a_idx][1] + shift_h;
+      proposals[sanc_idx][2] = anchors_[a_idx][2] + shift_w;
+      proposals[sanc_idx][3] = anchors_[a_idx][3] + shift_h;
+    });
     // Convert anchors into proposals via bbox transformations
     // 2. clip predicted boxes to image
     const float *bbox_deltas = rpn_bbox_pred->data<float>();
-#pragma omp parallel for collapse(3)
-    for (int h_idx = 0; h_idx < feat_height; ++h_idx) {
-      for (int w_idx = 0; w_idx < feat_width; ++w_idx) {
-        for (int a_idx = 0; a_idx < anchors_size; ++a_idx) {
-          const index_t sanc_idx = (h_idx * feat_width + w_idx) * anchors_size
-              + a_idx;
-          const float width = proposals[sanc_idx][2] -
-              proposals[sanc_idx][0] + 1;
-          const float height = proposals[sanc_idx][3] -
-              proposals[sanc_idx][1] + 1;
-          int delta_offset = sanc_idx * 4;
-          float pred_ctr_x = bbox_deltas[delta_offset + 0] * width +
-              (proposals[sanc_idx][0] + width / 2);
-          float pred_ctr_y = bbox_deltas[delta_offset + 1] * height +
-              (proposals[sanc_idx][1] + height / 2);
-          float pred_w = std::exp(bbox_deltas[delta_offset + 2]) * width;
-          float pred_h = std::exp(bbox_deltas[delta_offset + 3]) * height;
+    ParallelFor3D(0, feat_height, 0, feat_width, 0, anchors_size,
+                  [&](int h_idx, int w_idx, int a_idx) {
+      const index_t sanc_idx = (h_idx * feat_width + w_idx) * anchors_size
+          + a_idx;
+      const float width = proposals[sanc_idx][2] -
+          proposals[sanc_idx][0] + 1;
+      const float height = proposals[sanc_idx][3] -
+          proposals[sanc_idx][1] + 1;
+      int delta_offset = sanc_idx * 4;
+      float pred_ctr_x = bbox_deltas[delta_offset + 0] * width +
+          (proposals[sanc_idx][0] + width / 2);
+      float pred_ctr_y = bbox_deltas[delta_offset + 1] * height +
+          (proposals[sanc_idx][1] + height / 2);
+      float pred_w = std::exp(bbox_deltas[delta_offset + 2]) * width;
+      float pred_h = std::exp(bbox_deltas[delta_offset + 3]) * height;
 
-          proposals[sanc_idx][0] = std::max<float>(
-              std::min<float>(pred_ctr_x - pred_w / 2, im_width),
-              0);
-          proposals[sanc_idx][1] = std::max<float>(
-              std::min<float>(pred_ctr_y - pred_h / 2, im_height),
-              0);
-          proposals[sanc_idx][2] = std::max<float>(
-              std::min<float>(pred_ctr_x + pred_w / 2, im_width),
-              0);
-          proposals[sanc_idx][3] = std::max<float>(
-              std::min<float>(pred_ctr_y + pred_h / 2, im_height),
-              0);
-        }
-      }
-    }
+      proposals[sanc_idx][0] = std::max<float>(
+          std::min<float>(pred_ctr_x - pred_w / 2, im_width),
+          0);
+      proposals[sanc_idx][1] = std::max<float>(
+          std::min<float>(pred_ctr_y - pred_h / 2, im_height),
+          0);
+      proposals[sanc_idx][2] = std::max<float>(
+          std::min<float>(pred_ctr_x + pred_w / 2, im_width),
+          0);
+      proposals[sanc_idx][3] = std::max<float>(
+          std::min<float>(pred_ctr_y + pred_h / 2, im_height),
+          0);
+    });
     // 3. remove predicted boxes with either height or width < threshold
     // (NOTE: convert min_size to input image scale stored in im_info[2])
     std::vector<int> keep;
@@ -250,14 +242,13 @@ struct ProposalFunctor : OpKernel {
     int size = std::min<int>(pre_nms_top_n_, keep.size());
     std::vector<float> nms_scores(size, 0);
     std::vector<float> nms_proposals((size << 2), 0);
-#pragma omp parallel for
-    for (int i = 0; i < size; ++i) {
+    ParallelFor(0, size, [&](int i) {
       nms_scores[i] = scores[score_idx_func(keep[i])];
       nms_proposals[i << 2] = proposals[keep[i]][0];
       nms_proposals[(i << 2) + 1] = proposals[keep[i]][1];
       nms_proposals[(i << 2) + 2] = proposals[keep[i]][2];
       nms_proposals[(i << 2) + 3] = proposals[keep[i]][3];
-    }
+    });
 
     /* 6. apply nms (e.g. threshold = 0.7)
        7. take after_nms_topN (e.g. 300)
@@ -273,8 +264,7 @@ struct ProposalFunctor : OpKernel {
     size = static_cast<int>(nms_result.size());
     MACE_RETURN_IF_ERROR(output->Resize({size, 1, 1, 5}));
     auto output_ptr = output->mutable_data<float>();
-#pragma omp parallel for
-    for (int i = 0; i < size; ++i) {
+    ParallelFor(0, size, [&](int i) {
       const int out_idx = i * 5;
       const int nms_idx = nms_result[i] * 4;
       output_ptr[out_idx] = 0;
@@ -282,7 +272,7 @@ struct ProposalFunctor : OpKernel {
       output_ptr[out_idx + 2] = nms_proposals[nms_idx + 1];
       output_ptr[out_idx + 3] = nms_proposals[nms_idx + 2];
       output_ptr[out_idx + 4] = nms_proposals[nms_idx + 3];
-    }
+    });
 
     return MACE_SUCCESS;
   }
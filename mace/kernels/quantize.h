@@ -21,6 +21,7 @@
 #include <limits>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 #include "mace/utils/quantize.h"
@@ -28,6 +29,9 @@
 namespace mace {
 namespace kernels {
 
+// The elements a thread (de)quantizes at a time
+constexpr index_t kQuantizeBlockSize = 1 << 14;
+
 template<DeviceType D, typename T>
 struct QuantizeFunctor;
 
@@ -44,24 +48,27 @@ struct QuantizeFunctor<CPU, uint8_t> : OpKernel {
     Tensor::MappingGuard output_guard(output);
     const float *input_data = input->data<float>();
     uint8_t *output_data = output->mutable_data<uint8_t>();
-    if (output->scale() > 0.f) {
-      QuantizeWithScaleAndZeropoint(input_data,
-                                    input->size(),
-                                    output->scale(),
-                                    output->zero_point(),
-                                    output_data);
-    } else {
+    const index_t size = input->size();
+    if (output->scale() <= 0.f) {
+      float in_min_data;
+      float in_max_data;
+      FindMinMax(input_data, size, &in_min_data, &in_max_data);
       float scale;
       int32_t zero_point;
-      Quantize(input_data,
-               input->size(),
-               non_zero,
-               output_data,
-               &scale,
-               &zero_point);
+      AdjustRange<uint8_t>(in_min_data, in_max_data, non_zero,
+                           &scale, &zero_point);
       output->SetScale(scale);
       output->SetZeroPoint(zero_point);
     }
+    const float scale = output->scale();
+    const int32_t zero_point = output->zero_point();
+    ParallelFor(0, size, kQuantizeBlockSize, [&](index_t begin) {
+      QuantizeWithScaleAndZeropoint(input_data + begin,
+                                    std::min(kQuantizeBlockSize, size - begin),
+                                    scale,
+                                    zero_point,
+                                    output_data + begin);
+    });
 
     return MACE_SUCCESS;
   }
@@ -82,11 +89,14 @@ struct DequantizeFunctor<CPU, uint8_t> : OpKernel {
     Tensor::MappingGuard output_guard(output);
     const uint8_t *input_data = input->data<uint8_t>();
     float *output_data = output->mutable_data<float>();
-    Dequantize(input_data,
-               input->size(),
-               input->scale(),
-               input->zero_point(),
-               output_data);
+    const index_t size = input->size();
+    ParallelFor(0, size, kQuantizeBlockSize, [&](index_t begin) {
+      Dequantize(input_data + begin,
+                 std::min(kQuantizeBlockSize, size - begin),
+                 input->scale(),
+                 input->zero_point(),
+                 output_data + begin);
+    });
 
     return MACE_SUCCESS;
   }
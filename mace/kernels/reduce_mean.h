@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 namespace mace {
@@ -97,35 +98,31 @@ struct ReduceMeanFunctor : OpKernel {
           }
           output_ptr[0] = sum / data_reshape_[0];
         } else {
-#pragma omp parallel for
-          for (int i = 0; i < data_reshape_[0]; ++i) {
+          ParallelFor(0, data_reshape_[0], [&](int i) {
             output_ptr[i] = input_ptr[i];
-          }
+          });
         }
         break;
       case 2:
         if (reduce_first_axis_) {
-#pragma omp parallel for
-          for (int i = 0; i < data_reshape_[1]; ++i) {
+          ParallelFor(0, data_reshape_[1], [&](int i) {
             for (int j = 0; j < data_reshape_[0]; ++j) {
               output_ptr[i] += input_ptr[j * data_reshape_[1] + i];
             }
             output_ptr[i] /= data_reshape_[0];
-          }
+          });
         } else {
-#pragma omp parallel for
-          for (int i = 0; i < data_reshape_[0]; ++i) {
+          ParallelFor(0, data_reshape_[0], [&](int i) {
             for (int j = 0; j < data_reshape_[1]; ++j) {
               output_ptr[i] += input_ptr[i * data_reshape_[1] + j];
             }
             output_ptr[i] /= data_reshape_[1];
-          }
+          });
         }
         break;
       case 3:
         if (reduce_first_axis_) {
-#pragma omp parallel for
-          for (int i = 0; i < data_reshape_[1]; ++i) {
+          ParallelFor(0, data_reshape_[1], [&](int i) {
             for (int j = 0; j < data_reshape_[2]; ++j) {
               for (int k = 0; k < data_reshape_[0]; ++k) {
                 output_ptr[i] +=
@@ -134,52 +131,46 @@ struct ReduceMeanFunctor : OpKernel {
               }
             }
             output_ptr[i] /= (data_reshape_[0] * data_reshape_[2]);
-          }
+          });
         } else {
-#pragma omp parallel for collapse(2)
-          for (int i = 0; i < data_reshape_[0]; ++i) {
-            for (int j = 0; j < data_reshape_[2]; ++j) {
-              for (int k = 0; k < data_reshape_[1]; ++k) {
-                output_ptr[i * data_reshape_[2] + j] +=
-                    input_ptr[(i * data_reshape_[1] + k) * data_reshape_[2]
-                        + j];
-              }
-              output_ptr[i * data_reshape_[2] + j] /= data_reshape_[1];
+          ParallelFor2D(0, data_reshape_[0], 0, data_reshape_[2],
+                        [&](int i, int j) {
+            for (int k = 0; k < data_reshape_[1]; ++k) {
+              output_ptr[i * data_reshape_[2] + j] +=
+                  input_ptr[(i * data_reshape_[1] + k) * data_reshape_[2]
+                      + j];
             }
-          }
+            output_ptr[i * data_reshape_[2] + j] /= data_reshape_[1];
+          });
         }
         break;
       case 4:
         if (reduce_first_axis_) {
-#pragma omp parallel for collapse(2)
-          for (int i = 0; i < data_reshape_[1]; ++i) {
-            for (int j = 0; j < data_reshape_[3]; ++j) {
-              for (int k = 0; k < data_reshape_[2]; ++k) {
-                for (int t = 0; t < data_reshape_[0]; ++t) {
-                  output_ptr[i * data_reshape_[3] + j] +=
-                      input_ptr[((t * data_reshape_[1] + i) *
-                          data_reshape_[2] + k)*data_reshape_[3] + j];
-                }
+          ParallelFor2D(0, data_reshape_[1], 0, data_reshape_[3],
+                        [&](int i, int j) {
+            for (int k = 0; k < data_reshape_[2]; ++k) {
+              for (int t = 0; t < data_reshape_[0]; ++t) {
+                output_ptr[i * data_reshape_[3] + j] +=
+                    input_ptr[((t * data_reshape_[1] + i) *
+                        data_reshape_[2] + k)*data_reshape_[3] + j];
               }
-              output_ptr[i * data_reshape_[3] + j] /=
-                  (data_reshape_[0] * data_reshape_[2]);
             }
-          }
+            output_ptr[i * data_reshape_[3] + j] /=
+                (data_reshape_[0] * data_reshape_[2]);
+          });
         } else {
-#pragma omp parallel for collapse(2)
-          for (int i = 0; i < data_reshape_[0]; ++i) {
-            for (int j = 0; j < data_reshape_[2]; ++j) {
-              for (int k = 0; k < data_reshape_[1]; ++k) {
-                for (int t = 0; t < data_reshape_[3]; ++t) {
-                  output_ptr[i * data_reshape_[2] + j] +=
-                      input_ptr[((i * data_reshape_[1] + k) *
-                          data_reshape_[2] + j)*data_reshape_[3] + t];
-                }
+          ParallelFor2D(0, data_reshape_[0], 0, data_reshape_[2],
+                        [&](int i, int j) {
+            for (int k = 0; k < data_reshape_[1]; ++k) {
+              for (int t = 0; t < data_reshape_[3]; ++t) {
+                output_ptr[i * data_reshape_[2] + j] +=
+                    input_ptr[((i * data_reshape_[1] + k) *
+                        data_reshape_[2] + j)*data_reshape_[3] + t];
               }
-              output_ptr[i * data_reshape_[2] + j] /=
-                  (data_reshape_[1] * data_reshape_[3]);
             }
-          }
+            output_ptr[i * data_reshape_[2] + j] /=
+                (data_reshape_[1] * data_reshape_[3]);
+          });
         }
         break;
       default:
@@ -195,7 +186,7 @@ struct ReduceMeanFunctor : OpKernel {
                         StatsFuture *future) {
     MACE_UNUSED(future);
     Simplify(input);
-    output->Resize(out_shape_);
+    MACE_RETURN_IF_ERROR(output->Resize(out_shape_));
     Compute(input, output);
     return MACE_SUCCESS;
   }
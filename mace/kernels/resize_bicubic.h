@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 #include "mace/utils/logging.h"
@@ -96,45 +97,42 @@ inline void ResizeImage(const float *images,
                         const float height_scale,
                         const float width_scale,
                         float *output) {
-#pragma omp parallel for collapse(2)
-  for (index_t b = 0; b < batch_size; ++b) {
-    for (index_t y = 0; y < out_height; ++y) {
-      std::vector<float> y_weights;
-      std::vector<index_t> y_indices;
-      GetWeightsAndIndices(height_scale, y, in_height, &y_weights,
-                           &y_indices);
-      for (index_t x = 0; x < out_width; ++x) {
-        std::vector<float> x_weights;
-        std::vector<index_t> x_indices;
-        GetWeightsAndIndices(width_scale, x, in_width, &x_weights,
-                             &x_indices);
-
-        for (index_t c = 0; c < channels; ++c) {
-          // Use a 4x4 patch to compute the interpolated output value at
-          // (b, y, x, c).
-          const float *channel_input_ptr =
-                  images + (b * channels + c) * in_height * in_width;
-          float *channel_output_ptr =
-                  output + (b * channels + c) * out_height * out_width;
-          std::vector<float> coeff(4, 0.0);
-          for (index_t i = 0; i < 4; ++i) {
-            const std::vector<float> values = {
-              static_cast<float>(channel_input_ptr
-                  [y_indices[i] * in_width + x_indices[0]]),
-              static_cast<float>(channel_input_ptr
-                  [y_indices[i] * in_width + x_indices[1]]),
-              static_cast<float>(channel_input_ptr
-                  [y_indices[i] * in_width + x_indices[2]]),
-              static_cast<float>(channel_input_ptr
-                  [y_indices[i] * in_width + x_indices[3]])};
-            coeff[i] = Interpolate1D(x_weights, values);
-          }
-          channel_output_ptr[y * out_width + x] =
-                  Interpolate1D(y_weights, coeff);
+  ParallelFor2D(0, batch_size, 0, out_height, [&](index_t b, index_t y) {
+    std::vector<float> y_weights;
+    std::vector<index_t> y_indices;
+    GetWeightsAndIndices(height_scale, y, in_height, &y_weights,
+                         &y_indices);
+    for (index_t x = 0; x < out_width; ++x) {
+      std::vector<float> x_weights;
+      std::vector<index_t> x_indices;
+      GetWeightsAndIndices(width_scale, x, in_width, &x_weights,
+                           &x_indices);
+
+      for (index_t c = 0; c < channels; ++c) {
+        // Use a 4x4 patch to compute the interpolated output value at
+        // (b, y, x, c).
+        const float *channel_input_ptr =
+                images + (b * channels + c) * in_height * in_width;
+        float *channel_output_ptr =
+                output + (b * channels + c) * out_height * out_width;
+        std::vector<float> coeff(4, 0.0);
+        for (index_t i = 0; i < 4; ++i) {
+          const std::vector<float> values = {
+            static_cast<float>(channel_input_ptr
+                [y_indices[i] * in_width + x_indices[0]]),
+            static_cast<float>(channel_input_ptr
+                [y_indices[i] * in_width + x_indices[1]]),
+            static_cast<float>(channel_input_ptr
+                [y_indices[i] * in_width + x_indices[2]]),
+            static_cast<float>(channel_input_ptr
+                [y_indices[i] * in_width + x_indices[3]])};
+          coeff[i] = Interpolate1D(x_weights, values);
         }
+        channel_output_ptr[y * out_width + x] =
+                Interpolate1D(y_weights, coeff);
       }
     }
-  }
+  });
 }
 
 template<DeviceType D, typename T>
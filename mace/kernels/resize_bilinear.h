@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 #include "mace/utils/quantize.h"
@@ -103,34 +104,31 @@ inline void ResizeImageNCHW(const T *images,
                             T *output) {
   const CachedInterpolation *xs = xs_vec.data();
 
-#pragma omp parallel for collapse(2)
-  for (index_t b = 0; b < batch_size; ++b) {
-    for (index_t c = 0; c < channels; ++c) {
-      const T
-          *channel_input_ptr =
-          images + (b * channels + c) * in_height * in_width;
-      T *channel_output_ptr =
-          output + (b * channels + c) * out_height * out_width;
-      for (index_t y = 0; y < out_height; ++y) {
-        const T *y_lower_input_ptr =
-            channel_input_ptr + ys[y].lower * in_width;
-        const T *y_upper_input_ptr =
-            channel_input_ptr + ys[y].upper * in_width;
-        const float ys_lerp = ys[y].lerp;
-
-        for (index_t x = 0; x < out_width; ++x) {
-          const float xs_lerp = xs[x].lerp;
-          const T top_left = y_lower_input_ptr[xs[x].lower];
-          const T top_right = y_lower_input_ptr[xs[x].upper];
-          const T bottom_left = y_upper_input_ptr[xs[x].lower];
-          const T bottom_right = y_upper_input_ptr[xs[x].upper];
-          channel_output_ptr[y * out_width + x] =
-              ComputeLerp(top_left, top_right, bottom_left,
-                          bottom_right, xs_lerp, ys_lerp);
-        }
+  ParallelFor2D(0, batch_size, 0, channels, [&](index_t b, index_t c) {
+    const T
+        *channel_input_ptr =
+        images + (b * channels + c) * in_height * in_width;
+    T *channel_output_ptr =
+        output + (b * channels + c) * out_height * out_width;
+    for (index_t y = 0; y < out_height; ++y) {
+      const T *y_lower_input_ptr =
+          channel_input_ptr + ys[y].lower * in_width;
+      const T *y_upper_input_ptr =
+          channel_input_ptr + ys[y].upper * in_width;
+      const float ys_lerp = ys[y].lerp;
+
+      for (index_t x = 0; x < out_width; ++x) {
+        const float xs_lerp = xs[x].lerp;
+        const T top_left = y_lower_input_ptr[xs[x].lower];
+        const T top_right = y_lower_input_ptr[xs[x].upper];
+        const T bottom_left = y_upper_input_ptr[xs[x].lower];
+        const T bottom_right = y_upper_input_ptr[xs[x].upper];
+        channel_output_ptr[y * out_width + x] =
+            ComputeLerp(top_left, top_right, bottom_left,
+                        bottom_right, xs_lerp, ys_lerp);
       }
     }
-  }
+  });
 }
 
 template <typename T>
@@ -149,8 +147,7 @@ inline void ResizeImageNHWC(const T *images,
   for (index_t b = 0; b < batch_size; ++b) {
     const T *input_base = images + b * channels * in_height * in_width;
     T *output_base = output + b * channels * out_height * out_width;
-#pragma omp parallel for
-    for (index_t y = 0; y < out_height; ++y) {
+    ParallelFor(0, out_height, [&](index_t y) {
       const T
           *y_lower_input_ptr = input_base + ys[y].lower * in_width * channels;
       const T
@@ -171,7 +168,7 @@ inline void ResizeImageNHWC(const T *images,
                           bottom_right[c], xs_lerp, ys_lerp);
         }
       }
-    }
+    });
   }
 }
 
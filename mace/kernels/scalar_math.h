@@ -120,7 +120,7 @@ struct ScalarMathFunctor : OpKernel {
     if (input0->dim_size() > 0) {
       MACE_RETURN_IF_ERROR(output->Resize(input0->shape()));
     } else {
-      output->Resize({});
+      MACE_RETURN_IF_ERROR(output->Resize({}));
     }
 
     Tensor::MappingGuard output_guard(output);
@@ -15,7 +15,8 @@
 #include <memory>
 
 #include "mace/kernels/sgemm.h"
-#include "mace/core/runtime/cpu/cpu_runtime.h"
+#include "mace/core/run_control.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 
 
 #if defined(MACE_ENABLE_NEON)
@@ -240,25 +241,27 @@ void SGemm::RunInternal(const PackedBlock &lhs,
   const float *lhs_data = lhs.data<float>();
   const float *rhs_data = rhs.data<float>();
   float *result_data = result->mutable_data<float>();
-
-#define MACE_SGEMM_RUN_PER_BATCH                      \
-  for (index_t b = 0; b < batch; ++b) {               \
-    RunPerBatch(lhs_data + b * height * depth,        \
-                rhs_data + b * depth * width,         \
-                height,                               \
-                depth,                                \
-                width,                                \
-                result_data + b * height * width);    \
-  }
-
-  if (batch >= MaceOpenMPThreadCount) {
-#pragma omp parallel for
-    MACE_SGEMM_RUN_PER_BATCH
+  // Of the calling thread, not of those running the blocks
+  const RunControl *run_control = RunControl::current();
+
+  auto run_per_batch = [&](index_t b) {
+    RunPerBatch(lhs_data + b * height * depth,
+                rhs_data + b * depth * width,
+                height,
+                depth,
+                width,
+                run_control,
+                result_data + b * height * width);
+  };
+
+  // The loops of a batch run inline when the batches run in parallel
+  if (batch >= ParallelThreadCount()) {
+    ParallelFor(0, batch, run_per_batch);
   } else {
-    MACE_SGEMM_RUN_PER_BATCH
+    for (index_t b = 0; b < batch; ++b) {
+      run_per_batch(b);
+    }
   }
-
-#undef MACE_SGEMM_RUN_PER_BATCH
 }
 
 void SGemm::RunPerBatch(const float *lhs_data,
@@ -266,6 +269,7 @@ void SGemm::RunPerBatch(const float *lhs_data,
                         const index_t height,
                         const index_t depth,
                         const index_t width,
+                        const RunControl *run_control,
                         float *result_data) {
 #if defined(MACE_ENABLE_NEON)
   const index_t block_w = width >> 2;
@@ -279,8 +283,10 @@ void SGemm::RunPerBatch(const float *lhs_data,
   // as possible to cache, by tiling lhs by height and rhs by width.
 
   // w: 4
-#pragma omp parallel for
-  for (index_t bw = 0; bw < block_w; ++bw) {
+  ParallelFor(0, block_w, [&](index_t bw) {
+    if (run_control != nullptr && run_control->Stopped()) {
+      return;
+    }
     index_t remain_h = height;
     index_t block_h = 0;
 
@@ -692,7 +698,7 @@ void SGemm::RunPerBatch(const float *lhs_data,
       vst1q_f32(res_ptr, c0);
       res_ptr += 4;
     }  // bh: remain
-  }  // bw
+  });  // bw
 
 #endif  // MACE_ENABLE_NEON
 
@@ -702,8 +708,10 @@ void SGemm::RunPerBatch(const float *lhs_data,
   rhs_data += (width - remain_w) * depth;
 
   // w: 1
-#pragma omp parallel for
-  for (index_t bw = 0; bw < remain_w; ++bw) {
+  ParallelFor(0, remain_w, [&](index_t bw) {
+    if (run_control != nullptr && run_control->Stopped()) {
+      return;
+    }
     index_t remain_h = height;
 
     const float *lhs_ptr = lhs_data;
@@ -896,7 +904,7 @@ void SGemm::RunPerBatch(const float *lhs_data,
       *res_ptr = sum;
       ++res_ptr;
     }  // bh: remain
-  }  // bw
+  });  // bw
 }
 
 void SGemm::PackLhs(const MatrixMap<const float> &lhs,
@@ -918,17 +926,16 @@ void SGemm::Pack(const MatrixMap<const float> &src,
   const index_t width = src.col();
   auto packed_data = packed_block->mutable_data<float>();
 
-#define MACE_SGEMM_PACK_PER_BATCH                                     \
-    for (index_t b = 0; b < src.batch(); ++b) {                       \
-      PackPerBatch(src, order, b, packed_data + b * height * width);  \
-    }
-  if (src.batch() >= MaceOpenMPThreadCount) {
-#pragma omp parallel for
-    MACE_SGEMM_PACK_PER_BATCH
+  auto pack_per_batch = [&](index_t b) {
+    PackPerBatch(src, order, b, packed_data + b * height * width);
+  };
+  if (src.batch() >= ParallelThreadCount()) {
+    ParallelFor(0, src.batch(), pack_per_batch);
   } else {
-    MACE_SGEMM_PACK_PER_BATCH
+    for (index_t b = 0; b < src.batch(); ++b) {
+      pack_per_batch(b);
+    }
   }
-#undef MACE_SGEMM_PACK_PER_BATCH
 }
 
 void SGemm::UnPack(const PackedBlock &packed_result,
@@ -939,18 +946,16 @@ void SGemm::UnPack(const PackedBlock &packed_result,
   const index_t width = matrix_map->col();
   auto packed_data = packed_result.data<float>();
 
-#define MACE_SGEMM_UNPACK_PER_BATCH                                   \
-  for (index_t b = 0; b < matrix_map->batch(); ++b) {                 \
-    UnPackPerBatch(packed_data + b * height * width, b, matrix_map);  \
-  }
-
-  if (matrix_map->batch() >= MaceOpenMPThreadCount) {
-#pragma omp parallel for
-    MACE_SGEMM_UNPACK_PER_BATCH
+  auto unpack_per_batch = [&](index_t b) {
+    UnPackPerBatch(packed_data + b * height * width, b, matrix_map);
+  };
+  if (matrix_map->batch() >= ParallelThreadCount()) {
+    ParallelFor(0, matrix_map->batch(), unpack_per_batch);
   } else {
-    MACE_SGEMM_UNPACK_PER_BATCH
+    for (index_t b = 0; b < matrix_map->batch(); ++b) {
+      unpack_per_batch(b);
+    }
   }
-#undef MACE_SGEMM_UNPACK_PER_BATCH
 }
 
 void SGemm::PackPerBatch(const MatrixMap<const float> &src,
@@ -968,8 +973,7 @@ void SGemm::PackPerBatch(const MatrixMap<const float> &src,
     index_t h = 0;
 #if defined(MACE_ENABLE_NEON)
 #if defined(__aarch64__)
-#pragma omp parallel for
-    for (index_t ih = h; ih <= height - 8; ih += 8) {
+    ParallelFor(h, height - 7, 8, [&](index_t ih) {
       const float *src_data_ptr = src_data + ih * width;
       float *packed_data_ptr = packed_data + ih * width;
       for (index_t w = 0; w < width; ++w) {
@@ -986,11 +990,10 @@ void SGemm::PackPerBatch(const MatrixMap<const float> &src,
         vst1q_f32(packed_data_ptr + packed_offset, vs0);
         vst1q_f32(packed_data_ptr + packed_offset + 4, vs1);
       }
-    }
+    });
     h += (height - h) / 8 * 8;
 #endif
-#pragma omp parallel for
-    for (index_t ih = h; ih <= height - 4; ih += 4) {
+    ParallelFor(h, height - 3, 4, [&](index_t ih) {
       const float *src_data_ptr = src_data + ih * width;
       float *packed_data_ptr = packed_data + ih * width;
       for (index_t w = 0; w < width; ++w) {
@@ -1002,21 +1005,19 @@ void SGemm::PackPerBatch(const MatrixMap<const float> &src,
                           src_data_ptr[src_offset + 3 * width]};
         vst1q_f32(packed_data_ptr + packed_offset, vs);
       }
-    }
+    });
     h += (height - h) / 4 * 4;
 #endif
-#pragma omp parallel for
-    for (index_t ih = h; ih < height; ++ih) {
+    ParallelFor(h, height, [&](index_t ih) {
       std::copy_n(src_data + ih * width, width, packed_data + ih * width);
-    }
+    });
   } else if (src.map_major() == Major::ColMajor &&
              order == PackOrder::ColMajor) {
     // This is for packing transpose-needed lhs.
     index_t h = 0;
 #if defined(MACE_ENABLE_NEON)
 #if defined(__aarch64__)
-#pragma omp parallel for
-    for (index_t ih = h; ih <= height - 8; ih += 8) {
+    ParallelFor(h, height - 7, 8, [&](index_t ih) {
       const float *src_data_ptr = src_data + ih;
       float *packed_data_ptr = packed_data + ih * width;
       for (index_t w = 0; w < width; ++w) {
@@ -1027,11 +1028,10 @@ void SGemm::PackPerBatch(const MatrixMap<const float> &src,
         vst1q_f32(packed_data_ptr + packed_offset, vs0);
         vst1q_f32(packed_data_ptr + packed_offset + 4, vs1);
       }
-    }
+    });
     h += (height - h) / 8 * 8;
 #endif
-#pragma omp parallel for
-    for (index_t ih = h; ih <= height - 4; ih += 4) {
+    ParallelFor(h, height - 3, 4, [&](index_t ih) {
       const float *src_data_ptr = src_data + ih;
       float *packed_data_ptr = packed_data + ih * width;
       for (index_t w = 0; w < width; ++w) {
@@ -1040,24 +1040,22 @@ void SGemm::PackPerBatch(const MatrixMap<const float> &src,
         float32x4_t vs = vld1q_f32(src_data_ptr + src_offset);
         vst1q_f32(packed_data_ptr + packed_offset, vs);
       }
-    }
+    });
     h += (height - h) / 4 * 4;
 #endif
-#pragma omp parallel for
-    for (index_t ih = h; ih < height; ++ih) {
+    ParallelFor(h, height, [&](index_t ih) {
       const float *src_data_ptr = src_data + ih;
       float *packed_data_ptr = packed_data + ih * width;
       for (index_t w = 0; w < width; ++w) {
         packed_data_ptr[w] = src_data_ptr[w * height];
       }
-    }
+    });
   } else if (src.map_major() == Major::RowMajor &&
              order == PackOrder::RowMajor) {
     // This is for packing no-transpose rhs.
     index_t w = 0;
 #if defined(MACE_ENABLE_NEON)
-#pragma omp parallel for
-    for (index_t iw = w; iw <= width - 4; iw += 4) {
+    ParallelFor(w, width - 3, 4, [&](index_t iw) {
       const float *src_data_ptr = src_data + iw;
       float *packed_data_ptr = packed_data + iw * height;
       for (index_t h = 0; h < height; ++h) {
@@ -1066,24 +1064,22 @@ void SGemm::PackPerBatch(const MatrixMap<const float> &src,
         float32x4_t vs = vld1q_f32(src_data_ptr + src_offset);
         vst1q_f32(packed_data_ptr + packed_offset, vs);
       }
-    }
+    });
     w += (width - w) / 4 * 4;
 #endif
-#pragma omp parallel for
-    for (index_t iw = w; iw < width; ++iw) {
+    ParallelFor(w, width, [&](index_t iw) {
       const float *src_data_ptr = src_data + iw;
       float *packed_data_ptr = packed_data + iw * height;
       for (index_t h = 0; h < height; ++h) {
         packed_data_ptr[h] = src_data_ptr[h * width];
       }
-    }
+    });
   } else if (src.map_major() == Major::ColMajor &&
              order == PackOrder::RowMajor) {
     // This is for packing transpose-needed rhs.
     index_t w = 0;
 #if defined(MACE_ENABLE_NEON)
-#pragma omp parallel for
-    for (index_t iw = w; iw <= width - 4; iw += 4) {
+    ParallelFor(w, width - 3, 4, [&](index_t iw) {
       const float *src_data_ptr = src_data + iw * height;
       float *packed_data_ptr = packed_data + iw * height;
       for (index_t h = 0; h < height; ++h) {
@@ -1095,13 +1091,12 @@ void SGemm::PackPerBatch(const MatrixMap<const float> &src,
                           src_data_ptr[src_offset + 3 * height]};
         vst1q_f32(packed_data_ptr + packed_offset, vs);
       }
-    }
+    });
     w += (width - w) / 4 * 4;
 #endif
-#pragma omp parallel for
-    for (index_t iw = w; iw < width; ++iw) {
+    ParallelFor(w, width, [&](index_t iw) {
       std::copy_n(src_data + iw * height, height, packed_data + iw * height);
-    }
+    });
   }
 }
 
@@ -1118,8 +1113,7 @@ void SGemm::UnPackPerBatch(const float *packed_data,
     // This is for non-transposed result
     index_t w = 0;
 #if defined(MACE_ENABLE_NEON)
-#pragma omp parallel for
-    for (index_t iw = w; iw <= width - 4; iw += 4) {
+    ParallelFor(w, width - 3, 4, [&](index_t iw) {
       const float *packed_data_ptr = packed_data + iw * height;
       float *unpacked_data_ptr = unpacked_data + iw;
       for (index_t h = 0; h < height; ++h) {
@@ -1128,23 +1122,21 @@ void SGemm::UnPackPerBatch(const float *packed_data,
         float32x4_t vs = vld1q_f32(packed_data_ptr + packed_offset);
         vst1q_f32(unpacked_data_ptr + unpacked_offset, vs);
       }
-    }
+    });
     w += (width - w) / 4 * 4;
 #endif
-#pragma omp parallel for
-    for (index_t iw = w; iw < width; ++iw) {
+    ParallelFor(w, width, [&](index_t iw) {
       const float *packed_data_ptr = packed_data + iw * height;
       float *unpacked_data_ptr = unpacked_data + iw;
       for (index_t h = 0; h < height; ++h) {
         unpacked_data_ptr[h * width] = packed_data_ptr[h];
       }
-    }
+    });
   } else {
     // This is for transposed result
     index_t w = 0;
 #if defined(MACE_ENABLE_NEON)
-#pragma omp parallel for
-    for (index_t iw = w; iw <= width - 4; iw += 4) {
+    ParallelFor(w, width - 3, 4, [&](index_t iw) {
       const float *packed_data_ptr = packed_data + iw * height;
       float *unpacked_data_ptr = unpacked_data + iw * height;
       for (index_t h = 0; h < height; ++h) {
@@ -1156,14 +1148,13 @@ void SGemm::UnPackPerBatch(const float *packed_data,
         unpacked_data_ptr[unpacked_offset + 2 * height] = vs[2];
         unpacked_data_ptr[unpacked_offset + 3 * height] = vs[3];
       }
-    }
+    });
     w += (width - w) / 4 * 4;
 #endif
-#pragma omp parallel for
-    for (index_t iw = w; iw < width; ++iw) {
+    ParallelFor(w, width, [&](index_t iw) {
       std::copy_n(
           packed_data + iw * height, height, unpacked_data + iw * height);
-    }
+    });
   }
 }
 
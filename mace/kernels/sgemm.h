@@ -27,6 +27,9 @@
 #include "mace/core/tensor.h"
 
 namespace mace {
+
+class RunControl;
+
 namespace kernels {
 
 enum Major {
@@ -164,11 +167,14 @@ class SGemm {
                    const index_t width,
                    PackedBlock *result);
 
+  // Skips the remaining column blocks once run_control, if not null, is
+  // stopped
   void RunPerBatch(const float *lhs,
                    const float *rhs,
                    const index_t height,
                    const index_t depth,
                    const index_t width,
+                   const RunControl *run_control,
                    float *result);
 
   std::unique_ptr<Tensor> packed_lhs_;
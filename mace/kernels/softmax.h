@@ -22,6 +22,7 @@
 #include <limits>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/public/mace.h"
 #include "mace/utils/utils.h"
@@ -56,8 +57,7 @@ struct SoftmaxFunctor<DeviceType::CPU, float> : OpKernel {
       const index_t batch_size = class_count * class_size;
 
       for (index_t b = 0; b < batch; ++b) {
-#pragma omp parallel for
-        for (index_t k = 0; k < class_size; ++k) {
+        ParallelFor(0, class_size, [&](index_t k) {
           const float *input_ptr = input_data + b * batch_size + k;
           float *output_ptr = output_data + b * batch_size + k;
 
@@ -86,13 +86,12 @@ struct SoftmaxFunctor<DeviceType::CPU, float> : OpKernel {
             output_ptr[channel_offset] /= sum;
             channel_offset += class_size;
           }
-        }  // k
+        });  // k
       }  // b
     } else if (input->dim_size() == 2) {  // normal 2d softmax
       const index_t class_size = input->dim(0);
       const index_t class_count = input->dim(1);
-#pragma omp parallel for
-      for (index_t k = 0; k < class_size; ++k) {
+      ParallelFor(0, class_size, [&](index_t k) {
         const float *input_ptr = input_data + k * class_count;
         float *output_ptr = output_data + k * class_count;
 
@@ -112,7 +111,7 @@ struct SoftmaxFunctor<DeviceType::CPU, float> : OpKernel {
         for (index_t c = 0; c < class_count; ++c) {
           output_ptr[c] /= sum;
         }
-      }
+      });
     } else {
       MACE_NOT_IMPLEMENTED;
     }
@@ -165,8 +164,7 @@ struct SoftmaxFunctor<DeviceType::CPU, uint8_t> : OpKernel {
     // If depth is short, do it using float32. Float computation should not
     // be here, but as long as it is on CPU, it is fine.
     if (depth < 32) {
-#pragma omp parallel for
-      for (index_t b = 0; b < batch; ++b) {
+      ParallelFor(0, batch, [&](index_t b) {
         const uint8_t *input_ptr = input_data + b * depth;
         uint8_t *output_ptr = output_data + b * depth;
 
@@ -185,7 +183,7 @@ struct SoftmaxFunctor<DeviceType::CPU, uint8_t> : OpKernel {
           double output_f = depth_cache[d] / sum;
           output_ptr[d] = static_cast<uint8_t>(output_f * 255);
         }
-      }
+      });
       return MACE_SUCCESS;
     }
 
@@ -194,8 +192,7 @@ struct SoftmaxFunctor<DeviceType::CPU, uint8_t> : OpKernel {
         (1ll << 31) - 1.0));
     int32_t input_delta_limit = -((1ll << 31) - 1) / scale_q;
 
-#pragma omp parallel for
-    for (index_t b = 0; b < batch; ++b) {
+    ParallelFor(0, batch, [&](index_t b) {
       const uint8_t *input_ptr = input_data + b * depth;
       uint8_t *output_ptr = output_data + b * depth;
 
@@ -345,7 +342,7 @@ struct SoftmaxFunctor<DeviceType::CPU, uint8_t> : OpKernel {
           output_ptr[d] = std::max(std::min(output_data, 255), 0);
         }
       }
-    }
+    });
 
     return MACE_SUCCESS;
   }
@@ -20,6 +20,7 @@
 #include <algorithm>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/kernels/kernel.h"
 
@@ -134,69 +135,64 @@ struct SpaceToBatchFunctor<DeviceType::CPU, float> : SpaceToBatchFunctorBase {
         std::max(static_cast<index_t>(1), 8 * 1024 / block_shape_w / in_width);
 
     // make channel outter loop so we can make best use of cache
-#pragma omp parallel for collapse(3)
-    for (index_t c = 0; c < channels; ++c) {
-      for (index_t block_h = 0; block_h < out_height;
-           block_h += block_h_size) {
-        for (index_t b = 0; b < out_batches; ++b) {
-          const index_t in_b = b % in_batches;
-          const index_t tile_index = b / in_batches;
-          const index_t tile_h = tile_index / block_shape_w;
-          const index_t tile_w = tile_index % block_shape_w;
-          const index_t valid_h_start = std::max(block_h,
-                                                 (pad_top - tile_h
-                                                     + block_shape_h - 1)
-                                                     / block_shape_h);
-          const index_t valid_h_end = std::min(out_height,
-                                               std::min(
-                                                   block_h + block_h_size,
-                                                   (in_height + pad_top
-                                                       - tile_h
-                                                       + block_shape_h - 1)
-                                                       / block_shape_h));
-          const index_t valid_w_start = std::max(static_cast<index_t>(0),
-                                                 (pad_left - tile_w
-                                                     + block_shape_w - 1)
-                                                     / block_shape_w);
-          const index_t valid_w_end = std::min(out_width,
-                                               (in_width + pad_left - tile_w
-                                                   + block_shape_w - 1)
-                                                   / block_shape_w);
-          const float *input_base =
-              input_data + (in_b * channels + c) * in_height * in_width;
-          float *output_base =
-              output_data + (b * channels + c) * out_height * out_width;
-
-          memset(output_base + block_h * out_width,
-                 0,
-                 (valid_h_start - block_h) * out_width * sizeof(float));
-
-          index_t in_h = valid_h_start * block_shape_h + tile_h - pad_top;
-          for (index_t h = valid_h_start; h < valid_h_end; ++h) {
-            memset(output_base + h * out_width,
-                   0,
-                   valid_w_start * sizeof(float));
-
-            index_t in_w = valid_w_start * block_shape_w + tile_w - pad_left;
-            for (index_t w = valid_w_start; w < valid_w_end; ++w) {
-              output_base[h * out_width + w] =
-                  input_base[in_h * in_width + in_w];
-              in_w += block_shape_w;
-            }  // w
-            in_h += block_shape_h;
-
-            memset(output_base + h * out_width + valid_w_end,
-                   0,
-                   (out_width - valid_w_end) * sizeof(float));
-          }  // h
-
-          memset(output_base + valid_h_end * out_width,
-                 0,
-                 (std::min(out_height, block_h + block_h_size) - valid_h_end)
-                     * out_width * sizeof(float));
-        }  // b
-      }  // block_h
-    }  // c
+    ParallelFor3D(0, channels, 1, 0, out_height, block_h_size, 0, out_batches,
+                  1, [&](index_t c, index_t block_h, index_t b) {
+      const index_t in_b = b % in_batches;
+      const index_t tile_index = b / in_batches;
+      const index_t tile_h = tile_index / block_shape_w;
+      const index_t tile_w = tile_index % block_shape_w;
+      const index_t valid_h_start = std::max(block_h,
+                                             (pad_top - tile_h
+                                                 + block_shape_h - 1)
+                                                 / block_shape_h);
+      const index_t valid_h_end = std::min(out_height,
+                                           std::min(
+                                               block_h + block_h_size,
+                                               (in_height + pad_top
+                                                   - tile_h
+                                                   + block_shape_h - 1)
+                                                   / block_shape_h));
+      const index_t valid_w_start = std::max(static_cast<index_t>(0),
+                                             (pad_left - tile_w
+                                                 + block_shape_w - 1)
+                                                 / block_shape_w);
+      const index_t valid_w_end = std::min(out_width,
+                                           (in_width + pad_left - tile_w
+                                               + block_shape_w - 1)
+                                               / block_shape_w);
+      const float *input_base =
+          input_data + (in_b * channels + c) * in_height * in_width;
+      float *output_base =
+          output_data + (b * channels + c) * out_height * out_width;
+
+      memset(output_base + block_h * out_width,
+             0,
+             (valid_h_start - block_h) * out_width * sizeof(float));
+
+      index_t in_h = valid_h_start * block_shape_h + tile_h - pad_top;
+      for (index_t h = valid_h_start; h < valid_h_end; ++h) {
+        memset(output_base + h * out_width,
+               0,
+               valid_w_start * sizeof(float));
+
+        index_t in_w = valid_w_start * block_shape_w + tile_w - pad_left;
+        for (index_t w = valid_w_start; w < valid_w_end; ++w) {
+          output_base[h * out_width + w] =
+              input_base[in_h * in_width + in_w];
+          in_w += block_shape_w;
+        }  // w
+        in_h += block_shape_h;
+
+        memset(output_base + h * out_width + valid_w_end,
+               0,
+               (out_width - valid_w_end) * sizeof(float));
+      }  // h
+
+      memset(output_base + valid_h_end * out_width,
+             0,
+             (std::min(out_height, block_h + block_h_size) - valid_h_end)
+                 * out_width * sizeof(float));
+    });  // c
     return MACE_SUCCESS;
   }
 };
@@ -243,8 +239,7 @@ struct SpaceToBatchFunctor<DeviceType::CPU, uint8_t> : SpaceToBatchFunctorBase {
     index_t out_width = batch_tensor->dim(2);
     index_t channels = batch_tensor->dim(3);
 
-#pragma omp parallel for
-    for (index_t b = 0; b < out_batches; ++b) {
+    ParallelFor(0, out_batches, [&](index_t b) {
       const index_t in_b = b % in_batches;
       const index_t tile_index = b / in_batches;
       const index_t tile_h = tile_index / block_shape_w;
@@ -300,7 +295,7 @@ struct SpaceToBatchFunctor<DeviceType::CPU, uint8_t> : SpaceToBatchFunctorBase {
              zero_point,
              (out_height - valid_h_end) * out_width * channels
                  * sizeof(uint8_t));
-    }  // b
+    });  // b
 
     return MACE_SUCCESS;
   }
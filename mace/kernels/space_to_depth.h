@@ -18,6 +18,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/public/mace.h"
 #include "mace/kernels/kernel.h"
@@ -56,8 +57,7 @@ struct SpaceToDepthOpFunctor : OpKernel {
     const T *input_ptr = input->data<T>();
     T *output_ptr = output->mutable_data<T>();
 
-#pragma omp parallel for
-    for (index_t b = 0; b < batch_size; ++b) {
+    ParallelFor(0, batch_size, [&](index_t b) {
       for (index_t d = 0; d < input_depth; ++d) {
         for (index_t h = 0; h < input_height; ++h) {
           const index_t out_h = h / block_size_;
@@ -78,7 +78,7 @@ struct SpaceToDepthOpFunctor : OpKernel {
           }
         }
       }
-    }
+    });
 
     return MACE_SUCCESS;
   }
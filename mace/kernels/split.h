@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/core/types.h"
 #include "mace/kernels/kernel.h"
@@ -58,8 +59,7 @@ struct SplitFunctor : OpKernel {
     }
     const T *input_ptr = input->data<T>();
 
-#pragma omp parallel for
-    for (int outer_idx = 0; outer_idx < outer_size; ++outer_idx) {
+    ParallelFor(0, outer_size, [&](int outer_idx) {
       int input_idx = outer_idx * input_channels * inner_size;
       int output_idx = outer_idx * output_channels * inner_size;
       for (size_t i = 0; i < outputs_count; ++i) {
@@ -73,7 +73,7 @@ struct SplitFunctor : OpKernel {
         }
         input_idx += output_channels * inner_size;
       }
-    }
+    });
 
     return MACE_SUCCESS;
   }
@@ -23,6 +23,7 @@
 #include <algorithm>
 
 #include "mace/core/future.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
 #include "mace/core/tensor.h"
 #include "mace/public/mace.h"
 #include "mace/utils/utils.h"
@@ -36,8 +37,7 @@ static void TransposeNHWCToNCHWC3(const float *input,
                                   const index_t width) {
   index_t image_size = height * width;
 
-#pragma omp parallel for
-  for (index_t h = 0; h < height; ++h) {
+  ParallelFor(0, height, [&](index_t h) {
     index_t in_offset = h * width * 3;
     index_t out_offset = h * width;
 
@@ -65,7 +65,7 @@ static void TransposeNHWCToNCHWC3(const float *input,
       }
     }
 #endif
-  }
+  });
 }
 
 static void TransposeNCHWToNHWCC2(const float *input,
@@ -73,8 +73,7 @@ static void TransposeNCHWToNHWCC2(const float *input,
                                   const index_t height,
                                   const index_t width) {
   index_t image_size = height * width;
-#pragma omp parallel for
-  for (index_t h = 0; h < height; ++h) {
+  ParallelFor(0, height, [&](index_t h) {
     index_t in_offset = h * width;
     index_t out_offset = h * width * 2;
 
@@ -101,7 +100,7 @@ static void TransposeNCHWToNHWCC2(const float *input,
       }
     }
 #endif
-  }
+  });
 }
 
 template<DeviceType D, typename T>
@@ -127,19 +126,17 @@ struct TransposeFunctor : OpKernel {
 
       index_t tile_size = input_shape[0] > 512 || input_shape[1] > 512
                           ? 64 : 32;
-#pragma omp parallel for collapse(2)
-      for (index_t i = 0; i < input_shape[0]; i += tile_size) {
-        for (index_t j = 0; j < input_shape[1]; j += tile_size) {
-          index_t end_i = std::min(i + tile_size, input_shape[0]);
-          index_t end_j = std::min(j + tile_size, input_shape[1]);
-          for (index_t tile_i = i; tile_i < end_i; ++tile_i) {
-            for (index_t tile_j = j; tile_j < end_j; ++tile_j) {
-              output_data[tile_j * stride_i + tile_i] =
-                  input_data[tile_i * stride_j + tile_j];
-            }
+      ParallelFor2D(0, input_shape[0], tile_size, 0, input_shape[1], tile_size,
+                    [&](index_t i, index_t j) {
+        index_t end_i = std::min(i + tile_size, input_shape[0]);
+        index_t end_j = std::min(j + tile_size, input_shape[1]);
+        for (index_t tile_i = i; tile_i < end_i; ++tile_i) {
+          for (index_t tile_j = j; tile_j < end_j; ++tile_j) {
+            output_data[tile_j * stride_i + tile_i] =
+                input_data[tile_i * stride_j + tile_j];
           }
         }
-      }
+      });
     } else if (input->dim_size() == 4) {
       std::vector<int> transpose_order_from_NHWC_to_NCHW{0, 3, 1, 2};
       std::vector<int> transpose_order_from_NCHW_to_NHWC{0, 2, 3, 1};
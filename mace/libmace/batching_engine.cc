@@ -0,0 +1,261 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT(build/c++11)
+#include <numeric>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "mace/public/mace.h"
+#include "mace/utils/logging.h"
+
+namespace mace {
+namespace {
+
+struct BatchRequest {
+  const std::map<std::string, MaceTensor> *inputs;
+  std::map<std::string, MaceTensor> *outputs;
+  int64_t batch;
+  MaceStatus status;
+  bool done;
+};
+
+int64_t ItemSize(const std::vector<int64_t> &shape) {
+  return std::accumulate(shape.begin() + 1, shape.end(), 1,
+                         std::multiplies<int64_t>());
+}
+
+// Tensors can be stacked if all but the first dimensions are equal.
+bool CanStack(const std::map<std::string, MaceTensor> &lhs,
+              const std::map<std::string, MaceTensor> &rhs) {
+  if (lhs.size() != rhs.size()) return false;
+  for (auto &tensor : lhs) {
+    auto iter = rhs.find(tensor.first);
+    if (iter == rhs.end()) return false;
+    const std::vector<int64_t> &lhs_shape = tensor.second.shape();
+    const std::vector<int64_t> &rhs_shape = iter->second.shape();
+    if (lhs_shape.empty() || lhs_shape.size() != rhs_shape.size()
+        || !std::equal(lhs_shape.begin() + 1, lhs_shape.end(),
+                       rhs_shape.begin() + 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the batch of the request, or 0 if the inputs and outputs do not
+// agree on dimension 0.
+int64_t RequestBatch(const std::map<std::string, MaceTensor> &inputs,
+                     const std::map<std::string, MaceTensor> &outputs) {
+  int64_t batch = -1;
+  for (auto *tensors : {&inputs, &outputs}) {
+    for (auto &tensor : *tensors) {
+      const std::vector<int64_t> &shape = tensor.second.shape();
+      if (shape.empty() || (batch >= 0 && shape[0] != batch)) return 0;
+      batch = shape[0];
+    }
+  }
+  return std::max<int64_t>(batch, 0);
+}
+
+}  // namespace
+
+class BatchingEngine::Impl {
+ public:
+  Impl(std::shared_ptr<MaceEngine> engine,
+       const int max_batch_size,
+       const int64_t max_wait_micros);
+  ~Impl();
+
+  MaceStatus Run(const std::map<std::string, MaceTensor> &inputs,
+                 std::map<std::string, MaceTensor> *outputs);
+
+ private:
+  void Loop();
+  // Takes the requests from the front of the queue which can be stacked
+  // with the first one, up to max_batch_size_ in total.
+  std::vector<BatchRequest *> PopBatch();
+  MaceStatus RunBatch(const std::vector<BatchRequest *> &batch);
+
+  std::shared_ptr<MaceEngine> engine_;
+  const int max_batch_size_;
+  const int64_t max_wait_micros_;
+
+  std::mutex mutex_;
+  std::condition_variable request_cond_;
+  std::condition_variable done_cond_;
+  std::deque<BatchRequest *> requests_;
+  bool stop_;
+  std::thread worker_;
+};
+
+BatchingEngine::Impl::Impl(std::shared_ptr<MaceEngine> engine,
+                           const int max_batch_size,
+                           const int64_t max_wait_micros)
+    : engine_(engine),
+      max_batch_size_(std::max(1, max_batch_size)),
+      max_wait_micros_(std::max<int64_t>(0, max_wait_micros)),
+      stop_(false) {
+  MACE_CHECK_NOTNULL(engine_);
+  worker_ = std::thread(&BatchingEngine::Impl::Loop, this);
+}
+
+BatchingEngine::Impl::~Impl() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  request_cond_.notify_all();
+  worker_.join();
+}
+
+MaceStatus BatchingEngine::Impl::Run(
+    const std::map<std::string, MaceTensor> &inputs,
+    std::map<std::string, MaceTensor> *outputs) {
+  MACE_CHECK_NOTNULL(outputs);
+  BatchRequest request = {&inputs, outputs, RequestBatch(inputs, *outputs),
+                          MACE_SUCCESS, false};
+  if (request.batch == 0) {
+    LOG(ERROR) << "Inputs and outputs must have the same dimension 0";
+    return MACE_INVALID_ARGS;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  requests_.push_back(&request);
+  request_cond_.notify_all();
+  done_cond_.wait(lock, [&request] { return request.done; });
+  return request.status;
+}
+
+std::vector<BatchRequest *> BatchingEngine::Impl::PopBatch() {
+  std::vector<BatchRequest *> batch;
+  int64_t batch_size = 0;
+  while (!requests_.empty()) {
+    BatchRequest *request = requests_.front();
+    if (!batch.empty()
+        && (batch_size + request->batch > max_batch_size_
+            || !CanStack(*batch[0]->inputs, *request->inputs)
+            || !CanStack(*batch[0]->outputs, *request->outputs))) {
+      break;
+    }
+    batch.push_back(request);
+    batch_size += request->batch;
+    requests_.pop_front();
+  }
+  return batch;
+}
+
+void BatchingEngine::Impl::Loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    request_cond_.wait(lock, [this] { return stop_ || !requests_.empty(); });
+    if (stop_ && requests_.empty()) break;
+
+    // Wait for more requests until the batch is full or the oldest request
+    // has waited long enough.
+    auto deadline = std::chrono::steady_clock::now()
+        + std::chrono::microseconds(max_wait_micros_);
+    request_cond_.wait_until(lock, deadline, [this] {
+      if (stop_) return true;
+      int64_t batch_size = 0;
+      for (auto *request : requests_) {
+        batch_size += request->batch;
+      }
+      return batch_size >= max_batch_size_;
+    });
+
+    std::vector<BatchRequest *> batch = PopBatch();
+    lock.unlock();
+    MaceStatus status = RunBatch(batch);
+    lock.lock();
+    for (auto *request : batch) {
+      request->status = status;
+      request->done = true;
+    }
+    done_cond_.notify_all();
+  }
+}
+
+MaceStatus BatchingEngine::Impl::RunBatch(
+    const std::vector<BatchRequest *> &batch) {
+  if (batch.size() == 1) {
+    return engine_->Run(*batch[0]->inputs, batch[0]->outputs);
+  }
+  int64_t batch_size = 0;
+  for (auto *request : batch) {
+    batch_size += request->batch;
+  }
+
+  // Stack the inputs along dimension 0, the engine resizes the input
+  // tensors and the activations to the batched shapes.
+  std::map<std::string, MaceTensor> inputs;
+  for (auto &input : *batch[0]->inputs) {
+    std::vector<int64_t> shape = input.second.shape();
+    shape[0] = batch_size;
+    const int64_t item_size = ItemSize(shape);
+    std::shared_ptr<float> data(new float[batch_size * item_size],
+                                std::default_delete<float[]>());
+    float *dst = data.get();
+    for (auto *request : batch) {
+      const int64_t size = request->batch * item_size;
+      memcpy(dst, request->inputs->at(input.first).data().get(),
+             size * sizeof(float));
+      dst += size;
+    }
+    inputs[input.first] = MaceTensor(shape, data);
+  }
+  std::map<std::string, MaceTensor> outputs;
+  for (auto &output : *batch[0]->outputs) {
+    std::vector<int64_t> shape = output.second.shape();
+    shape[0] = batch_size;
+    std::shared_ptr<float> data(new float[batch_size * ItemSize(shape)],
+                                std::default_delete<float[]>());
+    outputs[output.first] = MaceTensor(shape, data);
+  }
+
+  MACE_RETURN_IF_ERROR(engine_->Run(inputs, &outputs));
+
+  // Scatter the outputs back to the requests
+  for (auto &output : outputs) {
+    const int64_t item_size = ItemSize(output.second.shape());
+    const float *src = output.second.data().get();
+    for (auto *request : batch) {
+      const int64_t size = request->batch * item_size;
+      memcpy(request->outputs->at(output.first).data().get(), src,
+             size * sizeof(float));
+      src += size;
+    }
+  }
+  return MACE_SUCCESS;
+}
+
+BatchingEngine::BatchingEngine(std::shared_ptr<MaceEngine> engine,
+                               const int max_batch_size,
+                               const int64_t max_wait_micros)
+    : impl_(new BatchingEngine::Impl(engine, max_batch_size,
+                                     max_wait_micros)) {}
+
+BatchingEngine::~BatchingEngine() = default;
+
+MaceStatus BatchingEngine::Run(
+    const std::map<std::string, MaceTensor> &inputs,
+    std::map<std::string, MaceTensor> *outputs) {
+  return impl_->Run(inputs, outputs);
+}
+
+}  // namespace mace
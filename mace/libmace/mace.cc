@@ -16,12 +16,31 @@
 #include <fcntl.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <deque>
+#include <functional>
+#include <future>  // NOLINT(build/c++11)
+#include <map>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
 
 #include "mace/core/net.h"
+#include "mace/core/compressed_model_data.h"
 #include "mace/core/device_context.h"
+#include "mace/core/engine_snapshot.h"
+#include "mace/core/flat_graph.h"
+#include "mace/core/graph_optimizer.h"
+#include "mace/core/pipeline.h"
+#include "mace/core/run_control.h"
 #include "mace/ops/ops_register.h"
 #include "mace/public/mace.h"
 
@@ -54,6 +73,22 @@ const unsigned char *LoadModelData(const std::string &model_data_file,
   return model_data;
 }
 
+// Returns the size of a compressed model data file, or 0 if it is not one
+size_t CompressedModelDataFileSize(const std::string &model_data_file) {
+  int fd = open(model_data_file.c_str(), O_RDONLY);
+  MACE_CHECK(fd >= 0, "Failed to open model data file ",
+             model_data_file, ", error code: ", strerror(errno));
+  unsigned char header[sizeof(CompressedModelDataHeader)];
+  struct stat st;
+  const bool compressed =
+      fstat(fd, &st) == 0
+          && pread(fd, header, sizeof(header), 0)
+              == static_cast<ssize_t>(sizeof(header))
+          && IsCompressedModelData(header, sizeof(header));
+  close(fd);
+  return compressed ? static_cast<size_t>(st.st_size) : 0;
+}
+
 void UnloadModelData(const unsigned char *model_data,
                      const size_t &data_size) {
   MACE_CHECK(model_data != nullptr && data_size > 0,
@@ -111,6 +146,28 @@ MaceStatus CheckGPUAvalibility(const NetDef *net_def, Device *device) {
 }
 #endif
 
+// User memory bound to a tensor, kept alive while bound. It cannot grow,
+// so an op resizing the tensor beyond it fails instead of reallocating.
+class BoundBuffer : public Buffer {
+ public:
+  BoundBuffer(Allocator *allocator,
+              const std::shared_ptr<float> &data,
+              index_t size)
+      : Buffer(allocator, data.get(), size), data_(data) {}
+
+  MaceStatus Resize(index_t nbytes) override {
+    if (nbytes > size()) {
+      LOG(ERROR) << "Bound buffer of " << size() << " bytes is too small for "
+                 << nbytes << " bytes";
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
+    return MaceStatus::MACE_SUCCESS;
+  }
+
+ private:
+  std::shared_ptr<float> data_;
+};
+
 }  // namespace
 
 class GPUContextBuilder::Impl {
@@ -187,6 +244,28 @@ class MaceEngineConfig::Impl {
                                 CPUAffinityPolicy policy,
                                 bool use_gemmlowp);
 
+  MaceStatus SetCPUCores(const std::vector<int> &cpu_ids);
+
+  MaceStatus SetExecutor(std::shared_ptr<Executor> executor);
+
+  MaceStatus SetInterOpThreads(int num_threads);
+
+  MaceStatus SetMemoryPlanCache(int capacity, int shape_granularity);
+
+  MaceStatus SetGraphOptimizerPass(const std::string &pass_name,
+                                   bool enabled);
+
+  MaceStatus SetWeightPaging(int prefetch_distance,
+                             const std::vector<std::string> &locked_ops,
+                             const std::vector<std::string> &released_ops);
+
+  MaceStatus SetSnapshotPath(const std::string &path);
+
+  MaceStatus SetWeightDedup(bool enabled, bool share_across_engines);
+
+  MaceStatus SetPipelineStages(
+      const std::vector<std::vector<int>> &stage_cpu_ids);
+
   inline DeviceType device_type() const {
     return device_type_;
   }
@@ -203,6 +282,59 @@ class MaceEngineConfig::Impl {
     return use_gemmlowp_;
   }
 
+  inline const std::vector<int> &cpu_ids() const {
+    return cpu_ids_;
+  }
+
+  inline std::shared_ptr<Executor> executor() const {
+    return executor_;
+  }
+
+  inline int inter_op_threads() const {
+    return inter_op_threads_;
+  }
+
+  inline int memory_plan_capacity() const {
+    return memory_plan_capacity_;
+  }
+
+  inline int shape_granularity() const {
+    return shape_granularity_;
+  }
+
+  inline const std::map<std::string, bool> &graph_optimizer_passes() const {
+    return graph_optimizer_passes_;
+  }
+
+  inline int weight_prefetch_distance() const {
+    return weight_prefetch_distance_;
+  }
+
+  inline const std::set<std::string> &locked_weight_ops() const {
+    return locked_weight_ops_;
+  }
+
+  inline const std::set<std::string> &released_weight_ops() const {
+    return released_weight_ops_;
+  }
+
+  inline const std::string &snapshot_path() const {
+    return snapshot_path_;
+  }
+
+  inline bool weight_dedup() const {
+    return weight_dedup_;
+  }
+
+  inline bool share_weights() const {
+    return share_weights_;
+  }
+
+  inline const std::vector<std::vector<int>> &pipeline_stage_cpu_ids()
+      const {
+    return pipeline_stage_cpu_ids_;
+  }
+
   inline std::shared_ptr<GPUContext> gpu_context() const {
     return gpu_context_;
   }
@@ -220,6 +352,19 @@ class MaceEngineConfig::Impl {
   int num_threads_;
   CPUAffinityPolicy cpu_affinity_policy_;
   bool use_gemmlowp_;
+  std::vector<int> cpu_ids_;
+  std::shared_ptr<Executor> executor_;
+  int inter_op_threads_;
+  int memory_plan_capacity_;
+  int shape_granularity_;
+  std::map<std::string, bool> graph_optimizer_passes_;
+  int weight_prefetch_distance_;
+  std::set<std::string> locked_weight_ops_;
+  std::set<std::string> released_weight_ops_;
+  std::string snapshot_path_;
+  bool weight_dedup_;
+  bool share_weights_;
+  std::vector<std::vector<int>> pipeline_stage_cpu_ids_;
   std::shared_ptr<GPUContext> gpu_context_;
   GPUPriorityHint gpu_priority_hint_;
   GPUPerfHint gpu_perf_hint_;
@@ -230,6 +375,12 @@ MaceEngineConfig::Impl::Impl(const DeviceType device_type)
       num_threads_(-1),
       cpu_affinity_policy_(CPUAffinityPolicy::AFFINITY_NONE),
       use_gemmlowp_(false),
+      inter_op_threads_(1),
+      memory_plan_capacity_(0),
+      shape_granularity_(1),
+      weight_prefetch_distance_(0),
+      weight_dedup_(false),
+      share_weights_(false),
       gpu_context_(new GPUContext),
       gpu_priority_hint_(GPUPriorityHint::PRIORITY_LOW),
       gpu_perf_hint_(GPUPerfHint::PERF_NORMAL) {}
@@ -258,6 +409,94 @@ MaceStatus MaceEngineConfig::Impl::SetCPUThreadPolicy(
   return MACE_SUCCESS;
 }
 
+MaceStatus MaceEngineConfig::Impl::SetCPUCores(
+    const std::vector<int> &cpu_ids) {
+  for (int cpu_id : cpu_ids) {
+    if (cpu_id < 0) {
+      return MACE_INVALID_ARGS;
+    }
+  }
+  cpu_ids_ = cpu_ids;
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineConfig::Impl::SetExecutor(
+    std::shared_ptr<Executor> executor) {
+  if (executor != nullptr && executor->num_threads() < 1) {
+    return MACE_INVALID_ARGS;
+  }
+  executor_ = executor;
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineConfig::Impl::SetInterOpThreads(int num_threads) {
+  if (num_threads < 1) {
+    return MACE_INVALID_ARGS;
+  }
+  inter_op_threads_ = num_threads;
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineConfig::Impl::SetMemoryPlanCache(int capacity,
+                                                      int shape_granularity) {
+  if (capacity < 0 || shape_granularity < 1) {
+    return MACE_INVALID_ARGS;
+  }
+  memory_plan_capacity_ = capacity;
+  shape_granularity_ = shape_granularity;
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineConfig::Impl::SetGraphOptimizerPass(
+    const std::string &pass_name, bool enabled) {
+  GraphOptimizer optimizer;
+  if (!optimizer.SetPassEnabled(pass_name, enabled)) {
+    LOG(ERROR) << "Unknown graph optimizer pass: " << pass_name;
+    return MACE_INVALID_ARGS;
+  }
+  graph_optimizer_passes_[pass_name] = enabled;
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineConfig::Impl::SetWeightPaging(
+    int prefetch_distance,
+    const std::vector<std::string> &locked_ops,
+    const std::vector<std::string> &released_ops) {
+  if (prefetch_distance < 0) {
+    return MACE_INVALID_ARGS;
+  }
+  weight_prefetch_distance_ = prefetch_distance;
+  locked_weight_ops_ = std::set<std::string>(locked_ops.begin(),
+                                             locked_ops.end());
+  released_weight_ops_ = std::set<std::string>(released_ops.begin(),
+                                               released_ops.end());
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineConfig::Impl::SetSnapshotPath(const std::string &path) {
+  snapshot_path_ = path;
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineConfig::Impl::SetWeightDedup(bool enabled,
+                                                  bool share_across_engines) {
+  weight_dedup_ = enabled;
+  share_weights_ = enabled && share_across_engines;
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineConfig::Impl::SetPipelineStages(
+    const std::vector<std::vector<int>> &stage_cpu_ids) {
+  for (auto &cpu_ids : stage_cpu_ids) {
+    for (int cpu_id : cpu_ids) {
+      if (cpu_id < 0) {
+        return MACE_INVALID_ARGS;
+      }
+    }
+  }
+  pipeline_stage_cpu_ids_ = stage_cpu_ids;
+  return MACE_SUCCESS;
+}
 
 MaceEngineConfig::MaceEngineConfig(
     const DeviceType device_type)
@@ -283,6 +522,49 @@ MaceStatus MaceEngineConfig::SetCPUThreadPolicy(
   return impl_->SetCPUThreadPolicy(num_threads_hint, policy, use_gemmlowp);
 }
 
+MaceStatus MaceEngineConfig::SetCPUCores(const std::vector<int> &cpu_ids) {
+  return impl_->SetCPUCores(cpu_ids);
+}
+
+MaceStatus MaceEngineConfig::SetExecutor(std::shared_ptr<Executor> executor) {
+  return impl_->SetExecutor(executor);
+}
+
+MaceStatus MaceEngineConfig::SetInterOpThreads(int num_threads) {
+  return impl_->SetInterOpThreads(num_threads);
+}
+
+MaceStatus MaceEngineConfig::SetMemoryPlanCache(int capacity,
+                                                int shape_granularity) {
+  return impl_->SetMemoryPlanCache(capacity, shape_granularity);
+}
+
+MaceStatus MaceEngineConfig::SetGraphOptimizerPass(
+    const std::string &pass_name, bool enabled) {
+  return impl_->SetGraphOptimizerPass(pass_name, enabled);
+}
+
+MaceStatus MaceEngineConfig::SetWeightPaging(
+    int prefetch_distance,
+    const std::vector<std::string> &locked_ops,
+    const std::vector<std::string> &released_ops) {
+  return impl_->SetWeightPaging(prefetch_distance, locked_ops, released_ops);
+}
+
+MaceStatus MaceEngineConfig::SetSnapshotPath(const std::string &path) {
+  return impl_->SetSnapshotPath(path);
+}
+
+MaceStatus MaceEngineConfig::SetWeightDedup(bool enabled,
+                                            bool share_across_engines) {
+  return impl_->SetWeightDedup(enabled, share_across_engines);
+}
+
+MaceStatus MaceEngineConfig::SetPipelineStages(
+    const std::vector<std::vector<int>> &stage_cpu_ids) {
+  return impl_->SetPipelineStages(stage_cpu_ids);
+}
+
 // Mace Tensor
 class MaceTensor::Impl {
  public:
@@ -334,6 +616,52 @@ const std::shared_ptr<float> MaceTensor::data() const { return impl_->data; }
 
 std::shared_ptr<float> MaceTensor::data() { return impl_->data; }
 
+CancellationToken::CancellationToken() : cancelled_(false) {}
+
+void CancellationToken::Cancel() {
+  cancelled_.store(true, std::memory_order_relaxed);
+}
+
+bool CancellationToken::IsCancelled() const {
+  return cancelled_.load(std::memory_order_relaxed);
+}
+
+// Two contexts are enough to overlap staging the inputs of one request
+// with computing another.
+constexpr int kNumAsyncContexts = 2;
+constexpr size_t kMaxSubmittedAsyncRuns = 4;
+
+// Execution Context
+class ExecutionContext {
+ public:
+  ExecutionContext() = default;
+  ~ExecutionContext() = default;
+
+  // The CPU device of the context, owning its scratch buffer,
+  // or nullptr if the engine's device is shared.
+  std::unique_ptr<Device> device;
+  std::unique_ptr<Workspace> ws;
+  std::unique_ptr<NetBase> net;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(ExecutionContext);
+};
+
+// A run executed in steps in the workspace of the engine
+class RunHandle {
+ public:
+  RunHandle() = default;
+  ~RunHandle() = default;
+
+  std::map<std::string, MaceTensor> outputs;
+  // The run of the engine it is, see MaceEngine::Impl::run_generation_
+  uint64_t generation;
+  size_t next_op;
+  bool done;
+  MaceStatus status;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(RunHandle);
+};
+
 // Mace Engine
 class MaceEngine::Impl {
  public:
@@ -351,20 +679,171 @@ class MaceEngine::Impl {
                   const std::vector<std::string> &output_nodes,
                   const std::string &model_data_file);
 
+  // The next Init of net_def uses it as the runtime net instead of a copy.
+  void AdoptNetDef(std::shared_ptr<NetDef> net_def);
+
+  MaceStatus CreateContext(std::shared_ptr<ExecutionContext> *context);
+
   MaceStatus Run(const std::map<std::string, MaceTensor> &inputs,
                  std::map<std::string, MaceTensor> *outputs,
-                 RunMetadata *run_metadata);
+                 RunMetadata *run_metadata,
+                 const RunOptions *run_options);
+
+  MaceStatus Run(ExecutionContext *context,
+                 const std::map<std::string, MaceTensor> &inputs,
+                 std::map<std::string, MaceTensor> *outputs,
+                 RunMetadata *run_metadata,
+                 const RunOptions *run_options);
+
+  MaceStatus GetInputHandle(const std::string &name, int *handle) const;
+
+  MaceStatus GetOutputHandle(const std::string &name, int *handle) const;
+
+  MaceStatus BindInput(const int handle, const MaceTensor &tensor);
+
+  MaceStatus BindOutput(const int handle, const MaceTensor &tensor);
+
+  MaceStatus GetInputBuffer(const int handle,
+                            const std::vector<int64_t> &shape,
+                            float **data);
+
+  MaceStatus GetOutputBuffer(const int handle,
+                             std::vector<int64_t> *shape,
+                             const float **data);
+
+  MaceStatus RunWithBindings(RunMetadata *run_metadata);
+
+  MaceStatus StartRun(const std::map<std::string, MaceTensor> &inputs,
+                      std::map<std::string, MaceTensor> *outputs,
+                      std::shared_ptr<RunHandle> *handle);
+
+  MaceStatus RunStep(RunHandle *handle, int64_t budget_micros, bool *done);
+
+  MaceStatus RunAsync(const std::map<std::string, MaceTensor> &inputs,
+                      std::map<std::string, MaceTensor> *outputs,
+                      std::function<void(MaceStatus)> callback,
+                      std::future<MaceStatus> *future);
+
+  MaceStatus SaveSnapshot();
+
+  MaceStatus GetInitStats(InitStats *stats) const;
+
+  MaceStatus GetPipelineStats(PipelineStats *stats);
 
  private:
+  struct AsyncRequest {
+    std::map<std::string, MaceTensor> inputs;
+    std::map<std::string, MaceTensor> outputs;
+    std::function<void(MaceStatus)> callback;
+    std::promise<MaceStatus> promise;
+    ExecutionContext *context;
+    MaceStatus status;
+  };
+
+  MaceStatus StartAsync();
+  void StopAsync();
+  // Queues the request to the pipeline, copying its inputs in.
+  MaceStatus SubmitToPipeline(std::unique_ptr<AsyncRequest> request);
+  // Copies the inputs of the submitted requests into a free context.
+  void StageLoop();
+  // Runs the staged requests and copies their outputs out.
+  void ComputeLoop();
+
+  // The input shapes, rounded up to the shape granularity
+  std::vector<index_t> MemoryPlanKey(
+      const std::map<std::string, MaceTensor> &inputs) const;
+
+  MaceStatus CopyInputs(Workspace *ws,
+                        const std::map<std::string, MaceTensor> &inputs,
+                        std::vector<Tensor *> *input_tensors);
+
+  MaceStatus CopyOutputs(Workspace *ws,
+                         std::map<std::string, MaceTensor> *outputs);
+
+  MaceStatus BindTensor(const MaceTensor &tensor,
+                        Tensor *mace_tensor,
+                        std::unique_ptr<BufferBase> *bound_buffer);
+
+  void UnbindAll();
+
+  // Returns the weight pager of a net, or nullptr if the weights are paged
+  // by the kernel alone. Only the pager of the engine's net locks weights.
+  std::unique_ptr<WeightPager> CreateWeightPager(bool lock_weights) const;
+
+  // The options the state after Init depends on, for the snapshot key
+  std::string SnapshotOptions() const;
+
+  // run_options may be null
+  MaceStatus Run(Workspace *ws,
+                 NetBase *net,
+                 const std::map<std::string, MaceTensor> &inputs,
+                 std::map<std::string, MaceTensor> *outputs,
+                 RunMetadata *run_metadata,
+                 const RunOptions *run_options);
+
   const unsigned char *model_data_;
   size_t model_data_size_;
+  // Of a compressed model data file
+  std::unique_ptr<unsigned char[]> decompressed_model_data_;
   std::shared_ptr<OperatorRegistryBase> op_registry_;
   DeviceType device_type_;
+  int num_threads_;
+  CPUAffinityPolicy cpu_affinity_policy_;
+  bool use_gemmlowp_;
+  std::vector<int> cpu_ids_;
+  std::shared_ptr<Executor> executor_;
+  int inter_op_threads_;
+  int memory_plan_capacity_;
+  int shape_granularity_;
+  std::map<std::string, bool> graph_optimizer_passes_;
+  int weight_prefetch_distance_;
+  std::set<std::string> locked_weight_ops_;
+  std::set<std::string> released_weight_ops_;
+  std::string snapshot_path_;
+  // Identifies the model data in the snapshot key, empty if they were not
+  // loaded from a file
+  std::string model_data_file_;
+  // Storage of the snapshot of the model, which holds the weights if the
+  // engine started from the snapshot
+  std::unique_ptr<KVStorage> snapshot_storage_;
+  std::string snapshot_key_;
+  bool from_snapshot_;
+  InitStats init_stats_;
+  bool initialized_;
   std::unique_ptr<Device> device_;
   std::unique_ptr<Workspace> ws_;
   std::unique_ptr<NetBase> net_;
+  std::shared_ptr<const NetDef> net_def_;
+  std::shared_ptr<NetDef> adopted_net_def_;
+  std::vector<std::string> input_nodes_;
+  std::vector<std::string> output_nodes_;
   std::map<std::string, mace::InputInfo> input_info_map_;
   std::map<std::string, mace::OutputInfo> output_info_map_;
+  // Workspace tensors of the input and output nodes, indexed by handle
+  std::vector<Tensor *> input_tensors_;
+  std::vector<Tensor *> output_tensors_;
+  // User memory bound to the tensors above, nullptr if not bound
+  std::vector<std::unique_ptr<BufferBase>> bound_inputs_;
+  std::vector<std::unique_ptr<BufferBase>> bound_outputs_;
+  std::vector<std::vector<int64_t>> bound_output_shapes_;
+  bool has_bindings_;
+  // Bumped by each run in ws_, which discards the run in steps before it
+  uint64_t run_generation_;
+  // Asynchronous runs: while one context computes, the inputs of the next
+  // request are staged into the other one.
+  std::mutex async_mutex_;
+  std::condition_variable async_cond_;
+  std::deque<std::unique_ptr<AsyncRequest>> submitted_requests_;
+  std::deque<std::unique_ptr<AsyncRequest>> staged_requests_;
+  std::vector<std::shared_ptr<ExecutionContext>> async_contexts_;
+  std::deque<ExecutionContext *> free_async_contexts_;
+  bool async_stop_;
+  bool async_staging_done_;
+  std::thread stage_thread_;
+  std::thread compute_thread_;
+  // Runs the asynchronous requests instead of the contexts if not empty
+  std::vector<std::vector<int>> pipeline_stage_cpu_ids_;
+  std::unique_ptr<Pipeline> pipeline_;
 #ifdef MACE_ENABLE_HEXAGON
   std::unique_ptr<HexagonControlWrapper> hexagon_controller_;
 #endif
@@ -377,18 +856,47 @@ MaceEngine::Impl::Impl(const MaceEngineConfig &config)
       model_data_size_(0),
       op_registry_(new OperatorRegistry()),
       device_type_(config.impl_->device_type()),
+      num_threads_(config.impl_->num_threads()),
+      cpu_affinity_policy_(config.impl_->cpu_affinity_policy()),
+      use_gemmlowp_(config.impl_->use_gemmlowp()),
+      cpu_ids_(config.impl_->cpu_ids()),
+      executor_(config.impl_->executor()),
+      inter_op_threads_(config.impl_->inter_op_threads()),
+      memory_plan_capacity_(device_type_ == DeviceType::CPU
+                                ? config.impl_->memory_plan_capacity() : 0),
+      shape_granularity_(config.impl_->shape_granularity()),
+      graph_optimizer_passes_(config.impl_->graph_optimizer_passes()),
+      weight_prefetch_distance_(config.impl_->weight_prefetch_distance()),
+      locked_weight_ops_(config.impl_->locked_weight_ops()),
+      released_weight_ops_(config.impl_->released_weight_ops()),
+      snapshot_path_(config.impl_->snapshot_path()),
+      snapshot_storage_(nullptr),
+      from_snapshot_(false),
+      init_stats_(),
+      initialized_(false),
       device_(nullptr),
       ws_(new Workspace()),
-      net_(nullptr)
+      net_(nullptr),
+      has_bindings_(false),
+      run_generation_(0),
+      async_stop_(false),
+      async_staging_done_(false),
+      pipeline_stage_cpu_ids_(device_type_ == DeviceType::CPU
+                                  ? config.impl_->pipeline_stage_cpu_ids()
+                                  : std::vector<std::vector<int>>())
 #ifdef MACE_ENABLE_HEXAGON
       , hexagon_controller_(nullptr)
 #endif
 {
   LOG(INFO) << "Creating MaceEngine, MACE version: " << MaceVersion();
+  ws_->SetWeightDedup(config.impl_->weight_dedup(),
+                      config.impl_->share_weights());
   if (device_type_ == DeviceType::CPU || device_type_ == DeviceType::HEXAGON) {
-    device_.reset(new CPUDevice(config.impl_->num_threads(),
-                                config.impl_->cpu_affinity_policy(),
-                                config.impl_->use_gemmlowp()));
+    device_.reset(new CPUDevice(num_threads_,
+                                cpu_affinity_policy_,
+                                use_gemmlowp_,
+                                cpu_ids_,
+                                executor_));
   }
 #ifdef MACE_ENABLE_OPENCL
   if (device_type_ == DeviceType::GPU) {
@@ -400,7 +908,9 @@ MaceEngine::Impl::Impl(const MaceEngineConfig &config)
         config.impl_->gpu_context()->opencl_binary_storage(),
         config.impl_->num_threads(),
         config.impl_->cpu_affinity_policy(),
-        config.impl_->use_gemmlowp()));
+        config.impl_->use_gemmlowp(),
+        config.impl_->cpu_ids(),
+        config.impl_->executor()));
   }
 #endif
 }
@@ -411,6 +921,26 @@ MaceStatus MaceEngine::Impl::Init(
     const std::vector<std::string> &output_nodes,
     const unsigned char *model_data) {
   LOG(INFO) << "Initializing MaceEngine";
+  const int64_t init_start_micros = NowMicros();
+  // Starts from the state a previous Init of the model saved, if any
+  std::unique_ptr<NetDef> snapshot_net_def;
+  if (device_type_ == DeviceType::CPU && !snapshot_path_.empty()) {
+    const std::string checksum =
+        ModelChecksum(*net_def, model_data, model_data_file_);
+    snapshot_key_ = EngineSnapshotKey(checksum, SnapshotOptions());
+    snapshot_storage_ = FileStorageFactory(snapshot_path_).CreateStorage(
+        MakeString("mace_engine_", checksum));
+    snapshot_net_def.reset(new NetDef());
+    const unsigned char *snapshot_data = nullptr;
+    if (LoadEngineSnapshot(snapshot_storage_.get(), snapshot_key_,
+                           snapshot_net_def.get(), &snapshot_data)
+        == MaceStatus::MACE_SUCCESS) {
+      LOG(INFO) << "Starting from the engine snapshot";
+      net_def = snapshot_net_def.get();
+      model_data = snapshot_data;
+      from_snapshot_ = true;
+    }
+  }
   // Check avalibility
 #ifdef MACE_ENABLE_OPENCL
   if (device_type_ == DeviceType::GPU) {
@@ -457,21 +987,98 @@ MaceStatus MaceEngine::Impl::Init(
     }
   } else {
 #endif
-    MACE_RETURN_IF_ERROR(ws_->LoadModelTensor(*net_def,
+    // Kept for creating the operators of execution contexts
+    std::shared_ptr<NetDef> runtime_net_def = std::move(adopted_net_def_);
+    if (runtime_net_def.get() != net_def) {
+      runtime_net_def.reset(new NetDef(*net_def));
+    }
+    int64_t phase_start_micros = NowMicros();
+    bool optimize_graph = false;
+    for (auto &pass : graph_optimizer_passes_) {
+      optimize_graph = optimize_graph || pass.second;
+    }
+    if (device_type_ == DeviceType::CPU && !from_snapshot_
+        && optimize_graph) {
+      // Rewrites the graph before the memory is planned for it, with the
+      // passes enabled in the config only
+      GraphOptimizer optimizer(op_registry_.get(), device_.get());
+      optimizer.SetAllPassesEnabled(false);
+      for (auto &pass : graph_optimizer_passes_) {
+        optimizer.SetPassEnabled(pass.first, pass.second);
+      }
+      if (memory_plan_capacity_ > 0) {
+        // The input shapes change from run to run
+        auto pass = graph_optimizer_passes_.find("FoldStaticShapes");
+        if (pass != graph_optimizer_passes_.end() && pass->second) {
+          LOG(WARNING) << "FoldStaticShapes is disabled by the memory plan"
+                       << " cache";
+        }
+        optimizer.SetPassEnabled("FoldStaticShapes", false);
+      }
+      MACE_RETURN_IF_ERROR(optimizer.Optimize(runtime_net_def.get(),
+                                              model_data,
+                                              ws_.get()));
+    }
+    net_def_ = runtime_net_def;
+    init_stats_.optimize_graph_micros = NowMicros() - phase_start_micros;
+
+    phase_start_micros = NowMicros();
+    MACE_RETURN_IF_ERROR(ws_->LoadModelTensor(*net_def_,
                                               device_.get(),
                                               model_data));
+    if (memory_plan_capacity_ > 0) {
+      ws_->EnableMemoryPlanCache(memory_plan_capacity_);
+    }
+    init_stats_.load_tensors_micros = NowMicros() - phase_start_micros;
+
+    input_nodes_ = input_nodes;
+    output_nodes_ = output_nodes;
 
     // Init model
-    auto net = CreateNet(op_registry_, *net_def, ws_.get(), device_.get(),
+    phase_start_micros = NowMicros();
+    auto net = CreateNet(op_registry_, net_def_, ws_.get(), device_.get(),
                          NetMode::INIT);
     MACE_RETURN_IF_ERROR(net->Run());
-    net_ = CreateNet(op_registry_, *net_def, ws_.get(), device_.get());
+    init_stats_.init_net_micros = NowMicros() - phase_start_micros;
+
+    phase_start_micros = NowMicros();
+    net_ = CreateNet(op_registry_, net_def_, ws_.get(), device_.get(),
+                     NetMode::NORMAL, inter_op_threads_);
+    init_stats_.create_operators_micros = NowMicros() - phase_start_micros;
+    std::unique_ptr<WeightPager> weight_pager = CreateWeightPager(true);
+    if (weight_pager != nullptr) {
+      if (weight_prefetch_distance_ > 0) {
+        weight_pager->DisableReadahead();
+      }
+      net_->SetWeightPager(std::move(weight_pager));
+    }
 #ifdef MACE_ENABLE_HEXAGON
   }
 #endif
   if (device_type_ == DeviceType::GPU) {
     ws_->RemoveAndReloadBuffer(*net_def, model_data, device_->allocator());
   }
+  // Resolved after loading the model, which may replace the output tensors
+  // by preallocated ones.
+  for (auto &input_name : input_nodes) {
+    input_tensors_.push_back(
+        ws_->GetTensor(MakeString("mace_input_node_", input_name)));
+  }
+  for (auto &output_name : output_nodes) {
+    output_tensors_.push_back(
+        ws_->GetTensor(MakeString("mace_output_node_", output_name)));
+  }
+  bound_inputs_.resize(input_tensors_.size());
+  bound_outputs_.resize(output_tensors_.size());
+  bound_output_shapes_.resize(output_tensors_.size());
+  init_stats_.total_micros = NowMicros() - init_start_micros;
+  initialized_ = true;
+  LOG(INFO) << "MaceEngine initialized in " << init_stats_.total_micros
+            << " us: optimize graph " << init_stats_.optimize_graph_micros
+            << " us, load tensors " << init_stats_.load_tensors_micros
+            << " us, init net " << init_stats_.init_net_micros
+            << " us, create operators "
+            << init_stats_.create_operators_micros << " us";
   return MaceStatus::MACE_SUCCESS;
 }
 
@@ -481,6 +1088,7 @@ MaceStatus MaceEngine::Impl::Init(
     const std::vector<std::string> &output_nodes,
     const std::string &model_data_file) {
   LOG(INFO) << "Loading Model Data";
+  model_data_file_ = model_data_file;
   for (auto &const_tensor : net_def->tensors()) {
     model_data_size_ = std::max(
         model_data_size_,
@@ -488,19 +1096,58 @@ MaceStatus MaceEngine::Impl::Init(
             const_tensor.data_size() *
                 GetEnumTypeSize(const_tensor.data_type())));
   }
+  const size_t compressed_size = CompressedModelDataFileSize(model_data_file);
+  if (compressed_size > 0) {
+    // Decompressed into memory the CPU tensors then use as is, without
+    // the weight paging of a mapped file
+    const unsigned char *compressed =
+        LoadModelData(model_data_file, compressed_size);
+    const uint64_t data_size =
+        DecompressedModelDataSize(compressed, compressed_size);
+    if (data_size < model_data_size_) {
+      LOG(ERROR) << "Invalid compressed model data file " << model_data_file;
+      UnloadModelData(compressed, compressed_size);
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
+    decompressed_model_data_.reset(new unsigned char[data_size]);
+    MaceStatus decompress_status;
+    {
+      ThreadPoolGuard thread_pool_guard(
+          device_ == nullptr ? nullptr
+                             : device_->cpu_runtime()->thread_pool());
+      decompress_status = DecompressModelData(
+          compressed, compressed_size, decompressed_model_data_.get());
+    }
+    UnloadModelData(compressed, compressed_size);
+    MACE_RETURN_IF_ERROR(decompress_status);
+
+    MACE_RETURN_IF_ERROR(Init(net_def, input_nodes, output_nodes,
+                              decompressed_model_data_.get()));
+    if (device_type_ != DeviceType::CPU || from_snapshot_) {
+      decompressed_model_data_.reset();
+    }
+    return MaceStatus::MACE_SUCCESS;
+  }
   model_data_ = LoadModelData(model_data_file, model_data_size_);
 
   MACE_RETURN_IF_ERROR(Init(net_def, input_nodes, output_nodes, model_data_));
 
   if (device_type_ == DeviceType::GPU || device_type_ == DeviceType::HEXAGON) {
     UnloadModelData(model_data_, model_data_size_);
+  } else if (from_snapshot_) {
+    // The snapshot holds the weights
+    UnloadModelData(model_data_, model_data_size_);
+    model_data_ = nullptr;
   }
   return MaceStatus::MACE_SUCCESS;
 }
 
 MaceEngine::Impl::~Impl() {
   LOG(INFO) << "Destroying MaceEngine";
+  StopAsync();
   if (device_type_ == DeviceType::CPU && model_data_ != nullptr) {
+    // Unlocks the weights
+    net_.reset();
     UnloadModelData(model_data_, model_data_size_);
   }
 #ifdef MACE_ENABLE_HEXAGON
@@ -515,13 +1162,503 @@ MaceEngine::Impl::~Impl() {
 #endif
 }
 
+std::unique_ptr<WeightPager> MaceEngine::Impl::CreateWeightPager(
+    bool lock_weights) const {
+  // Only the data file mapped by the engine is paged, not a snapshot
+  if (device_type_ != DeviceType::CPU || model_data_ == nullptr
+      || from_snapshot_
+      || (weight_prefetch_distance_ == 0 && released_weight_ops_.empty()
+          && (!lock_weights || locked_weight_ops_.empty()))) {
+    return nullptr;
+  }
+  return std::unique_ptr<WeightPager>(new WeightPager(
+      model_data_, model_data_size_, weight_prefetch_distance_,
+      lock_weights ? locked_weight_ops_ : std::set<std::string>(),
+      released_weight_ops_));
+}
+
+std::string MaceEngine::Impl::SnapshotOptions() const {
+  std::stringstream options;
+  options << "plan_cache=" << (memory_plan_capacity_ > 0);
+  for (auto &pass : graph_optimizer_passes_) {
+    options << "," << pass.first << "=" << pass.second;
+  }
+  return options.str();
+}
+
+MaceStatus MaceEngine::Impl::SaveSnapshot() {
+  if (snapshot_storage_ == nullptr || net_def_ == nullptr) {
+    LOG(ERROR) << "Saving a snapshot needs a CPU engine initialized"
+               << " with a snapshot path";
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  if (from_snapshot_) {
+    // Up to date, and holding the weights in use
+    return MaceStatus::MACE_SUCCESS;
+  }
+  return SaveEngineSnapshot(*net_def_, *ws_, snapshot_key_,
+                            snapshot_storage_.get());
+}
+
+MaceStatus MaceEngine::Impl::GetInitStats(InitStats *stats) const {
+  MACE_CHECK_NOTNULL(stats);
+  if (!initialized_) {
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  *stats = init_stats_;
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus MaceEngine::Impl::GetPipelineStats(PipelineStats *stats) {
+  MACE_CHECK_NOTNULL(stats);
+  std::lock_guard<std::mutex> lock(async_mutex_);
+  if (pipeline_ == nullptr) {
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  pipeline_->GetStats(stats);
+  return MaceStatus::MACE_SUCCESS;
+}
+
+void MaceEngine::Impl::AdoptNetDef(std::shared_ptr<NetDef> net_def) {
+  adopted_net_def_ = std::move(net_def);
+}
+
+MaceStatus MaceEngine::Impl::CreateContext(
+    std::shared_ptr<ExecutionContext> *context) {
+  MACE_CHECK_NOTNULL(context);
+  if (net_def_ == nullptr) {
+    LOG(ERROR) << "Execution context needs an initialized CPU or GPU engine";
+    return MACE_INVALID_ARGS;
+  }
+  std::shared_ptr<ExecutionContext> ctx(new ExecutionContext());
+  Device *device = device_.get();
+  if (device_type_ == DeviceType::CPU) {
+    ctx->device.reset(new CPUDevice(num_threads_,
+                                    cpu_affinity_policy_,
+                                    use_gemmlowp_,
+                                    cpu_ids_,
+                                    executor_));
+    device = ctx->device.get();
+  }
+  ctx->ws.reset(new Workspace(ws_.get()));
+  for (auto &input_name : input_nodes_) {
+    ctx->ws->CreateTensor(MakeString("mace_input_node_", input_name),
+                          device->allocator(), DT_FLOAT);
+  }
+  for (auto &output_name : output_nodes_) {
+    ctx->ws->CreateTensor(MakeString("mace_output_node_", output_name),
+                          device->allocator(), DT_FLOAT);
+  }
+  MACE_RETURN_IF_ERROR(ctx->ws->CreateContextTensors(*net_def_, device));
+  if (memory_plan_capacity_ > 0) {
+    ctx->ws->EnableMemoryPlanCache(memory_plan_capacity_);
+  }
+  ctx->net = CreateNet(op_registry_, net_def_, ctx->ws.get(), device,
+                       NetMode::NORMAL, inter_op_threads_);
+  ctx->net->SetWeightPager(CreateWeightPager(false));
+  *context = ctx;
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngine::Impl::Run(
+    const std::map<std::string, MaceTensor> &inputs,
+    std::map<std::string, MaceTensor> *outputs,
+    RunMetadata *run_metadata,
+    const RunOptions *run_options) {
+  // Inputs are copied into the workspace's own buffers
+  if (has_bindings_) {
+    UnbindAll();
+  }
+  ++run_generation_;
+  return Run(ws_.get(), net_.get(), inputs, outputs, run_metadata,
+             run_options);
+}
+
+MaceStatus MaceEngine::Impl::GetInputHandle(const std::string &name,
+                                            int *handle) const {
+  MACE_CHECK_NOTNULL(handle);
+  auto iter = std::find(input_nodes_.begin(), input_nodes_.end(), name);
+  if (iter == input_nodes_.end()) {
+    LOG(ERROR) << "'" << name << "' is not an input node of the engine";
+    return MACE_INVALID_ARGS;
+  }
+  *handle = static_cast<int>(iter - input_nodes_.begin());
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngine::Impl::GetOutputHandle(const std::string &name,
+                                             int *handle) const {
+  MACE_CHECK_NOTNULL(handle);
+  auto iter = std::find(output_nodes_.begin(), output_nodes_.end(), name);
+  if (iter == output_nodes_.end()) {
+    LOG(ERROR) << "'" << name << "' is not an output node of the engine";
+    return MACE_INVALID_ARGS;
+  }
+  *handle = static_cast<int>(iter - output_nodes_.begin());
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngine::Impl::BindTensor(
+    const MaceTensor &tensor,
+    Tensor *mace_tensor,
+    std::unique_ptr<BufferBase> *bound_buffer) {
+  if (tensor.data() == nullptr) {
+    return MACE_INVALID_ARGS;
+  }
+  const std::vector<int64_t> &shape = tensor.shape();
+  const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                       std::multiplies<int64_t>());
+  // The padding is part of the user allocation, see MaceEngine::BindInput.
+  bound_buffer->reset(new BoundBuffer(
+      device_->allocator(), tensor.data(),
+      size * sizeof(float) + MACE_EXTRA_BUFFER_PAD_SIZE));
+  mace_tensor->SetBuffer(bound_buffer->get());
+  has_bindings_ = true;
+  return mace_tensor->Resize(shape);
+}
+
+void MaceEngine::Impl::UnbindAll() {
+  for (size_t i = 0; i < input_tensors_.size(); ++i) {
+    if (bound_inputs_[i] != nullptr) {
+      input_tensors_[i]->SetBuffer(nullptr);
+      bound_inputs_[i].reset();
+    }
+  }
+  for (size_t i = 0; i < output_tensors_.size(); ++i) {
+    if (bound_outputs_[i] != nullptr) {
+      output_tensors_[i]->SetBuffer(nullptr);
+      bound_outputs_[i].reset();
+    }
+  }
+  has_bindings_ = false;
+}
+
+MaceStatus MaceEngine::Impl::BindInput(const int handle,
+                                       const MaceTensor &tensor) {
+  if (device_type_ != DeviceType::CPU || handle < 0
+      || handle >= static_cast<int>(input_tensors_.size())) {
+    return MACE_INVALID_ARGS;
+  }
+  return BindTensor(tensor, input_tensors_[handle], &bound_inputs_[handle]);
+}
+
+MaceStatus MaceEngine::Impl::BindOutput(const int handle,
+                                        const MaceTensor &tensor) {
+  if (device_type_ != DeviceType::CPU || handle < 0
+      || handle >= static_cast<int>(output_tensors_.size())) {
+    return MACE_INVALID_ARGS;
+  }
+  bound_output_shapes_[handle] = tensor.shape();
+  return BindTensor(tensor, output_tensors_[handle],
+                    &bound_outputs_[handle]);
+}
+
+MaceStatus MaceEngine::Impl::GetInputBuffer(
+    const int handle,
+    const std::vector<int64_t> &shape,
+    float **data) {
+  MACE_CHECK_NOTNULL(data);
+  if (device_type_ != DeviceType::CPU || handle < 0
+      || handle >= static_cast<int>(input_tensors_.size())) {
+    return MACE_INVALID_ARGS;
+  }
+  Tensor *input_tensor = input_tensors_[handle];
+  if (bound_inputs_[handle] != nullptr) {
+    input_tensor->SetBuffer(nullptr);
+    bound_inputs_[handle].reset();
+  }
+  MACE_RETURN_IF_ERROR(input_tensor->Resize(shape));
+  *data = input_tensor->mutable_data<float>();
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngine::Impl::GetOutputBuffer(
+    const int handle,
+    std::vector<int64_t> *shape,
+    const float **data) {
+  MACE_CHECK_NOTNULL(shape);
+  MACE_CHECK_NOTNULL(data);
+  if (device_type_ != DeviceType::CPU || handle < 0
+      || handle >= static_cast<int>(output_tensors_.size())) {
+    return MACE_INVALID_ARGS;
+  }
+  const Tensor *output_tensor = output_tensors_[handle];
+  *shape = output_tensor->shape();
+  *data = output_tensor->data<float>();
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngine::Impl::RunWithBindings(RunMetadata *run_metadata) {
+  if (device_type_ != DeviceType::CPU) {
+    return MACE_INVALID_ARGS;
+  }
+  ++run_generation_;
+  MACE_RETURN_IF_ERROR(net_->Run(run_metadata));
+  for (size_t i = 0; i < output_tensors_.size(); ++i) {
+    if (bound_outputs_[i] != nullptr
+        && output_tensors_[i]->shape() != bound_output_shapes_[i]) {
+      LOG(ERROR) << "Output shape mismatch: "
+                 << MakeString<int64_t>(bound_output_shapes_[i])
+                 << " != " << MakeString<int64_t>(output_tensors_[i]->shape());
+      return MACE_INVALID_ARGS;
+    }
+  }
+  return MACE_SUCCESS;
+}
+
 MaceStatus MaceEngine::Impl::Run(
+    ExecutionContext *context,
+    const std::map<std::string, MaceTensor> &inputs,
+    std::map<std::string, MaceTensor> *outputs,
+    RunMetadata *run_metadata,
+    const RunOptions *run_options) {
+  MACE_CHECK_NOTNULL(context);
+  return Run(context->ws.get(), context->net.get(), inputs, outputs,
+             run_metadata, run_options);
+}
+
+MaceStatus MaceEngine::Impl::StartRun(
     const std::map<std::string, MaceTensor> &inputs,
     std::map<std::string, MaceTensor> *outputs,
-    RunMetadata *run_metadata) {
+    std::shared_ptr<RunHandle> *handle) {
   MACE_CHECK_NOTNULL(outputs);
+  MACE_CHECK_NOTNULL(handle);
+  if (device_type_ != DeviceType::CPU || net_ == nullptr) {
+    LOG(ERROR) << "Runs in steps need an initialized CPU engine";
+    return MACE_INVALID_ARGS;
+  }
+  for (auto &output : *outputs) {
+    if (output_info_map_.find(output.first) == output_info_map_.end()) {
+      LOG(ERROR) << "'" << output.first
+                 << "' does not belong to model's outputs: "
+                 << MakeString(MapKeys(output_info_map_));
+      return MACE_INVALID_ARGS;
+    }
+  }
+  if (has_bindings_) {
+    UnbindAll();
+  }
+  ++run_generation_;
+  if (memory_plan_capacity_ > 0) {
+    ws_->SwitchMemoryPlan(MemoryPlanKey(inputs));
+  }
   std::vector<Tensor *> input_tensors;
-  std::vector<Tensor *> output_tensors;
+  MACE_RETURN_IF_ERROR(CopyInputs(ws_.get(), inputs, &input_tensors));
+
+  std::shared_ptr<RunHandle> run(new RunHandle());
+  run->outputs = *outputs;
+  run->generation = run_generation_;
+  run->next_op = 0;
+  run->done = false;
+  run->status = MaceStatus::MACE_SUCCESS;
+  *handle = run;
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngine::Impl::RunStep(RunHandle *handle,
+                                     int64_t budget_micros,
+                                     bool *done) {
+  MACE_CHECK_NOTNULL(handle);
+  MACE_CHECK_NOTNULL(done);
+  if (!handle->done) {
+    if (handle->generation != run_generation_
+        || handle->status != MaceStatus::MACE_SUCCESS) {
+      LOG(ERROR) << "The run in steps is discarded by another run or failed";
+      return MACE_INVALID_ARGS;
+    }
+    bool ops_done = false;
+    handle->status = net_->RunStep(&handle->next_op, budget_micros,
+                                   &ops_done);
+    MACE_RETURN_IF_ERROR(handle->status);
+    if (ops_done) {
+      handle->status = CopyOutputs(ws_.get(), &handle->outputs);
+      MACE_RETURN_IF_ERROR(handle->status);
+      handle->done = true;
+    }
+  }
+  *done = handle->done;
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngine::Impl::StartAsync() {
+  if (!pipeline_stage_cpu_ids_.empty()) {
+    if (net_def_ == nullptr || memory_plan_capacity_ > 0) {
+      LOG(ERROR) << "Pipeline needs an initialized CPU engine without"
+                 << " memory plan cache";
+      return MACE_INVALID_ARGS;
+    }
+    std::vector<std::string> input_tensors;
+    for (auto &input_name : input_nodes_) {
+      input_tensors.push_back(MakeString("mace_input_node_", input_name));
+    }
+    std::vector<std::string> output_tensors;
+    for (auto &output_name : output_nodes_) {
+      output_tensors.push_back(MakeString("mace_output_node_", output_name));
+    }
+    std::unique_ptr<Pipeline> pipeline(new Pipeline(
+        op_registry_, net_def_, ws_.get(), input_tensors, output_tensors,
+        pipeline_stage_cpu_ids_, use_gemmlowp_));
+    MACE_RETURN_IF_ERROR(pipeline->Init());
+    pipeline_ = std::move(pipeline);
+    return MACE_SUCCESS;
+  }
+  std::vector<std::shared_ptr<ExecutionContext>> contexts(kNumAsyncContexts);
+  for (auto &context : contexts) {
+    MACE_RETURN_IF_ERROR(CreateContext(&context));
+  }
+  for (auto &context : contexts) {
+    async_contexts_.push_back(context);
+    free_async_contexts_.push_back(context.get());
+  }
+  stage_thread_ = std::thread(&MaceEngine::Impl::StageLoop, this);
+  compute_thread_ = std::thread(&MaceEngine::Impl::ComputeLoop, this);
+  return MACE_SUCCESS;
+}
+
+void MaceEngine::Impl::StopAsync() {
+  {
+    std::lock_guard<std::mutex> lock(async_mutex_);
+    async_stop_ = true;
+  }
+  async_cond_.notify_all();
+  if (stage_thread_.joinable()) {
+    stage_thread_.join();
+  }
+  if (compute_thread_.joinable()) {
+    compute_thread_.join();
+  }
+  // Completes the frames in the pipeline
+  pipeline_.reset();
+}
+
+MaceStatus MaceEngine::Impl::RunAsync(
+    const std::map<std::string, MaceTensor> &inputs,
+    std::map<std::string, MaceTensor> *outputs,
+    std::function<void(MaceStatus)> callback,
+    std::future<MaceStatus> *future) {
+  MACE_CHECK_NOTNULL(outputs);
+  std::unique_ptr<AsyncRequest> request(new AsyncRequest());
+  request->inputs = inputs;
+  request->outputs = *outputs;
+  request->callback = callback;
+  request->context = nullptr;
+  request->status = MACE_SUCCESS;
+
+  std::unique_lock<std::mutex> lock(async_mutex_);
+  if (async_contexts_.empty() && pipeline_ == nullptr) {
+    MACE_RETURN_IF_ERROR(StartAsync());
+  }
+  if (future != nullptr) {
+    *future = request->promise.get_future();
+  }
+  if (pipeline_ != nullptr) {
+    lock.unlock();
+    return SubmitToPipeline(std::move(request));
+  }
+  async_cond_.wait(lock, [this] {
+    return submitted_requests_.size() < kMaxSubmittedAsyncRuns;
+  });
+  submitted_requests_.push_back(std::move(request));
+  async_cond_.notify_all();
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngine::Impl::SubmitToPipeline(
+    std::unique_ptr<AsyncRequest> request) {
+  std::shared_ptr<AsyncRequest> shared_request(std::move(request));
+  return pipeline_->Submit(
+      [this, shared_request](Workspace *ws) {
+        return CopyInputs(ws, shared_request->inputs, nullptr);
+      },
+      [this, shared_request](MaceStatus status, Workspace *ws) {
+        if (status == MACE_SUCCESS) {
+          status = CopyOutputs(ws, &shared_request->outputs);
+        }
+        if (shared_request->callback != nullptr) {
+          shared_request->callback(status);
+        }
+        shared_request->promise.set_value(status);
+      });
+}
+
+void MaceEngine::Impl::StageLoop() {
+  std::unique_lock<std::mutex> lock(async_mutex_);
+  while (true) {
+    async_cond_.wait(lock, [this] {
+      return (async_stop_ && submitted_requests_.empty())
+          || (!submitted_requests_.empty() && !free_async_contexts_.empty());
+    });
+    if (submitted_requests_.empty()) break;
+    std::unique_ptr<AsyncRequest> request =
+        std::move(submitted_requests_.front());
+    submitted_requests_.pop_front();
+    request->context = free_async_contexts_.front();
+    free_async_contexts_.pop_front();
+    // Let the submitters waiting for room in the queue continue
+    async_cond_.notify_all();
+
+    lock.unlock();
+    request->status = CopyInputs(request->context->ws.get(),
+                                 request->inputs, nullptr);
+    lock.lock();
+    staged_requests_.push_back(std::move(request));
+    async_cond_.notify_all();
+  }
+  async_staging_done_ = true;
+  async_cond_.notify_all();
+}
+
+void MaceEngine::Impl::ComputeLoop() {
+  std::unique_lock<std::mutex> lock(async_mutex_);
+  while (true) {
+    async_cond_.wait(lock, [this] {
+      return async_staging_done_ || !staged_requests_.empty();
+    });
+    if (staged_requests_.empty()) break;
+    std::unique_ptr<AsyncRequest> request =
+        std::move(staged_requests_.front());
+    staged_requests_.pop_front();
+
+    lock.unlock();
+    ExecutionContext *context = request->context;
+    MaceStatus status = request->status;
+    if (status == MACE_SUCCESS) {
+      if (memory_plan_capacity_ > 0) {
+        context->ws->SwitchMemoryPlan(MemoryPlanKey(request->inputs));
+      }
+      status = context->net->Run();
+    }
+    if (status == MACE_SUCCESS) {
+      status = CopyOutputs(context->ws.get(), &request->outputs);
+    }
+    lock.lock();
+    free_async_contexts_.push_back(context);
+    async_cond_.notify_all();
+
+    lock.unlock();
+    if (request->callback != nullptr) {
+      request->callback(status);
+    }
+    request->promise.set_value(status);
+    lock.lock();
+  }
+}
+
+std::vector<index_t> MaceEngine::Impl::MemoryPlanKey(
+    const std::map<std::string, MaceTensor> &inputs) const {
+  std::vector<index_t> key;
+  for (auto &input : inputs) {
+    for (auto dim : input.second.shape()) {
+      key.push_back(RoundUp<index_t>(dim, shape_granularity_));
+    }
+  }
+  return key;
+}
+
+MaceStatus MaceEngine::Impl::CopyInputs(
+    Workspace *ws,
+    const std::map<std::string, MaceTensor> &inputs,
+    std::vector<Tensor *> *input_tensors) {
   for (auto &input : inputs) {
     if (input_info_map_.find(input.first) == input_info_map_.end()) {
       LOG(FATAL) << "'" << input.first
@@ -529,7 +1666,7 @@ MaceStatus MaceEngine::Impl::Run(
                  << MakeString(MapKeys(input_info_map_));
     }
     Tensor *input_tensor =
-        ws_->GetTensor(MakeString("mace_input_node_", input.first));
+        ws->GetTensor(MakeString("mace_input_node_", input.first));
     MACE_RETURN_IF_ERROR(input_tensor->Resize(input.second.shape()));
     {
       Tensor::MappingGuard input_guard(input_tensor);
@@ -537,8 +1674,58 @@ MaceStatus MaceEngine::Impl::Run(
       memcpy(input_data, input.second.data().get(),
              input_tensor->size() * sizeof(float));
     }
-    input_tensors.push_back(input_tensor);
+    if (input_tensors != nullptr) {
+      input_tensors->push_back(input_tensor);
+    }
+  }
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngine::Impl::CopyOutputs(
+    Workspace *ws,
+    std::map<std::string, MaceTensor> *outputs) {
+  for (auto &output : *outputs) {
+    Tensor *output_tensor =
+        ws->GetTensor(MakeString("mace_output_node_", output.first));
+    // save output
+    if (output_tensor != nullptr && output.second.data() != nullptr) {
+      Tensor::MappingGuard output_guard(output_tensor);
+      auto shape = output_tensor->shape();
+      int64_t output_size = std::accumulate(shape.begin(), shape.end(), 1,
+                                            std::multiplies<int64_t>());
+      MACE_CHECK(shape == output.second.shape())
+          << "Output shape mismatch: "
+          << MakeString<int64_t>(output.second.shape())
+          << " != " << MakeString<int64_t>(shape);
+      std::memcpy(output.second.data().get(), output_tensor->data<float>(),
+                  output_size * sizeof(float));
+    } else {
+      return MACE_INVALID_ARGS;
+    }
   }
+  return MACE_SUCCESS;
+}
+
+MaceStatus MaceEngine::Impl::Run(
+    Workspace *ws,
+    NetBase *net,
+    const std::map<std::string, MaceTensor> &inputs,
+    std::map<std::string, MaceTensor> *outputs,
+    RunMetadata *run_metadata,
+    const RunOptions *run_options) {
+  MACE_CHECK_NOTNULL(outputs);
+  if (run_options != nullptr
+      && (run_options->priority < RUN_PRIORITY_LOW
+          || run_options->priority > RUN_PRIORITY_HIGH)) {
+    LOG(ERROR) << "Invalid run priority: " << run_options->priority;
+    return MACE_INVALID_ARGS;
+  }
+  std::vector<Tensor *> input_tensors;
+  std::vector<Tensor *> output_tensors;
+  if (memory_plan_capacity_ > 0) {
+    ws->SwitchMemoryPlan(MemoryPlanKey(inputs));
+  }
+  MACE_RETURN_IF_ERROR(CopyInputs(ws, inputs, &input_tensors));
   for (auto &output : *outputs) {
     if (output_info_map_.find(output.first) == output_info_map_.end()) {
       LOG(FATAL) << "'" << output.first
@@ -546,7 +1733,7 @@ MaceStatus MaceEngine::Impl::Run(
                  << MakeString(MapKeys(output_info_map_));
     }
     Tensor *output_tensor =
-        ws_->GetTensor(MakeString("mace_output_node_", output.first));
+        ws->GetTensor(MakeString("mace_output_node_", output.first));
     output_tensors.push_back(output_tensor);
   }
 #ifdef MACE_ENABLE_HEXAGON
@@ -556,7 +1743,17 @@ MaceStatus MaceEngine::Impl::Run(
     hexagon_controller_->ExecuteGraph(*input_tensors[0], output_tensors[0]);
   } else {
 #endif
-    MACE_RETURN_IF_ERROR(net_->Run(run_metadata));
+    std::unique_ptr<RunControl> run_control;
+    if (run_options != nullptr) {
+      run_control.reset(new RunControl(*run_options));
+    }
+    RunControlGuard run_control_guard(run_control.get());
+    const MaceStatus run_status = net->Run(run_metadata);
+    // Not a failure to log
+    if (run_status == MaceStatus::MACE_CANCELLED) {
+      return run_status;
+    }
+    MACE_RETURN_IF_ERROR(run_status);
 #ifdef MACE_ENABLE_HEXAGON
   }
 #endif
@@ -566,26 +1763,7 @@ MaceStatus MaceEngine::Impl::Run(
     device_->opencl_runtime()->SaveBuiltCLProgram();
   }
 #endif
-  for (auto &output : *outputs) {
-    Tensor *output_tensor =
-        ws_->GetTensor(MakeString("mace_output_node_", output.first));
-    // save output
-    if (output_tensor != nullptr && output.second.data() != nullptr) {
-      Tensor::MappingGuard output_guard(output_tensor);
-      auto shape = output_tensor->shape();
-      int64_t output_size = std::accumulate(shape.begin(), shape.end(), 1,
-                                            std::multiplies<int64_t>());
-      MACE_CHECK(shape == output.second.shape())
-          << "Output shape mismatch: "
-          << MakeString<int64_t>(output.second.shape())
-          << " != " << MakeString<int64_t>(shape);
-      std::memcpy(output.second.data().get(), output_tensor->data<float>(),
-                  output_size * sizeof(float));
-    } else {
-      return MACE_INVALID_ARGS;
-    }
-  }
-  return MACE_SUCCESS;
+  return CopyOutputs(ws, outputs);
 }
 
 MaceEngine::MaceEngine(const MaceEngineConfig &config):
@@ -611,12 +1789,115 @@ MaceStatus MaceEngine::Init(const NetDef *net_def,
 MaceStatus MaceEngine::Run(const std::map<std::string, MaceTensor> &inputs,
                            std::map<std::string, MaceTensor> *outputs,
                            RunMetadata *run_metadata) {
-  return impl_->Run(inputs, outputs, run_metadata);
+  return impl_->Run(inputs, outputs, run_metadata, nullptr);
 }
 
 MaceStatus MaceEngine::Run(const std::map<std::string, MaceTensor> &inputs,
                            std::map<std::string, MaceTensor> *outputs) {
-  return impl_->Run(inputs, outputs, nullptr);
+  return impl_->Run(inputs, outputs, nullptr, nullptr);
+}
+
+MaceStatus MaceEngine::Run(const std::map<std::string, MaceTensor> &inputs,
+                           std::map<std::string, MaceTensor> *outputs,
+                           const RunOptions &options) {
+  return impl_->Run(inputs, outputs, nullptr, &options);
+}
+
+MaceStatus MaceEngine::GetInputHandle(const std::string &name,
+                                      int *handle) const {
+  return impl_->GetInputHandle(name, handle);
+}
+
+MaceStatus MaceEngine::GetOutputHandle(const std::string &name,
+                                       int *handle) const {
+  return impl_->GetOutputHandle(name, handle);
+}
+
+MaceStatus MaceEngine::BindInput(const int handle, const MaceTensor &tensor) {
+  return impl_->BindInput(handle, tensor);
+}
+
+MaceStatus MaceEngine::BindOutput(const int handle,
+                                  const MaceTensor &tensor) {
+  return impl_->BindOutput(handle, tensor);
+}
+
+MaceStatus MaceEngine::GetInputBuffer(const int handle,
+                                      const std::vector<int64_t> &shape,
+                                      float **data) {
+  return impl_->GetInputBuffer(handle, shape, data);
+}
+
+MaceStatus MaceEngine::GetOutputBuffer(const int handle,
+                                       std::vector<int64_t> *shape,
+                                       const float **data) {
+  return impl_->GetOutputBuffer(handle, shape, data);
+}
+
+MaceStatus MaceEngine::RunWithBindings() {
+  return impl_->RunWithBindings(nullptr);
+}
+
+MaceStatus MaceEngine::RunWithBindings(RunMetadata *run_metadata) {
+  return impl_->RunWithBindings(run_metadata);
+}
+
+MaceStatus MaceEngine::RunAsync(
+    const std::map<std::string, MaceTensor> &inputs,
+    std::map<std::string, MaceTensor> *outputs,
+    std::function<void(MaceStatus)> callback,
+    std::future<MaceStatus> *future) {
+  return impl_->RunAsync(inputs, outputs, callback, future);
+}
+
+MaceStatus MaceEngine::GetPipelineStats(PipelineStats *stats) const {
+  return impl_->GetPipelineStats(stats);
+}
+
+MaceStatus MaceEngine::SaveSnapshot() {
+  return impl_->SaveSnapshot();
+}
+
+MaceStatus MaceEngine::GetInitStats(InitStats *stats) const {
+  return impl_->GetInitStats(stats);
+}
+
+MaceStatus MaceEngine::StartRun(
+    const std::map<std::string, MaceTensor> &inputs,
+    std::map<std::string, MaceTensor> *outputs,
+    std::shared_ptr<RunHandle> *handle) {
+  return impl_->StartRun(inputs, outputs, handle);
+}
+
+MaceStatus MaceEngine::RunStep(RunHandle *handle,
+                               int64_t budget_micros,
+                               bool *done) {
+  return impl_->RunStep(handle, budget_micros, done);
+}
+
+MaceStatus MaceEngine::CreateContext(
+    std::shared_ptr<ExecutionContext> *context) {
+  return impl_->CreateContext(context);
+}
+
+MaceStatus MaceEngine::Run(ExecutionContext *context,
+                           const std::map<std::string, MaceTensor> &inputs,
+                           std::map<std::string, MaceTensor> *outputs,
+                           RunMetadata *run_metadata) {
+  return impl_->Run(context, inputs, outputs, run_metadata, nullptr);
+}
+
+MaceStatus MaceEngine::Run(ExecutionContext *context,
+                           const std::map<std::string, MaceTensor> &inputs,
+                           std::map<std::string, MaceTensor> *outputs) {
+  return impl_->Run(context, inputs, outputs, nullptr, nullptr);
+}
+
+MaceStatus MaceEngine::Run(ExecutionContext *context,
+                           const std::map<std::string, MaceTensor> &inputs,
+                           std::map<std::string, MaceTensor> *outputs,
+                           const RunOptions &options) {
+  return impl_->Run(context, inputs, outputs, nullptr, &options);
 }
 
 MaceStatus CreateMaceEngineFromProto(
@@ -642,4 +1923,47 @@ MaceStatus CreateMaceEngineFromProto(
   return status;
 }
 
+MaceStatus CreateMaceEngineFromFlatGraph(
+    const std::string &graph_file,
+    const std::string &model_data_file,
+    const std::vector<std::string> &input_nodes,
+    const std::vector<std::string> &output_nodes,
+    const MaceEngineConfig &config,
+    std::shared_ptr<MaceEngine> *engine) {
+  LOG(INFO) << "Create MaceEngine from flat graph";
+  if (engine == nullptr) {
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+
+  int fd = open(graph_file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "Failed to open graph file " << graph_file
+               << ", error code: " << strerror(errno);
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  struct stat st;
+  int ret = fstat(fd, &st);
+  close(fd);
+  if (ret != 0 || st.st_size <= 0) {
+    LOG(ERROR) << "Failed to stat graph file " << graph_file;
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  const size_t graph_size = static_cast<size_t>(st.st_size);
+  const unsigned char *graph_data = LoadModelData(graph_file, graph_size);
+
+  FlatGraph graph;
+  std::shared_ptr<NetDef> net_def;
+  MaceStatus load_status = graph.Open(graph_data, graph_size);
+  if (load_status == MaceStatus::MACE_SUCCESS) {
+    load_status = graph.CreateNetDef(&net_def);
+  }
+  UnloadModelData(graph_data, graph_size);
+  MACE_RETURN_IF_ERROR(load_status);
+
+  engine->reset(new mace::MaceEngine(config));
+  (*engine)->impl_->AdoptNetDef(net_def);
+  return (*engine)->Init(net_def.get(), input_nodes, output_nodes,
+                         model_data_file);
+}
+
 }  // namespace mace
@@ -54,6 +54,18 @@ def if_opencl_enabled(a):
       "//conditions:default": [],
   })
 
+def if_selective_ops_enabled(a):
+  return select({
+      "//mace:selective_ops_enabled": a,
+      "//conditions:default": [],
+  })
+
+def if_not_selective_ops_enabled(a):
+  return select({
+      "//mace:selective_ops_enabled": [],
+      "//conditions:default": a,
+  })
+
 def if_opencl_enabled_str(a):
   return select({
       "//mace:opencl_enabled": a,
@@ -26,6 +26,9 @@ class BufferInverseTransformOp : public Operator<D, T> {
  public:
   BufferInverseTransformOp(const OperatorDef &op_def, OpKernelContext *context)
       : Operator<D, T>(op_def, context),
+        type_(static_cast<kernels::BufferType>(
+            OperatorBase::GetOptionalArg<int>(
+                "buffer_type", static_cast<int>(kernels::CONV2D_FILTER)))),
         functor_(context,
                  OperatorBase::GetOptionalArg<int>("wino_block_size", 2)) {}
 
@@ -33,13 +36,11 @@ class BufferInverseTransformOp : public Operator<D, T> {
     const Tensor *input = this->Input(INPUT);
     Tensor *output = this->Output(OUTPUT);
 
-    kernels::BufferType type =
-        static_cast<kernels::BufferType>(OperatorBase::GetOptionalArg<int>(
-            "buffer_type", static_cast<int>(kernels::CONV2D_FILTER)));
-    return functor_(input, type, output, future);
+    return functor_(input, type_, output, future);
   }
 
  private:
+  const kernels::BufferType type_;
   kernels::BufferInverseTransformFunctor<D, T> functor_;
 
  protected:
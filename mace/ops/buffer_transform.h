@@ -26,21 +26,22 @@ class BufferTransformOp : public Operator<D, T> {
  public:
   BufferTransformOp(const OperatorDef &op_def, OpKernelContext *context)
       : Operator<D, T>(op_def, context),
+        type_(static_cast<kernels::BufferType>(
+            OperatorBase::GetOptionalArg<int>(
+                "buffer_type", static_cast<int>(kernels::CONV2D_FILTER)))),
         functor_(context,
                  OperatorBase::GetOptionalArg<int>("wino_block_size", 2)) {}
 
   MaceStatus Run(StatsFuture *future) override {
     const Tensor *input_tensor = this->Input(INPUT);
 
-    kernels::BufferType type =
-        static_cast<kernels::BufferType>(OperatorBase::GetOptionalArg<int>(
-            "buffer_type", static_cast<int>(kernels::CONV2D_FILTER)));
     Tensor *output = this->Output(OUTPUT);
 
-    return functor_(input_tensor, type, output, future);
+    return functor_(input_tensor, type_, output, future);
   }
 
  private:
+  const kernels::BufferType type_;
   kernels::BufferTransformFunctor<D, T> functor_;
 
  protected:
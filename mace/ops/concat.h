@@ -28,19 +28,19 @@ class ConcatOp : public Operator<D, T> {
  public:
   ConcatOp(const OperatorDef &op_def, OpKernelContext *context)
       : Operator<D, T>(op_def, context),
-        functor_(context, OperatorBase::GetOptionalArg<int>("axis", 3)) {}
+        axis_(OperatorBase::GetOptionalArg<int>("axis", 3)),
+        functor_(context, axis_) {}
 
   MaceStatus Run(StatsFuture *future) override {
     MACE_CHECK(this->InputSize() >= 2)
         << "There must be at least two inputs to concat";
     const std::vector<const Tensor *> input_list = this->Inputs();
-    const int32_t concat_axis = OperatorBase::GetOptionalArg<int>("axis", 3);
     const int32_t input_dims = input_list[0]->dim_size();
     const int32_t axis =
-        concat_axis < 0 ? concat_axis + input_dims : concat_axis;
+        axis_ < 0 ? axis_ + input_dims : axis_;
     MACE_CHECK((0 <= axis && axis < input_dims),
                "Expected concatenating axis in the range [", -input_dims, ", ",
-               input_dims, "], but got", concat_axis);
+               input_dims, "], but got", axis_);
 
     Tensor *output = this->Output(OUTPUT);
 
@@ -48,6 +48,7 @@ class ConcatOp : public Operator<D, T> {
   }
 
  private:
+  const int32_t axis_;
   kernels::ConcatFunctor<D, T> functor_;
 
  private:
@@ -25,6 +25,30 @@
 namespace mace {
 namespace ops {
 
+// Only the CPU float convolution adds a residual input to its output.
+template <typename Functor>
+MaceStatus RunConv2dFunctor(Functor *functor,
+                            const Tensor *input,
+                            const Tensor *filter,
+                            const Tensor *bias,
+                            const Tensor *residual,
+                            Tensor *output,
+                            StatsFuture *future) {
+  MACE_CHECK(residual == nullptr, "Conv2D does not support residual input");
+  return (*functor)(input, filter, bias, output, future);
+}
+
+inline MaceStatus RunConv2dFunctor(
+    kernels::Conv2dFunctor<DeviceType::CPU, float> *functor,
+    const Tensor *input,
+    const Tensor *filter,
+    const Tensor *bias,
+    const Tensor *residual,
+    Tensor *output,
+    StatsFuture *future) {
+  return (*functor)(input, filter, bias, residual, output, future);
+}
+
 template <DeviceType D, typename T>
 class Conv2dOp : public ConvPool2dOpBase<D, T> {
  public:
@@ -44,15 +68,18 @@ class Conv2dOp : public ConvPool2dOpBase<D, T> {
     const Tensor *input = this->Input(INPUT);
     const Tensor *filter = this->Input(FILTER);
     const Tensor *bias = this->InputSize() >= 3 ? this->Input(BIAS) : nullptr;
+    const Tensor *residual =
+        this->InputSize() >= 4 ? this->Input(RESIDUAL) : nullptr;
     Tensor *output = this->Output(OUTPUT);
-    return functor_(input, filter, bias, output, future);
+    return RunConv2dFunctor(&functor_, input, filter, bias, residual, output,
+                            future);
   }
 
  private:
   kernels::Conv2dFunctor<D, T> functor_;
 
  protected:
-  MACE_OP_INPUT_TAGS(INPUT, FILTER, BIAS);
+  MACE_OP_INPUT_TAGS(INPUT, FILTER, BIAS, RESIDUAL);
   MACE_OP_OUTPUT_TAGS(OUTPUT);
 };
 
@@ -12,12 +12,24 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "mace/core/memory_planner.h"
+#include "mace/core/testing/test_net_util.h"
+#include "mace/kernels/conv_pool_2d_util.h"
+#include "mace/kernels/eltwise.h"
 #include "mace/ops/ops_test_util.h"
 
 namespace mace {
 namespace ops {
+
+extern void Register_Activation(OperatorRegistryBase *op_registry);
+extern void Register_Conv2D(OperatorRegistryBase *op_registry);
+
 namespace test {
 
+using mace::test::AddOpDef;
+using mace::test::BuildResidualNet;
+using mace::test::RunResidualNet;
+
 TEST(CoreTest, INIT_MODE) {
   std::vector<OperatorDef> op_defs;
 
@@ -69,6 +81,363 @@ TEST(CoreTest, INIT_MODE) {
                           1e-5);
 }
 
+namespace {
+void AddOp(const std::string &type,
+           const std::vector<std::string> &inputs,
+           const std::string &output,
+           int mem_id,
+           NetDef *net_def) {
+  OpDefBuilder builder(type.c_str(), output);
+  for (auto &input : inputs) {
+    builder.Input(input);
+  }
+  builder.Output(output);
+  if (type == "Activation") {
+    builder.AddStringArg("activation", "RELU");
+  } else if (type == "Eltwise") {
+    builder.AddIntArg("type", static_cast<int>(kernels::EltwiseType::SUM));
+  } else if (type == "Conv2D") {
+    builder.AddIntsArg("strides", {1, 1})
+        .AddIntArg("padding", Padding::SAME)
+        .AddIntsArg("dilations", {1, 1});
+  }
+  OperatorDef *op_def = net_def->add_op();
+  builder.Finalize(op_def);
+  op_def->add_mem_id(mem_id);
+}
+
+// Two conv branches and two activation branches, with buffers reused as
+// soon as their previous content is dead.
+void BuildBranchedNet(NetDef *net_def) {
+  AddOp("Conv2D", {"Input", "Filter0"}, "A", 0, net_def);
+  AddOp("Conv2D", {"Input", "Filter1"}, "B", 1, net_def);
+  AddOp("Eltwise", {"A", "B"}, "C", 2, net_def);
+  AddOp("Activation", {"C"}, "D", 0, net_def);
+  AddOp("Conv2D", {"C", "Filter0"}, "E", 1, net_def);
+  AddOp("Eltwise", {"D", "E"}, "Output", 2, net_def);
+  for (int mem_id = 0; mem_id < 3; ++mem_id) {
+    MemoryBlock *mem_block = net_def->mutable_mem_arena()->add_mem_block();
+    mem_block->set_mem_id(mem_id);
+    mem_block->set_device_type(DeviceType::CPU);
+    mem_block->set_mem_type(MemoryType::CPU_BUFFER);
+    mem_block->set_x(1 * 8 * 32 * 32 * sizeof(float));
+    mem_block->set_y(1);
+  }
+}
+
+void RunBranchedNet(const NetDef &net_def,
+                    int num_inter_op_threads,
+                    const std::vector<float> &input_data,
+                    const std::vector<float> &filter_data,
+                    std::vector<float> *output_data) {
+  Device *device = OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  Workspace ws;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            ws.LoadModelTensor(net_def, device, nullptr));
+  Tensor *input = ws.CreateTensor("Input", device->allocator(), DT_FLOAT);
+  input->Resize({1, 8, 32, 32});
+  std::copy(input_data.begin(), input_data.end(),
+            input->mutable_data<float>());
+  for (const std::string filter_name : {"Filter0", "Filter1"}) {
+    Tensor *filter = ws.CreateTensor(filter_name, device->allocator(),
+                                     DT_FLOAT);
+    filter->Resize({8, 8, 3, 3});
+    std::copy(filter_data.begin(), filter_data.end(),
+              filter->mutable_data<float>());
+  }
+
+  std::shared_ptr<OperatorRegistryBase> op_registry(new OperatorRegistry());
+  auto net = CreateNet(op_registry, net_def, &ws, device, NetMode::NORMAL,
+                       num_inter_op_threads);
+  for (int i = 0; i < 10; ++i) {
+    RunMetadata run_metadata;
+    ASSERT_EQ(MaceStatus::MACE_SUCCESS, net->Run(&run_metadata));
+    EXPECT_EQ(static_cast<size_t>(net_def.op_size()),
+              run_metadata.op_stats.size());
+  }
+  const Tensor *output = ws.GetTensor("Output");
+  output_data->assign(output->data<float>(),
+                      output->data<float>() + output->size());
+}
+
+}  // namespace
+
+TEST(CoreTest, ParallelNet) {
+  NetDef net_def;
+  BuildBranchedNet(&net_def);
+  std::vector<float> input_data;
+  std::vector<float> filter_data;
+  GenerateRandomRealTypeData<float>({1, 8, 32, 32}, &input_data);
+  GenerateRandomRealTypeData<float>({8, 8, 3, 3}, &filter_data);
+
+  std::vector<float> expected;
+  RunBranchedNet(net_def, 1, input_data, filter_data, &expected);
+  for (int num_threads : {2, 4}) {
+    std::vector<float> output;
+    RunBranchedNet(net_def, num_threads, input_data, filter_data, &output);
+    ASSERT_EQ(expected.size(), output.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_NEAR(expected[i], output[i], 1e-5);
+    }
+  }
+}
+
+TEST(CoreTest, ContextWorkspace) {
+  NetDef net_def;
+  OpDefBuilder("Activation", "Relu")
+      .Input("Input")
+      .Output("Output")
+      .AddStringArg("activation", "RELU")
+      .Finalize(net_def.add_op());
+
+  // The engine workspace holds the input and output nodes too
+  Device *device = OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  Workspace ws;
+  Tensor *input = ws.CreateTensor("Input", device->allocator(), DT_FLOAT);
+  input->Resize({1, 2, 2, 1});
+  std::fill(input->mutable_data<float>(),
+            input->mutable_data<float>() + input->size(), 1.f);
+  Tensor *output = ws.CreateTensor("Output", device->allocator(), DT_FLOAT);
+  output->Resize({1, 2, 2, 1});
+  std::fill(output->mutable_data<float>(),
+            output->mutable_data<float>() + output->size(), 7.f);
+
+  // A context creates its own, and never writes into those of the engine
+  Workspace context_ws(&ws);
+  Tensor *context_input =
+      context_ws.CreateTensor("Input", device->allocator(), DT_FLOAT);
+  ASSERT_NE(input, context_input);
+  context_input->Resize({1, 2, 2, 1});
+  const std::vector<float> input_data = {-2, -1, 1, 2};
+  std::copy(input_data.begin(), input_data.end(),
+            context_input->mutable_data<float>());
+  std::shared_ptr<OperatorRegistryBase> op_registry(new OperatorRegistry());
+  auto net = CreateNet(op_registry, net_def, &context_ws, device);
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS, net->Run());
+
+  const Tensor *context_output = context_ws.GetTensor("Output");
+  ASSERT_NE(output, context_output);
+  for (index_t i = 0; i < output->size(); ++i) {
+    EXPECT_EQ(1.f, input->data<float>()[i]);
+    EXPECT_EQ(7.f, output->data<float>()[i]);
+    EXPECT_EQ(std::max(input_data[i], 0.f), context_output->data<float>()[i]);
+  }
+}
+
+TEST(CoreTest, ParallelNetPlannedMemory) {
+  // Without mem_arena the buffers are planned at load time, and shared as
+  // in BuildBranchedNet, so the workers must keep their order too.
+  NetDef net_def;
+  BuildBranchedNet(&net_def);
+  net_def.clear_mem_arena();
+  for (auto &op_def : *net_def.mutable_op()) {
+    op_def.clear_mem_id();
+    OutputShape *shape = op_def.add_output_shape();
+    for (auto dim : {1, 8, 32, 32}) {
+      shape->add_dims(dim);
+    }
+  }
+  net_def.add_output_info()->set_name("Output");
+  CPUMemoryPlanner planner;
+  ASSERT_TRUE(planner.Plan(net_def, [](const OperatorDef &) {
+    return true;
+  }));
+  EXPECT_LT(planner.planned_size(), planner.naive_size());
+
+  std::vector<float> input_data;
+  std::vector<float> filter_data;
+  GenerateRandomRealTypeData<float>({1, 8, 32, 32}, &input_data);
+  GenerateRandomRealTypeData<float>({8, 8, 3, 3}, &filter_data);
+  std::vector<float> expected;
+  RunBranchedNet(net_def, 1, input_data, filter_data, &expected);
+  for (int num_threads : {2, 4}) {
+    std::vector<float> output;
+    RunBranchedNet(net_def, num_threads, input_data, filter_data, &output);
+    ASSERT_EQ(expected.size(), output.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_NEAR(expected[i], output[i], 1e-5);
+    }
+  }
+}
+
+TEST(CoreTest, ParallelInit) {
+  // Quantized weights of a few sizes, dequantized in chunks
+  NetDef net_def;
+  std::vector<unsigned char> model_data;
+  const std::vector<index_t> sizes = {3, 70000, 200000};
+  for (size_t t = 0; t < sizes.size(); ++t) {
+    ConstTensor *tensor = net_def.add_tensors();
+    tensor->set_name(MakeString("Weight", t));
+    tensor->set_data_type(DT_UINT8);
+    tensor->add_dims(sizes[t]);
+    tensor->set_offset(model_data.size());
+    tensor->set_data_size(sizes[t]);
+    tensor->set_quantized(true);
+    tensor->set_scale(0.5f + t);
+    tensor->set_zero_point(static_cast<int>(t * 10));
+    for (index_t i = 0; i < sizes[t]; ++i) {
+      model_data.push_back(static_cast<unsigned char>((i * 7 + t) % 256));
+    }
+  }
+  // A chain of operators, which must run in model order
+  const int kNumOps = 64;
+  for (int i = 0; i < kNumOps; ++i) {
+    AddOpDef("Activation", {i == 0 ? "Input" : MakeString("A", i - 1)},
+                 i == kNumOps - 1 ? "Output" : MakeString("A", i),
+                 {1, 2, 2, 3}, &net_def);
+    Argument *activation = net_def.mutable_op(i)->add_arg();
+    activation->set_name("activation");
+    activation->set_s("RELUX");
+    Argument *max_limit = net_def.mutable_op(i)->add_arg();
+    max_limit->set_name("max_limit");
+    max_limit->set_f(6.f - i * 0.05f);
+  }
+  net_def.add_output_info()->set_name("Output");
+
+  Device *device = OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  Workspace ws;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            ws.LoadModelTensor(net_def, device, model_data.data()));
+  for (auto &const_tensor : net_def.tensors()) {
+    const Tensor *weight = ws.GetTensor(const_tensor.name());
+    ASSERT_EQ(DT_FLOAT, weight->dtype());
+    ASSERT_EQ(const_tensor.data_size(), weight->size());
+    const unsigned char *quantized = model_data.data() + const_tensor.offset();
+    for (index_t i = 0; i < weight->size(); ++i) {
+      ASSERT_EQ(const_tensor.scale()
+                    * (quantized[i] - const_tensor.zero_point()),
+                weight->data<float>()[i]);
+    }
+  }
+
+  const std::vector<float> input_data =
+      {-3, -2, -1, 0, 1, 2, 3, 4, 5, 6, 7, 8};
+  Tensor *input = ws.CreateTensor("Input", device->allocator(), DT_FLOAT);
+  input->Resize({1, 2, 2, 3});
+  std::copy(input_data.begin(), input_data.end(),
+            input->mutable_data<float>());
+  std::shared_ptr<OperatorRegistryBase> op_registry(new OperatorRegistry());
+  auto net = CreateNet(op_registry, net_def, &ws, device);
+  RunMetadata run_metadata;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS, net->Run(&run_metadata));
+  ASSERT_EQ(static_cast<size_t>(kNumOps), run_metadata.op_stats.size());
+  for (int i = 0; i < kNumOps; ++i) {
+    EXPECT_EQ(net_def.op(i).name(), run_metadata.op_stats[i].operator_name);
+  }
+  const float min_limit = 6.f - (kNumOps - 1) * 0.05f;
+  const Tensor *output = ws.GetTensor("Output");
+  for (size_t i = 0; i < input_data.size(); ++i) {
+    EXPECT_NEAR(std::min(std::max(input_data[i], 0.f), min_limit),
+                output->data<float>()[i], 1e-5);
+  }
+}
+
+namespace {
+// As the registry generated for a model of CPU float activations
+class SelectiveOperatorRegistry : public OperatorRegistryBase {
+ public:
+  SelectiveOperatorRegistry() {
+    registry()->Select({
+        OpKeyBuilder("Activation")
+            .Device(DeviceType::CPU)
+            .TypeConstraint("T", DT_FLOAT)
+            .Build(),
+    });
+    Register_Activation(this);
+    Register_Conv2D(this);
+  }
+};
+}  // namespace
+
+TEST(CoreTest, SelectiveRegistration) {
+  SelectiveOperatorRegistry op_registry;
+  EXPECT_TRUE(op_registry.registry()->Has(
+      OpKeyBuilder("Activation")
+          .Device(DeviceType::CPU)
+          .TypeConstraint("T", DT_FLOAT)
+          .Build()));
+  EXPECT_FALSE(op_registry.registry()->Has(
+      OpKeyBuilder("Activation")
+          .Device(DeviceType::GPU)
+          .TypeConstraint("T", DT_HALF)
+          .Build()));
+  EXPECT_FALSE(op_registry.registry()->Has(
+      OpKeyBuilder("Conv2D")
+          .Device(DeviceType::CPU)
+          .TypeConstraint("T", DT_FLOAT)
+          .Build()));
+
+  NetDef net_def;
+  AddOpDef("Activation", {"Input"}, "Output", {1, 2, 2, 3}, &net_def);
+  Argument *activation = net_def.mutable_op(0)->add_arg();
+  activation->set_name("activation");
+  activation->set_s("RELU");
+  Device *device = OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  Workspace ws;
+  ws.CreateTensor("Input", device->allocator(), DT_FLOAT);
+  OpKernelContext context(&ws, device);
+  EXPECT_NE(nullptr, op_registry.CreateOperator(net_def.op(0), &context,
+                                                DeviceType::CPU,
+                                                NetMode::NORMAL));
+}
+
+TEST(CoreTest, OperatorSharesDef) {
+  std::shared_ptr<NetDef> net_def(new NetDef());
+  AddOpDef("Activation", {"Input"}, "Output", {1, 2, 2, 3},
+               net_def.get());
+  Device *device = OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  Workspace ws;
+  ws.CreateTensor("Input", device->allocator(), DT_FLOAT);
+  OperatorRegistry op_registry;
+
+  // Operators of a net refer to its OperatorDefs, others copy theirs
+  OpKernelContext net_context(&ws, device, net_def);
+  std::unique_ptr<OperatorBase> op = op_registry.CreateOperator(
+      net_def->op(0), &net_context, DeviceType::CPU, NetMode::NORMAL);
+  ASSERT_NE(nullptr, op);
+  EXPECT_EQ(&net_def->op(0), &op->debug_def());
+  OpKernelContext context(&ws, device);
+  op = op_registry.CreateOperator(net_def->op(0), &context, DeviceType::CPU,
+                                  NetMode::NORMAL);
+  ASSERT_NE(nullptr, op);
+  EXPECT_NE(&net_def->op(0), &op->debug_def());
+  EXPECT_EQ("Output", op->debug_def().output(0));
+}
+
+TEST(CoreTest, RunStep) {
+  NetDef net_def;
+  std::vector<float> model_data;
+  BuildResidualNet(&net_def, &model_data);
+  Workspace ws;
+  std::vector<float> expected;
+  RunResidualNet(net_def, model_data, &ws, &expected);
+  Tensor *output = ws.GetTensor("Output");
+  std::fill(output->mutable_data<float>(),
+            output->mutable_data<float>() + output->size(), 0.f);
+
+  Device *device = OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  std::shared_ptr<OperatorRegistryBase> op_registry(new OperatorRegistry());
+  auto net = CreateNet(op_registry, net_def, &ws, device);
+  // Without budget, a step runs one operator
+  size_t next_op = 0;
+  bool done = false;
+  for (int step = 0; step < net_def.op_size(); ++step) {
+    ASSERT_FALSE(done);
+    ASSERT_EQ(MaceStatus::MACE_SUCCESS, net->RunStep(&next_op, 0, &done));
+    EXPECT_EQ(static_cast<size_t>(step + 1), next_op);
+  }
+  EXPECT_TRUE(done);
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected[i], output->data<float>()[i], 1e-5);
+  }
+
+  next_op = 0;
+  ASSERT_EQ(MaceStatus::MACE_SUCCESS,
+            net->RunStep(&next_op, 1000 * 1000 * 1000, &done));
+  EXPECT_TRUE(done);
+  EXPECT_EQ(static_cast<size_t>(net_def.op_size()), next_op);
+}
+
 }  // namespace test
 }  // namespace ops
 }  // namespace mace
@@ -0,0 +1,108 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mace/core/flat_graph.h"
+#include "mace/core/net.h"
+#include "mace/core/testing/test_benchmark.h"
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+namespace {
+// A chain of activations, with the args and shapes the converter records
+void BuildChainNet(int num_ops, NetDef *net_def) {
+  for (int i = 0; i < num_ops; ++i) {
+    OperatorDef *op = net_def->add_op();
+    op->set_name(MakeString("activation_", i));
+    op->set_type("Activation");
+    op->add_input(i == 0 ? "Input" : MakeString("activation_", i - 1));
+    op->add_output(MakeString("activation_", i));
+    Argument *activation = op->add_arg();
+    activation->set_name("activation");
+    activation->set_s("RELUX");
+    Argument *max_limit = op->add_arg();
+    max_limit->set_name("max_limit");
+    max_limit->set_f(6.f);
+    Argument *data_format = op->add_arg();
+    data_format->set_name("data_format");
+    data_format->set_i(NHWC);
+    OutputShape *shape = op->add_output_shape();
+    for (int64_t dim : {1, 56, 56, 32}) {
+      shape->add_dims(dim);
+    }
+    op->add_output_type(DT_FLOAT);
+  }
+  net_def->add_output_info()->set_name(
+      MakeString("activation_", num_ops - 1));
+}
+
+// Loads the graph bytes and creates the operators, as the engine does
+void GraphLoadBenchmark(int iters, int num_ops, bool flat) {
+  mace::testing::StopTiming();
+
+  NetDef net_def;
+  BuildChainNet(num_ops, &net_def);
+  std::vector<unsigned char> data;
+  if (flat) {
+    MACE_CHECK(SerializeFlatGraph(net_def, &data) == MACE_SUCCESS);
+  } else {
+    const std::string pb = net_def.SerializeAsString();
+    data.assign(pb.begin(), pb.end());
+  }
+  Device *device = OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  std::shared_ptr<OperatorRegistryBase> op_registry(new OperatorRegistry());
+
+  mace::testing::StartTiming();
+  while (iters--) {
+    Workspace ws;
+    ws.CreateTensor("Input", device->allocator(), DT_FLOAT);
+    std::unique_ptr<NetBase> net;
+    if (flat) {
+      // The engine runs the net it loaded on the arena
+      FlatGraph graph;
+      std::shared_ptr<NetDef> loaded_net_def;
+      MACE_CHECK(graph.Open(data.data(), data.size()) == MACE_SUCCESS);
+      MACE_CHECK(graph.CreateNetDef(&loaded_net_def) == MACE_SUCCESS);
+      net = CreateNet(op_registry, loaded_net_def, &ws, device);
+    } else {
+      // The engine copies the net the application parsed
+      NetDef loaded_net_def;
+      MACE_CHECK(loaded_net_def.ParseFromArray(data.data(), data.size()));
+      net = CreateNet(op_registry, loaded_net_def, &ws, device);
+    }
+    MACE_CHECK(net != nullptr);
+  }
+}
+}  // namespace
+
+#define MACE_BM_GRAPH_LOAD(N, FORMAT, FLAT)                     \
+  static void MACE_BM_GRAPH_LOAD_##N##_##FORMAT(int iters) {    \
+    GraphLoadBenchmark(iters, N, FLAT);                         \
+  }                                                             \
+  MACE_BENCHMARK(MACE_BM_GRAPH_LOAD_##N##_##FORMAT)
+
+MACE_BM_GRAPH_LOAD(100, PB, false);
+MACE_BM_GRAPH_LOAD(100, FLAT, true);
+MACE_BM_GRAPH_LOAD(2000, PB, false);
+MACE_BM_GRAPH_LOAD(2000, FLAT, true);
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
@@ -27,7 +27,13 @@ template <DeviceType D, typename T>
 class InferConv2dShapeOp : public Operator<D, T> {
  public:
   InferConv2dShapeOp(const OperatorDef &op_def, OpKernelContext *context)
-      : Operator<D, T>(op_def, context) {}
+      : Operator<D, T>(op_def, context),
+        data_format_(OperatorBase::GetOptionalArg<int>("data_format", 0)),
+        padding_type_(static_cast<Padding>(OperatorBase::GetOptionalArg<int>(
+            "padding", static_cast<int>(SAME)))),
+        paddings_(OperatorBase::GetRepeatedArgs<int32_t>("padding_values")),
+        kernels_(OperatorBase::GetRepeatedArgs<int32_t>("kernels")),
+        strides_(OperatorBase::GetRepeatedArgs<int32_t>("strides", {1, 1})) {}
 
   MaceStatus Run(StatsFuture *future) override {
     const Tensor *input = this->Input(INPUT);
@@ -37,21 +43,10 @@ class InferConv2dShapeOp : public Operator<D, T> {
     Tensor::MappingGuard output_guard(output);
     int32_t *output_data = output->mutable_data<int32_t>();
 
-    const int32_t data_format =
-        OperatorBase::GetOptionalArg<int>("data_format", 0);
-    const bool isNCHW = data_format == 1;
-
-    Padding padding_type =
-        static_cast<Padding>(OperatorBase::GetOptionalArg<int>(
-            "padding", static_cast<int>(SAME)));
-    const std::vector<int32_t> paddings =
-        OperatorBase::GetRepeatedArgs<int32_t>("padding_values");
-    const std::vector<int32_t> kernels =
-        OperatorBase::GetRepeatedArgs<int32_t>("kernels");
-    const std::vector<int32_t> strides =
-        OperatorBase::GetRepeatedArgs<int32_t>("strides", {1, 1});
+    const bool isNCHW = data_format_ == 1;
+
     const int32_t out_batch = static_cast<int32_t>(input->dim(0));
-    const int32_t out_channel = static_cast<int32_t>(kernels[0]);
+    const int32_t out_channel = static_cast<int32_t>(kernels_[0]);
 
     int32_t in_h = 0, in_w = 0, in_c = 0;
     if (isNCHW) {  // NCHW
@@ -63,21 +58,21 @@ class InferConv2dShapeOp : public Operator<D, T> {
       in_w = static_cast<int32_t>(input->dim(2));
       in_c = static_cast<int32_t>(input->dim(3));
     }
-    MACE_CHECK(in_c == kernels[1],
+    MACE_CHECK(in_c == kernels_[1],
                "different number of input channels between input and kernel");
     int32_t out_h = 0, out_w = 0;
-    if (!paddings.empty()) {
-      out_h = (in_h - kernels[2] + paddings[0]) / strides[0] + 1;
-      out_w = (in_w - kernels[3]  + paddings[1]) / strides[1] + 1;
+    if (!paddings_.empty()) {
+      out_h = (in_h - kernels_[2] + paddings_[0]) / strides_[0] + 1;
+      out_w = (in_w - kernels_[3]  + paddings_[1]) / strides_[1] + 1;
     } else {
-      switch (padding_type) {
+      switch (padding_type_) {
         case SAME:
-          out_h = (in_h + strides[0] - 1) / strides[0];
-          out_w = (in_w + strides[1] - 1) / strides[1];
+          out_h = (in_h + strides_[0] - 1) / strides_[0];
+          out_w = (in_w + strides_[1] - 1) / strides_[1];
           break;
         case VALID:
-          out_h = (in_h - kernels[2] + 1) / strides[0];
-          out_w = (in_w - kernels[3] + 1) / strides[1];
+          out_h = (in_h - kernels_[2] + 1) / strides_[0];
+          out_w = (in_w - kernels_[3] + 1) / strides_[1];
           break;
         default:
           MACE_NOT_IMPLEMENTED;
@@ -102,6 +97,13 @@ class InferConv2dShapeOp : public Operator<D, T> {
     return MACE_SUCCESS;
   }
 
+ private:
+  const int32_t data_format_;
+  const Padding padding_type_;
+  const std::vector<int32_t> paddings_;
+  const std::vector<int32_t> kernels_;
+  const std::vector<int32_t> strides_;
+
  private:
   MACE_OP_INPUT_TAGS(INPUT);
   MACE_OP_OUTPUT_TAGS(OUTPUT);
@@ -0,0 +1,100 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "mace/core/net.h"
+#include "mace/core/testing/test_benchmark.h"
+#include "mace/kernels/conv_pool_2d_util.h"
+#include "mace/kernels/pooling.h"
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+namespace {
+// A chain of ops on a single element, so running the net is mostly the
+// per-op dispatch: the loop of the net, the op's Run and, with metadata,
+// the op stats. Identity does no work, Pooling has window args.
+void BuildTinyOpNet(const std::string &type, int num_ops, NetDef *net_def) {
+  for (int i = 0; i < num_ops; ++i) {
+    OperatorDef *op = net_def->add_op();
+    op->set_name(MakeString("op_", i));
+    op->set_type(type);
+    op->add_input(i == 0 ? "Input" : MakeString("op_", i - 1));
+    op->add_output(MakeString("op_", i));
+    if (type == "Pooling") {
+      Argument *pooling_type = op->add_arg();
+      pooling_type->set_name("pooling_type");
+      pooling_type->set_i(PoolingType::MAX);
+      for (const char *name : {"kernels", "strides", "dilations"}) {
+        Argument *arg = op->add_arg();
+        arg->set_name(name);
+        arg->add_ints(1);
+        arg->add_ints(1);
+      }
+      Argument *padding = op->add_arg();
+      padding->set_name("padding");
+      padding->set_i(Padding::VALID);
+    }
+    OutputShape *shape = op->add_output_shape();
+    for (int64_t dim : {1, 1, 1, 1}) {
+      shape->add_dims(dim);
+    }
+    op->add_output_type(DT_FLOAT);
+  }
+  net_def->add_output_info()->set_name(MakeString("op_", num_ops - 1));
+}
+
+void OpDispatchBenchmark(int iters, const std::string &type, int num_ops,
+                         bool metadata) {
+  mace::testing::StopTiming();
+
+  NetDef net_def;
+  BuildTinyOpNet(type, num_ops, &net_def);
+  Device *device = OpTestContext::Get()->GetDevice(DeviceType::CPU);
+  std::shared_ptr<OperatorRegistryBase> op_registry(new OperatorRegistry());
+  Workspace ws;
+  Tensor *input = ws.CreateTensor("Input", device->allocator(), DT_FLOAT);
+  input->Resize({1, 1, 1, 1});
+  auto net = CreateNet(op_registry, net_def, &ws, device);
+  MACE_CHECK(net != nullptr);
+  // Warm-up
+  MACE_CHECK(net->Run() == MACE_SUCCESS);
+
+  mace::testing::StartTiming();
+  while (iters--) {
+    RunMetadata run_metadata;
+    MACE_CHECK(net->Run(metadata ? &run_metadata : nullptr) == MACE_SUCCESS);
+  }
+}
+}  // namespace
+
+// The time per iteration divided by N is the dispatch overhead of an op
+#define MACE_BM_OP_DISPATCH(TYPE, N, METADATA, WITH_METADATA)           \
+  static void MACE_BM_OP_DISPATCH_##TYPE##_##N##_##METADATA(int iters) { \
+    OpDispatchBenchmark(iters, #TYPE, N, WITH_METADATA);                \
+  }                                                                     \
+  MACE_BENCHMARK(MACE_BM_OP_DISPATCH_##TYPE##_##N##_##METADATA)
+
+MACE_BM_OP_DISPATCH(Identity, 1000, NO_METADATA, false);
+MACE_BM_OP_DISPATCH(Identity, 1000, METADATA, true);
+MACE_BM_OP_DISPATCH(Pooling, 1000, NO_METADATA, false);
+MACE_BM_OP_DISPATCH(Pooling, 1000, METADATA, true);
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
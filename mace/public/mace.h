@@ -18,7 +18,11 @@
 #ifndef MACE_PUBLIC_MACE_H_
 #define MACE_PUBLIC_MACE_H_
 
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
 #include <cstdint>
+#include <functional>
+#include <future>  // NOLINT(build/c++11)
 #include <map>
 #include <memory>
 #include <string>
@@ -59,6 +63,13 @@ struct CallStats {
   int64_t end_micros;
 };
 
+// Page faults of the process while an operator ran; with inter-op threads
+// they include the faults of the operators running at the same time.
+struct PageFaults {
+  int64_t minor;
+  int64_t major;
+};
+
 struct ConvPoolArgs {
   std::vector<int> strides;
   int padding_type;
@@ -73,6 +84,7 @@ struct OperatorStats {
   std::vector<std::vector<int64_t>> output_shape;
   ConvPoolArgs args;
   CallStats stats;
+  PageFaults page_faults;
 };
 
 class RunMetadata {
@@ -80,12 +92,38 @@ class RunMetadata {
   std::vector<OperatorStats> op_stats;
 };
 
+// Time spent in the phases of MaceEngine::Init, in microseconds
+struct InitStats {
+  int64_t optimize_graph_micros;
+  int64_t load_tensors_micros;
+  int64_t init_net_micros;
+  int64_t create_operators_micros;
+  int64_t total_micros;
+};
+
+// Work of a stage of a pipelined engine, see
+// MaceEngineConfig::SetPipelineStages
+struct PipelineStageStats {
+  int num_ops;
+  // Running the operators and handing the frames over, in microseconds
+  int64_t busy_micros;
+};
+
+struct PipelineStats {
+  // Completed frames
+  int64_t frames;
+  // Since the first frame was submitted
+  int64_t elapsed_micros;
+  std::vector<PipelineStageStats> stages;
+};
+
 const char *MaceVersion();
 
 enum MaceStatus {
   MACE_SUCCESS = 0,
   MACE_INVALID_ARGS = 1,
-  MACE_OUT_OF_RESOURCES = 2
+  MACE_OUT_OF_RESOURCES = 2,
+  MACE_CANCELLED = 3
 };
 
 #define MACE_RETURN_IF_ERROR(stmt)                                          \
@@ -154,6 +192,36 @@ class MACE_API GPUContextBuilder {
   std::unique_ptr<Impl> impl_;
 };
 
+/// \brief Threads of the application to run the CPU operators on.
+///
+/// By default an engine runs the parallel loops of the operators on a
+/// thread pool of its own. An application with a task scheduler of its
+/// own implements Executor to run them on its threads instead, so that
+/// both don't compete for the cores.
+///
+/// Must be thread-safe: engines sharing the executor, or running
+/// operators concurrently (see SetInterOpThreads), call Run concurrently.
+class MACE_API Executor {
+ public:
+  virtual ~Executor() = default;
+
+  /// \brief The number of threads the chunks run on.
+  ///
+  /// The work of a loop is split in a few chunks per thread.
+  virtual int num_threads() const = 0;
+
+  /// \brief Schedule num_chunks chunks and wait for them.
+  ///
+  /// Calls chunk_fn(i) once for each i in [0, num_chunks), in any order
+  /// and on any threads, including the calling one, and returns once all
+  /// are done. A chunk never waits for other work of the executor.
+  ///
+  /// \param num_chunks the number of chunks, at least 1
+  /// \param chunk_fn the function running a chunk
+  virtual void Run(int num_chunks,
+                   const std::function<void(int)> &chunk_fn) = 0;
+};
+
 class MACE_API MaceEngineConfig {
   friend class MaceEngine;
 
@@ -192,8 +260,10 @@ class MACE_API MaceEngineConfig {
   /// (AFFINITY_NONE) cores according to the policy. The threads number will
   /// also be truncated to the corresponding cores number when num_threads_hint
   /// is larger than it.
-  /// The OpenMP threads will be bind to (via sched_setaffinity) big cores
-  /// (AFFINITY_BIG_ONLY) and little cores (AFFINITY_LITTLE_ONLY).
+  /// The operators run on a thread pool owned by the engine, whose worker
+  /// threads will be bind to (via sched_setaffinity) big cores
+  /// (AFFINITY_BIG_ONLY) and little cores (AFFINITY_LITTLE_ONLY). Engines
+  /// in one process keep their own threads and don't affect each other.
   ///
   /// \param num_threads_hint it is only a hint.
   /// \param policy one of CPUAffinityPolicy
@@ -206,6 +276,160 @@ class MACE_API MaceEngineConfig {
                                 CPUAffinityPolicy policy,
                                 bool use_gemmlowp = false);
 
+  /// \brief Pin the CPU threads of the engine to the given cores.
+  ///
+  /// Overrides the cores chosen by the policy of SetCPUThreadPolicy. The
+  /// worker threads are bind to cpu_ids in turn; the thread calling Run
+  /// is never bind. When num_threads_hint is zero or negative, the threads
+  /// number is the size of cpu_ids, otherwise it is not truncated.
+  ///
+  /// \param cpu_ids the cores, empty for the policy to choose them
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS if a core id is
+  ///         negative.
+  MaceStatus SetCPUCores(const std::vector<int> &cpu_ids);
+
+  /// \brief Run the CPU operators on the threads of the application.
+  ///
+  /// All the parallel loops of the operators, including the quantized
+  /// matrix multiplications, run on the executor instead of the threads
+  /// set by SetCPUThreadPolicy and SetCPUCores. The engine keeps the
+  /// executor alive.
+  ///
+  /// \param executor the executor, nullptr for the engine's own threads
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS if the executor
+  ///         has no threads.
+  MaceStatus SetExecutor(std::shared_ptr<Executor> executor);
+
+  /// \brief Set the number of threads running operators concurrently.
+  ///
+  /// By default operators run one after another in model order. When
+  /// num_threads is larger than 1, independent branches of the graph
+  /// (e.g. Inception blocks) run concurrently on num_threads threads,
+  /// which share the thread pool set by SetCPUThreadPolicy.
+  /// Only takes effect on CPU.
+  ///
+  /// \param num_threads number of inter-operator threads
+  /// \return MACE_SUCCESS for success, other for failed.
+  MaceStatus SetInterOpThreads(int num_threads);
+
+  /// \brief Cache the activation memory of each input shape.
+  ///
+  /// The memory arena of the model is planned offline for one input shape.
+  /// With a capacity larger than 0, the engine keeps a set of memory blocks
+  /// per input shape seen at runtime, for models whose input shape changes
+  /// on every call. The blocks are not sized ahead: a new shape starts with
+  /// empty blocks, which the operators grow to what the shape needs during
+  /// its first run. The blocks of the last `capacity` shapes are kept, so
+  /// a repeated shape runs without allocating memory. Input dimensions are
+  /// rounded up to a multiple of shape_granularity when choosing the
+  /// blocks, so that close shapes share them; a larger shape of the group
+  /// grows them again on its first run. Only takes effect on CPU.
+  ///
+  /// \param capacity number of shapes to keep the blocks of, 0 disables
+  ///        the cache
+  /// \param shape_granularity granularity of the shapes to share blocks
+  /// \return MACE_SUCCESS for success, other for failed.
+  MaceStatus SetMemoryPlanCache(int capacity, int shape_granularity = 1);
+
+  /// \brief Enable or disable a load-time graph optimization pass.
+  ///
+  /// On CPU, the ops of the model can be rewritten when the engine is
+  /// initialized, before planning the memory. The passes, all disabled by
+  /// default, are:
+  ///   FoldStaticShapes, FoldConstants, RemoveIdentity, FoldBatchNorm,
+  ///   FuseBiasAdd, FuseResidualAdd and FuseActivation.
+  /// The enabled ones run in that order. The folding passes evaluate the
+  /// ops computing shapes from constants once, instead of on every run.
+  /// FoldStaticShapes also takes the shapes of the model's tensors as
+  /// constant, so it is only for models whose input shapes never change:
+  /// not for a BatchingEngine, and it is ignored when a memory plan cache
+  /// is set.
+  /// A rewritten net does not use the memory plan of the converter, but
+  /// one made when the engine is initialized. The number of rewrites of
+  /// each pass is logged.
+  ///
+  /// \param pass_name name of the pass
+  /// \param enabled whether the pass runs
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS for unknown pass.
+  MaceStatus SetGraphOptimizerPass(const std::string &pass_name,
+                                   bool enabled);
+
+  /// \brief Page in the weights lazily on CPU, as the layers run.
+  ///
+  /// A model data file is mapped, and its pages are read when the first
+  /// run faults on them. With prefetch_distance larger than 0, the kernel
+  /// no longer reads ahead around the faults; instead the weights of each
+  /// operator are prefetched (MADV_WILLNEED) when the operator
+  /// prefetch_distance before it starts, overlapping reading the file with
+  /// computing. The weights of locked_ops, the hot layers, are locked in
+  /// memory (mlock). Those of released_ops, e.g. rarely used branches, are
+  /// dropped (MADV_DONTNEED) after they run, and read from the file again
+  /// next time. Only takes effect for models loaded from a data file.
+  /// Page faults of each operator are reported in RunMetadata.
+  ///
+  /// \param prefetch_distance number of operators to prefetch ahead, 0
+  ///        leaves paging to the kernel
+  /// \param locked_ops names of the operators whose weights are locked
+  /// \param released_ops names of the operators whose weights are dropped
+  /// \return MACE_SUCCESS for success, other for failed.
+  MaceStatus SetWeightPaging(
+      int prefetch_distance,
+      const std::vector<std::string> &locked_ops = {},
+      const std::vector<std::string> &released_ops = {});
+
+  /// \brief Set the directory of the engine snapshots.
+  ///
+  /// Init on CPU rewrites the graph, folds constants, dequantizes the
+  /// weights and plans the memory on every start. MaceEngine::SaveSnapshot
+  /// writes the result in the directory, one file per model, and a later
+  /// Init of the same model and model data with the same options on the
+  /// same CPU starts from it, skipping that work. The snapshot is found by
+  /// a checksum of the model and, for a model data file, of its path,
+  /// inode, size and modification time, so the weights are not read for
+  /// it; model data in memory are checksummed. The snapshot holds a copy of
+  /// the weights, so they are not paged from the data file (see
+  /// SetWeightPaging). Only takes effect on CPU.
+  ///
+  /// \param path directory which the app can read and write, empty to
+  ///        disable snapshots
+  /// \return MACE_SUCCESS for success, other for failed.
+  MaceStatus SetSnapshotPath(const std::string &path);
+
+  /// \brief Set whether to load identical weights once.
+  ///
+  /// Models with repeated blocks often have const tensors with the same
+  /// bytes. With dedup, Init finds them by content, loads them as one and
+  /// dequantizes them once. Sharing across engines also lets the engines
+  /// of the process loading the same quantized weights, e.g. variants of a
+  /// model, use one dequantized copy, which is freed with the last of them.
+  /// Dedup reads all the weights at Init.
+  ///
+  /// \param enabled whether to dedup the weights of the engine
+  /// \param share_across_engines whether to share them with other engines
+  /// \return MACE_SUCCESS for success, other for failed.
+  MaceStatus SetWeightDedup(bool enabled, bool share_across_engines = false);
+
+  /// \brief Run the asynchronous runs as a pipeline of stages.
+  ///
+  /// By default RunAsync runs one request at a time, on all the threads.
+  /// For streams, e.g. of video frames, splitting the operators in model
+  /// order into stages of about the same cost, each run by threads of its
+  /// own on its own cores, runs several frames at once: while a stage runs
+  /// a frame, the stage before it runs the next one. That raises the frames
+  /// per second when the operators don't scale over all the cores, at the
+  /// cost of the latency of each frame and of a copy of the tensors going
+  /// from one stage to the next. The synchronous Run is not affected. See
+  /// MaceEngine::GetPipelineStats for the balance of the stages. Only
+  /// takes effect on CPU, without a memory plan cache.
+  ///
+  /// \param stage_cpu_ids the cores of each stage, whose threads number is
+  ///        the number of its cores, or one unbound thread if it has none;
+  ///        empty to disable the pipeline
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS if a core id is
+  ///         negative.
+  MaceStatus SetPipelineStages(
+      const std::vector<std::vector<int>> &stage_cpu_ids);
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
@@ -235,6 +459,68 @@ class MACE_API MaceTensor {
   std::unique_ptr<Impl> impl_;
 };
 
+/// \brief Cancels the runs it is passed to, see RunOptions.
+///
+/// Cancel may be called from any thread. A cancelled token stays
+/// cancelled: use a new one for the next runs.
+class MACE_API CancellationToken {
+ public:
+  CancellationToken();
+
+  void Cancel();
+
+  bool IsCancelled() const;
+
+ private:
+  std::atomic<bool> cancelled_;
+
+  CancellationToken(const CancellationToken &) = delete;
+  CancellationToken &operator=(const CancellationToken &) = delete;
+};
+
+enum RunPriority {
+  RUN_PRIORITY_LOW = 0,
+  RUN_PRIORITY_NORMAL = 1,
+  RUN_PRIORITY_HIGH = 2
+};
+
+/// \brief Options of a run, see MaceEngine::Run.
+///
+/// The run checks the token and the deadline between the operators and
+/// inside long kernels (e.g. between the blocks of a matrix multiply), and
+/// returns MACE_CANCELLED, with undefined outputs, once either is hit.
+///
+/// Between its operators, a run also waits while runs of a higher
+/// priority are in progress on the same CPU threads, i.e. on engines
+/// sharing an Executor (see MaceEngineConfig::SetExecutor), so that they
+/// get all of them.
+struct RunOptions {
+  /// Not owned, must outlive the run; null for none
+  const CancellationToken *cancellation_token = nullptr;
+  /// None by default
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::time_point::max();
+  /// A value out of the enum fails the run with MACE_INVALID_ARGS
+  RunPriority priority = RUN_PRIORITY_NORMAL;
+};
+
+/// \brief Execution state of one MaceEngine: activation tensors, scratch
+/// buffer and the operators bound to them.
+///
+/// Weights and the graph are shared with the engine, so a context costs
+/// about the activation memory of the model. Runs with different contexts
+/// may be issued concurrently; a context must not be used by two Runs at
+/// the same time, nor outlive the engine which created it.
+class ExecutionContext;
+
+/// \brief A run of one MaceEngine executed in steps, see
+/// MaceEngine::RunStep.
+///
+/// Holds the outputs to write and the next operator to run; the
+/// intermediate tensors stay in the workspace of the engine between the
+/// steps. Must not outlive the engine which started it.
+class RunHandle;
+
 class MACE_API MaceEngine {
  public:
   explicit MaceEngine(const MaceEngineConfig &config);
@@ -257,7 +543,201 @@ class MACE_API MaceEngine {
                  std::map<std::string, MaceTensor> *outputs,
                  RunMetadata *run_metadata);
 
+  /// \brief Run the model with a cancellation token, a deadline or a
+  /// priority.
+  ///
+  /// \param options[in]: see RunOptions
+  /// \return MACE_SUCCESS for success, MACE_CANCELLED if the token is
+  ///         cancelled or the deadline passed before the run completed,
+  ///         other for failed.
+  MaceStatus Run(const std::map<std::string, MaceTensor> &inputs,
+                 std::map<std::string, MaceTensor> *outputs,
+                 const RunOptions &options);
+
+  /// \brief Run the model asynchronously
+  ///
+  /// The request is queued and this call returns at once, unless too many
+  /// requests are already waiting. An engine-owned worker stages the inputs
+  /// of the next request while the current one computes, on two execution
+  /// contexts (see CreateContext). Requests complete in submission order.
+  /// The inputs and outputs maps are copied, their data must stay valid
+  /// until the request completes. Only supported on CPU and GPU.
+  /// With pipeline stages (see MaceEngineConfig::SetPipelineStages), the
+  /// inputs are copied into the pipeline by this call, which waits for the
+  /// first stage to have room for them.
+  ///
+  /// \param inputs[in]: the inputs of the model
+  /// \param outputs[in]: the buffers the outputs are written to
+  /// \param callback[in]: called with the status on completion, may be null
+  /// \param future[out]: the status of the run, may be null
+  /// \return MACE_SUCCESS if the request is queued, other for failed.
+  MaceStatus RunAsync(const std::map<std::string, MaceTensor> &inputs,
+                      std::map<std::string, MaceTensor> *outputs,
+                      std::function<void(MaceStatus)> callback,
+                      std::future<MaceStatus> *future);
+
+  /// \brief Get the handle of an input node, to be resolved once after Init
+  ///
+  /// \param name[in]: name of the input node passed to Init
+  /// \param handle[out]: the handle used by BindInput and GetInputBuffer
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS for unknown name.
+  MaceStatus GetInputHandle(const std::string &name, int *handle) const;
+
+  /// \brief Get the handle of an output node, to be resolved once after Init
+  MaceStatus GetOutputHandle(const std::string &name, int *handle) const;
+
+  /// \brief Use the buffer of tensor as the input, without copying it.
+  ///
+  /// The binding stays until the input is bound again, GetInputBuffer is
+  /// called for it or the map based Run is called, which drops all the
+  /// bindings. The engine holds a reference to the data while bound. It
+  /// should be allocated with 64 extra bytes, which NEON kernels may read.
+  /// Only supported on CPU.
+  ///
+  /// \param handle[in]: handle got from GetInputHandle
+  /// \param tensor[in]: the input shape and data
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS for bad handle,
+  ///         null data or a non-CPU engine.
+  MaceStatus BindInput(const int handle, const MaceTensor &tensor);
+
+  /// \brief Let the model write the output into the buffer of tensor.
+  ///
+  /// Same as BindInput. The model output must have the shape of tensor,
+  /// else RunWithBindings fails.
+  MaceStatus BindOutput(const int handle, const MaceTensor &tensor);
+
+  /// \brief Get the buffer of the input inside the engine to write it
+  /// directly, instead of binding a user buffer. Only supported on CPU.
+  ///
+  /// \param handle[in]: handle got from GetInputHandle
+  /// \param shape[in]: the input shape
+  /// \param data[out]: the buffer, valid until the next call for the input
+  MaceStatus GetInputBuffer(const int handle,
+                            const std::vector<int64_t> &shape,
+                            float **data);
+
+  /// \brief Get the buffer of the output inside the engine after
+  /// RunWithBindings. Only supported on CPU.
+  ///
+  /// \param handle[in]: handle got from GetOutputHandle
+  /// \param shape[out]: the output shape
+  /// \param data[out]: the buffer, valid until the next run
+  MaceStatus GetOutputBuffer(const int handle,
+                             std::vector<int64_t> *shape,
+                             const float **data);
+
+  /// \brief Run the model on the bound or directly written inputs.
+  ///
+  /// There is no copy nor name lookup on this path: inputs come from
+  /// BindInput or GetInputBuffer, outputs go to the buffers bound by
+  /// BindOutput or are read by GetOutputBuffer. Only supported on CPU.
+  ///
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS if an output
+  ///         does not have the shape of its bound buffer, other for failed.
+  MaceStatus RunWithBindings();
+
+  MaceStatus RunWithBindings(RunMetadata *run_metadata);
+
+  /// \brief Create an execution context to run the model concurrently
+  ///
+  /// Must be called after Init, only supported on CPU and GPU.
+  ///
+  /// \param context[out]: the created ExecutionContext
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS if the engine is
+  ///         not initialized or runs on HEXAGON.
+  MaceStatus CreateContext(std::shared_ptr<ExecutionContext> *context);
+
+  MaceStatus Run(ExecutionContext *context,
+                 const std::map<std::string, MaceTensor> &inputs,
+                 std::map<std::string, MaceTensor> *outputs);
+
+  MaceStatus Run(ExecutionContext *context,
+                 const std::map<std::string, MaceTensor> &inputs,
+                 std::map<std::string, MaceTensor> *outputs,
+                 RunMetadata *run_metadata);
+
+  MaceStatus Run(ExecutionContext *context,
+                 const std::map<std::string, MaceTensor> &inputs,
+                 std::map<std::string, MaceTensor> *outputs,
+                 const RunOptions &options);
+
+  /// \brief Start a run to execute in steps of a time budget each.
+  ///
+  /// Copies the inputs in; no operator runs until RunStep. The outputs
+  /// map is copied, its data must stay valid until the run is done. The
+  /// run uses the workspace of the engine: a Run, RunWithBindings or
+  /// StartRun in between discards it, while runs with execution contexts
+  /// do not. Only supported on CPU.
+  ///
+  /// \param inputs[in]: the inputs of the model
+  /// \param outputs[in]: the buffers the outputs are written to
+  /// \param handle[out]: the run, to pass to RunStep
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS if the engine is
+  ///         not initialized on CPU.
+  MaceStatus StartRun(const std::map<std::string, MaceTensor> &inputs,
+                      std::map<std::string, MaceTensor> *outputs,
+                      std::shared_ptr<RunHandle> *handle);
+
+  /// \brief Run the next operators of a started run for budget_micros.
+  ///
+  /// Runs operators in model order until the budget is spent, then
+  /// returns, and the next call resumes with the following operator: no
+  /// work is repeated. At least one operator runs per call and an operator
+  /// is never split, so a step overruns the budget by up to the time of
+  /// its last operator. The step running the last operator also writes the
+  /// outputs.
+  ///
+  /// \param handle[in]: the run started by StartRun
+  /// \param budget_micros[in]: the time to spend in this step
+  /// \param done[out]: whether the run completed, its outputs written
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS if the run was
+  ///         discarded (see StartRun) or already failed, other for a
+  ///         failed operator.
+  MaceStatus RunStep(RunHandle *handle, int64_t budget_micros, bool *done);
+
+  /// \brief Save the state after Init for the next Init to start from.
+  ///
+  /// See MaceEngineConfig::SetSnapshotPath. Does nothing if the engine
+  /// started from a snapshot.
+  ///
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS if the engine is
+  ///         not initialized on CPU with a snapshot path, or the snapshot
+  ///         can't be written.
+  MaceStatus SaveSnapshot();
+
+  /// \brief Get the time spent in each phase of the last Init.
+  ///
+  /// load_tensors includes dequantizing the weights, init_net running the
+  /// INIT mode operators (e.g. weight transforms on GPU). On CPU, both the
+  /// dequantization and constructing the operators are spread over the
+  /// threads set by SetCPUThreadPolicy; the result doesn't depend
+  /// on the number of threads. The phases are also logged.
+  ///
+  /// \param stats[out]: the phase timings
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS if the engine is
+  ///         not initialized.
+  MaceStatus GetInitStats(InitStats *stats) const;
+
+  /// \brief Get the work of the pipeline stages since the first RunAsync.
+  ///
+  /// The busy time of a stage over the elapsed time is its utilization;
+  /// the most utilized stage bounds the frames per second.
+  ///
+  /// \param stats[out]: the frames completed and the work of each stage
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS if the engine has
+  ///         no pipeline running, i.e. before the first RunAsync.
+  MaceStatus GetPipelineStats(PipelineStats *stats) const;
+
  private:
+  // Hands the net it loads over to the engine, instead of Init copying it
+  friend MaceStatus CreateMaceEngineFromFlatGraph(
+      const std::string &graph_file,
+      const std::string &model_data_file,
+      const std::vector<std::string> &input_nodes,
+      const std::vector<std::string> &output_nodes,
+      const MaceEngineConfig &config,
+      std::shared_ptr<MaceEngine> *engine);
+
   class Impl;
   std::unique_ptr<Impl> impl_;
 
@@ -265,6 +745,42 @@ class MACE_API MaceEngine {
   MaceEngine &operator=(const MaceEngine &) = delete;
 };
 
+/// \brief Batches concurrent Runs of batch-1 (or small batch) requests.
+///
+/// Run calls from different threads are collected until max_batch_size
+/// items are queued or the oldest one has waited max_wait_micros. Their
+/// inputs are stacked along dimension 0, the model runs once at the larger
+/// batch and the outputs are scattered back to each caller.
+/// Requests are batched together only if their tensors have the same shape
+/// except dimension 0, so the model must accept a variable batch size.
+/// The engine must not be run by others while the BatchingEngine is alive.
+class MACE_API BatchingEngine {
+ public:
+  /// \param engine[in]: the initialized engine to run the batches
+  /// \param max_batch_size[in]: maximum number of items in a batch
+  /// \param max_wait_micros[in]: maximum time a request waits for others
+  BatchingEngine(std::shared_ptr<MaceEngine> engine,
+                 const int max_batch_size,
+                 const int64_t max_wait_micros);
+  ~BatchingEngine();
+
+  /// \brief Run one request, blocks until its outputs are filled.
+  ///
+  /// Thread-safe. All inputs and outputs must have the same dimension 0.
+  ///
+  /// \return MACE_SUCCESS for success, MACE_INVALID_ARGS for inconsistent
+  ///         shapes, or the status of running the batch.
+  MaceStatus Run(const std::map<std::string, MaceTensor> &inputs,
+                 std::map<std::string, MaceTensor> *outputs);
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+
+  BatchingEngine(const BatchingEngine &) = delete;
+  BatchingEngine &operator=(const BatchingEngine &) = delete;
+};
+
 /// \brief Create MaceEngine from files (model file + data file)
 ///
 /// Create MaceEngine object
@@ -285,6 +801,28 @@ MACE_API MaceStatus CreateMaceEngineFromProto(
     const MaceEngineConfig &config,
     std::shared_ptr<MaceEngine> *engine);
 
+/// \brief Create MaceEngine from a flat graph file and a data file
+///
+/// The flat graph is converted from the model pb by convert_flat_graph. It
+/// is mapped and read in place, skipping the protobuf parsing.
+///
+/// \param graph_file[in]: the path of flat graph file
+/// \param model_data_file[in]: the path of model data file
+/// \param input_nodes[in]: the array of input nodes' name
+/// \param output_nodes[in]: the array of output nodes' name
+/// \param config[in]: configurations for MaceEngine.
+/// \param engine[out]: output MaceEngine object
+/// \return MACE_SUCCESS for success, MACE_INVALID_ARGS for wrong arguments
+///         or a corrupted or incompatible graph file,
+///         MACE_OUT_OF_RESOURCES for resources is out of range.
+MACE_API MaceStatus CreateMaceEngineFromFlatGraph(
+    const std::string &graph_file,
+    const std::string &model_data_file,
+    const std::vector<std::string> &input_nodes,
+    const std::vector<std::string> &output_nodes,
+    const MaceEngineConfig &config,
+    std::shared_ptr<MaceEngine> *engine);
+
 }  // namespace mace
 
 #endif  // MACE_PUBLIC_MACE_H_
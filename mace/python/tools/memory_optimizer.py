@@ -61,6 +61,8 @@ class MemoryOptimizer(object):
         self.total_mem_count = 0
         self.input_ref_counter = {}
         self.mem_ref_counter = {}
+        self.tensor_info = {}  # tensor_name->(element count, data type)
+        self.output_names = set([info.name for info in net_def.output_info])
         ocl_mem_type_arg = ConverterUtil.get_arg(
             net_def, MaceKeyword.mace_opencl_mem_type)
         self.cl_mem_type = ocl_mem_type_arg.i if ocl_mem_type_arg is not None \
@@ -139,6 +141,27 @@ class MemoryOptimizer(object):
         return op.type == 'Reshape' or op.type == 'Identity' \
                or op.type == 'Squeeze' or op.type == 'ExpandDims'
 
+    @staticmethod
+    def is_in_place_op(op):
+        return op.type in ['Activation', 'BiasAdd', 'BatchNorm',
+                           'FoldedBatchNorm', 'Eltwise', 'ScalarMath']
+
+    def get_in_place_mem_id(self, op, output_info):
+        # write the output over input 0 if they have the same shape and
+        # every tensor in its memory dies at this op
+        ipt = op.input[0]
+        if ipt not in self.op_mem or ipt in self.output_names \
+                or self.tensor_info.get(ipt) != output_info:
+            return -1
+        mem_id = self.op_mem[ipt]
+        dying_tensors = set([t for t in op.input
+                             if self.op_mem.get(t) == mem_id and
+                             self.input_ref_counter.get(t) ==
+                             list(op.input).count(t)])
+        if len(dying_tensors) != self.mem_ref_counter[mem_id]:
+            return -1
+        return mem_id
+
     def optimize(self):
         for op in self.net_def.op:
             if not self.op_need_optimize_memory(op):
@@ -157,6 +180,9 @@ class MemoryOptimizer(object):
                 if self.is_memory_reuse_op(op):
                     # make these ops reuse memory of input tensor
                     mem_id = self.op_mem.get(op.input[0], -1)
+                    if op.input[0] in self.tensor_info:
+                        self.tensor_info[op.output[i]] = \
+                            self.tensor_info[op.input[0]]
                 else:
                     output_type = mace_pb2.DT_FLOAT
                     for arg in op.arg:
@@ -168,8 +194,14 @@ class MemoryOptimizer(object):
                         op.type,
                         op.output_shape[i].dims,
                         output_type)
+                    output_info = (
+                        reduce(operator.mul, op.output_shape[i].dims, 1),
+                        output_type)
+                    self.tensor_info[op.output[i]] = output_info
                     mem_id = -1
-                    if len(self.idle_mem) > 0:
+                    if i == 0 and self.is_in_place_op(op):
+                        mem_id = self.get_in_place_mem_id(op, output_info)
+                    if mem_id == -1 and len(self.idle_mem) > 0:
                         best_mem_add_size = sys.maxint
                         best_mem_waste_size = sys.maxint
                         for mid in self.idle_mem:
@@ -236,6 +268,11 @@ class MemoryOptimizer(object):
 
 
 class GPUMemoryOptimizer(MemoryOptimizer):
+    @staticmethod
+    def is_in_place_op(op):
+        # only the CPU kernels are known to work in place
+        return False
+
     def op_need_optimize_memory(self, op):
         if op.type == MaceKeyword.mace_buffer_transform:
             for arg in op.arg:
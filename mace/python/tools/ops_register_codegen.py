@@ -0,0 +1,103 @@
+# Copyright 2018 Xiaomi, Inc.  All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import argparse
+
+from jinja2 import Environment, FileSystemLoader
+
+from mace.proto import mace_pb2
+
+# bazel build //mace/python/tools:ops_register_codegen
+# ./bazel-bin/mace/python/tools/ops_register_codegen \
+#     --model_files=build/mobilenet/model/mobilenet_v1.pb \
+#     --device=cpu \
+#     --template_dir=mace/python/tools \
+#     --output_dir=mace/codegen/ops
+# then build the library with --define selective_ops=true.
+
+FLAGS = None
+
+DEVICE_NAMES = {0: 'CPU', 2: 'GPU', 3: 'HEXAGON'}
+
+# Registered in mace/ops only when built with OpenCL
+OPENCL_OP_TYPES = ['BufferInverseTransform', 'BufferTransform', 'LSTMCell']
+
+
+def get_arg(op, name):
+    for arg in op.arg:
+        if arg.name == name:
+            return arg
+    return None
+
+
+def collect_op_keys(net_def, default_device):
+    op_keys = set()
+    for op in net_def.op:
+        device_arg = get_arg(op, 'device')
+        device = device_arg.i if device_arg is not None else default_device
+        dtype_arg = get_arg(op, 'T')
+        dtype = dtype_arg.i if dtype_arg is not None else mace_pb2.DT_FLOAT
+        op_keys.add((op.type, DEVICE_NAMES[device],
+                     mace_pb2.DataType.Name(dtype)))
+    return op_keys
+
+
+def gen_ops_register(model_files, default_device, template_dir,
+                     output_dir):
+    op_keys = set()
+    for model_file in model_files:
+        net_def = mace_pb2.NetDef()
+        with open(model_file, "rb") as f:
+            net_def.ParseFromString(f.read())
+        op_keys |= collect_op_keys(net_def, default_device)
+    op_types = sorted(set([key[0] for key in op_keys]))
+
+    j2_env = Environment(
+        loader=FileSystemLoader(template_dir), trim_blocks=True)
+    source = j2_env.get_template('ops_register.cc.jinja2').render(
+        op_keys=sorted(op_keys),
+        op_types=[op_type for op_type in op_types
+                  if op_type not in OPENCL_OP_TYPES],
+        opencl_op_types=[op_type for op_type in op_types
+                         if op_type in OPENCL_OP_TYPES],
+    )
+    with open(output_dir + '/ops_register.cc', "wb") as f:
+        f.write(source)
+
+
+def parse_args():
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "--model_files",
+        type=str,
+        default="",
+        help="Comma-separated model graph files (.pb) to register the"
+             " operators of.")
+    parser.add_argument(
+        "--device",
+        type=str,
+        default="cpu",
+        help="cpu/gpu/dsp, the device of the ops without a device arg.")
+    parser.add_argument(
+        "--template_dir", type=str, default="", help="template path")
+    parser.add_argument(
+        "--output_dir", type=str, default="", help="output path")
+    return parser.parse_known_args()
+
+
+if __name__ == '__main__':
+    FLAGS, unparsed = parse_args()
+    device = {'cpu': 0, 'gpu': 2, 'dsp': 3}[FLAGS.device]
+    gen_ops_register(FLAGS.model_files.split(','), device,
+                     FLAGS.template_dir, FLAGS.output_dir)
@@ -12,12 +12,15 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <atomic>
 #include <fstream>
+#include <functional>
 #include <thread>  // NOLINT(build/c++11)
 
 #include "mace/core/operator.h"
 #include "mace/kernels/conv_pool_2d_util.h"
 #include "mace/ops/ops_test_util.h"
+#include "mace/utils/env_time.h"
 
 namespace mace {
 namespace test {
@@ -356,8 +359,311 @@ void MaceRunFunc(const int in_out_size) {
   CheckOutputs<DeviceType::GPU, half>(*net_def, inputs, outputs, data);
 }
 
+// Creates a CPU net running Conv2D and Relu on a {1, 16, 32, 32} input.
+std::shared_ptr<NetDef> CreateCPUConvNet(const std::string &input_name,
+                                         const std::string &output_name,
+                                         std::vector<float> *weights) {
+  const std::string filter_tensor_name = "filter";
+  const std::string conv_output_name = "conv_output";
+
+  const DeviceType device = DeviceType::CPU;
+
+  const std::vector<int64_t> filter_shape = {16, 16, 3, 3};
+
+  std::shared_ptr<NetDef> net_def(new NetDef());
+  MemoryBlock *mem_blk_ptr = net_def->mutable_mem_arena()->add_mem_block();
+  mem_blk_ptr->set_mem_id(0);
+  mem_blk_ptr->set_device_type(device);
+  mem_blk_ptr->set_mem_type(MemoryType::CPU_BUFFER);
+  mem_blk_ptr->set_x(1 * 16 * 32 * 32 * sizeof(float));
+  mem_blk_ptr->set_y(1);
+
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, weights);
+  AddTensor<float>(
+      filter_tensor_name, filter_shape, 0, weights->size(), net_def.get());
+
+  Conv3x3<float>(MakeString("mace_input_node_", input_name),
+                 filter_tensor_name, conv_output_name, {0}, device,
+                 net_def.get());
+  Relu<float>(conv_output_name,
+              MakeString("mace_output_node_", output_name),
+              device, net_def.get());
+  net_def->add_input_info()->set_name(input_name);
+  net_def->add_output_info()->set_name(output_name);
+  return net_def;
+}
+
+void MaceRunContextFunc(MaceEngine *engine,
+                        const std::map<std::string, mace::MaceTensor> &inputs,
+                        const std::map<std::string, mace::MaceTensor> &expected,
+                        const std::vector<int64_t> &output_shape) {
+  std::shared_ptr<ExecutionContext> context;
+  ASSERT_EQ(engine->CreateContext(&context), MaceStatus::MACE_SUCCESS);
+  const int64_t output_size =
+      std::accumulate(output_shape.begin(), output_shape.end(), 1,
+                      std::multiplies<int64_t>());
+  for (int i = 0; i < 5; ++i) {
+    std::map<std::string, mace::MaceTensor> outputs;
+    std::vector<std::string> output_names;
+    for (auto &output : expected) {
+      output_names.push_back(output.first);
+    }
+    GenerateOutputs(output_names, output_shape, &outputs);
+    ASSERT_EQ(engine->Run(context.get(), inputs, &outputs),
+              MaceStatus::MACE_SUCCESS);
+    for (auto &output : outputs) {
+      const float *data = output.second.data().get();
+      const float *expected_data = expected.at(output.first).data().get();
+      for (int64_t j = 0; j < output_size; ++j) {
+        EXPECT_NEAR(expected_data[j], data[j], 1e-5);
+      }
+    }
+  }
+}
+
 }  // namespace
 
+TEST_F(MaceMTAPITest, MultipleContexts) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> input_shape = {1, 16, 32, 32};
+  const std::vector<int64_t> output_shape = {1, 16, 32, 32};
+  const DeviceType device = DeviceType::CPU;
+
+  std::vector<float> data;
+  std::shared_ptr<NetDef> net_def =
+      CreateCPUConvNet(input_names[0], output_names[0], &data);
+
+  MaceEngineConfig config(device);
+  MaceEngine engine(config);
+  MaceStatus status = engine.Init(net_def.get(), input_names, output_names,
+      reinterpret_cast<unsigned char *>(data.data()));
+  ASSERT_EQ(status, MaceStatus::MACE_SUCCESS);
+
+  const int thread_num = 4;
+  std::vector<std::map<std::string, mace::MaceTensor>> inputs(thread_num);
+  std::vector<std::map<std::string, mace::MaceTensor>> expected(thread_num);
+  for (int i = 0; i < thread_num; ++i) {
+    GenerateInputs(input_names, input_shape, &inputs[i]);
+    GenerateOutputs(output_names, output_shape, &expected[i]);
+    ASSERT_EQ(engine.Run(inputs[i], &expected[i]), MaceStatus::MACE_SUCCESS);
+  }
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < thread_num; ++i) {
+    threads.push_back(std::thread(MaceRunContextFunc, &engine,
+                                  std::cref(inputs[i]), std::cref(expected[i]),
+                                  std::cref(output_shape)));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+TEST_F(MaceMTAPITest, MultipleContextsScaling) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> input_shape = {1, 16, 32, 32};
+  const std::vector<int64_t> output_shape = {1, 16, 32, 32};
+
+  std::vector<float> data;
+  std::shared_ptr<NetDef> net_def =
+      CreateCPUConvNet(input_names[0], output_names[0], &data);
+
+  MaceEngineConfig config(DeviceType::CPU);
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names,
+                        reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+
+  const int max_thread_num = 4;
+  std::vector<std::map<std::string, mace::MaceTensor>>
+      inputs(max_thread_num);
+  std::vector<std::map<std::string, mace::MaceTensor>>
+      expected(max_thread_num);
+  for (int i = 0; i < max_thread_num; ++i) {
+    GenerateInputs(input_names, input_shape, &inputs[i]);
+    GenerateOutputs(output_names, output_shape, &expected[i]);
+    ASSERT_EQ(engine.Run(inputs[i], &expected[i]), MaceStatus::MACE_SUCCESS);
+  }
+
+  // Each thread runs its context 5 times, the throughput should grow with
+  // the threads up to the number of cores.
+  for (int thread_num = 1; thread_num <= max_thread_num; thread_num *= 2) {
+    const int64_t start_micros = NowMicros();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_num; ++i) {
+      threads.push_back(std::thread(MaceRunContextFunc, &engine,
+                                    std::cref(inputs[i]),
+                                    std::cref(expected[i]),
+                                    std::cref(output_shape)));
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    const int64_t elapsed_micros = NowMicros() - start_micros;
+    LOG(INFO) << thread_num << " contexts: "
+              << thread_num * 5 * 1e6 / std::max<int64_t>(elapsed_micros, 1)
+              << " runs/s";
+  }
+}
+
+TEST_F(MaceMTAPITest, BatchingRun) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> input_shape = {1, 16, 32, 32};
+  const std::vector<int64_t> output_shape = {1, 16, 32, 32};
+
+  std::vector<float> data;
+  std::shared_ptr<NetDef> net_def =
+      CreateCPUConvNet(input_names[0], output_names[0], &data);
+
+  MaceEngineConfig config(DeviceType::CPU);
+  std::shared_ptr<MaceEngine> engine(new MaceEngine(config));
+  ASSERT_EQ(engine->Init(net_def.get(), input_names, output_names,
+                         reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+
+  const int thread_num = 8;
+  std::vector<std::map<std::string, mace::MaceTensor>> inputs(thread_num);
+  std::vector<std::map<std::string, mace::MaceTensor>> expected(thread_num);
+  for (int i = 0; i < thread_num; ++i) {
+    GenerateInputs(input_names, input_shape, &inputs[i]);
+    GenerateOutputs(output_names, output_shape, &expected[i]);
+    ASSERT_EQ(engine->Run(inputs[i], &expected[i]),
+              MaceStatus::MACE_SUCCESS);
+  }
+
+  BatchingEngine batching_engine(engine, 4, 1000);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < thread_num; ++i) {
+    threads.push_back(std::thread([&, i] {
+      std::map<std::string, mace::MaceTensor> outputs;
+      GenerateOutputs(output_names, output_shape, &outputs);
+      ASSERT_EQ(batching_engine.Run(inputs[i], &outputs),
+                MaceStatus::MACE_SUCCESS);
+      const int64_t size =
+          std::accumulate(output_shape.begin(), output_shape.end(), 1,
+                          std::multiplies<int64_t>());
+      const float *out = outputs[output_names[0]].data().get();
+      const float *ref = expected[i][output_names[0]].data().get();
+      for (int64_t j = 0; j < size; ++j) {
+        EXPECT_NEAR(ref[j], out[j], 1e-5);
+      }
+    }));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+TEST_F(MaceMTAPITest, RunAsync) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> shape = {1, 16, 32, 32};
+  const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                       std::multiplies<int64_t>());
+
+  std::vector<float> data;
+  std::shared_ptr<NetDef> net_def =
+      CreateCPUConvNet(input_names[0], output_names[0], &data);
+
+  MaceEngineConfig config(DeviceType::CPU);
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names,
+                        reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+
+  const int request_num = 8;
+  std::vector<std::map<std::string, mace::MaceTensor>> inputs(request_num);
+  std::vector<std::map<std::string, mace::MaceTensor>> expected(request_num);
+  std::vector<std::map<std::string, mace::MaceTensor>> outputs(request_num);
+  for (int i = 0; i < request_num; ++i) {
+    GenerateInputs(input_names, shape, &inputs[i]);
+    GenerateOutputs(output_names, shape, &expected[i]);
+    GenerateOutputs(output_names, shape, &outputs[i]);
+    ASSERT_EQ(engine.Run(inputs[i], &expected[i]),
+              MaceStatus::MACE_SUCCESS);
+  }
+
+  std::atomic<int> completed(0);
+  std::vector<std::future<MaceStatus>> futures(request_num);
+  for (int i = 0; i < request_num; ++i) {
+    ASSERT_EQ(engine.RunAsync(inputs[i], &outputs[i],
+                              [&completed](MaceStatus status) {
+                                EXPECT_EQ(status, MaceStatus::MACE_SUCCESS);
+                                ++completed;
+                              },
+                              &futures[i]),
+              MaceStatus::MACE_SUCCESS);
+  }
+  for (int i = 0; i < request_num; ++i) {
+    EXPECT_EQ(futures[i].get(), MaceStatus::MACE_SUCCESS);
+    const float *out = outputs[i][output_names[0]].data().get();
+    const float *ref = expected[i][output_names[0]].data().get();
+    for (int64_t j = 0; j < size; ++j) {
+      EXPECT_NEAR(ref[j], out[j], 1e-5);
+    }
+  }
+  EXPECT_EQ(request_num, completed.load());
+}
+
+TEST_F(MaceMTAPITest, RunAsyncPipeline) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> shape = {1, 16, 32, 32};
+  const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                       std::multiplies<int64_t>());
+
+  std::vector<float> data;
+  std::shared_ptr<NetDef> net_def =
+      CreateCPUConvNet(input_names[0], output_names[0], &data);
+
+  MaceEngineConfig config(DeviceType::CPU);
+  ASSERT_EQ(config.SetPipelineStages({{}, {}}), MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(config.SetPipelineStages({{0}, {-1}}),
+            MaceStatus::MACE_INVALID_ARGS);
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names,
+                        reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+  PipelineStats stats;
+  EXPECT_EQ(engine.GetPipelineStats(&stats), MaceStatus::MACE_INVALID_ARGS);
+
+  const int request_num = 8;
+  std::vector<std::map<std::string, mace::MaceTensor>> inputs(request_num);
+  std::vector<std::map<std::string, mace::MaceTensor>> expected(request_num);
+  std::vector<std::map<std::string, mace::MaceTensor>> outputs(request_num);
+  for (int i = 0; i < request_num; ++i) {
+    GenerateInputs(input_names, shape, &inputs[i]);
+    GenerateOutputs(output_names, shape, &expected[i]);
+    GenerateOutputs(output_names, shape, &outputs[i]);
+    ASSERT_EQ(engine.Run(inputs[i], &expected[i]),
+              MaceStatus::MACE_SUCCESS);
+  }
+
+  std::vector<std::future<MaceStatus>> futures(request_num);
+  for (int i = 0; i < request_num; ++i) {
+    ASSERT_EQ(engine.RunAsync(inputs[i], &outputs[i], nullptr, &futures[i]),
+              MaceStatus::MACE_SUCCESS);
+  }
+  for (int i = 0; i < request_num; ++i) {
+    EXPECT_EQ(futures[i].get(), MaceStatus::MACE_SUCCESS);
+    const float *out = outputs[i][output_names[0]].data().get();
+    const float *ref = expected[i][output_names[0]].data().get();
+    for (int64_t j = 0; j < size; ++j) {
+      EXPECT_NEAR(ref[j], out[j], 1e-5);
+    }
+  }
+  ASSERT_EQ(engine.GetPipelineStats(&stats), MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(request_num, stats.frames);
+  ASSERT_EQ(2u, stats.stages.size());
+  for (auto &stage : stats.stages) {
+    EXPECT_EQ(1, stage.num_ops);
+    EXPECT_LE(stage.busy_micros, stats.elapsed_micros);
+  }
+}
+
 TEST_F(MaceMTAPITest, MultipleThread) {
   const int thread_num = 10;
   std::vector<std::thread> threads;
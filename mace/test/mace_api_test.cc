@@ -13,8 +13,12 @@
 // limitations under the License.
 
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <thread>  // NOLINT(build/c++11)
 
+#include "mace/core/engine_snapshot.h"
 #include "mace/core/operator.h"
 #include "mace/kernels/conv_pool_2d_util.h"
 #include "mace/ops/ops_test_util.h"
@@ -358,6 +362,53 @@ void MaceRun(const int in_out_size,
   CheckOutputs<DeviceType::GPU, T>(*net_def, inputs, outputs, data);
 }
 
+// Runs the chunks of each call on threads of its own and the calling one
+class TestExecutor : public Executor {
+ public:
+  explicit TestExecutor(int num_threads)
+      : num_threads_(num_threads), num_runs_(0), max_num_chunks_(0) {}
+
+  int num_threads() const override {
+    return num_threads_;
+  }
+
+  void Run(int num_chunks,
+           const std::function<void(int)> &chunk_fn) override {
+    ++num_runs_;
+    int max_num_chunks = max_num_chunks_;
+    while (max_num_chunks < num_chunks
+        && !max_num_chunks_.compare_exchange_weak(max_num_chunks,
+                                                  num_chunks)) {}
+    std::atomic<int> next(0);
+    auto run_chunks = [&]() {
+      for (int i = next++; i < num_chunks; i = next++) {
+        chunk_fn(i);
+      }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < std::min(num_threads_, num_chunks); ++i) {
+      threads.emplace_back(run_chunks);
+    }
+    run_chunks();
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  int num_runs() const {
+    return num_runs_;
+  }
+
+  int max_num_chunks() const {
+    return max_num_chunks_;
+  }
+
+ private:
+  const int num_threads_;
+  std::atomic<int> num_runs_;
+  std::atomic<int> max_num_chunks_;
+};
+
 }  // namespace
 
 TEST_F(MaceAPITest, GPUSingleInputOutput) {
@@ -387,5 +438,629 @@ TEST_F(MaceAPITest, GPUVariableInputShape) {
                 {16, 16, 3, 3});
 }
 
+TEST_F(MaceAPITest, CPUIOBinding) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> shape = {1, 16, 32, 32};
+  const std::vector<int64_t> filter_shape = {16, 16, 3, 3};
+  const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                       std::multiplies<int64_t>());
+  // Bound buffers are padded for NEON kernels
+  const int64_t padded_size = size + 16;
+
+  std::shared_ptr<NetDef> net_def(new NetDef());
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+  AddTensor<float>("filter", filter_shape, 0, data.size(), net_def.get());
+  Conv3x3<float>(MakeString("mace_input_node_", input_names[0]), "filter",
+                 "conv_output", {}, DeviceType::CPU, net_def.get());
+  Relu<float>("conv_output", MakeString("mace_output_node_", output_names[0]),
+              DeviceType::CPU, net_def.get());
+  net_def->add_input_info()->set_name(input_names[0]);
+  net_def->add_output_info()->set_name(output_names[0]);
+
+  MaceEngineConfig config(DeviceType::CPU);
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names,
+                        reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+
+  int input_handle = -1;
+  int output_handle = -1;
+  ASSERT_EQ(engine.GetInputHandle(input_names[0], &input_handle),
+            MaceStatus::MACE_SUCCESS);
+  ASSERT_EQ(engine.GetOutputHandle(output_names[0], &output_handle),
+            MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(engine.GetInputHandle("unknown", &input_handle),
+            MaceStatus::MACE_INVALID_ARGS);
+
+  std::map<std::string, mace::MaceTensor> inputs;
+  std::map<std::string, mace::MaceTensor> expected;
+  GenerateInputs(input_names, shape, &inputs);
+  GenerateOutputs(output_names, shape, &expected);
+  ASSERT_EQ(engine.Run(inputs, &expected), MaceStatus::MACE_SUCCESS);
+  const float *expected_data = expected[output_names[0]].data().get();
+
+  // Bind user buffers
+  std::shared_ptr<float> input_data(new float[padded_size],
+                                    std::default_delete<float[]>());
+  std::shared_ptr<float> output_data(new float[padded_size],
+                                     std::default_delete<float[]>());
+  memcpy(input_data.get(), inputs[input_names[0]].data().get(),
+         size * sizeof(float));
+  ASSERT_EQ(engine.BindInput(input_handle, MaceTensor(shape, input_data)),
+            MaceStatus::MACE_SUCCESS);
+  ASSERT_EQ(engine.BindOutput(output_handle, MaceTensor(shape, output_data)),
+            MaceStatus::MACE_SUCCESS);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(engine.RunWithBindings(), MaceStatus::MACE_SUCCESS);
+    for (int64_t j = 0; j < size; ++j) {
+      EXPECT_NEAR(expected_data[j], output_data.get()[j], 1e-5);
+    }
+  }
+
+  // Write and read the buffers of the engine
+  float *engine_input = nullptr;
+  ASSERT_EQ(engine.GetInputBuffer(input_handle, shape, &engine_input),
+            MaceStatus::MACE_SUCCESS);
+  memcpy(engine_input, inputs[input_names[0]].data().get(),
+         size * sizeof(float));
+  memset(output_data.get(), 0, size * sizeof(float));
+  ASSERT_EQ(engine.RunWithBindings(), MaceStatus::MACE_SUCCESS);
+  std::vector<int64_t> output_shape;
+  const float *engine_output = nullptr;
+  ASSERT_EQ(engine.GetOutputBuffer(output_handle, &output_shape,
+                                   &engine_output),
+            MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(shape, output_shape);
+  EXPECT_EQ(output_data.get(), engine_output);
+  for (int64_t j = 0; j < size; ++j) {
+    EXPECT_NEAR(expected_data[j], engine_output[j], 1e-5);
+  }
+
+  // The map based Run drops the bindings
+  std::map<std::string, mace::MaceTensor> outputs;
+  GenerateOutputs(output_names, shape, &outputs);
+  memset(output_data.get(), 0, size * sizeof(float));
+  ASSERT_EQ(engine.Run(inputs, &outputs), MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(0.f, output_data.get()[0]);
+  for (int64_t j = 0; j < size; ++j) {
+    EXPECT_NEAR(expected_data[j], outputs[output_names[0]].data().get()[j],
+                1e-5);
+  }
+
+  // An output not fitting its bound buffer fails the run
+  ASSERT_EQ(engine.BindInput(input_handle, MaceTensor(shape, input_data)),
+            MaceStatus::MACE_SUCCESS);
+  std::shared_ptr<float> small_data(new float[size / 2 + 16],
+                                    std::default_delete<float[]>());
+  ASSERT_EQ(engine.BindOutput(output_handle,
+                              MaceTensor({1, 16, 16, 32}, small_data)),
+            MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(engine.RunWithBindings(), MaceStatus::MACE_INVALID_ARGS);
+  ASSERT_EQ(engine.BindOutput(output_handle,
+                              MaceTensor({1, 32, 32, 16}, output_data)),
+            MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(engine.RunWithBindings(), MaceStatus::MACE_INVALID_ARGS);
+
+  // The engine holds the bound data until the binding is dropped
+  std::weak_ptr<float> bound_output(output_data);
+  ASSERT_EQ(engine.BindOutput(output_handle, MaceTensor(shape, output_data)),
+            MaceStatus::MACE_SUCCESS);
+  output_data.reset();
+  ASSERT_EQ(engine.RunWithBindings(), MaceStatus::MACE_SUCCESS);
+  EXPECT_FALSE(bound_output.expired());
+  ASSERT_EQ(engine.Run(inputs, &outputs), MaceStatus::MACE_SUCCESS);
+  EXPECT_TRUE(bound_output.expired());
+}
+
+TEST_F(MaceAPITest, CPUMemoryPlanCache) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> filter_shape = {16, 16, 3, 3};
+  const std::vector<std::vector<int64_t>> shapes = {
+      {1, 16, 32, 32}, {1, 16, 24, 20}, {1, 16, 32, 32}, {1, 16, 40, 8},
+      {1, 16, 23, 19}, {1, 16, 24, 20}};
+
+  std::shared_ptr<NetDef> net_def(new NetDef());
+  MemoryBlock *mem_blk_ptr = net_def->mutable_mem_arena()->add_mem_block();
+  mem_blk_ptr->set_mem_id(0);
+  mem_blk_ptr->set_device_type(DeviceType::CPU);
+  mem_blk_ptr->set_mem_type(MemoryType::CPU_BUFFER);
+  mem_blk_ptr->set_x(1 * 16 * 32 * 32 * sizeof(float));
+  mem_blk_ptr->set_y(1);
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+  AddTensor<float>("filter", filter_shape, 0, data.size(), net_def.get());
+  Conv3x3<float>(MakeString("mace_input_node_", input_names[0]), "filter",
+                 "conv_output", {0}, DeviceType::CPU, net_def.get());
+  Relu<float>("conv_output", MakeString("mace_output_node_", output_names[0]),
+              DeviceType::CPU, net_def.get());
+  net_def->add_input_info()->set_name(input_names[0]);
+  net_def->add_output_info()->set_name(output_names[0]);
+
+  MaceEngineConfig config(DeviceType::CPU);
+  EXPECT_EQ(config.SetMemoryPlanCache(2, 0), MaceStatus::MACE_INVALID_ARGS);
+  ASSERT_EQ(config.SetMemoryPlanCache(2, 4), MaceStatus::MACE_SUCCESS);
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names,
+                        reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+  MaceEngineConfig ref_config(DeviceType::CPU);
+  MaceEngine ref_engine(ref_config);
+  ASSERT_EQ(ref_engine.Init(net_def.get(), input_names, output_names,
+                            reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+
+  for (auto &shape : shapes) {
+    std::map<std::string, mace::MaceTensor> inputs;
+    std::map<std::string, mace::MaceTensor> outputs;
+    std::map<std::string, mace::MaceTensor> expected;
+    GenerateInputs(input_names, shape, &inputs);
+    GenerateOutputs(output_names, shape, &outputs);
+    GenerateOutputs(output_names, shape, &expected);
+    ASSERT_EQ(engine.Run(inputs, &outputs), MaceStatus::MACE_SUCCESS);
+    ASSERT_EQ(ref_engine.Run(inputs, &expected), MaceStatus::MACE_SUCCESS);
+    const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                         std::multiplies<int64_t>());
+    const float *out = outputs[output_names[0]].data().get();
+    const float *ref = expected[output_names[0]].data().get();
+    for (int64_t j = 0; j < size; ++j) {
+      EXPECT_NEAR(ref[j], out[j], 1e-5);
+    }
+  }
+}
+
+TEST_F(MaceAPITest, CPUWeightPaging) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> shape = {1, 16, 32, 32};
+  const std::vector<int64_t> filter_shape = {16, 16, 3, 3};
+  const std::string data_file = "mace_api_weight_paging_test.data";
+
+  std::shared_ptr<NetDef> net_def(new NetDef());
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+  AddTensor<float>("filter", filter_shape, 0, data.size(), net_def.get());
+  Conv3x3<float>(MakeString("mace_input_node_", input_names[0]), "filter",
+                 "conv_output", {}, DeviceType::CPU, net_def.get());
+  Relu<float>("conv_output", MakeString("mace_output_node_", output_names[0]),
+              DeviceType::CPU, net_def.get());
+  net_def->add_input_info()->set_name(input_names[0]);
+  net_def->add_output_info()->set_name(output_names[0]);
+  {
+    std::ofstream out(data_file, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(data.data()),
+              data.size() * sizeof(float));
+  }
+
+  MaceEngineConfig config(DeviceType::CPU);
+  EXPECT_EQ(config.SetWeightPaging(-1), MaceStatus::MACE_INVALID_ARGS);
+  ASSERT_EQ(config.SetWeightPaging(1, {"Conv2dOp"}, {"Conv2dOp"}),
+            MaceStatus::MACE_SUCCESS);
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names, data_file),
+            MaceStatus::MACE_SUCCESS);
+  MaceEngineConfig ref_config(DeviceType::CPU);
+  MaceEngine ref_engine(ref_config);
+  ASSERT_EQ(ref_engine.Init(net_def.get(), input_names, output_names,
+                            reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+
+  for (int i = 0; i < 2; ++i) {
+    std::map<std::string, mace::MaceTensor> inputs;
+    std::map<std::string, mace::MaceTensor> outputs;
+    std::map<std::string, mace::MaceTensor> expected;
+    GenerateInputs(input_names, shape, &inputs);
+    GenerateOutputs(output_names, shape, &outputs);
+    GenerateOutputs(output_names, shape, &expected);
+    RunMetadata run_metadata;
+    ASSERT_EQ(engine.Run(inputs, &outputs, &run_metadata),
+              MaceStatus::MACE_SUCCESS);
+    ASSERT_EQ(ref_engine.Run(inputs, &expected), MaceStatus::MACE_SUCCESS);
+    ASSERT_EQ(2u, run_metadata.op_stats.size());
+    for (auto &op_stats : run_metadata.op_stats) {
+      EXPECT_GE(op_stats.page_faults.minor, 0);
+      EXPECT_GE(op_stats.page_faults.major, 0);
+    }
+    const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                         std::multiplies<int64_t>());
+    const float *out = outputs[output_names[0]].data().get();
+    const float *ref = expected[output_names[0]].data().get();
+    for (int64_t j = 0; j < size; ++j) {
+      EXPECT_NEAR(ref[j], out[j], 1e-5);
+    }
+  }
+  remove(data_file.c_str());
+}
+
+TEST_F(MaceAPITest, CPUEngineSnapshot) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> shape = {1, 16, 32, 32};
+  const std::vector<int64_t> filter_shape = {16, 16, 3, 3};
+
+  std::shared_ptr<NetDef> net_def(new NetDef());
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+  AddTensor<float>("filter", filter_shape, 0, data.size(), net_def.get());
+  Conv3x3<float>(MakeString("mace_input_node_", input_names[0]), "filter",
+                 "conv_output", {}, DeviceType::CPU, net_def.get());
+  Relu<float>("conv_output", MakeString("mace_output_node_", output_names[0]),
+              DeviceType::CPU, net_def.get());
+  net_def->add_input_info()->set_name(input_names[0]);
+  net_def->add_output_info()->set_name(output_names[0]);
+  const unsigned char *model_data =
+      reinterpret_cast<const unsigned char *>(data.data());
+  const std::string snapshot_file =
+      MakeString("./mace_engine_", ModelChecksum(*net_def, model_data));
+
+  std::map<std::string, mace::MaceTensor> inputs;
+  std::map<std::string, mace::MaceTensor> expected;
+  GenerateInputs(input_names, shape, &inputs);
+  GenerateOutputs(output_names, shape, &expected);
+  {
+    MaceEngineConfig config(DeviceType::CPU);
+    MaceEngine engine(config);
+    ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names,
+                          model_data),
+              MaceStatus::MACE_SUCCESS);
+    // No snapshot path
+    EXPECT_EQ(engine.SaveSnapshot(), MaceStatus::MACE_INVALID_ARGS);
+    ASSERT_EQ(engine.Run(inputs, &expected), MaceStatus::MACE_SUCCESS);
+  }
+  {
+    MaceEngineConfig config(DeviceType::CPU);
+    ASSERT_EQ(config.SetSnapshotPath("."), MaceStatus::MACE_SUCCESS);
+    MaceEngine engine(config);
+    ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names,
+                          model_data),
+              MaceStatus::MACE_SUCCESS);
+    ASSERT_EQ(engine.SaveSnapshot(), MaceStatus::MACE_SUCCESS);
+  }
+
+  MaceEngineConfig config(DeviceType::CPU);
+  ASSERT_EQ(config.SetSnapshotPath("."), MaceStatus::MACE_SUCCESS);
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names, model_data),
+            MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(engine.SaveSnapshot(), MaceStatus::MACE_SUCCESS);
+  // The engine reads the weights of the snapshot, not those passed to Init
+  std::fill(data.begin(), data.end(), 0.f);
+  for (int i = 0; i < 2; ++i) {
+    std::map<std::string, mace::MaceTensor> outputs;
+    GenerateOutputs(output_names, shape, &outputs);
+    ASSERT_EQ(engine.Run(inputs, &outputs), MaceStatus::MACE_SUCCESS);
+    const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                         std::multiplies<int64_t>());
+    const float *out = outputs[output_names[0]].data().get();
+    const float *ref = expected[output_names[0]].data().get();
+    for (int64_t j = 0; j < size; ++j) {
+      EXPECT_NEAR(ref[j], out[j], 1e-5);
+    }
+  }
+  EXPECT_EQ(0, remove(snapshot_file.c_str()));
+}
+
+TEST_F(MaceAPITest, CPUInitStats) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> filter_shape = {16, 16, 3, 3};
+
+  std::shared_ptr<NetDef> net_def(new NetDef());
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+  AddTensor<float>("filter", filter_shape, 0, data.size(), net_def.get());
+  Conv3x3<float>(MakeString("mace_input_node_", input_names[0]), "filter",
+                 "conv_output", {}, DeviceType::CPU, net_def.get());
+  Relu<float>("conv_output", MakeString("mace_output_node_", output_names[0]),
+              DeviceType::CPU, net_def.get());
+  net_def->add_input_info()->set_name(input_names[0]);
+  net_def->add_output_info()->set_name(output_names[0]);
+
+  MaceEngineConfig config(DeviceType::CPU);
+  MaceEngine engine(config);
+  InitStats stats;
+  EXPECT_EQ(engine.GetInitStats(&stats), MaceStatus::MACE_INVALID_ARGS);
+  ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names,
+                        reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+  ASSERT_EQ(engine.GetInitStats(&stats), MaceStatus::MACE_SUCCESS);
+  for (int64_t micros : {stats.optimize_graph_micros,
+                         stats.load_tensors_micros, stats.init_net_micros,
+                         stats.create_operators_micros}) {
+    EXPECT_GE(micros, 0);
+  }
+  EXPECT_GE(stats.total_micros,
+            stats.optimize_graph_micros + stats.load_tensors_micros
+                + stats.init_net_micros + stats.create_operators_micros);
+}
+
+TEST_F(MaceAPITest, CPUExecutor) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> shape = {1, 16, 32, 32};
+  const std::vector<int64_t> filter_shape = {16, 16, 3, 3};
+
+  std::shared_ptr<NetDef> net_def(new NetDef());
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+  AddTensor<float>("filter", filter_shape, 0, data.size(), net_def.get());
+  Conv3x3<float>(MakeString("mace_input_node_", input_names[0]), "filter",
+                 "conv_output", {}, DeviceType::CPU, net_def.get());
+  Relu<float>("conv_output", MakeString("mace_output_node_", output_names[0]),
+              DeviceType::CPU, net_def.get());
+  net_def->add_input_info()->set_name(input_names[0]);
+  net_def->add_output_info()->set_name(output_names[0]);
+
+  MaceEngineConfig ref_config(DeviceType::CPU);
+  ASSERT_EQ(ref_config.SetCPUThreadPolicy(4, AFFINITY_NONE),
+            MaceStatus::MACE_SUCCESS);
+  MaceEngine ref_engine(ref_config);
+  ASSERT_EQ(ref_engine.Init(net_def.get(), input_names, output_names,
+                            reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+  std::map<std::string, mace::MaceTensor> inputs;
+  std::map<std::string, mace::MaceTensor> expected;
+  GenerateInputs(input_names, shape, &inputs);
+  GenerateOutputs(output_names, shape, &expected);
+  ASSERT_EQ(ref_engine.Run(inputs, &expected), MaceStatus::MACE_SUCCESS);
+
+  MaceEngineConfig config(DeviceType::CPU);
+  EXPECT_EQ(config.SetExecutor(std::make_shared<TestExecutor>(0)),
+            MaceStatus::MACE_INVALID_ARGS);
+  // One thread runs all inline, more split the loops in more chunks
+  for (int num_threads : {1, 2, 4}) {
+    auto executor = std::make_shared<TestExecutor>(num_threads);
+    ASSERT_EQ(config.SetExecutor(executor), MaceStatus::MACE_SUCCESS);
+    MaceEngine engine(config);
+    ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names,
+                          reinterpret_cast<unsigned char *>(data.data())),
+              MaceStatus::MACE_SUCCESS);
+    std::map<std::string, mace::MaceTensor> outputs;
+    GenerateOutputs(output_names, shape, &outputs);
+    ASSERT_EQ(engine.Run(inputs, &outputs), MaceStatus::MACE_SUCCESS);
+    if (num_threads == 1) {
+      EXPECT_EQ(0, executor->num_runs());
+    } else {
+      EXPECT_GT(executor->num_runs(), 0);
+      EXPECT_GE(executor->max_num_chunks(), num_threads);
+    }
+
+    const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                         std::multiplies<int64_t>());
+    const float *out = outputs[output_names[0]].data().get();
+    const float *ref = expected[output_names[0]].data().get();
+    for (int64_t j = 0; j < size; ++j) {
+      EXPECT_NEAR(ref[j], out[j], 1e-5);
+    }
+  }
+}
+
+TEST_F(MaceAPITest, CPUContextExecutor) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> shape = {1, 16, 32, 32};
+  const std::vector<int64_t> filter_shape = {16, 16, 3, 3};
+
+  std::shared_ptr<NetDef> net_def(new NetDef());
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+  AddTensor<float>("filter", filter_shape, 0, data.size(), net_def.get());
+  Conv3x3<float>(MakeString("mace_input_node_", input_names[0]), "filter",
+                 "conv_output", {}, DeviceType::CPU, net_def.get());
+  Relu<float>("conv_output", MakeString("mace_output_node_", output_names[0]),
+              DeviceType::CPU, net_def.get());
+  net_def->add_input_info()->set_name(input_names[0]);
+  net_def->add_output_info()->set_name(output_names[0]);
+
+  MaceEngineConfig config(DeviceType::CPU);
+  auto executor = std::make_shared<TestExecutor>(4);
+  ASSERT_EQ(config.SetExecutor(executor), MaceStatus::MACE_SUCCESS);
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names,
+                        reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+  std::map<std::string, mace::MaceTensor> inputs;
+  std::map<std::string, mace::MaceTensor> expected;
+  GenerateInputs(input_names, shape, &inputs);
+  GenerateOutputs(output_names, shape, &expected);
+  ASSERT_EQ(engine.Run(inputs, &expected), MaceStatus::MACE_SUCCESS);
+
+  // The context's device runs on the executor of the config as well
+  std::shared_ptr<ExecutionContext> context;
+  ASSERT_EQ(engine.CreateContext(&context), MaceStatus::MACE_SUCCESS);
+  const int num_engine_runs = executor->num_runs();
+  std::map<std::string, mace::MaceTensor> outputs;
+  GenerateOutputs(output_names, shape, &outputs);
+  ASSERT_EQ(engine.Run(context.get(), inputs, &outputs),
+            MaceStatus::MACE_SUCCESS);
+  EXPECT_GT(executor->num_runs(), num_engine_runs);
+
+  const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                       std::multiplies<int64_t>());
+  const float *out = outputs[output_names[0]].data().get();
+  const float *ref = expected[output_names[0]].data().get();
+  for (int64_t j = 0; j < size; ++j) {
+    EXPECT_NEAR(ref[j], out[j], 1e-5);
+  }
+}
+
+TEST_F(MaceAPITest, CPURunOptions) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> shape = {1, 16, 32, 32};
+  const std::vector<int64_t> filter_shape = {16, 16, 3, 3};
+
+  std::shared_ptr<NetDef> net_def(new NetDef());
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+  AddTensor<float>("filter", filter_shape, 0, data.size(), net_def.get());
+  Conv3x3<float>(MakeString("mace_input_node_", input_names[0]), "filter",
+                 "conv_output", {}, DeviceType::CPU, net_def.get());
+  Relu<float>("conv_output", MakeString("mace_output_node_", output_names[0]),
+              DeviceType::CPU, net_def.get());
+  net_def->add_input_info()->set_name(input_names[0]);
+  net_def->add_output_info()->set_name(output_names[0]);
+
+  MaceEngineConfig config(DeviceType::CPU);
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names,
+                        reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+  std::map<std::string, mace::MaceTensor> inputs;
+  std::map<std::string, mace::MaceTensor> expected;
+  std::map<std::string, mace::MaceTensor> outputs;
+  GenerateInputs(input_names, shape, &inputs);
+  GenerateOutputs(output_names, shape, &expected);
+  GenerateOutputs(output_names, shape, &outputs);
+  ASSERT_EQ(engine.Run(inputs, &expected), MaceStatus::MACE_SUCCESS);
+
+  CancellationToken token;
+  RunOptions options;
+  options.cancellation_token = &token;
+  options.deadline = std::chrono::steady_clock::now() + std::chrono::hours(1);
+  options.priority = RUN_PRIORITY_LOW;
+  ASSERT_EQ(engine.Run(inputs, &outputs, options), MaceStatus::MACE_SUCCESS);
+  const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                       std::multiplies<int64_t>());
+  const float *out = outputs[output_names[0]].data().get();
+  const float *ref = expected[output_names[0]].data().get();
+  for (int64_t j = 0; j < size; ++j) {
+    EXPECT_NEAR(ref[j], out[j], 1e-5);
+  }
+
+  token.Cancel();
+  EXPECT_TRUE(token.IsCancelled());
+  EXPECT_EQ(engine.Run(inputs, &outputs, options),
+            MaceStatus::MACE_CANCELLED);
+
+  RunOptions past_deadline;
+  past_deadline.deadline = std::chrono::steady_clock::now();
+  EXPECT_EQ(engine.Run(inputs, &outputs, past_deadline),
+            MaceStatus::MACE_CANCELLED);
+
+  RunOptions invalid_priority;
+  invalid_priority.priority = static_cast<RunPriority>(RUN_PRIORITY_HIGH + 1);
+  EXPECT_EQ(engine.Run(inputs, &outputs, invalid_priority),
+            MaceStatus::MACE_INVALID_ARGS);
+
+  // Cancelling a run does not affect the next ones
+  ASSERT_EQ(engine.Run(inputs, &outputs, RunOptions()),
+            MaceStatus::MACE_SUCCESS);
+  for (int64_t j = 0; j < size; ++j) {
+    EXPECT_NEAR(ref[j], out[j], 1e-5);
+  }
+}
+
+TEST_F(MaceAPITest, CPUCancelRunningMatMul) {
+  // A single operator taking seconds, which stops between its blocks
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> shape = {1, 512, 2048};
+  const std::vector<int64_t> weight_shape = {1, 2048, 2048};
+
+  std::shared_ptr<NetDef> net_def(new NetDef());
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(weight_shape, &data);
+  AddTensor<float>("weight", weight_shape, 0, data.size(), net_def.get());
+  OperatorDef *op_def = net_def->add_op();
+  ops::test::OpDefBuilder("MatMul", "MatMulTest")
+      .Input(MakeString("mace_input_node_", input_names[0]))
+      .Input("weight")
+      .Output(MakeString("mace_output_node_", output_names[0]))
+      .AddIntArg("T", static_cast<int>(DT_FLOAT))
+      .AddIntArg("device", static_cast<int>(DeviceType::CPU))
+      .Finalize(op_def);
+  net_def->add_input_info()->set_name(input_names[0]);
+  net_def->add_output_info()->set_name(output_names[0]);
+
+  MaceEngineConfig config(DeviceType::CPU);
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names,
+                        reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+  std::map<std::string, mace::MaceTensor> inputs;
+  std::map<std::string, mace::MaceTensor> outputs;
+  GenerateInputs(input_names, shape, &inputs);
+  GenerateOutputs(output_names, shape, &outputs);
+
+  CancellationToken token;
+  RunOptions options;
+  options.cancellation_token = &token;
+  std::thread cancel_thread([&token]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    token.Cancel();
+  });
+  EXPECT_EQ(engine.Run(inputs, &outputs, options),
+            MaceStatus::MACE_CANCELLED);
+  cancel_thread.join();
+}
+
+TEST_F(MaceAPITest, CPURunStep) {
+  const std::vector<std::string> input_names = {"input0"};
+  const std::vector<std::string> output_names = {"output0"};
+  const std::vector<int64_t> shape = {1, 16, 32, 32};
+  const std::vector<int64_t> filter_shape = {16, 16, 3, 3};
+
+  std::shared_ptr<NetDef> net_def(new NetDef());
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+  AddTensor<float>("filter", filter_shape, 0, data.size(), net_def.get());
+  Conv3x3<float>(MakeString("mace_input_node_", input_names[0]), "filter",
+                 "conv_output", {}, DeviceType::CPU, net_def.get());
+  Relu<float>("conv_output", MakeString("mace_output_node_", output_names[0]),
+              DeviceType::CPU, net_def.get());
+  net_def->add_input_info()->set_name(input_names[0]);
+  net_def->add_output_info()->set_name(output_names[0]);
+
+  MaceEngineConfig config(DeviceType::CPU);
+  MaceEngine engine(config);
+  std::map<std::string, mace::MaceTensor> inputs;
+  std::map<std::string, mace::MaceTensor> expected;
+  std::map<std::string, mace::MaceTensor> outputs;
+  GenerateInputs(input_names, shape, &inputs);
+  GenerateOutputs(output_names, shape, &expected);
+  GenerateOutputs(output_names, shape, &outputs);
+  std::shared_ptr<RunHandle> handle;
+  EXPECT_EQ(engine.StartRun(inputs, &outputs, &handle),
+            MaceStatus::MACE_INVALID_ARGS);
+  ASSERT_EQ(engine.Init(net_def.get(), input_names, output_names,
+                        reinterpret_cast<unsigned char *>(data.data())),
+            MaceStatus::MACE_SUCCESS);
+  ASSERT_EQ(engine.Run(inputs, &expected), MaceStatus::MACE_SUCCESS);
+
+  // Without budget, a step runs one operator
+  ASSERT_EQ(engine.StartRun(inputs, &outputs, &handle),
+            MaceStatus::MACE_SUCCESS);
+  bool done = true;
+  ASSERT_EQ(engine.RunStep(handle.get(), 0, &done), MaceStatus::MACE_SUCCESS);
+  EXPECT_FALSE(done);
+  ASSERT_EQ(engine.RunStep(handle.get(), 0, &done), MaceStatus::MACE_SUCCESS);
+  EXPECT_TRUE(done);
+  const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                       std::multiplies<int64_t>());
+  const float *out = outputs[output_names[0]].data().get();
+  const float *ref = expected[output_names[0]].data().get();
+  for (int64_t j = 0; j < size; ++j) {
+    EXPECT_NEAR(ref[j], out[j], 1e-5);
+  }
+  ASSERT_EQ(engine.RunStep(handle.get(), 0, &done), MaceStatus::MACE_SUCCESS);
+  EXPECT_TRUE(done);
+
+  ASSERT_EQ(engine.StartRun(inputs, &outputs, &handle),
+            MaceStatus::MACE_SUCCESS);
+  ASSERT_EQ(engine.RunStep(handle.get(), 1000 * 1000 * 1000, &done),
+            MaceStatus::MACE_SUCCESS);
+  EXPECT_TRUE(done);
+
+  // Another run in the workspace of the engine discards the run in steps
+  ASSERT_EQ(engine.StartRun(inputs, &outputs, &handle),
+            MaceStatus::MACE_SUCCESS);
+  ASSERT_EQ(engine.Run(inputs, &expected), MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(engine.RunStep(handle.get(), 0, &done),
+            MaceStatus::MACE_INVALID_ARGS);
+}
+
 }  // namespace test
 }  // namespace mace
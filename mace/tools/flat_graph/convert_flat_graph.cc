@@ -0,0 +1,83 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Usage:
+ * convert_flat_graph --model_file=mobi_mace.pb \
+ *          --output_file=mobi_mace.flat
+ *
+ * The flat graph is loaded by CreateMaceEngineFromFlatGraph with the same
+ * model data file as the pb.
+ */
+#include <fstream>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "mace/core/flat_graph.h"
+#include "mace/utils/logging.h"
+#include "mace/utils/utils.h"
+
+DEFINE_string(model_file, "", "model graph pb file path");
+DEFINE_string(output_file, "", "flat graph file path");
+
+namespace mace {
+namespace tools {
+namespace flat_graph {
+
+int Main(int argc, char **argv) {
+  gflags::SetUsageMessage("convert a model pb to the flat graph format");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_model_file.empty() || FLAGS_output_file.empty()) {
+    LOG(ERROR) << "model_file and output_file are required";
+    return -1;
+  }
+
+  std::vector<unsigned char> model_pb;
+  if (!ReadBinaryFile(&model_pb, FLAGS_model_file)) {
+    LOG(ERROR) << "Failed to read " << FLAGS_model_file;
+    return -1;
+  }
+  NetDef net_def;
+  if (!net_def.ParseFromArray(model_pb.data(), model_pb.size())) {
+    LOG(ERROR) << "Failed to parse " << FLAGS_model_file;
+    return -1;
+  }
+
+  std::vector<unsigned char> data;
+  if (SerializeFlatGraph(net_def, &data) != MaceStatus::MACE_SUCCESS) {
+    return -1;
+  }
+  // Checks the output can be loaded
+  FlatGraph graph;
+  MACE_CHECK(graph.Open(data.data(), data.size()) == MACE_SUCCESS);
+
+  std::ofstream out(FLAGS_output_file, std::ios::out | std::ios::binary);
+  out.write(reinterpret_cast<const char *>(data.data()), data.size());
+  out.close();
+  if (!out) {
+    LOG(ERROR) << "Failed to write " << FLAGS_output_file;
+    return -1;
+  }
+  LOG(INFO) << "Converted " << net_def.op_size() << " ops, "
+            << model_pb.size() << " bytes to " << data.size() << " bytes";
+  return 0;
+}
+
+}  // namespace flat_graph
+}  // namespace tools
+}  // namespace mace
+
+int main(int argc, char **argv) {
+  return mace::tools::flat_graph::Main(argc, argv);
+}
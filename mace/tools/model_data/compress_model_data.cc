@@ -0,0 +1,106 @@
+// Copyright 2018 Xiaomi, Inc.  All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Usage:
+ * compress_model_data --model_file=mobi_mace.pb \
+ *          --model_data_file=mobi_mace.data \
+ *          --output_file=mobi_mace.data.lz
+ *
+ * The compressed file replaces the model data file as is: the engine
+ * detects it and decompresses it when loading the model.
+ */
+#include <cstring>
+#include <fstream>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "mace/core/compressed_model_data.h"
+#include "mace/core/runtime/cpu/thread_pool.h"
+#include "mace/utils/logging.h"
+#include "mace/utils/utils.h"
+
+DEFINE_string(model_file, "", "model graph pb file path");
+DEFINE_string(model_data_file, "", "model data file path");
+DEFINE_string(output_file, "", "compressed model data file path");
+DEFINE_int64(block_size, mace::kDefaultCompressedBlockSize,
+             "max bytes of a block, which are decompressed in parallel");
+
+namespace mace {
+namespace tools {
+namespace model_data {
+
+int Main(int argc, char **argv) {
+  gflags::SetUsageMessage("compress a model data file in blocks");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_model_file.empty() || FLAGS_model_data_file.empty()
+      || FLAGS_output_file.empty()) {
+    LOG(ERROR) << "model_file, model_data_file and output_file are required";
+    return -1;
+  }
+
+  std::vector<unsigned char> model_pb;
+  if (!ReadBinaryFile(&model_pb, FLAGS_model_file)) {
+    LOG(ERROR) << "Failed to read " << FLAGS_model_file;
+    return -1;
+  }
+  NetDef net_def;
+  if (!net_def.ParseFromArray(model_pb.data(), model_pb.size())) {
+    LOG(ERROR) << "Failed to parse " << FLAGS_model_file;
+    return -1;
+  }
+  std::vector<unsigned char> model_data;
+  if (!ReadBinaryFile(&model_data, FLAGS_model_data_file)) {
+    LOG(ERROR) << "Failed to read " << FLAGS_model_data_file;
+    return -1;
+  }
+
+  // Compresses and checks the blocks on all the cores
+  ThreadPool thread_pool(std::thread::hardware_concurrency(), {});
+  ThreadPoolGuard thread_pool_guard(&thread_pool);
+  std::vector<unsigned char> data;
+  if (CompressModelData(net_def, model_data.data(), model_data.size(),
+                        FLAGS_block_size, &data)
+      != MaceStatus::MACE_SUCCESS) {
+    return -1;
+  }
+  // Checks the output decompresses to the model data
+  std::vector<unsigned char> decompressed(
+      DecompressedModelDataSize(data.data(), data.size()));
+  MACE_CHECK(decompressed.size() == model_data.size()
+                 && DecompressModelData(data.data(), data.size(),
+                                        decompressed.data()) == MACE_SUCCESS
+                 && memcmp(decompressed.data(), model_data.data(),
+                           model_data.size()) == 0);
+
+  std::ofstream out(FLAGS_output_file, std::ios::out | std::ios::binary);
+  out.write(reinterpret_cast<const char *>(data.data()), data.size());
+  out.close();
+  if (!out) {
+    LOG(ERROR) << "Failed to write " << FLAGS_output_file;
+    return -1;
+  }
+  LOG(INFO) << "Compressed " << model_data.size() << " bytes to "
+            << data.size() << " bytes";
+  return 0;
+}
+
+}  // namespace model_data
+}  // namespace tools
+}  // namespace mace
+
+int main(int argc, char **argv) {
+  return mace::tools::model_data::Main(argc, argv);
+}
@@ -15,6 +15,8 @@
 #ifndef MACE_UTILS_UTILS_H_
 #define MACE_UTILS_UTILS_H_
 
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <map>
 #include <sstream>
@@ -70,6 +72,23 @@ Integer CeilQuotient(Integer a, Integer b) {
   return (a + b - 1) / b;
 }
 
+// A fast non-cryptographic hash of the bytes, continuing from hash
+inline uint64_t Hash64(const unsigned char *data, size_t size, uint64_t hash) {
+  const uint64_t kMul = 0x9E3779B97F4A7C15ULL;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * kMul;
+    hash ^= hash >> 29;
+  }
+  for (; i < size; ++i) {
+    hash = (hash ^ data[i]) * kMul;
+    hash ^= hash >> 29;
+  }
+  return hash;
+}
+
 inline std::string ObfuscateString(const std::string &src,
                                    const std::string &lookup_table) {
   std::string dest;